@@ -0,0 +1,206 @@
+// afpacket_capture.cpp - AF_PACKET TPACKET_V3 抓包后端实现
+#include "afpacket_capture.h"
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// ==================== AfPacketBlock 实现 ====================
+
+AfPacketBlock::AfPacketBlock(struct tpacket_block_desc* desc)
+    : desc_(desc),
+      remaining_(desc->hdr.bh1.num_pkts),
+      next_(reinterpret_cast<uint8_t*>(desc) + desc->hdr.bh1.offset_to_first_pkt) {}
+
+uint32_t AfPacketBlock::frame_count() const {
+    return desc_ != NULL ? desc_->hdr.bh1.num_pkts : 0;
+}
+
+// ==================== AfPacketCapture 实现 ====================
+
+AfPacketCapture::AfPacketCapture()
+    : fd_(-1), ring_(NULL), ring_size_(0), block_size_(0), block_count_(0), current_(0) {}
+
+AfPacketCapture::~AfPacketCapture() {
+    close();
+}
+
+bool AfPacketCapture::fail(const std::string& what) {
+    error_ = what + ": " + strerror(errno);
+    close();
+    return false;
+}
+
+bool AfPacketCapture::open(const std::string& interface_name, size_t block_size,
+                           size_t block_count, bool promiscuous, bool ip_only) {
+    close();
+
+    unsigned int ifindex = if_nametoindex(interface_name.c_str());
+    if (ifindex == 0) {
+        return fail("找不到网卡 " + interface_name);
+    }
+
+    // 协议号为0的套接字在bind()之前不接收任何帧；若创建时就指定ETH_P_ALL，挂载过滤器和
+    // 建立块环之前就会收到所有网卡的帧，第一个块中混入其他网卡和未经过滤的流量。
+    // 因此先挂载过滤器、建立块环，最后bind()到指定网卡时才给出ETH_P_ALL
+    fd_ = socket(AF_PACKET, SOCK_RAW, 0);
+    if (fd_ < 0) {
+        return fail("创建AF_PACKET套接字失败");
+    }
+
+    int version = TPACKET_V3;
+    if (setsockopt(fd_, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+        return fail("设置TPACKET_V3失败");
+    }
+
+    // 在内核中丢弃不需要的帧：优先使用用户指定的BPF程序，
+    // 否则只保留IPv4/IPv6帧和带VLAN标签（802.1Q、802.1ad及旧的QinQ类型0x9100）的帧，
+    // 相当于libpcap的"ip or ip6 or vlan"（网卡剥离了VLAN标签时，BPF看到的是内层以太网类型）
+    if (!filter_.empty()) {
+        struct sock_fprog program;
+        program.len = static_cast<unsigned short>(filter_.size());
+        program.filter = filter_.data();
+        if (setsockopt(fd_, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program)) < 0) {
+            return fail("挂载BPF过滤器失败");
+        }
+    } else if (ip_only) {
+        static struct sock_filter ip_filter[] = {
+            { 0x28, 0, 0, 0x0000000c },   // ldh [12]
+            { 0x15, 5, 0, 0x00000800 },   // jeq #0x800 -> 接收
+            { 0x15, 4, 0, 0x000086dd },   // jeq #0x86dd -> 接收
+            { 0x15, 3, 0, 0x00008100 },   // jeq #0x8100 -> 接收
+            { 0x15, 2, 0, 0x000088a8 },   // jeq #0x88a8 -> 接收
+            { 0x15, 1, 0, 0x00009100 },   // jeq #0x9100 -> 接收
+            { 0x06, 0, 0, 0x00000000 },   // 丢弃
+            { 0x06, 0, 0, 0x00040000 },   // 接收
+        };
+        struct sock_fprog program;
+        program.len = sizeof(ip_filter) / sizeof(ip_filter[0]);
+        program.filter = ip_filter;
+        if (setsockopt(fd_, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program)) < 0) {
+            return fail("挂载BPF过滤器失败");
+        }
+    }
+
+    // 在每帧之前预留4字节，供重新插入内核剥离的VLAN标签（须在建立块环之前设置）
+    unsigned int reserve = AFPACKET_VLAN_TAG_LEN;
+    if (setsockopt(fd_, SOL_PACKET, PACKET_RESERVE, &reserve, sizeof(reserve)) < 0) {
+        return fail("设置帧前预留空间失败");
+    }
+
+    struct tpacket_req3 req;
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = block_size;
+    req.tp_block_nr = block_count;
+    req.tp_frame_size = DEFAULT_FRAME_SIZE;
+    req.tp_frame_nr = (block_size * block_count) / DEFAULT_FRAME_SIZE;
+    req.tp_retire_blk_tov = DEFAULT_BLOCK_TIMEOUT_MS;
+    req.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
+    if (setsockopt(fd_, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+        return fail("建立接收块环失败");
+    }
+
+    ring_size_ = block_size * block_count;
+    void* ring = mmap(NULL, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, fd_, 0);
+    if (ring == MAP_FAILED) {
+        // 锁定内存失败（如RLIMIT_MEMLOCK过小）时退回普通映射
+        ring = mmap(NULL, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (ring == MAP_FAILED) {
+            ring_size_ = 0;
+            return fail("映射块环失败");
+        }
+    }
+    ring_ = static_cast<uint8_t*>(ring);
+    block_size_ = block_size;
+    block_count_ = block_count;
+    current_ = 0;
+
+    // 从这里开始接收：过滤器和块环都已就绪，只有本网卡、通过过滤器的帧进入块环
+    struct sockaddr_ll addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex = ifindex;
+    if (bind(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        return fail("绑定网卡失败");
+    }
+
+    if (promiscuous) {
+        struct packet_mreq mreq;
+        memset(&mreq, 0, sizeof(mreq));
+        mreq.mr_ifindex = ifindex;
+        mreq.mr_type = PACKET_MR_PROMISC;
+        if (setsockopt(fd_, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+            return fail("开启混杂模式失败");
+        }
+    }
+
+    error_.clear();
+    return true;
+}
+
+bool AfPacketCapture::join_fanout(uint16_t group_id) {
+    // 低16位为组号，高16位为分发模式；DEFRAG让内核先重组IP分片再计算哈希
+    int fanout_arg = group_id | ((PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG) << 16);
+    if (setsockopt(fd_, SOL_PACKET, PACKET_FANOUT, &fanout_arg, sizeof(fanout_arg)) < 0) {
+        return fail("加入PACKET_FANOUT组失败");
+    }
+    return true;
+}
+
+void AfPacketCapture::close() {
+    if (ring_ != NULL) {
+        munmap(ring_, ring_size_);
+        ring_ = NULL;
+    }
+    ring_size_ = 0;
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+struct tpacket_block_desc* AfPacketCapture::block_at(size_t index) const {
+    return reinterpret_cast<struct tpacket_block_desc*>(ring_ + index * block_size_);
+}
+
+bool AfPacketCapture::next_block(int timeout_ms, AfPacketBlock& block) {
+    struct tpacket_block_desc* desc = block_at(current_);
+    if ((__atomic_load_n(&desc->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+        struct pollfd pfd;
+        pfd.fd = fd_;
+        pfd.events = POLLIN | POLLERR;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, timeout_ms) <= 0) {
+            return false;
+        }
+        if ((__atomic_load_n(&desc->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+            return false;
+        }
+    }
+    block = AfPacketBlock(desc);
+    return true;
+}
+
+void AfPacketCapture::release_block() {
+    struct tpacket_block_desc* desc = block_at(current_);
+    __atomic_store_n(&desc->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+    current_ = (current_ + 1) % block_count_;
+}
+
+bool AfPacketCapture::read_stats(uint64_t& packets, uint64_t& drops) {
+    struct tpacket_stats_v3 stats;
+    socklen_t length = sizeof(stats);
+    memset(&stats, 0, sizeof(stats));
+    if (getsockopt(fd_, SOL_PACKET, PACKET_STATISTICS, &stats, &length) < 0) {
+        return false;
+    }
+    packets = stats.tp_packets;
+    drops = stats.tp_drops;
+    return true;
+}
@@ -0,0 +1,136 @@
+// afpacket_capture.h - Linux AF_PACKET TPACKET_V3 内存映射抓包后端
+#ifndef AFPACKET_CAPTURE_H
+#define AFPACKET_CAPTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <linux/filter.h>
+#include <linux/if_packet.h>
+
+// 块中的一帧（指向内存映射区，不复制）
+struct AfPacketFrame {
+    const uint8_t* data;   // 链路层帧起始位置
+    uint32_t caplen;       // 捕获长度
+    uint32_t len;          // 原始帧长度
+    uint32_t sec;          // 时间戳（秒）
+    uint32_t nsec;         // 时间戳（纳秒）
+    uint16_t vlan_tci;     // 内核剥离的VLAN标签（vlan_valid为false时为0）
+    uint16_t vlan_tpid;
+    bool vlan_valid;
+};
+
+const size_t AFPACKET_VLAN_TAG_LEN = 4;   // 重新插入VLAN标签需要的帧前预留空间（PACKET_RESERVE）
+
+// 内核交给用户态的一个块，按顺序遍历其中的帧
+class AfPacketBlock {
+public:
+    AfPacketBlock() : desc_(NULL), remaining_(0), next_(NULL) {}
+    explicit AfPacketBlock(struct tpacket_block_desc* desc);
+
+    uint32_t frame_count() const;
+
+    // 取出下一帧，块中没有更多帧时返回false
+    // 内核剥离了VLAN标签（TP_STATUS_VLAN_VALID）时，把标签重新插入到以太网首部之后（与libpcap相同），
+    // 使链路层解码、VLAN统计和写文件看到的都是线上的原始帧；帧前的空间由PACKET_RESERVE预留
+    bool next(AfPacketFrame& frame) {
+        if (remaining_ == 0) {
+            return false;
+        }
+        const struct tpacket3_hdr* hdr = reinterpret_cast<const struct tpacket3_hdr*>(next_);
+        uint8_t* data = next_ + hdr->tp_mac;
+        frame.caplen = hdr->tp_snaplen;
+        frame.len = hdr->tp_len;
+        frame.sec = hdr->tp_sec;
+        frame.nsec = hdr->tp_nsec;
+        frame.vlan_valid = (hdr->tp_status & TP_STATUS_VLAN_VALID) != 0;
+        frame.vlan_tci = frame.vlan_valid ? hdr->hv1.tp_vlan_tci : 0;
+        frame.vlan_tpid = 0;
+        if (frame.vlan_valid) {
+            frame.vlan_tpid = (hdr->tp_status & TP_STATUS_VLAN_TPID_VALID) != 0 ?
+                              hdr->hv1.tp_vlan_tpid : 0x8100;
+            if (frame.caplen >= 12) {
+                data -= AFPACKET_VLAN_TAG_LEN;
+                memmove(data, data + AFPACKET_VLAN_TAG_LEN, 12);
+                data[12] = static_cast<uint8_t>(frame.vlan_tpid >> 8);
+                data[13] = static_cast<uint8_t>(frame.vlan_tpid);
+                data[14] = static_cast<uint8_t>(frame.vlan_tci >> 8);
+                data[15] = static_cast<uint8_t>(frame.vlan_tci);
+                frame.caplen += AFPACKET_VLAN_TAG_LEN;
+                frame.len += AFPACKET_VLAN_TAG_LEN;
+            }
+        }
+        frame.data = data;
+        next_ += hdr->tp_next_offset;
+        remaining_--;
+        return true;
+    }
+
+private:
+    struct tpacket_block_desc* desc_;
+    uint32_t remaining_;
+    uint8_t* next_;
+};
+
+// AF_PACKET TPACKET_V3 抓包器
+// 内核把帧直接写入与用户态共享的块环中，每个块装满或超时后整体交给用户态；
+// 用户态遍历完一个块后把它归还内核。整个过程没有逐包的系统调用、复制或回调。
+class AfPacketCapture {
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 1 << 20;   // 每块1MB（须为页大小的整数倍）
+    static const size_t DEFAULT_BLOCK_COUNT = 64;       // 块数
+    static const size_t DEFAULT_FRAME_SIZE = 2048;      // 帧对齐大小
+    static const int DEFAULT_BLOCK_TIMEOUT_MS = 100;    // 块未满时的最长等待时间
+
+    AfPacketCapture();
+    ~AfPacketCapture();
+
+    // 设置open()时挂载的经典BPF程序（如pcap_compile的结果），代替默认的IP过滤器
+    void set_filter(const std::vector<struct sock_filter>& program) { filter_ = program; }
+
+    // 打开网卡并建立块环，失败时返回false，错误信息见error()
+    // ip_only: 未设置set_filter()时，为true则在内核中挂载只接收IPv4/IPv6及VLAN标签帧的BPF过滤器
+    bool open(const std::string& interface_name,
+              size_t block_size = DEFAULT_BLOCK_SIZE,
+              size_t block_count = DEFAULT_BLOCK_COUNT,
+              bool promiscuous = true,
+              bool ip_only = true);
+    void close();
+
+    // 加入PACKET_FANOUT组（hash模式）：同一组内的多个套接字按流哈希分担同一网卡的流量，
+    // 同一条流的包总是落到同一个套接字。须在open()成功后调用。
+    bool join_fanout(uint16_t group_id);
+
+    // 等待下一个就绪的块，超时返回false
+    bool next_block(int timeout_ms, AfPacketBlock& block);
+    // 把当前块归还内核（每次next_block成功后必须调用）
+    void release_block();
+
+    // 读取并清零内核统计（收到的包数、因块环满丢弃的包数）
+    bool read_stats(uint64_t& packets, uint64_t& drops);
+
+    int fd() const { return fd_; }
+    bool is_open() const { return fd_ >= 0; }
+    const std::string& error() const { return error_; }
+    size_t ring_bytes() const { return ring_size_; }
+
+private:
+    AfPacketCapture(const AfPacketCapture&);
+    AfPacketCapture& operator=(const AfPacketCapture&);
+
+    bool fail(const std::string& what);
+    struct tpacket_block_desc* block_at(size_t index) const;
+
+    int fd_;
+    uint8_t* ring_;         // mmap得到的块环
+    size_t ring_size_;
+    size_t block_size_;
+    size_t block_count_;
+    size_t current_;        // 下一个要读取的块
+    std::vector<struct sock_filter> filter_;  // 用户指定的BPF程序，为空时使用默认过滤器
+    std::string error_;
+};
+
+#endif // AFPACKET_CAPTURE_H
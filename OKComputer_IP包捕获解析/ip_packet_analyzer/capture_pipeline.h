@@ -0,0 +1,328 @@
+// capture_pipeline.h - 采集/解码/汇总三级流水线
+#ifndef CAPTURE_PIPELINE_H
+#define CAPTURE_PIPELINE_H
+
+#include "spsc_ring.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <thread>
+#include <vector>
+#include <sys/time.h>
+
+// 单帧的默认最大保存长度（与libpcap的最大快照长度一致），超出部分截断并计数
+const size_t PIPELINE_MAX_FRAME_SIZE = 262144;
+
+// 数据区按输入环每个槽位平均预留的字节数：帧数据按实际长度首尾相接存放，
+// 大帧多占、小帧少占，数据区不足时与输入环满一样处理
+const size_t PIPELINE_ARENA_BYTES_PER_SLOT = 2048;
+
+// 采集阶段复制出的原始帧
+struct PipelineFrame {
+    uint64_t seq;          // 入队顺序号，汇总阶段按此顺序输出
+    uint64_t number;       // 包编号（采集线程看到的第几个包）
+    struct timeval ts;     // 捕获时间戳（抓包句柄给出的原始值，纳秒精度时tv_usec为纳秒）
+    uint32_t caplen;       // 保存的字节数
+    uint32_t len;          // 原始帧长度
+    uint32_t arena_bytes;  // 在数据区中占用的字节数（含回绕时跳过的尾部），解码后归还
+    const uint8_t* data;   // 帧数据，位于所属解码线程的数据区中
+};
+
+// 解码阶段的输出
+template <typename Result>
+struct PipelineResult {
+    uint64_t seq;
+    uint64_t number;
+    bool valid;            // 解码失败（如非IP帧）时为false，汇总阶段跳过
+    Result value;
+};
+
+// 空转退避：先让出CPU，持续空闲时短暂休眠
+inline void pipeline_backoff(unsigned& idle_rounds) {
+    if (++idle_rounds < 64) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+// 三级流水线
+// 采集线程（pcap回调）把帧复制进各解码线程的输入环和数据区，解码线程解析后写入各自的结果环，
+// 汇总线程按入队顺序合并所有结果环并交给消费函数（存储/打印）。
+// 每个环都是无锁SPSC队列；输入环满时采集线程丢弃该帧（或在回放模式下等待），
+// 保证慢速打印不会反压到内核抓包缓冲区。
+template <typename Result>
+class CapturePipeline {
+public:
+    typedef bool (*DecodeFn)(const PipelineFrame& frame, Result& result, void* worker_context);
+    typedef void (*ConsumeFn)(const Result& result, uint64_t number, void* consumer_context);
+    typedef void (*FinishFn)(void* consumer_context);  // 汇总线程退出前调用（如刷新输出缓冲区）
+    typedef void (*IdleFn)(void* consumer_context);    // 汇总线程空闲时调用（如提交定时刷新的输出）
+    typedef void (*WorkerIdleFn)(void* worker_context); // 解码线程空闲时调用（如结束超时的连接）
+
+    CapturePipeline()
+        : running_(false), stopping_(false), block_when_full_(false),
+          decode_(NULL), consume_(NULL), finish_(NULL), idle_(NULL), worker_idle_(NULL),
+          consumer_context_(NULL), max_frame_size_(0),
+          next_seq_(0), submitted_(0), dropped_(0), blocked_(0), truncated_(0), consumed_(0) {}
+
+    ~CapturePipeline() {
+        stop();
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            delete workers_[i];
+        }
+    }
+
+    // 启动解码线程和汇总线程
+    // worker_count: 解码线程数
+    // ring_capacity: 每个输入环/结果环的槽位数
+    // max_frame_size: 单帧最大保存长度（一般为抓包的快照长度），更长的帧截断并计数
+    // block_when_full: 为true时输入环满则等待（离线回放，不丢包），否则丢弃并计数
+    // worker_contexts: 每个解码线程的私有状态，可为NULL
+    bool start(size_t worker_count, size_t ring_capacity, size_t max_frame_size, bool block_when_full,
+               DecodeFn decode, ConsumeFn consume, FinishFn finish,
+               void* consumer_context, void* const* worker_contexts = NULL) {
+        if (running_ || worker_count == 0 || ring_capacity == 0 || max_frame_size == 0 ||
+            max_frame_size > 0xFFFFFFFFu || decode == NULL || consume == NULL) {
+            return false;
+        }
+        // 数据区至少能放下两个最大帧，保证回绕跳过尾部后仍有足够的连续空间
+        size_t arena_size = ring_capacity * PIPELINE_ARENA_BYTES_PER_SLOT;
+        if (arena_size < 2 * max_frame_size) {
+            arena_size = 2 * max_frame_size;
+        }
+        max_frame_size_ = max_frame_size;
+        block_when_full_ = block_when_full;
+        decode_ = decode;
+        consume_ = consume;
+        finish_ = finish;
+        consumer_context_ = consumer_context;
+        stopping_.store(false);
+        for (size_t i = 0; i < worker_count; ++i) {
+            Worker* worker = new Worker(ring_capacity, arena_size);
+            worker->context = worker_contexts != NULL ? worker_contexts[i] : NULL;
+            workers_.push_back(worker);
+        }
+        running_ = true;
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            workers_[i]->thread = std::thread(&CapturePipeline::worker_loop, this, workers_[i]);
+        }
+        aggregator_ = std::thread(&CapturePipeline::aggregator_loop, this);
+        return true;
+    }
+
+    // 设置汇总线程/解码线程的空闲回调（须在start()之前调用）
+    void set_idle_callback(IdleFn idle) { idle_ = idle; }
+    void set_worker_idle_callback(WorkerIdleFn idle) { worker_idle_ = idle; }
+
+    // 采集阶段：复制一帧到shard_hash选中的解码线程，丢弃时返回false
+    // 同一对地址的包应给出相同的shard_hash，使其由同一解码线程处理
+    bool submit(const struct timeval& ts, const uint8_t* data, uint32_t caplen, uint32_t len,
+                uint64_t number, uint32_t shard_hash) {
+        Worker* worker = workers_[shard_hash % workers_.size()];
+        bool truncated = caplen > max_frame_size_;
+        if (truncated) {
+            caplen = static_cast<uint32_t>(max_frame_size_);
+        }
+        size_t arena_bytes = 0;
+        PipelineFrame* frame = worker->frames.begin_push();
+        uint8_t* slot = frame != NULL ? worker->arena.reserve(caplen, arena_bytes) : NULL;
+        if (slot == NULL) {
+            if (!block_when_full_) {
+                bump(dropped_);
+                return false;
+            }
+            bump(blocked_);
+            unsigned idle = 0;
+            while ((frame = worker->frames.begin_push()) == NULL ||
+                   (slot = worker->arena.reserve(caplen, arena_bytes)) == NULL) {
+                pipeline_backoff(idle);
+            }
+        }
+        if (truncated) {
+            bump(truncated_);
+        }
+        memcpy(slot, data, caplen);
+        worker->arena.commit(arena_bytes);
+        frame->seq = next_seq_++;
+        frame->number = number;
+        frame->ts = ts;
+        frame->caplen = caplen;
+        frame->len = len;
+        frame->arena_bytes = static_cast<uint32_t>(arena_bytes);
+        frame->data = slot;
+        worker->frames.commit_push();
+        note_depth(worker->frames_high_water, worker->frames.size_approx());
+        submitted_.store(next_seq_, std::memory_order_release);
+        return true;
+    }
+
+    // 停止采集并等待所有已入队的帧处理完毕
+    void stop() {
+        if (!running_) {
+            return;
+        }
+        stopping_.store(true, std::memory_order_release);
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            workers_[i]->thread.join();
+        }
+        aggregator_.join();
+        running_ = false;
+    }
+
+    // 打印各阶段队列深度和反压统计
+    void print_stats(std::ostream& os) const {
+        os << "流水线统计" << std::endl;
+        os << "----------------------------------------" << std::endl;
+        os << "采集: 入队 " << submitted_.load() << ", 丢弃(输入环/数据区满) " << dropped_.load()
+           << ", 等待(回放反压) " << blocked_.load()
+           << ", 截断(超过" << max_frame_size_ << "字节) " << truncated_.load() << std::endl;
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            const Worker* worker = workers_[i];
+            os << "解码线程" << i << ": 输入环 " << worker->frames.size_approx() << "/"
+               << worker->frames.capacity() << " (峰值 " << worker->frames_high_water.load() << ")"
+               << ", 数据区 " << worker->arena.size() / 1024 << "KB"
+               << ", 结果环 " << worker->results.size_approx() << "/" << worker->results.capacity()
+               << " (峰值 " << worker->results_high_water.load() << ")"
+               << ", 已解码 " << worker->decoded.load()
+               << ", 结果环满等待 " << worker->stalls.load() << std::endl;
+        }
+        os << "汇总: 已处理 " << consumed_.load() << std::endl;
+        os << "========================================" << std::endl;
+    }
+
+    size_t worker_count() const { return workers_.size(); }
+    uint64_t submitted() const { return submitted_.load(); }
+    uint64_t dropped() const { return dropped_.load(); }
+    uint64_t truncated() const { return truncated_.load(); }
+
+private:
+    CapturePipeline(const CapturePipeline&);
+    CapturePipeline& operator=(const CapturePipeline&);
+
+    struct Worker {
+        Worker(size_t capacity, size_t arena_size)
+            : frames(capacity), results(capacity), arena(arena_size),
+              context(NULL),
+              frames_high_water(0), results_high_water(0), decoded(0), stalls(0) {}
+
+        SpscRing<PipelineFrame> frames;            // 采集 -> 解码
+        SpscRing<PipelineResult<Result> > results; // 解码 -> 汇总
+        SpscArena arena;                           // 帧数据（采集线程预留，解码线程归还）
+        void* context;
+        std::thread thread;
+        std::atomic<uint64_t> frames_high_water;   // 输入环峰值深度（采集线程写）
+        std::atomic<uint64_t> results_high_water;  // 结果环峰值深度（解码线程写）
+        std::atomic<uint64_t> decoded;
+        std::atomic<uint64_t> stalls;              // 结果环满而等待的次数
+    };
+
+    // 单写者计数器：只有一个线程写，用load+store代替原子加
+    static void bump(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    static void note_depth(std::atomic<uint64_t>& high_water, size_t depth) {
+        if (depth > high_water.load(std::memory_order_relaxed)) {
+            high_water.store(depth, std::memory_order_relaxed);
+        }
+    }
+
+    void worker_loop(Worker* worker) {
+        unsigned idle = 0;
+        while (true) {
+            PipelineFrame* frame = worker->frames.front();
+            if (frame == NULL) {
+                if (stopping_.load(std::memory_order_acquire) && worker->frames.front() == NULL) {
+                    break;
+                }
+                if (worker_idle_ != NULL && idle >= 64) {
+                    worker_idle_(worker->context);
+                }
+                pipeline_backoff(idle);
+                continue;
+            }
+            idle = 0;
+
+            PipelineResult<Result>* result = worker->results.begin_push();
+            if (result == NULL) {
+                bump(worker->stalls);
+                unsigned wait = 0;
+                while ((result = worker->results.begin_push()) == NULL) {
+                    pipeline_backoff(wait);
+                }
+            }
+            result->seq = frame->seq;
+            result->number = frame->number;
+            result->valid = decode_(*frame, result->value, worker->context);
+            worker->results.commit_push();
+            uint32_t arena_bytes = frame->arena_bytes;
+            worker->frames.pop();
+            worker->arena.release(arena_bytes);
+            bump(worker->decoded);
+            note_depth(worker->results_high_water, worker->results.size_approx());
+        }
+    }
+
+    // 按seq顺序合并各结果环：每个入队的帧都恰好产生一个结果，
+    // 因此下一个seq一定会出现在某个结果环的队首
+    void aggregator_loop() {
+        uint64_t expected = 0;
+        unsigned idle = 0;
+        while (true) {
+            bool progressed = false;
+            for (size_t i = 0; i < workers_.size(); ++i) {
+                PipelineResult<Result>* result = workers_[i]->results.front();
+                while (result != NULL && result->seq == expected) {
+                    if (result->valid) {
+                        consume_(result->value, result->number, consumer_context_);
+                    }
+                    workers_[i]->results.pop();
+                    expected++;
+                    progressed = true;
+                    result = workers_[i]->results.front();
+                }
+            }
+            if (progressed) {
+                consumed_.store(expected, std::memory_order_relaxed);
+                idle = 0;
+                continue;
+            }
+            if (stopping_.load(std::memory_order_acquire) &&
+                expected == submitted_.load(std::memory_order_acquire)) {
+                break;
+            }
+            if (idle_ != NULL && idle >= 64) {
+                idle_(consumer_context_);
+            }
+            pipeline_backoff(idle);
+        }
+        if (finish_ != NULL) {
+            finish_(consumer_context_);
+        }
+    }
+
+    bool running_;
+    std::atomic<bool> stopping_;
+    bool block_when_full_;
+    DecodeFn decode_;
+    ConsumeFn consume_;
+    FinishFn finish_;
+    IdleFn idle_;
+    WorkerIdleFn worker_idle_;
+    void* consumer_context_;
+    size_t max_frame_size_;
+    std::vector<Worker*> workers_;
+    std::thread aggregator_;
+
+    uint64_t next_seq_;                 // 采集线程私有
+    std::atomic<uint64_t> submitted_;   // 已入队帧数（采集线程写）
+    std::atomic<uint64_t> dropped_;     // 输入环或数据区满而丢弃的帧数
+    std::atomic<uint64_t> blocked_;     // 回放模式下输入环满而等待的次数
+    std::atomic<uint64_t> truncated_;   // 超过max_frame_size_而截断的帧数
+    std::atomic<uint64_t> consumed_;    // 汇总线程已处理的结果数
+};
+
+#endif // CAPTURE_PIPELINE_H
@@ -0,0 +1,84 @@
+// capture_stats.h - 可合并的抓包统计
+#ifndef CAPTURE_STATS_H
+#define CAPTURE_STATS_H
+
+#include <cstdint>
+#include <cstring>
+
+// 抓包统计
+// 每个处理线程各自累加一份，不加锁；报告时把各线程的副本合并。
+struct CaptureStats {
+    uint64_t frames;                 // 收到的帧数
+    uint64_t bytes;                  // 收到的字节数（按原始帧长度）
+    uint64_t ip_packets;             // 成功解码的IPv4包数
+    uint64_t ip_bytes;               // IPv4总长度之和
+    uint64_t fragments;              // IPv4分片数
+    uint64_t filtered;               // 被用户态过滤器（--match）丢弃的IP包数
+    uint64_t vlan_frames;            // 带VLAN标签的帧数
+    uint64_t non_ip_frames;          // 非IP帧或首部不完整而未解码的帧数
+    uint64_t ipv6_packets;           // 成功解码的IPv6包数
+    uint64_t ipv6_bytes;             // IPv6总长度（固定首部+载荷）之和
+    uint64_t ipv6_fragments;         // 带分片扩展首部的IPv6包数
+    uint64_t protocol_packets[256];  // 按协议号统计的IPv4包数
+    uint64_t bad_ip_checksums[256];  // 按协议号统计的IPv4首部校验和错误数
+    uint64_t bad_l4_checksums[256];  // 按协议号统计的TCP/UDP/ICMP校验和错误数
+    uint64_t ipv6_protocol_packets[256]; // 按上层协议号统计的IPv6包数
+
+    CaptureStats() { reset(); }
+
+    void reset() {
+        memset(this, 0, sizeof(*this));
+    }
+
+    // 统计一个已解码的IPv4包
+    void count_ip(uint8_t protocol, uint16_t total_length, bool fragment) {
+        ip_packets++;
+        ip_bytes += total_length;
+        protocol_packets[protocol]++;
+        if (fragment) {
+            fragments++;
+        }
+    }
+
+    // 统计一个已解码的IPv6包（protocol为扩展首部链之后的上层协议）
+    void count_ipv6(uint8_t protocol, uint16_t total_length, bool fragment) {
+        ipv6_packets++;
+        ipv6_bytes += total_length;
+        ipv6_protocol_packets[protocol]++;
+        if (fragment) {
+            ipv6_fragments++;
+        }
+    }
+
+    // 统计校验和错误
+    void count_checksum_errors(uint8_t protocol, bool bad_ip, bool bad_l4) {
+        if (bad_ip) {
+            bad_ip_checksums[protocol]++;
+        }
+        if (bad_l4) {
+            bad_l4_checksums[protocol]++;
+        }
+    }
+
+    void merge(const CaptureStats& other) {
+        frames += other.frames;
+        bytes += other.bytes;
+        ip_packets += other.ip_packets;
+        ip_bytes += other.ip_bytes;
+        fragments += other.fragments;
+        filtered += other.filtered;
+        vlan_frames += other.vlan_frames;
+        non_ip_frames += other.non_ip_frames;
+        ipv6_packets += other.ipv6_packets;
+        ipv6_bytes += other.ipv6_bytes;
+        ipv6_fragments += other.ipv6_fragments;
+        for (int i = 0; i < 256; ++i) {
+            protocol_packets[i] += other.protocol_packets[i];
+            bad_ip_checksums[i] += other.bad_ip_checksums[i];
+            bad_l4_checksums[i] += other.bad_l4_checksums[i];
+            ipv6_protocol_packets[i] += other.ipv6_protocol_packets[i];
+        }
+    }
+};
+
+#endif // CAPTURE_STATS_H
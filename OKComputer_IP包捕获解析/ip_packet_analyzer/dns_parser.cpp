@@ -0,0 +1,227 @@
+// dns_parser.cpp - DNS报文解析
+#include "dns_parser.h"
+#include "protocol_table.h"
+#include <cstring>
+
+namespace {
+// 名字中的字符映射表：大写转小写，空白、控制字符、非ASCII和标签内的'.'替换为'?'，
+// 保证文本形式与标签一一对应，可以直接作为统计的键和输出；查表代替逐字节的分支判断
+struct NameCharTable {
+    char map[256];
+};
+
+constexpr NameCharTable build_name_char_table() {
+    NameCharTable table = {};
+    for (int c = 0; c < 256; ++c) {
+        if (c >= 'A' && c <= 'Z') {
+            table.map[c] = static_cast<char>(c + ('a' - 'A'));
+        } else if (c <= 0x20 || c >= 0x7F || c == '.') {
+            table.map[c] = '?';
+        } else {
+            table.map[c] = static_cast<char>(c);
+        }
+    }
+    return table;
+}
+
+constexpr NameCharTable NAME_CHARS = build_name_char_table();
+
+// 跳过一个名字（不跟随指针、不生成文本），用于超出DNS_MAX_QUESTIONS的问题
+bool skip_dns_name(const uint8_t* message, size_t length, size_t& offset) {
+    size_t pos = offset;
+    while (pos < length) {
+        uint8_t label = message[pos];
+        if (label == 0) {
+            offset = pos + 1;
+            return true;
+        }
+        if ((label & 0xC0) == 0xC0) {
+            if (pos + 2 > length) {
+                return false;
+            }
+            offset = pos + 2;
+            return true;
+        }
+        if ((label & 0xC0) != 0) {
+            return false;
+        }
+        pos += 1 + label;
+    }
+    return false;
+}
+
+// 解析一条资源记录；名字类rdata中的标签不能超出rdata本身
+bool parse_record(const uint8_t* data, size_t length, size_t& offset, DnsRecord& record) {
+    if (!read_dns_name(data, length, offset, record.name) || offset + 10 > length) {
+        return false;
+    }
+    const uint8_t* fixed = data + offset;
+    record.type = load_be16(fixed);
+    record.rclass = load_be16(fixed + 2);
+    record.ttl = load_be32(fixed + 4);
+    record.rdlength = load_be16(fixed + 8);
+    offset += 10;
+    if (offset + record.rdlength > length) {
+        return false;
+    }
+    size_t rdata = offset;
+    size_t rdata_end = offset + record.rdlength;
+    record.rdata_offset = static_cast<uint16_t>(rdata);
+    record.target.length = 0;
+    record.target.text[0] = '\0';
+    offset = rdata_end;
+
+    switch (record.type) {
+        case DNS_TYPE_A:
+            if (record.rdlength != 4) {
+                return false;
+            }
+            memcpy(record.address, data + rdata, 4);
+            break;
+        case DNS_TYPE_AAAA:
+            if (record.rdlength != 16) {
+                return false;
+            }
+            memcpy(record.address, data + rdata, 16);
+            break;
+        case DNS_TYPE_MX:
+            // 2字节优先级之后是名字
+            if (record.rdlength < 3) {
+                return false;
+            }
+            rdata += 2;
+            return read_dns_name(data, rdata_end, rdata, record.target);
+        case DNS_TYPE_CNAME:
+        case DNS_TYPE_NS:
+        case DNS_TYPE_PTR:
+            return read_dns_name(data, rdata_end, rdata, record.target);
+        default:
+            break;
+    }
+    return true;
+}
+}
+
+bool read_dns_name(const uint8_t* message, size_t length, size_t& offset, DnsName& name) {
+    size_t pos = offset;
+    size_t run_start = offset;     // 当前这段标签的起点，指针只能指向它之前
+    size_t next_offset = 0;        // 第一个指针之后的位置（0为未跟随过指针）
+    size_t wire_length = 1;        // 线上格式的长度（含结尾的0）
+    size_t text_length = 0;
+    while (true) {
+        if (pos >= length) {
+            return false;
+        }
+        uint8_t label = message[pos];
+        if (label == 0) {
+            pos++;
+            break;
+        }
+        if ((label & 0xC0) == 0xC0) {
+            if (pos + 1 >= length) {
+                return false;
+            }
+            size_t target = (static_cast<size_t>(label & 0x3F) << 8) | message[pos + 1];
+            if (target < DNS_HEADER_LEN || target >= run_start) {
+                return false;
+            }
+            if (next_offset == 0) {
+                next_offset = pos + 2;
+            }
+            pos = target;
+            run_start = target;
+            continue;
+        }
+        if ((label & 0xC0) != 0) {
+            return false;   // 0x40/0x80为保留的标签类型
+        }
+        wire_length += 1 + label;
+        if (wire_length > DNS_MAX_NAME_LENGTH || pos + 1 + label > length) {
+            return false;
+        }
+        if (text_length > 0) {
+            name.text[text_length++] = '.';
+        }
+        const uint8_t* bytes = message + pos + 1;
+        for (size_t i = 0; i < label; ++i) {
+            name.text[text_length++] = NAME_CHARS.map[bytes[i]];
+        }
+        pos += 1 + label;
+    }
+    if (text_length == 0) {
+        name.text[text_length++] = '.';
+    }
+    name.text[text_length] = '\0';
+    name.length = static_cast<uint8_t>(text_length);
+    offset = next_offset != 0 ? next_offset : pos;
+    return true;
+}
+
+bool parse_dns_message(const uint8_t* data, size_t length, DnsMessage& message) {
+    if (data == NULL || length < DNS_HEADER_LEN) {
+        return false;
+    }
+    message.id = load_be16(data);
+    message.flags = load_be16(data + 2);
+    message.question_count = load_be16(data + 4);
+    message.answer_count = load_be16(data + 6);
+    message.authority_count = load_be16(data + 8);
+    message.additional_count = load_be16(data + 10);
+    message.questions_parsed = 0;
+    message.answers_parsed = 0;
+    message.complete = false;
+
+    size_t offset = DNS_HEADER_LEN;
+    for (size_t i = 0; i < message.question_count; ++i) {
+        if (i < DNS_MAX_QUESTIONS) {
+            DnsQuestion& question = message.questions[i];
+            if (!read_dns_name(data, length, offset, question.name) || offset + 4 > length) {
+                return false;
+            }
+            question.qtype = load_be16(data + offset);
+            question.qclass = load_be16(data + offset + 2);
+            message.questions_parsed++;
+        } else if (!skip_dns_name(data, length, offset) || offset + 4 > length) {
+            return false;
+        }
+        offset += 4;
+    }
+
+    size_t answers = message.answer_count < DNS_MAX_ANSWERS ? message.answer_count : DNS_MAX_ANSWERS;
+    for (size_t i = 0; i < answers; ++i) {
+        if (!parse_record(data, length, offset, message.answers[i])) {
+            return true;
+        }
+        message.answers_parsed++;
+    }
+    message.complete = message.question_count <= DNS_MAX_QUESTIONS && message.answer_count <= DNS_MAX_ANSWERS;
+    return true;
+}
+
+const char* dns_type_name(uint16_t type) {
+    switch (type) {
+        case DNS_TYPE_A: return "A";
+        case DNS_TYPE_NS: return "NS";
+        case DNS_TYPE_CNAME: return "CNAME";
+        case 6: return "SOA";
+        case DNS_TYPE_PTR: return "PTR";
+        case DNS_TYPE_MX: return "MX";
+        case 16: return "TXT";
+        case DNS_TYPE_AAAA: return "AAAA";
+        case 33: return "SRV";
+        case 41: return "OPT";
+        case 43: return "DS";
+        case 46: return "RRSIG";
+        case 48: return "DNSKEY";
+        case 64: return "SVCB";
+        case 65: return "HTTPS";
+        case 255: return "ANY";
+        case 257: return "CAA";
+        default: return NULL;
+    }
+}
+
+const char* dns_rcode_name(uint8_t rcode) {
+    static const char* const names[] = { "NOERROR", "FORMERR", "SERVFAIL", "NXDOMAIN", "NOTIMP", "REFUSED" };
+    return rcode < sizeof(names) / sizeof(names[0]) ? names[rcode] : NULL;
+}
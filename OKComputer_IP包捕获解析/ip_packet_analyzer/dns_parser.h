@@ -0,0 +1,82 @@
+// dns_parser.h - DNS报文解析（首部、问题和回答记录，名字支持压缩指针）
+#ifndef DNS_PARSER_H
+#define DNS_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+
+const uint16_t DNS_PORT = 53;
+const size_t DNS_HEADER_LEN = 12;
+const size_t DNS_MAX_NAME_LENGTH = 255;   // 线上格式的名字最长255字节，点分文本不会更长
+const size_t DNS_MAX_QUESTIONS = 4;       // 每个报文最多保存的问题数（实际几乎总是1个）
+const size_t DNS_MAX_ANSWERS = 16;        // 每个报文最多保存的回答记录数
+
+// 常用记录类型
+const uint16_t DNS_TYPE_A = 1;
+const uint16_t DNS_TYPE_NS = 2;
+const uint16_t DNS_TYPE_CNAME = 5;
+const uint16_t DNS_TYPE_PTR = 12;
+const uint16_t DNS_TYPE_MX = 15;
+const uint16_t DNS_TYPE_AAAA = 28;
+
+// 点分文本形式的名字：标签按原样拼接，A-Z转为小写，不可打印字符和标签内的'.'替换为'?'；
+// 根域名为"."。文本以'\0'结尾，长度不含结尾
+struct DnsName {
+    uint8_t length;
+    char text[DNS_MAX_NAME_LENGTH + 1];
+};
+
+struct DnsQuestion {
+    DnsName name;
+    uint16_t qtype;
+    uint16_t qclass;
+};
+
+// 回答记录；rdata仍在报文缓冲区中，只解析地址和名字类的记录
+struct DnsRecord {
+    DnsName name;
+    uint16_t type;
+    uint16_t rclass;
+    uint32_t ttl;
+    uint16_t rdlength;
+    uint16_t rdata_offset;    // rdata相对报文起点的偏移
+    uint8_t address[16];      // A：前4字节，AAAA：16字节（网络字节序）
+    DnsName target;           // CNAME/NS/PTR的目标名字、MX的邮件交换机；其他类型length为0
+};
+
+// 解析结果。问题和回答保存在定长数组中，整个结构作为解析的暂存区重复使用，
+// 解析过程中不分配内存（约10KB，由调用方长期持有，不要放在热路径的栈上）
+struct DnsMessage {
+    uint16_t id;
+    uint16_t flags;
+    uint16_t question_count;      // 首部中的计数
+    uint16_t answer_count;
+    uint16_t authority_count;
+    uint16_t additional_count;
+    uint8_t questions_parsed;     // 保存在questions中的问题数（不超过DNS_MAX_QUESTIONS）
+    uint8_t answers_parsed;       // 保存在answers中的回答数（不超过DNS_MAX_ANSWERS）
+    bool complete;                // 问题和回答都已按首部计数全部解析并保存
+    DnsQuestion questions[DNS_MAX_QUESTIONS];
+    DnsRecord answers[DNS_MAX_ANSWERS];
+
+    bool is_response() const { return (flags & 0x8000) != 0; }
+    bool truncated() const { return (flags & 0x0200) != 0; }
+    uint8_t opcode() const { return (flags >> 11) & 0x0F; }
+    uint8_t rcode() const { return flags & 0x0F; }
+};
+
+// 从offset处读取一个名字，offset前移到名字之后（遇到压缩指针时为指针之后）。
+// 指针只能指向本段标签之前的位置，因此跟随的次数有限，构造的循环指针会被拒绝；
+// 标签超过63字节、使用保留的标签类型、总长度超过255字节或越界时返回false
+bool read_dns_name(const uint8_t* message, size_t length, size_t& offset, DnsName& name);
+
+// 解析一个DNS报文（UDP载荷）。首部或问题部分无法解析时返回false；
+// 回答部分解析到第一个无法解析的记录或DNS_MAX_ANSWERS条为止，此时complete为false。
+// 授权和附加部分不解析
+bool parse_dns_message(const uint8_t* data, size_t length, DnsMessage& message);
+
+// 记录类型/响应码的名称，未知时返回NULL
+const char* dns_type_name(uint16_t type);
+const char* dns_rcode_name(uint8_t rcode);
+
+#endif // DNS_PARSER_H
@@ -0,0 +1,179 @@
+// dns_stats.cpp - DNS报文计数与查询名/类型Top-K
+#include "dns_stats.h"
+#include "protocol_table.h"
+
+// ==================== DnsSummary 实现 ====================
+
+void DnsSummary::merge(const DnsSummary& other, size_t top_n) {
+    stats.merge(other.stats);
+    merge_top_entries(queries, other.queries, top_n);
+}
+
+// ==================== DnsCounters 实现 ====================
+
+bool DnsCounters::init(size_t capacity) {
+    stats_.reset();
+    return queries_.init(capacity);
+}
+
+void DnsCounters::add_udp(const uint8_t* segment, size_t length) {
+    if (length < 8) {
+        return;
+    }
+    uint16_t src_port = load_be16(segment);
+    uint16_t dst_port = load_be16(segment + 2);
+    if (src_port != DNS_PORT && dst_port != DNS_PORT) {
+        return;
+    }
+    // UDP长度字段比捕获的数据短时以它为准（以太网最小帧的填充不属于载荷）
+    size_t udp_length = load_be16(segment + 4);
+    if (udp_length >= 8 && udp_length < length) {
+        length = udp_length;
+    }
+    add(segment + 8, length - 8);
+}
+
+bool DnsCounters::add(const uint8_t* data, size_t length) {
+    if (!parse_dns_message(data, length, message_)) {
+        stats_.malformed++;
+        return false;
+    }
+    stats_.messages++;
+    if (!message_.is_response()) {
+        // 只统计查询中的问题：响应会重复同一个问题，计入会使每次查询算两次
+        stats_.queries++;
+        uint32_t bytes = static_cast<uint32_t>(length);
+        for (size_t i = 0; i < message_.questions_parsed; ++i) {
+            const DnsQuestion& question = message_.questions[i];
+            key_.qtype = question.qtype;
+            key_.name.length = question.name.length;
+            memcpy(key_.name.text, question.name.text, question.name.length + 1);
+            queries_.add(key_, bytes);
+            stats_.questions++;
+        }
+        return true;
+    }
+    stats_.responses++;
+    stats_.rcodes[message_.rcode()]++;
+    stats_.answers += message_.answers_parsed;
+    if (message_.truncated()) {
+        stats_.truncated++;
+    }
+    if (message_.answers_parsed < message_.answer_count) {
+        stats_.incomplete++;
+    }
+    return true;
+}
+
+void DnsCounters::summarize(size_t top_n, DnsSummary& summary) const {
+    summary.stats = stats_;
+    queries_.top(top_n, summary.queries);
+}
+
+// ==================== DNS-over-TCP ====================
+
+bool DnsCounters::enable_tcp(TcpReassembler& streams) {
+    tcp_streams_.assign(DNS_TCP_STREAMS, TcpStream());
+    return streams.add_consumer(tcp_consumer, this);
+}
+
+void DnsCounters::tcp_consumer(const TcpStreamEvent& event, void* context) {
+    if (event.client_port != DNS_PORT && event.server_port != DNS_PORT) {
+        return;
+    }
+    static_cast<DnsCounters*>(context)->add_tcp_event(event);
+}
+
+DnsCounters::TcpStream* DnsCounters::find_tcp_stream(uint64_t stream_id) {
+    for (size_t i = 0; i < tcp_streams_.size(); ++i) {
+        if (tcp_streams_[i].stream_id == stream_id) {
+            return &tcp_streams_[i];
+        }
+    }
+    return NULL;
+}
+
+void DnsCounters::add_tcp_event(const TcpStreamEvent& event) {
+    if (event.type == TCP_STREAM_OPEN) {
+        TcpStream* stream = find_tcp_stream(0);
+        if (stream == NULL) {
+            stats_.tcp_skipped++;
+            return;
+        }
+        stream->stream_id = event.stream_id;
+        for (int direction = 0; direction < 2; ++direction) {
+            TcpHalf& half = stream->half[direction];
+            half.synced = true;
+            half.prefix_bytes = 0;
+            half.length = 0;
+            half.have = 0;
+        }
+        return;
+    }
+    TcpStream* stream = find_tcp_stream(event.stream_id);
+    if (stream == NULL) {
+        return;
+    }
+    TcpHalf& half = stream->half[event.direction];
+    switch (event.type) {
+        case TCP_STREAM_DATA:
+            if (half.synced) {
+                add_tcp_data(half, event.data, event.length);
+            }
+            break;
+        case TCP_STREAM_GAP:
+            // 缺失的字节中可能有长度前缀，之后的报文边界无法确定
+            if (half.synced) {
+                half.synced = false;
+                stats_.tcp_skipped++;
+            }
+            break;
+        case TCP_STREAM_CLOSE:
+            stream->stream_id = 0;
+            break;
+        default:
+            break;
+    }
+}
+
+// 按长度前缀切分字节流：整个报文都在本次数据中时直接解析，否则拼接到缓冲区
+void DnsCounters::add_tcp_data(TcpHalf& half, const uint8_t* data, size_t length) {
+    while (length > 0) {
+        if (half.prefix_bytes < 2) {
+            half.length = static_cast<uint16_t>((half.length << 8) | *data);
+            half.prefix_bytes++;
+            half.have = 0;
+            data++;
+            length--;
+            continue;
+        }
+        if (half.have == 0 && length >= half.length) {
+            stats_.tcp_messages++;
+            add(data, half.length);
+            data += half.length;
+            length -= half.length;
+        } else {
+            size_t take = half.length - half.have;
+            if (take > length) {
+                take = length;
+            }
+            if (half.length <= DNS_TCP_MESSAGE_MAX) {
+                memcpy(half.buffer + half.have, data, take);
+            }
+            half.have = static_cast<uint16_t>(half.have + take);
+            data += take;
+            length -= take;
+            if (half.have < half.length) {
+                return;
+            }
+            if (half.length <= DNS_TCP_MESSAGE_MAX) {
+                stats_.tcp_messages++;
+                add(half.buffer, half.length);
+            } else {
+                stats_.tcp_skipped++;
+            }
+        }
+        half.prefix_bytes = 0;
+        half.length = 0;
+    }
+}
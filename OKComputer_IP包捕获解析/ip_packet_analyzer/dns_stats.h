@@ -0,0 +1,147 @@
+// dns_stats.h - DNS报文计数与查询名/类型Top-K（定长内存）
+#ifndef DNS_STATS_H
+#define DNS_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "dns_parser.h"
+#include "heavy_hitters.h"
+#include "tcp_reassembler.h"
+
+const size_t DNS_TCP_STREAMS = 32;           // 同时解析的DNS-over-TCP连接数
+const size_t DNS_TCP_MESSAGE_MAX = 16384;    // 跨段报文的拼接缓冲区大小，更长的报文跳过
+
+// 查询名 + 查询类型（Top-K的键）
+struct DnsQueryKey {
+    DnsQueryKey() : qtype(0) {
+        name.length = 0;
+        name.text[0] = '\0';
+    }
+
+    DnsName name;
+    uint16_t qtype;
+
+    bool operator==(const DnsQueryKey& other) const {
+        return qtype == other.qtype && name.length == other.name.length &&
+               memcmp(name.text, other.name.text, name.length) == 0;
+    }
+};
+
+// FNV-1a：名字很短（通常不到30字节），逐字节哈希即可
+struct DnsQueryKeyHash {
+    uint32_t operator()(const DnsQueryKey& key) const {
+        uint32_t h = 2166136261u ^ key.qtype;
+        for (size_t i = 0; i < key.name.length; ++i) {
+            h = (h ^ static_cast<uint8_t>(key.name.text[i])) * 16777619u;
+        }
+        return h;
+    }
+};
+
+typedef SpaceSaving<DnsQueryKey, DnsQueryKeyHash> DnsQueryTopK;
+
+// DNS报文计数（每个处理线程一份，报告时合并）
+struct DnsMessageStats {
+    uint64_t messages;     // 解析成功的报文数
+    uint64_t queries;      // 其中的查询
+    uint64_t responses;    // 其中的响应
+    uint64_t malformed;    // 端口为53但首部或问题部分无法解析的报文数
+    uint64_t truncated;    // TC位置位的响应
+    uint64_t incomplete;   // 回答记录无法全部解析或超过DNS_MAX_ANSWERS条的响应
+    uint64_t questions;    // 计入Top-K的问题数（只统计查询中的问题）
+    uint64_t answers;      // 解析出的回答记录数
+    uint64_t tcp_messages; // 其中经TCP流重组得到的报文数（已计入上面各项）
+    uint64_t tcp_skipped;  // TCP上因超长、遇到空洞或连接数超过DNS_TCP_STREAMS而未解析的报文/连接数
+    uint64_t rcodes[16];   // 响应的响应码分布
+
+    DnsMessageStats() { reset(); }
+
+    void reset() {
+        memset(this, 0, sizeof(*this));
+    }
+
+    void merge(const DnsMessageStats& other) {
+        messages += other.messages;
+        queries += other.queries;
+        responses += other.responses;
+        malformed += other.malformed;
+        truncated += other.truncated;
+        incomplete += other.incomplete;
+        questions += other.questions;
+        answers += other.answers;
+        tcp_messages += other.tcp_messages;
+        tcp_skipped += other.tcp_skipped;
+        for (size_t i = 0; i < 16; ++i) {
+            rcodes[i] += other.rcodes[i];
+        }
+    }
+};
+
+// DNS汇总（用于报告，多线程时可合并）
+struct DnsSummary {
+    DnsMessageStats stats;
+    std::vector<DnsQueryTopK::Entry> queries;   // 按次数排序的查询名/类型
+
+    // 合并另一份汇总，查询名/类型保留前top_n个（与HeavyHitterSummary一样是近似值）
+    void merge(const DnsSummary& other, size_t top_n);
+};
+
+// DNS统计：解析53端口的UDP载荷和TCP字节流，计数并把查询中的（名字, 类型）计入Space-Saving Top-K。
+// 解析结果写入对象内的定长暂存区，Top-K的计数器和索引在init()时一次性分配，TCP的拼接缓冲区在
+// enable_tcp()时一次性分配，每个报文的处理过程不分配内存。非线程安全：每个处理线程使用独立的实例。
+class DnsCounters {
+public:
+    // 分配capacity个查询名/类型计数器
+    bool init(size_t capacity);
+    bool enabled() const { return queries_.enabled(); }
+
+    // 分配DNS-over-TCP的连接槽位并注册为streams的消费者（streams须与本对象在同一线程中使用）
+    bool enable_tcp(TcpReassembler& streams);
+
+    // 送入一个完整（未分片或已重组）的UDP段，源或目的端口为53时解析其载荷
+    void add_udp(const uint8_t* segment, size_t length);
+
+    // 解析并统计一个DNS报文，返回是否解析成功；解析结果可通过last()读取，下一次调用前有效
+    bool add(const uint8_t* data, size_t length);
+    const DnsMessage& last() const { return message_; }
+
+    // 生成汇总，top_n为需要列出的最大条数
+    void summarize(size_t top_n, DnsSummary& summary) const;
+
+    const DnsMessageStats& stats() const { return stats_; }
+    size_t capacity() const { return queries_.capacity(); }
+    size_t memory_bytes() const {
+        return queries_.memory_bytes() + sizeof(message_) +
+               tcp_streams_.size() * sizeof(TcpStream);
+    }
+
+private:
+    // 一个方向的字节流：按2字节长度前缀切分报文，报文跨段时拼接到buffer中
+    struct TcpHalf {
+        bool synced;              // 遇到空洞后失去报文边界，直到连接结束不再解析
+        uint8_t prefix_bytes;     // 已读到的长度前缀字节数（0~2）
+        uint16_t length;          // 当前报文长度（prefix_bytes为2时有效）
+        uint16_t have;            // 当前报文已收到的字节数
+        uint8_t buffer[DNS_TCP_MESSAGE_MAX];
+    };
+
+    struct TcpStream {
+        uint64_t stream_id;       // 0为空闲
+        TcpHalf half[2];
+    };
+
+    static void tcp_consumer(const TcpStreamEvent& event, void* context);
+    void add_tcp_event(const TcpStreamEvent& event);
+    void add_tcp_data(TcpHalf& half, const uint8_t* data, size_t length);
+    TcpStream* find_tcp_stream(uint64_t stream_id);
+
+    DnsMessage message_;      // 解析暂存区
+    DnsQueryKey key_;         // 计数用的键（复用，不在栈上构造）
+    DnsQueryTopK queries_;
+    DnsMessageStats stats_;
+    std::vector<TcpStream> tcp_streams_;  // DNS_TCP_STREAMS个连接槽位，未调用enable_tcp()时为空
+};
+
+#endif // DNS_STATS_H
@@ -0,0 +1,286 @@
+// flow_table.cpp - 五元组流表实现
+#include "flow_table.h"
+#include <algorithm>
+
+namespace {
+// 按字节数降序
+bool more_bytes(const FlowRecord& a, const FlowRecord& b) {
+    return a.bytes > b.bytes;
+}
+}
+
+// ==================== FlowTableSummary 实现 ====================
+
+void FlowTableSummary::merge(const FlowTableSummary& other, size_t top_n) {
+    active += other.active;
+    created += other.created;
+    expired += other.expired;
+    dropped += other.dropped;
+    top.insert(top.end(), other.top.begin(), other.top.end());
+    std::sort(top.begin(), top.end(), more_bytes);
+    if (top.size() > top_n) {
+        top.resize(top_n);
+    }
+}
+
+// ==================== FlowTable 实现 ====================
+
+const uint32_t FlowTable::NIL;
+
+FlowTable::FlowTable()
+    : bucket_mask_(0), free_head_(NIL), wheel_mask_(0), idle_timeout_(0),
+      wheel_time_(0), wheel_started_(false), active_(0), created_(0), expired_(0),
+      dropped_(0), expire_callback_(NULL), expire_context_(NULL) {}
+
+bool FlowTable::init(size_t capacity, uint32_t idle_timeout_sec) {
+    if (capacity == 0 || capacity >= NIL || idle_timeout_sec == 0) {
+        return false;
+    }
+
+    // 索引桶数取不小于2倍容量的2的幂，装载因子不超过0.5
+    size_t bucket_count = 1;
+    while (bucket_count < capacity * 2) {
+        bucket_count <<= 1;
+    }
+    Bucket empty_bucket = { 0, NIL };
+    buckets_.assign(bucket_count, empty_bucket);
+    bucket_mask_ = bucket_count - 1;
+
+    // slab中所有记录串成空闲链表
+    entries_.assign(capacity, Entry());
+    for (size_t i = 0; i < capacity; ++i) {
+        entries_[i].in_use = false;
+        entries_[i].next = (i + 1 < capacity) ? static_cast<uint32_t>(i + 1) : NIL;
+    }
+    free_head_ = 0;
+
+    // 时间轮槽位数大于超时秒数，保证同一槽位内的流到期秒相同
+    size_t wheel_size = 1;
+    while (wheel_size < static_cast<size_t>(idle_timeout_sec) + 2) {
+        wheel_size <<= 1;
+    }
+    wheel_.assign(wheel_size, NIL);
+    wheel_mask_ = wheel_size - 1;
+    idle_timeout_ = idle_timeout_sec;
+    wheel_time_ = 0;
+    wheel_started_ = false;
+
+    active_ = 0;
+    created_ = 0;
+    expired_ = 0;
+    dropped_ = 0;
+    return true;
+}
+
+// 线性探测：返回键所在的桶，不存在时返回应插入的空桶
+size_t FlowTable::find_bucket(const FlowKey& key, uint32_t hash) const {
+    size_t pos = hash & bucket_mask_;
+    while (true) {
+        const Bucket& bucket = buckets_[pos];
+        if (bucket.index == NIL) {
+            return pos;
+        }
+        if (bucket.hash == hash && entries_[bucket.index].record.key == key) {
+            return pos;
+        }
+        pos = (pos + 1) & bucket_mask_;
+    }
+}
+
+// 后移删除：把后续探测链上的桶前移填补空位，不需要墓碑标记
+void FlowTable::remove_bucket(size_t pos) {
+    buckets_[pos].index = NIL;
+    size_t hole = pos;
+    size_t next = pos;
+    while (true) {
+        next = (next + 1) & bucket_mask_;
+        if (buckets_[next].index == NIL) {
+            return;
+        }
+        size_t home = buckets_[next].hash & bucket_mask_;
+        // home不在(hole, next]区间内时，该桶可以前移到hole
+        bool stays = (hole <= next) ? (home > hole && home <= next)
+                                    : (home > hole || home <= next);
+        if (!stays) {
+            buckets_[hole] = buckets_[next];
+            buckets_[next].index = NIL;
+            hole = next;
+        }
+    }
+}
+
+void FlowTable::wheel_link(uint32_t index, uint32_t expire_sec) {
+    Entry& entry = entries_[index];
+    uint32_t& head = wheel_[expire_sec & wheel_mask_];
+    entry.expire_sec = expire_sec;
+    entry.prev = NIL;
+    entry.next = head;
+    if (head != NIL) {
+        entries_[head].prev = index;
+    }
+    head = index;
+}
+
+void FlowTable::wheel_unlink(uint32_t index) {
+    Entry& entry = entries_[index];
+    if (entry.prev != NIL) {
+        entries_[entry.prev].next = entry.next;
+    } else {
+        wheel_[entry.expire_sec & wheel_mask_] = entry.next;
+    }
+    if (entry.next != NIL) {
+        entries_[entry.next].prev = entry.prev;
+    }
+}
+
+FlowRecord* FlowTable::update(const FlowKey& key, uint32_t bytes, uint64_t timestamp_us, uint8_t tcp_flags) {
+    uint32_t hash = flow_key_hash(key);
+    size_t pos = find_bucket(key, hash);
+    uint32_t second = static_cast<uint32_t>(timestamp_us / 1000000);
+    if (!wheel_started_) {
+        wheel_time_ = second;
+        wheel_started_ = true;
+    }
+    // 时间戳乱序时按时间轮当前时间计算，避免挂到已处理过的槽位
+    uint32_t expire_sec = std::max(second, wheel_time_) + idle_timeout_;
+
+    uint32_t index = buckets_[pos].index;
+    if (index != NIL) {
+        Entry& entry = entries_[index];
+        FlowRecord& record = entry.record;
+        record.packets++;
+        record.bytes += bytes;
+        if (timestamp_us > record.last_seen_us) {
+            record.last_seen_us = timestamp_us;
+        }
+        record.tcp_flags |= tcp_flags;
+        // 只有跨秒时才需要在时间轮上移动
+        if (expire_sec != entry.expire_sec) {
+            wheel_unlink(index);
+            wheel_link(index, expire_sec);
+        }
+        return &record;
+    }
+
+    // 新流：从slab空闲链表取一条记录
+    if (free_head_ == NIL) {
+        dropped_++;
+        return NULL;
+    }
+    index = free_head_;
+    Entry& entry = entries_[index];
+    free_head_ = entry.next;
+
+    entry.in_use = true;
+    entry.hash = hash;
+    entry.record.key = key;
+    entry.record.packets = 1;
+    entry.record.bytes = bytes;
+    entry.record.first_seen_us = timestamp_us;
+    entry.record.last_seen_us = timestamp_us;
+    entry.record.tcp_flags = tcp_flags;
+    buckets_[pos].hash = hash;
+    buckets_[pos].index = index;
+    wheel_link(index, expire_sec);
+
+    active_++;
+    created_++;
+    return &entry.record;
+}
+
+void FlowTable::expire_entry(uint32_t index) {
+    Entry& entry = entries_[index];
+    if (expire_callback_ != NULL) {
+        expire_callback_(entry.record, expire_context_);
+    }
+    wheel_unlink(index);
+    remove_bucket(find_bucket(entry.record.key, entry.hash));
+    entry.in_use = false;
+    entry.next = free_head_;
+    free_head_ = index;
+    active_--;
+    expired_++;
+}
+
+void FlowTable::expire(uint64_t now_us) {
+    uint32_t now_sec = static_cast<uint32_t>(now_us / 1000000);
+    if (!wheel_started_ || now_sec <= wheel_time_) {
+        return;
+    }
+    // 时间跳跃超过一圈时每个槽位只需处理一次
+    uint32_t steps = now_sec - wheel_time_;
+    if (steps > wheel_.size()) {
+        steps = static_cast<uint32_t>(wheel_.size());
+    }
+    for (uint32_t step = 1; step <= steps; ++step) {
+        uint32_t index = wheel_[(wheel_time_ + step) & wheel_mask_];
+        while (index != NIL) {
+            uint32_t next = entries_[index].next;
+            if (entries_[index].expire_sec <= now_sec) {
+                expire_entry(index);
+            }
+            index = next;
+        }
+    }
+    wheel_time_ = now_sec;
+}
+
+void FlowTable::for_each_active(ExpireCallback callback, void* context) const {
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        if (entries_[i].in_use) {
+            callback(entries_[i].record, context);
+        }
+    }
+}
+
+void FlowTable::summarize(size_t top_n, FlowTableSummary& summary) const {
+    FlowTableScan scan;
+    begin_summary(top_n, scan);
+    continue_summary(scan, entries_.size(), summary);
+}
+
+void FlowTable::begin_summary(size_t top_n, FlowTableScan& scan) const {
+    scan.top_n = top_n;
+    scan.cursor = 0;
+    scan.heap.clear();
+    scan.heap.reserve(top_n);
+}
+
+bool FlowTable::continue_summary(FlowTableScan& scan, size_t max_entries, FlowTableSummary& summary) const {
+    if (scan.top_n == 0) {
+        scan.cursor = entries_.size();
+    }
+    size_t end = std::min(entries_.size(), scan.cursor + max_entries);
+    // more_bytes作为堆的比较函数时堆顶是字节数最少的一条，满堆后只替换比它多的
+    for (size_t i = scan.cursor; i < end; ++i) {
+        if (!entries_[i].in_use) {
+            continue;
+        }
+        const FlowRecord& record = entries_[i].record;
+        if (scan.heap.size() < scan.top_n) {
+            scan.heap.push_back(record);
+            std::push_heap(scan.heap.begin(), scan.heap.end(), more_bytes);
+        } else if (record.bytes > scan.heap.front().bytes) {
+            std::pop_heap(scan.heap.begin(), scan.heap.end(), more_bytes);
+            scan.heap.back() = record;
+            std::push_heap(scan.heap.begin(), scan.heap.end(), more_bytes);
+        }
+    }
+    scan.cursor = end;
+    if (scan.cursor < entries_.size()) {
+        return false;
+    }
+    summary.active = active_;
+    summary.created = created_;
+    summary.expired = expired_;
+    summary.dropped = dropped_;
+    std::sort_heap(scan.heap.begin(), scan.heap.end(), more_bytes);
+    summary.top.swap(scan.heap);
+    scan.heap.clear();
+    return true;
+}
+
+size_t FlowTable::memory_bytes() const {
+    return entries_.size() * sizeof(Entry) + buckets_.size() * sizeof(Bucket) +
+           wheel_.size() * sizeof(uint32_t);
+}
@@ -0,0 +1,161 @@
+// flow_table.h - 五元组流表（开放寻址哈希 + 预分配slab + 时间轮超时）
+#ifndef FLOW_TABLE_H
+#define FLOW_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 流的五元组键（单向：源 -> 目的）
+struct FlowKey {
+    uint32_t src_addr;   // 主机字节序
+    uint32_t dst_addr;
+    uint16_t src_port;   // 非TCP/UDP时为0
+    uint16_t dst_port;
+    uint8_t protocol;
+    uint8_t reserved[3]; // 填充，保持为0以便整体比较
+
+    bool operator==(const FlowKey& other) const {
+        return src_addr == other.src_addr && dst_addr == other.dst_addr &&
+               src_port == other.src_port && dst_port == other.dst_port &&
+               protocol == other.protocol;
+    }
+};
+
+// 五元组的32位哈希（流表索引和Top-K共用）
+inline uint32_t flow_key_hash(const FlowKey& key) {
+    uint64_t addrs = (static_cast<uint64_t>(key.src_addr) << 32) | key.dst_addr;
+    uint64_t rest = (static_cast<uint64_t>(key.src_port) << 32) |
+                    (static_cast<uint64_t>(key.dst_port) << 16) | key.protocol;
+    uint64_t h = addrs * 0x9E3779B97F4A7C15ULL;
+    h ^= (rest + 0x632BE59BD9B4E019ULL) * 0xC2B2AE3D27D4EB4FULL;
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 32;
+    return static_cast<uint32_t>(h);
+}
+
+// 单条流的计数
+struct FlowRecord {
+    FlowKey key;
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t first_seen_us;   // 首包时间（微秒）
+    uint64_t last_seen_us;    // 末包时间（微秒）
+    uint8_t tcp_flags;        // 出现过的TCP标志位（按位或）
+};
+
+// 流表汇总（用于报告，多线程时可合并）
+struct FlowTableSummary {
+    FlowTableSummary() : active(0), created(0), expired(0), dropped(0) {}
+
+    uint64_t active;               // 当前活跃流数
+    uint64_t created;              // 累计新建流数
+    uint64_t expired;              // 累计超时流数
+    uint64_t dropped;              // 表满而未能跟踪的包数
+    std::vector<FlowRecord> top;   // 按字节数排序的前N条活跃流
+
+    // 合并另一份汇总，保留字节数最多的top_n条流
+    void merge(const FlowTableSummary& other, size_t top_n);
+};
+
+// 分步生成汇总的进度：按slab下标扫描，用最多top_n条的小顶堆保留字节数最多的流。
+// 扫描期间表仍在更新，结果是近似值（存活的流各自只会被看到一次）
+struct FlowTableScan {
+    FlowTableScan() : top_n(0), cursor(0) {}
+
+    size_t top_n;
+    size_t cursor;                  // 下一个要扫描的slab下标
+    std::vector<FlowRecord> heap;   // 按字节数的小顶堆
+};
+
+// 流表
+// - 索引为线性探测的开放寻址哈希表，每个桶8字节（32位哈希 + 记录下标），
+//   先比较哈希再访问记录，探测序列连续，缓存友好；删除采用后移法，不留墓碑
+// - 流记录存放在初始化时一次性分配的slab中，运行时不再分配内存
+// - 空闲超时由时间轮管理：每条流挂在其到期秒对应的槽位链表上，
+//   更新时O(1)移动，推进时间时只处理到期的槽位
+class FlowTable {
+public:
+    // 流超时回调（可用于导出流记录）
+    typedef void (*ExpireCallback)(const FlowRecord& record, void* context);
+
+    FlowTable();
+
+    // 分配容量为capacity条流的slab和索引，idle_timeout_sec秒无新包的流将超时
+    bool init(size_t capacity, uint32_t idle_timeout_sec);
+    bool enabled() const { return !entries_.empty(); }
+
+    void set_expire_callback(ExpireCallback callback, void* context) {
+        expire_callback_ = callback;
+        expire_context_ = context;
+    }
+
+    // 记录一个包，返回对应的流记录；表满时返回NULL并计入dropped
+    FlowRecord* update(const FlowKey& key, uint32_t bytes, uint64_t timestamp_us, uint8_t tcp_flags);
+
+    // 推进时间轮，使now_us之前到期的流超时
+    void expire(uint64_t now_us);
+
+    // 对每条仍活跃的流调用callback（不移除、不计入超时），用于结束时导出剩余的流
+    void for_each_active(ExpireCallback callback, void* context) const;
+
+    // 生成汇总，top_n为需要列出的最大流数
+    void summarize(size_t top_n, FlowTableSummary& summary) const;
+
+    // 分步生成汇总：begin_summary()开始，每次continue_summary()最多扫描max_entries个slab槽位，
+    // 扫描完成时填充summary并返回true。用于不能一次扫描整张表的抓包线程
+    void begin_summary(size_t top_n, FlowTableScan& scan) const;
+    bool continue_summary(FlowTableScan& scan, size_t max_entries, FlowTableSummary& summary) const;
+
+    size_t size() const { return active_; }
+    size_t capacity() const { return entries_.size(); }
+    size_t memory_bytes() const;
+    uint64_t created() const { return created_; }
+    uint64_t expired_count() const { return expired_; }
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    static const uint32_t NIL = 0xFFFFFFFFu;
+
+    struct Bucket {
+        uint32_t hash;    // 键的哈希值
+        uint32_t index;   // slab下标，NIL表示空桶
+    };
+
+    struct Entry {
+        FlowRecord record;
+        uint32_t hash;
+        uint32_t expire_sec;   // 到期秒（时间轮槽位 = expire_sec & wheel_mask_）
+        uint32_t prev;         // 时间轮链表/空闲链表
+        uint32_t next;
+        bool in_use;
+    };
+
+    size_t find_bucket(const FlowKey& key, uint32_t hash) const;
+    void remove_bucket(size_t bucket);
+    void wheel_link(uint32_t index, uint32_t expire_sec);
+    void wheel_unlink(uint32_t index);
+    void expire_entry(uint32_t index);
+
+    std::vector<Entry> entries_;      // 预分配的流记录slab
+    std::vector<Bucket> buckets_;     // 开放寻址索引，大小为2的幂且不小于容量的2倍
+    size_t bucket_mask_;
+    uint32_t free_head_;              // 空闲记录链表
+
+    std::vector<uint32_t> wheel_;     // 时间轮槽位，每个槽位是到期流链表的表头
+    size_t wheel_mask_;
+    uint32_t idle_timeout_;
+    uint32_t wheel_time_;             // 已处理到的秒
+    bool wheel_started_;
+
+    size_t active_;
+    uint64_t created_;
+    uint64_t expired_;
+    uint64_t dropped_;
+
+    ExpireCallback expire_callback_;
+    void* expire_context_;
+};
+
+#endif // FLOW_TABLE_H
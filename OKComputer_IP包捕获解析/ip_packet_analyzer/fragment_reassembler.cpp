@@ -0,0 +1,371 @@
+// fragment_reassembler.cpp - IPv4分片重组实现
+#include "fragment_reassembler.h"
+#include "checksum.h"
+
+const uint32_t FragmentReassembler::NIL;
+
+FragmentReassembler::FragmentReassembler()
+    : bucket_mask_(0), free_slot_(NIL), oldest_(NIL), newest_(NIL),
+      active_(0), timeout_us_(0) {}
+
+bool FragmentReassembler::init(size_t memory_budget_bytes, uint32_t timeout_sec) {
+    // 按平均每个数据报占2块估算槽位数，其余预算全部用作缓冲池；
+    // 缓冲池至少要能容纳一个最大长度的数据报
+    size_t slot_count = memory_budget_bytes / (sizeof(Datagram) + 2 * CHUNK_SIZE);
+    if (slot_count == 0 || timeout_sec == 0) {
+        return false;
+    }
+    size_t chunk_count = (memory_budget_bytes - slot_count * sizeof(Datagram)) / CHUNK_SIZE;
+    if (chunk_count < MAX_CHUNKS || chunk_count >= NIL) {
+        return false;
+    }
+
+    chunk_pool_.assign(chunk_count * CHUNK_SIZE, 0);
+    free_chunks_.resize(chunk_count);
+    for (size_t i = 0; i < chunk_count; ++i) {
+        free_chunks_[i] = static_cast<uint32_t>(chunk_count - 1 - i);
+    }
+
+    slots_.assign(slot_count, Datagram());
+    for (size_t i = 0; i < slot_count; ++i) {
+        slots_[i].in_use = false;
+        slots_[i].next = (i + 1 < slot_count) ? static_cast<uint32_t>(i + 1) : NIL;
+    }
+    free_slot_ = 0;
+
+    size_t bucket_count = 1;
+    while (bucket_count < slot_count) {
+        bucket_count <<= 1;
+    }
+    buckets_.assign(bucket_count, NIL);
+    bucket_mask_ = bucket_count - 1;
+
+    oldest_ = NIL;
+    newest_ = NIL;
+    active_ = 0;
+    timeout_us_ = static_cast<uint64_t>(timeout_sec) * 1000000;
+    output_.assign(65535, 0);
+    stats_.reset();
+    return true;
+}
+
+uint32_t FragmentReassembler::hash_key(uint32_t src, uint32_t dst, uint16_t id, uint8_t protocol) {
+    uint64_t h = ((static_cast<uint64_t>(src) << 32) | dst) * 0x9E3779B97F4A7C15ULL;
+    h ^= ((static_cast<uint64_t>(id) << 8) | protocol) * 0xC2B2AE3D27D4EB4FULL;
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 32;
+    return static_cast<uint32_t>(h);
+}
+
+uint32_t FragmentReassembler::find(const IPv4HeaderView& fragment, uint32_t hash) const {
+    uint32_t index = buckets_[hash & bucket_mask_];
+    while (index != NIL) {
+        const Datagram& entry = slots_[index];
+        if (entry.hash == hash && entry.src_addr == fragment.src_addr() &&
+            entry.dst_addr == fragment.dst_addr() &&
+            entry.identification == fragment.identification() &&
+            entry.protocol == fragment.protocol()) {
+            return index;
+        }
+        index = entry.hash_next;
+    }
+    return NIL;
+}
+
+uint32_t FragmentReassembler::create(const IPv4HeaderView& fragment, uint32_t hash, uint64_t timestamp_us) {
+    if (free_slot_ == NIL) {
+        drop_oldest(NIL, stats_.evicted);
+    }
+    uint32_t index = free_slot_;
+    Datagram& entry = slots_[index];
+    free_slot_ = entry.next;
+
+    entry.src_addr = fragment.src_addr();
+    entry.dst_addr = fragment.dst_addr();
+    entry.identification = fragment.identification();
+    entry.protocol = fragment.protocol();
+    entry.in_use = true;
+    entry.hash = hash;
+    entry.created_us = timestamp_us;
+    entry.fragment_count = 0;
+    entry.total_payload = 0;
+    entry.range_count = 0;
+    entry.header_length = 0;
+    for (size_t i = 0; i < MAX_CHUNKS; ++i) {
+        entry.chunks[i] = NIL;
+    }
+
+    // 挂到哈希桶和创建顺序链表的尾部
+    uint32_t& bucket = buckets_[hash & bucket_mask_];
+    entry.hash_next = bucket;
+    bucket = index;
+    entry.prev = newest_;
+    entry.next = NIL;
+    if (newest_ != NIL) {
+        slots_[newest_].next = index;
+    } else {
+        oldest_ = index;
+    }
+    newest_ = index;
+    active_++;
+    return index;
+}
+
+void FragmentReassembler::release(uint32_t index) {
+    Datagram& entry = slots_[index];
+    for (size_t i = 0; i < MAX_CHUNKS; ++i) {
+        if (entry.chunks[i] != NIL) {
+            free_chunks_.push_back(entry.chunks[i]);
+        }
+    }
+
+    uint32_t* link = &buckets_[entry.hash & bucket_mask_];
+    while (*link != index) {
+        link = &slots_[*link].hash_next;
+    }
+    *link = entry.hash_next;
+
+    if (entry.prev != NIL) {
+        slots_[entry.prev].next = entry.next;
+    } else {
+        oldest_ = entry.next;
+    }
+    if (entry.next != NIL) {
+        slots_[entry.next].prev = entry.prev;
+    } else {
+        newest_ = entry.prev;
+    }
+
+    entry.in_use = false;
+    entry.next = free_slot_;
+    free_slot_ = index;
+    active_--;
+}
+
+// 丢弃最旧的数据报（跳过keep），丢弃的分片数计入counter
+bool FragmentReassembler::drop_oldest(uint32_t keep, uint64_t& counter) {
+    uint32_t index = oldest_;
+    if (index == keep && index != NIL) {
+        index = slots_[index].next;
+    }
+    if (index == NIL) {
+        return false;
+    }
+    counter += slots_[index].fragment_count;
+    release(index);
+    return true;
+}
+
+void FragmentReassembler::expire(uint64_t now_us) {
+    while (oldest_ != NIL && slots_[oldest_].created_us + timeout_us_ <= now_us) {
+        stats_.timed_out += slots_[oldest_].fragment_count;
+        release(oldest_);
+    }
+}
+
+// 为载荷区间[start, end)分配缓冲池块，池中不足时淘汰其他数据报
+bool FragmentReassembler::reserve_chunks(uint32_t index, size_t start, size_t end) {
+    if (start >= end) {
+        return true;
+    }
+    size_t first = start / CHUNK_SIZE;
+    size_t last = (end - 1) / CHUNK_SIZE;
+    size_t needed = 0;
+    for (size_t i = first; i <= last; ++i) {
+        if (slots_[index].chunks[i] == NIL) {
+            needed++;
+        }
+    }
+    while (free_chunks_.size() < needed) {
+        if (!drop_oldest(index, stats_.evicted)) {
+            return false;
+        }
+    }
+    for (size_t i = first; i <= last; ++i) {
+        if (slots_[index].chunks[i] == NIL) {
+            slots_[index].chunks[i] = free_chunks_.back();
+            free_chunks_.pop_back();
+        }
+    }
+    return true;
+}
+
+void FragmentReassembler::write_payload(Datagram& entry, size_t start, const uint8_t* data, size_t length) {
+    while (length > 0) {
+        size_t chunk = start / CHUNK_SIZE;
+        size_t offset = start % CHUNK_SIZE;
+        size_t count = CHUNK_SIZE - offset;
+        if (count > length) {
+            count = length;
+        }
+        memcpy(&chunk_pool_[entry.chunks[chunk] * CHUNK_SIZE + offset], data, count);
+        start += count;
+        data += count;
+        length -= count;
+    }
+}
+
+// 把[start, end)并入有序区间表，与相邻区间合并
+FragmentReassembler::RangeResult FragmentReassembler::insert_range(Datagram& entry, size_t start, size_t end) {
+    size_t pos = 0;
+    while (pos < entry.range_count && entry.range_end[pos] < start) {
+        pos++;
+    }
+    // pos是第一个可能与新区间相交或相邻的区间
+    if (pos < entry.range_count && entry.range_start[pos] < end && entry.range_end[pos] > start) {
+        if (entry.range_start[pos] <= start && entry.range_end[pos] >= end) {
+            return RANGE_DUPLICATE;
+        }
+        return RANGE_OVERLAP;
+    }
+    if (pos + 1 < entry.range_count && entry.range_start[pos + 1] < end) {
+        return RANGE_OVERLAP;
+    }
+
+    bool join_left = pos < entry.range_count && entry.range_end[pos] == start;
+    size_t right = join_left ? pos + 1 : pos;
+    bool join_right = right < entry.range_count && entry.range_start[right] == end;
+    if (join_left && join_right) {
+        entry.range_end[pos] = entry.range_end[right];
+        for (size_t i = right; i + 1 < entry.range_count; ++i) {
+            entry.range_start[i] = entry.range_start[i + 1];
+            entry.range_end[i] = entry.range_end[i + 1];
+        }
+        entry.range_count--;
+    } else if (join_left) {
+        entry.range_end[pos] = static_cast<uint16_t>(end);
+    } else if (join_right) {
+        entry.range_start[right] = static_cast<uint16_t>(start);
+    } else {
+        if (entry.range_count == MAX_RANGES) {
+            return RANGE_FULL;
+        }
+        for (size_t i = entry.range_count; i > pos; --i) {
+            entry.range_start[i] = entry.range_start[i - 1];
+            entry.range_end[i] = entry.range_end[i - 1];
+        }
+        entry.range_start[pos] = static_cast<uint16_t>(start);
+        entry.range_end[pos] = static_cast<uint16_t>(end);
+        entry.range_count++;
+    }
+    return RANGE_ADDED;
+}
+
+bool FragmentReassembler::add(const IPv4HeaderView& fragment, uint64_t timestamp_us, IPv4HeaderView& datagram) {
+    if (!enabled()) {
+        return false;
+    }
+    stats_.fragments++;
+    expire(timestamp_us);
+
+    size_t header_length = fragment.header_length();
+    size_t start = static_cast<size_t>(fragment.fragment_offset()) * 8;
+    size_t length = fragment.payload_length();
+    size_t end = start + length;
+    bool last = !fragment.more_fragments();
+    // 截断的分片、非末片长度不是8的非零倍数、重组后超过65535字节都视为非法
+    if (fragment.total_length() > fragment.captured_length() ||
+        end > MAX_PAYLOAD || header_length + end > 65535 ||
+        (!last && (length == 0 || length % 8 != 0))) {
+        stats_.invalid++;
+        return false;
+    }
+
+    uint32_t hash = hash_key(fragment.src_addr(), fragment.dst_addr(),
+                             fragment.identification(), fragment.protocol());
+    uint32_t index = find(fragment, hash);
+    if (index == NIL) {
+        index = create(fragment, hash, timestamp_us);
+    }
+    Datagram& entry = slots_[index];
+    entry.fragment_count++;
+
+    // 末片确定数据报总长度，与已收到的数据不一致时整体丢弃
+    bool consistent = true;
+    if (last) {
+        if ((entry.total_payload != 0 && entry.total_payload != end) ||
+            (entry.range_count > 0 && entry.range_end[entry.range_count - 1] > end)) {
+            consistent = false;
+        }
+        entry.total_payload = static_cast<uint32_t>(end);
+    } else if (entry.total_payload != 0 && end > entry.total_payload) {
+        consistent = false;
+    }
+    if (!consistent) {
+        stats_.invalid += entry.fragment_count;
+        release(index);
+        return false;
+    }
+
+    if (!reserve_chunks(index, start, end)) {
+        stats_.evicted += entry.fragment_count;
+        release(index);
+        return false;
+    }
+
+    RangeResult result = start < end ? insert_range(entry, start, end) : RANGE_ADDED;
+    if (result == RANGE_DUPLICATE) {
+        stats_.duplicates++;
+        return false;
+    }
+    if (result == RANGE_OVERLAP) {
+        stats_.overlaps++;
+        release(index);
+        return false;
+    }
+    if (result == RANGE_FULL) {
+        stats_.invalid += entry.fragment_count;
+        release(index);
+        return false;
+    }
+
+    write_payload(entry, start, fragment.payload(), length);
+    if (start == 0 && entry.header_length == 0) {
+        entry.header_length = static_cast<uint8_t>(header_length);
+        memcpy(entry.header, fragment.data(), header_length);
+    }
+
+    // 收齐：有首片、有末片、区间表只剩一个[0, total)
+    if (entry.header_length != 0 && entry.total_payload != 0 && entry.range_count == 1 &&
+        entry.range_start[0] == 0 && entry.range_end[0] == entry.total_payload) {
+        build_datagram(entry, datagram);
+        stats_.reassembled++;
+        release(index);
+        return true;
+    }
+    return false;
+}
+
+// 拼接首片首部和全部载荷，清除分片标志并更新总长度和校验和
+void FragmentReassembler::build_datagram(const Datagram& entry, IPv4HeaderView& datagram) {
+    uint8_t* out = output_.data();
+    size_t header_length = entry.header_length;
+    size_t total_length = header_length + entry.total_payload;
+    memcpy(out, entry.header, header_length);
+
+    size_t copied = 0;
+    for (size_t chunk = 0; copied < entry.total_payload; ++chunk) {
+        size_t count = entry.total_payload - copied;
+        if (count > CHUNK_SIZE) {
+            count = CHUNK_SIZE;
+        }
+        memcpy(out + header_length + copied, &chunk_pool_[entry.chunks[chunk] * CHUNK_SIZE], count);
+        copied += count;
+    }
+
+    out[2] = static_cast<uint8_t>(total_length >> 8);
+    out[3] = static_cast<uint8_t>(total_length);
+    out[6] &= 0xC0;   // 保留位和DF，清除MF与片偏移
+    out[7] = 0;
+    out[10] = 0;
+    out[11] = 0;
+    uint16_t checksum = internet_checksum(out, header_length);
+    memcpy(out + 10, &checksum, sizeof(checksum));
+    datagram.decode(out, total_length);
+}
+
+size_t FragmentReassembler::memory_bytes() const {
+    return chunk_pool_.size() + free_chunks_.capacity() * sizeof(uint32_t) +
+           slots_.size() * sizeof(Datagram) + buckets_.size() * sizeof(uint32_t) + output_.size();
+}
@@ -0,0 +1,126 @@
+// fragment_reassembler.h - IPv4分片重组（预分配缓冲池，内存有硬上限）
+#ifndef FRAGMENT_REASSEMBLER_H
+#define FRAGMENT_REASSEMBLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "packet_decode.h"
+
+// 重组统计（每个处理线程一份，报告时合并）
+struct ReassemblyStats {
+    uint64_t fragments;     // 送入重组的分片数
+    uint64_t reassembled;   // 重组完成的数据报数
+    uint64_t timed_out;     // 因超时丢弃的分片数
+    uint64_t evicted;       // 因缓冲池或槽位不足被淘汰的分片数
+    uint64_t overlaps;      // 因分片部分重叠而整体丢弃的数据报数
+    uint64_t duplicates;    // 完全重复的分片数（忽略）
+    uint64_t invalid;       // 非法分片数（长度错误、超过65535字节、空洞过多）
+
+    ReassemblyStats() { reset(); }
+
+    void reset() {
+        memset(this, 0, sizeof(*this));
+    }
+
+    void merge(const ReassemblyStats& other) {
+        fragments += other.fragments;
+        reassembled += other.reassembled;
+        timed_out += other.timed_out;
+        evicted += other.evicted;
+        overlaps += other.overlaps;
+        duplicates += other.duplicates;
+        invalid += other.invalid;
+    }
+};
+
+// IPv4分片重组器
+// - 分片按（源地址, 目的地址, 标识, 协议）归组，载荷按偏移写入定长块组成的缓冲池，
+//   块和重组槽位都在初始化时按内存预算一次性分配，分片洪泛只会导致淘汰，不会增加内存
+// - 已收到的区间以有序、合并后的区间表记录；完全重复的分片被忽略，
+//   部分重叠的分片使整个数据报被丢弃（与RFC 5722及Linux的处理一致，防止重叠分片规避检测）
+// - 槽位按创建顺序串成链表，超时与内存不足时都从最旧的数据报开始丢弃
+// 非线程安全：每个处理线程使用独立的实例。
+class FragmentReassembler {
+public:
+    static const size_t CHUNK_SIZE = 2048;                 // 缓冲池块大小
+    static const size_t MAX_PAYLOAD = 65535 - IPV4_MIN_HEADER_LEN;
+    static const size_t MAX_CHUNKS = (MAX_PAYLOAD + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    static const size_t MAX_RANGES = 16;                   // 每个数据报最多的不连续区间数
+
+    FragmentReassembler();
+
+    // 按内存预算分配缓冲池和槽位，timeout_sec秒内未收齐的数据报被丢弃
+    bool init(size_t memory_budget_bytes, uint32_t timeout_sec);
+    bool enabled() const { return !chunk_pool_.empty(); }
+
+    // 送入一个分片（ip_view.is_fragment()为true）
+    // 收齐一个数据报时返回true，datagram指向重组后的完整IPv4包（首部已清除分片标志、
+    // 更新总长度和校验和），在下一次调用add()之前有效
+    bool add(const IPv4HeaderView& fragment, uint64_t timestamp_us, IPv4HeaderView& datagram);
+
+    // 丢弃now_us时已超时的数据报
+    void expire(uint64_t now_us);
+
+    const ReassemblyStats& stats() const { return stats_; }
+    size_t pending() const { return active_; }
+    size_t memory_bytes() const;
+
+private:
+    static const uint32_t NIL = 0xFFFFFFFFu;
+
+    // 新分片区间与已收到区间的关系
+    enum RangeResult {
+        RANGE_ADDED,       // 新数据
+        RANGE_DUPLICATE,   // 完全落在已收到的区间内
+        RANGE_OVERLAP,     // 与已收到的区间部分重叠
+        RANGE_FULL         // 不连续区间过多
+    };
+
+    struct Datagram {
+        uint32_t src_addr;
+        uint32_t dst_addr;
+        uint16_t identification;
+        uint8_t protocol;
+        bool in_use;
+        uint32_t hash;
+        uint32_t hash_next;                  // 哈希桶链表
+        uint32_t prev;                       // 按创建顺序的链表/空闲链表
+        uint32_t next;
+        uint64_t created_us;
+        uint32_t fragment_count;
+        uint32_t total_payload;              // 收到末片后确定，之前为0
+        uint8_t range_count;
+        uint16_t range_start[MAX_RANGES];    // 已收到的载荷区间[start, end)，有序且不相邻
+        uint16_t range_end[MAX_RANGES];
+        uint8_t header_length;               // 首片首部长度，0表示尚未收到首片
+        uint8_t header[60];
+        uint32_t chunks[MAX_CHUNKS];         // 载荷所在的缓冲池块，NIL表示尚未分配
+    };
+
+    static uint32_t hash_key(uint32_t src, uint32_t dst, uint16_t id, uint8_t protocol);
+    uint32_t find(const IPv4HeaderView& fragment, uint32_t hash) const;
+    uint32_t create(const IPv4HeaderView& fragment, uint32_t hash, uint64_t timestamp_us);
+    void release(uint32_t index);
+    bool drop_oldest(uint32_t keep, uint64_t& counter);
+    bool reserve_chunks(uint32_t index, size_t start, size_t end);
+    void write_payload(Datagram& entry, size_t start, const uint8_t* data, size_t length);
+    RangeResult insert_range(Datagram& entry, size_t start, size_t end);
+    void build_datagram(const Datagram& entry, IPv4HeaderView& datagram);
+
+    std::vector<uint8_t> chunk_pool_;     // 载荷缓冲池
+    std::vector<uint32_t> free_chunks_;   // 空闲块栈
+    std::vector<Datagram> slots_;
+    std::vector<uint32_t> buckets_;       // 哈希桶（链表头）
+    size_t bucket_mask_;
+    uint32_t free_slot_;
+    uint32_t oldest_;                     // 最早创建的数据报
+    uint32_t newest_;
+    size_t active_;
+    uint64_t timeout_us_;
+    std::vector<uint8_t> output_;         // 重组结果
+    ReassemblyStats stats_;
+};
+
+#endif // FRAGMENT_REASSEMBLER_H
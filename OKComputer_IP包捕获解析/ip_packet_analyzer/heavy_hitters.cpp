@@ -0,0 +1,24 @@
+// heavy_hitters.cpp - Top-K统计汇总与合并
+#include "heavy_hitters.h"
+
+// ==================== HeavyHitterSummary 实现 ====================
+
+void HeavyHitterSummary::merge(const HeavyHitterSummary& other, size_t top_n) {
+    packets += other.packets;
+    merge_top_entries(sources, other.sources, top_n);
+    merge_top_entries(destinations, other.destinations, top_n);
+    merge_top_entries(flows, other.flows, top_n);
+}
+
+// ==================== HeavyHitters 实现 ====================
+
+bool HeavyHitters::init(size_t capacity) {
+    return sources_.init(capacity) && destinations_.init(capacity) && flows_.init(capacity);
+}
+
+void HeavyHitters::summarize(size_t top_n, HeavyHitterSummary& summary) const {
+    summary.packets = sources_.total();
+    sources_.top(top_n, summary.sources);
+    destinations_.top(top_n, summary.destinations);
+    flows_.top(top_n, summary.flows);
+}
@@ -0,0 +1,364 @@
+// heavy_hitters.h - 定长内存的Top-K统计（Space-Saving算法）
+#ifndef HEAVY_HITTERS_H
+#define HEAVY_HITTERS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "flow_table.h"
+
+// Space-Saving算法（Metwally等，2005）
+// 固定保留capacity个计数器：已跟踪的键直接加1；未跟踪的键替换计数最小的计数器，
+// 继承其计数并记下该计数作为误差上界。任何出现次数超过 总数/capacity 的键都一定在表中，
+// 报告的计数不低于真实值，且不超过真实值 + error。
+//
+// 计数器按计数分组到“计数桶”中，桶按计数升序组成双向链表（Stream-Summary结构）：
+// 加1时计数器只会移到相邻的桶，最小计数器就是第一个桶的表头，因此更新是O(1)的。
+// 计数器、桶和开放寻址索引都在init()时一次性分配，运行时不再分配内存。
+//
+// Key 须可默认构造、可复制并支持==，Hash 为返回32位哈希值的函数对象。
+template <typename Key, typename Hash>
+class SpaceSaving {
+public:
+    struct Entry {
+        Key key;
+        uint64_t count;    // 包数（可能高估，不超过error）
+        uint64_t error;    // 接管计数器时继承的计数，即高估的上界
+        uint64_t bytes;    // 接管计数器之后累计的字节数
+    };
+
+    SpaceSaving() : slot_mask_(0), size_(0), min_bucket_(NIL), max_bucket_(NIL),
+                    free_bucket_(NIL), total_(0) {}
+
+    // 分配capacity个计数器
+    bool init(size_t capacity) {
+        if (capacity == 0 || capacity >= NIL) {
+            return false;
+        }
+        counters_.assign(capacity, Counter());
+        buckets_.assign(capacity, Bucket());
+        for (size_t i = 0; i < capacity; ++i) {
+            buckets_[i].next = (i + 1 < capacity) ? static_cast<uint32_t>(i + 1) : NIL;
+        }
+        free_bucket_ = 0;
+
+        // 索引槽位数取不小于2倍容量的2的幂
+        size_t slot_count = 1;
+        while (slot_count < capacity * 2) {
+            slot_count <<= 1;
+        }
+        Slot empty_slot = { 0, NIL };
+        slots_.assign(slot_count, empty_slot);
+        slot_mask_ = slot_count - 1;
+
+        size_ = 0;
+        min_bucket_ = NIL;
+        max_bucket_ = NIL;
+        total_ = 0;
+        return true;
+    }
+
+    bool enabled() const { return !counters_.empty(); }
+
+    // 记录一次出现
+    void add(const Key& key, uint32_t bytes) {
+        total_++;
+        uint32_t hash = Hash()(key);
+        size_t pos = find_slot(key, hash);
+        uint32_t index = slots_[pos].index;
+        if (index != NIL) {
+            counters_[index].bytes += bytes;
+            increment(index);
+            return;
+        }
+
+        if (size_ < counters_.size()) {
+            // 还有空闲计数器：以计数1加入
+            index = static_cast<uint32_t>(size_++);
+            Counter& counter = counters_[index];
+            counter.key = key;
+            counter.hash = hash;
+            counter.error = 0;
+            counter.bytes = bytes;
+            if (min_bucket_ != NIL && buckets_[min_bucket_].count == 1) {
+                bucket_link(min_bucket_, index);
+            } else {
+                bucket_link(new_bucket(1, NIL, min_bucket_), index);
+            }
+            slots_[pos].hash = hash;
+            slots_[pos].index = index;
+            return;
+        }
+
+        // 表满：接管计数最小的计数器
+        index = buckets_[min_bucket_].head;
+        Counter& counter = counters_[index];
+        remove_slot(find_slot(counter.key, counter.hash));
+        counter.key = key;
+        counter.hash = hash;
+        counter.error = buckets_[min_bucket_].count;
+        counter.bytes = bytes;
+        pos = find_slot(key, hash);
+        slots_[pos].hash = hash;
+        slots_[pos].index = index;
+        increment(index);
+    }
+
+    // 按计数降序输出前n个计数器（从计数最大的桶向前遍历）
+    void top(size_t n, std::vector<Entry>& out) const {
+        out.clear();
+        for (uint32_t b = max_bucket_; b != NIL && out.size() < n; b = buckets_[b].prev) {
+            for (uint32_t c = buckets_[b].head; c != NIL && out.size() < n; c = counters_[c].next) {
+                Entry entry;
+                entry.key = counters_[c].key;
+                entry.count = buckets_[b].count;
+                entry.error = counters_[c].error;
+                entry.bytes = counters_[c].bytes;
+                out.push_back(entry);
+            }
+        }
+    }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return counters_.size(); }
+    uint64_t total() const { return total_; }
+    size_t memory_bytes() const {
+        return counters_.size() * sizeof(Counter) + buckets_.size() * sizeof(Bucket) +
+               slots_.size() * sizeof(Slot);
+    }
+
+private:
+    static const uint32_t NIL = 0xFFFFFFFFu;
+
+    struct Counter {
+        Key key;
+        uint64_t error;
+        uint64_t bytes;
+        uint32_t hash;
+        uint32_t bucket;   // 所在计数桶
+        uint32_t prev;     // 同一计数桶内的双向链表
+        uint32_t next;
+    };
+
+    struct Bucket {
+        uint64_t count;
+        uint32_t head;     // 桶内第一个计数器
+        uint32_t prev;     // 按计数升序的双向链表（空闲桶用next串成空闲链表）
+        uint32_t next;
+    };
+
+    struct Slot {
+        uint32_t hash;
+        uint32_t index;    // 计数器下标，NIL表示空槽
+    };
+
+    // 线性探测：返回键所在的槽位，不存在时返回应插入的空槽
+    size_t find_slot(const Key& key, uint32_t hash) const {
+        size_t pos = hash & slot_mask_;
+        while (true) {
+            const Slot& slot = slots_[pos];
+            if (slot.index == NIL || (slot.hash == hash && counters_[slot.index].key == key)) {
+                return pos;
+            }
+            pos = (pos + 1) & slot_mask_;
+        }
+    }
+
+    // 后移删除（与FlowTable相同）
+    void remove_slot(size_t pos) {
+        slots_[pos].index = NIL;
+        size_t hole = pos;
+        size_t next = pos;
+        while (true) {
+            next = (next + 1) & slot_mask_;
+            if (slots_[next].index == NIL) {
+                return;
+            }
+            size_t home = slots_[next].hash & slot_mask_;
+            bool stays = (hole <= next) ? (home > hole && home <= next)
+                                        : (home > hole || home <= next);
+            if (!stays) {
+                slots_[hole] = slots_[next];
+                slots_[next].index = NIL;
+                hole = next;
+            }
+        }
+    }
+
+    // 从空闲链表取一个桶，插入到prev和next之间
+    uint32_t new_bucket(uint64_t count, uint32_t prev, uint32_t next) {
+        uint32_t b = free_bucket_;
+        free_bucket_ = buckets_[b].next;
+        Bucket& bucket = buckets_[b];
+        bucket.count = count;
+        bucket.head = NIL;
+        bucket.prev = prev;
+        bucket.next = next;
+        if (prev != NIL) {
+            buckets_[prev].next = b;
+        } else {
+            min_bucket_ = b;
+        }
+        if (next != NIL) {
+            buckets_[next].prev = b;
+        } else {
+            max_bucket_ = b;
+        }
+        return b;
+    }
+
+    void free_bucket(uint32_t b) {
+        Bucket& bucket = buckets_[b];
+        if (bucket.prev != NIL) {
+            buckets_[bucket.prev].next = bucket.next;
+        } else {
+            min_bucket_ = bucket.next;
+        }
+        if (bucket.next != NIL) {
+            buckets_[bucket.next].prev = bucket.prev;
+        } else {
+            max_bucket_ = bucket.prev;
+        }
+        bucket.next = free_bucket_;
+        free_bucket_ = b;
+    }
+
+    void bucket_link(uint32_t b, uint32_t index) {
+        Counter& counter = counters_[index];
+        counter.bucket = b;
+        counter.prev = NIL;
+        counter.next = buckets_[b].head;
+        if (counter.next != NIL) {
+            counters_[counter.next].prev = index;
+        }
+        buckets_[b].head = index;
+    }
+
+    void bucket_unlink(uint32_t index) {
+        Counter& counter = counters_[index];
+        if (counter.prev != NIL) {
+            counters_[counter.prev].next = counter.next;
+        } else {
+            buckets_[counter.bucket].head = counter.next;
+        }
+        if (counter.next != NIL) {
+            counters_[counter.next].prev = counter.prev;
+        }
+    }
+
+    // 计数加1：移到计数为count+1的相邻桶，没有时新建；桶内只有自己时直接修改桶的计数
+    void increment(uint32_t index) {
+        uint32_t b = counters_[index].bucket;
+        uint64_t count = buckets_[b].count + 1;
+        uint32_t next = buckets_[b].next;
+        bool alone = buckets_[b].head == index && counters_[index].next == NIL;
+        if (alone && (next == NIL || buckets_[next].count != count)) {
+            buckets_[b].count = count;
+            return;
+        }
+        bucket_unlink(index);
+        if (next != NIL && buckets_[next].count == count) {
+            bucket_link(next, index);
+        } else {
+            bucket_link(new_bucket(count, b, next), index);
+        }
+        if (buckets_[b].head == NIL) {
+            free_bucket(b);
+        }
+    }
+
+    std::vector<Counter> counters_;   // 前size_个在用
+    std::vector<Bucket> buckets_;     // 计数桶池（桶数不会超过计数器数）
+    std::vector<Slot> slots_;         // 键到计数器的开放寻址索引
+    size_t slot_mask_;
+    size_t size_;
+    uint32_t min_bucket_;
+    uint32_t max_bucket_;
+    uint32_t free_bucket_;
+    uint64_t total_;
+};
+
+template <typename Key, typename Hash>
+const uint32_t SpaceSaving<Key, Hash>::NIL;
+
+// 合并两份按计数降序的Top-K列表：相同键相加后重新排序，保留前top_n个
+// 列表很短（每个线程只上报前几十个），逐个查找即可
+template <typename Entry>
+void merge_top_entries(std::vector<Entry>& merged, const std::vector<Entry>& other, size_t top_n) {
+    for (size_t i = 0; i < other.size(); ++i) {
+        size_t j = 0;
+        while (j < merged.size() && !(merged[j].key == other[i].key)) {
+            ++j;
+        }
+        if (j < merged.size()) {
+            merged[j].count += other[i].count;
+            merged[j].error += other[i].error;
+            merged[j].bytes += other[i].bytes;
+        } else {
+            merged.push_back(other[i]);
+        }
+    }
+    std::sort(merged.begin(), merged.end(), [](const Entry& a, const Entry& b) { return a.count > b.count; });
+    if (merged.size() > top_n) {
+        merged.resize(top_n);
+    }
+}
+
+// 地址和五元组的哈希函数对象
+struct AddressHash {
+    uint32_t operator()(uint32_t addr) const {
+        uint64_t h = addr * 0x9E3779B97F4A7C15ULL;
+        return static_cast<uint32_t>(h >> 32);
+    }
+};
+
+struct FlowKeyHash {
+    uint32_t operator()(const FlowKey& key) const { return flow_key_hash(key); }
+};
+
+typedef SpaceSaving<uint32_t, AddressHash> AddressTopK;
+typedef SpaceSaving<FlowKey, FlowKeyHash> FlowTopK;
+
+// Top-K汇总（用于报告，多线程时可合并）
+struct HeavyHitterSummary {
+    HeavyHitterSummary() : packets(0) {}
+
+    uint64_t packets;                         // 参与统计的包数
+    std::vector<AddressTopK::Entry> sources;  // 按包数排序的源地址
+    std::vector<AddressTopK::Entry> destinations;
+    std::vector<FlowTopK::Entry> flows;
+
+    // 合并另一份汇总：相同键的计数相加，保留前top_n个
+    // 某个键只出现在一方的列表中时，另一方的计数无法得知，合并结果是近似值
+    void merge(const HeavyHitterSummary& other, size_t top_n);
+};
+
+// 源地址、目的地址和五元组三个Top-K，每个已解码的包更新一次
+class HeavyHitters {
+public:
+    // 每个Top-K分配capacity个计数器
+    bool init(size_t capacity);
+    bool enabled() const { return sources_.enabled(); }
+
+    void add(const FlowKey& key, uint32_t bytes) {
+        sources_.add(key.src_addr, bytes);
+        destinations_.add(key.dst_addr, bytes);
+        flows_.add(key, bytes);
+    }
+
+    // 生成汇总，top_n为每类需要列出的最大条数
+    void summarize(size_t top_n, HeavyHitterSummary& summary) const;
+
+    size_t capacity() const { return sources_.capacity(); }
+    size_t memory_bytes() const {
+        return sources_.memory_bytes() + destinations_.memory_bytes() + flows_.memory_bytes();
+    }
+
+private:
+    AddressTopK sources_;
+    AddressTopK destinations_;
+    FlowTopK flows_;
+};
+
+#endif // HEAVY_HITTERS_H
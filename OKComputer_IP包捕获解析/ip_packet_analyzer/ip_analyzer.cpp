@@ -11,55 +11,800 @@
 #include <netinet/in.h>
 #include <netinet/ip.h>
 #include <arpa/inet.h>
-#include <net/ethernet.h>
 #include <cstring>
 #include <cstdlib>
+#include <cerrno>
+#include <climits>
+#include <csignal>
 #include <vector>
-#include <map>
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include "packet_parser.h"
+#include "packet_aggregate.h"
+#include "packet_print.h"
+#include "packet_store.h"
+#include "output_writer.h"
+#include "capture_pipeline.h"
+#include "afpacket_capture.h"
+#include "capture_stats.h"
+#include "flow_table.h"
+#include "fragment_reassembler.h"
+#include "tcp_reassembler.h"
+#include "dns_stats.h"
+#include "checksum.h"
+#include "packet_filter.h"
+#include "heavy_hitters.h"
+#include "hyperloglog.h"
+#include "rate_stats.h"
+#include "protocol_table.h"
+#include "record_export.h"
+#include "pcap_dump_ring.h"
+#include <unistd.h>
+#include <fcntl.h>
 
 using namespace std;
 
-// 协议名称映射表
-const map<uint8_t, string> PROTOCOL_NAMES = {
-    {1, "ICMP"},
-    {2, "IGMP"},
-    {6, "TCP"},
-    {17, "UDP"},
-    {89, "OSPF"},
-    {50, "ESP"},
-    {51, "AH"},
-    {58, "ICMPv6"}
+// 分析上下文：一个处理线程独占的统计和状态
+// 单线程/流水线模式下只有一份（main_context），fanout模式下每个抓包线程一份，报告时合并
+// 统计、流表、Top-K、去重计数和速率统计在基类PacketAggregates中，由aggregate_packet更新
+struct AnalyzerContext : PacketAggregates {
+    AnalyzerContext() : next_report(0), summary_sec(0) {}
+
+    PacketRingStore<IPPacketInfo> store;   // 最近捕获的包（定长环形存储）
+    FragmentReassembler fragments;         // 分片重组（流水线模式下由解码线程各自持有）
+    TcpReassembler streams;                // TCP流重组（同上，--tcp-memory 0时不启用）
+    DnsCounters dns;                       // DNS报文统计和查询名Top-K（同上，--dns-top-k 0时不启用）
+    time_t next_report;                    // 下一次输出定期报告的包时间（单线程/流水线模式）
+    time_t summary_sec;                    // 实时摘要模式下正在统计的秒
+};
+
+// 流水线模式下一个解码线程的私有状态
+struct DecodeWorkerContext {
+    FragmentReassembler fragments;   // 分片重组器
+    TcpReassembler streams;          // TCP流重组器
+    DnsCounters dns;                 // DNS统计
+    CaptureStats stats;              // 解码阶段的计数（过滤丢弃、VLAN帧、非IP帧），回放结束时合并
+};
+
+// 实时抓包句柄的参数（pcap_create + pcap_activate）
+struct LiveCaptureConfig {
+    int snaplen;              // 每个包最多捕获的字节数
+    int buffer_size;          // 内核缓冲区字节数
+    int timeout_ms;           // 读超时：内核攒够一批或超时后才唤醒用户态
+    bool immediate;           // 立即模式：包到达即交付，不等待缓冲区填满
+    bool nanosecond;          // 请求纳秒精度时间戳
+};
+
+// fanout线程上报的一份统计快照
+struct FanoutSnapshot {
+    FanoutSnapshot() : distinct_clear(true) {}
+
+    CaptureStats stats;
+    FlowTableSummary flows;              // 流表汇总（分多轮扫描生成）
+    HeavyHitterSummary talkers;
+    DistinctCounters distinct;           // 一个报告周期的去重计数：线程换出正在计数的寄存器，不复制
+    bool distinct_clear;                 // distinct已由主线程合并后清零，可以直接换入继续计数
+    RateStats rates;
+    ReassemblyStats reassembly;
+    TcpStreamStats streams;
+    DnsSummary dns;
 };
 
-// IP包解析结果结构体
-struct IPPacketInfo {
-    uint8_t version;          // 版本号
-    uint8_t header_length;    // 首部长度
-    uint16_t total_length;    // 总长度
-    uint16_t identification;  // 标识
-    uint8_t flags;           // 标志位
-    uint16_t fragment_offset; // 片偏移
-    uint8_t protocol;        // 协议
-    uint16_t checksum;       // 首部校验和
-    char source_ip[16];      // 源IP地址
-    char dest_ip[16];        // 目的IP地址
-    time_t timestamp;        // 捕获时间戳
+// fanout模式下的一个抓包线程
+struct FanoutWorker {
+    FanoutWorker()
+        : index(0), served_epoch(0), front(0), building(false), publish_pending(false), building_epoch(0),
+          reported_frames(0), kernel_packets(0), kernel_drops(0) {}
+
+    size_t index;
+    AfPacketCapture capture;             // 加入同一fanout组的独立套接字
+    AnalyzerContext context;             // 线程私有状态，不与其他线程共享
+    std::thread thread;
+    std::atomic<unsigned> served_epoch;  // 已发布的快照所响应的报告请求编号
+    // 双缓冲快照：主线程持有snapshot_mutex读取snapshots[front]；线程在另一份中分多轮生成下一份，
+    // 完成后只在交换front时try_lock，抓包线程从不等待主线程
+    std::mutex snapshot_mutex;
+    FanoutSnapshot snapshots[2];
+    unsigned front;
+    bool building;                       // 以下为线程私有：正在生成快照
+    bool publish_pending;                // 快照已生成，等待交换front
+    unsigned building_epoch;             // 正在响应的报告请求编号
+    FlowTableScan flow_scan;             // 分步扫描流表的进度
+    uint64_t reported_frames;            // 最近一次合并的快照中的帧数（主线程读写）
+    uint64_t kernel_packets;             // 内核累计收到的包数（主线程读取）
+    uint64_t kernel_drops;               // 内核累计丢弃的包数（主线程读取）
 };
 
 // 函数声明
 void packet_handler(u_char *user_data, const struct pcap_pkthdr* pkthdr, const u_char* packet);
-void print_packet_info(const IPPacketInfo& packet_info, int packet_count);
-string get_protocol_name(uint8_t protocol);
-void print_flags_info(uint8_t flags);
-void print_ip_header(const struct ip* ip_header, const IPPacketInfo& packet_info);
+bool decode_packet(const u_char* packet, uint32_t caplen, const struct timeval& capture_ts, CaptureStats& stats,
+                   FragmentReassembler& fragments, TcpReassembler& streams, DnsCounters& dns,
+                   IPPacketInfo& packet_info);
+bool select_link_decoder(pcap_t* handle);
+const char* default_kernel_filter(int datalink);
+void record_packet(AnalyzerContext& context, const IPPacketInfo& packet_info, uint64_t number);
+bool reassemble_fragment(FragmentReassembler& reassembler, const IPv4HeaderView& ip_view,
+                         IPPacketInfo& packet_info, IPv4HeaderView& datagram);
+void pipeline_capture_handler(u_char *user_data, const struct pcap_pkthdr* pkthdr, const u_char* packet);
+bool pipeline_decode(const PipelineFrame& frame, IPPacketInfo& packet_info, void* worker_context);
+void pipeline_consume(const IPPacketInfo& packet_info, uint64_t number, void* consumer_context);
+void pipeline_finish(void* consumer_context);
+void pipeline_idle(void* consumer_context);
+void pipeline_decode_idle(void* worker_context);
+void expire_idle_streams(TcpReassembler& streams);
 void list_all_devices();
 string get_device_by_index(int index);
+void print_usage(const char* program);
+int run_offline(const char* pcap_file, const char* filter_exp, bool nanosecond);
+pcap_t* open_live_handle(const string& device, const LiveCaptureConfig& config);
+int capture_live(pcap_t* handle, unsigned stats_interval);
+void install_stop_handlers();
+void handle_stop_signal(int signo);
+void start_duration_timer();
+void finish_output();
+void export_flow_record(const FlowRecord& record, void* context);
+bool start_packet_dump(int linktype, int snaplen, int tstamp_precision);
+void report_pcap_stats(pcap_t* handle, struct pcap_stat& previous, bool final_report);
+int run_afpacket(const string& device, size_t block_size, size_t block_count);
+bool compile_kernel_filter(const char* filter_exp, vector<struct sock_filter>& program);
+uint64_t process_afpacket_block(AfPacketBlock& block, AnalyzerContext& context, uint64_t max_frames);
+int run_fanout(const string& device, size_t worker_count, size_t block_size, size_t block_count,
+               size_t store_packets, time_t store_seconds, size_t store_memory_bytes,
+               size_t flow_capacity, uint32_t flow_timeout, size_t reassembly_memory_bytes,
+               uint32_t reassembly_timeout, size_t tcp_memory_bytes, size_t tcp_connection_bytes,
+               size_t tcp_connections, uint32_t tcp_timeout, size_t topk_capacity, size_t dns_capacity,
+               unsigned distinct_precision, unsigned report_interval);
+void fanout_worker_loop(FanoutWorker* worker);
+uint64_t claim_fanout_frames(uint64_t frames);
+void begin_worker_snapshot(FanoutWorker* worker, unsigned epoch);
+bool continue_worker_snapshot(FanoutWorker* worker, size_t max_flow_entries);
+bool publish_worker_snapshot(FanoutWorker* worker, bool wait);
+void collect_fanout_stats(vector<std::unique_ptr<FanoutWorker> >& workers, bool request_snapshot, CaptureStats& merged,
+                          FlowTableSummary& merged_flows, ReassemblyStats& merged_reassembly,
+                          TcpStreamStats& merged_streams, HeavyHitterSummary& merged_talkers,
+                          DnsSummary& merged_dns, DistinctCounters& merged_distinct, RateStats& merged_rates);
+void print_capture_stats(ostream& os, const CaptureStats& stats);
+void print_flow_summary(ostream& os, const FlowTableSummary& summary, size_t capacity);
+void print_reassembly_stats(ostream& os, const ReassemblyStats& stats, size_t memory_bytes);
+void print_tcp_stream_stats(ostream& os, const TcpStreamStats& stats, size_t memory_bytes);
+void print_heavy_hitters(ostream& os, const HeavyHitterSummary& summary, size_t capacity);
+void print_dns_stats(ostream& os, const DnsSummary& summary, size_t capacity);
+void print_distinct_counts(ostream& os, const DistinctCounters& distinct, const char* window);
+void emit_interval_report(AnalyzerContext& context);
+bool init_rate_stats(RateStats& rates);
+void print_rate_stats(ostream& os, const RateStats& rates);
+void emit_rate_line(const RateStats& rates, time_t second);
+void emit_report(const string& report, bool final_report);
+void print_run_summary(const char* title, double elapsed_seconds);
+void print_store_summary(const PacketRingStore<IPPacketInfo>& store);
+void print_output_stats(ostream& os);
+bool parse_number_arg(const char* text, unsigned long long& value);
+
+// 实时抓包默认配置
+const int DEFAULT_SNAPLEN = 65535;               // 默认快照长度（覆盖最大IP包）
+const size_t DEFAULT_PCAP_BUFFER_MB = 32;        // 默认内核缓冲区（MB），libpcap自身的默认值在Linux上只有2MB
+const int PCAP_READ_TIMEOUT_MS = 1000;           // 读超时，也是定期输出pcap_stats的最大延迟
+const unsigned DEFAULT_STATS_INTERVAL = 10;      // 默认每10秒输出一次内核收包/丢包计数
+
+// 包存储默认配置
+const size_t DEFAULT_STORE_PACKETS = 100000;     // 默认最多保留的包数
+const size_t DEFAULT_STORE_MEMORY_MB = 64;       // 默认内存预算（MB）
+
+// 流水线默认配置
+const size_t DEFAULT_RING_SIZE = 4096;           // 每个解码线程的输入环/结果环槽位数
+
+// 流表默认配置
+const size_t DEFAULT_FLOW_CAPACITY = 262144;     // 默认最多同时跟踪的流数
+const uint32_t DEFAULT_FLOW_TIMEOUT = 60;        // 默认流空闲超时（秒）
+const size_t FLOW_REPORT_TOP = 10;               // 报告中列出的流数
+const size_t FLOW_SCAN_STEP = 16384;             // fanout线程生成快照时每轮循环最多扫描的流表槽位数
+
+// 分片重组默认配置
+const size_t DEFAULT_REASSEMBLY_MEMORY_MB = 16;  // 默认重组缓冲池内存上限（MB）
+const uint32_t DEFAULT_REASSEMBLY_TIMEOUT = 30;  // 默认重组超时（秒）
+
+// TCP流重组默认配置
+const size_t DEFAULT_TCP_MEMORY_MB = 0;          // 默认乱序缓冲池内存上限（MB），0为不重组
+const size_t DEFAULT_TCP_CONNECTION_KB = 256;    // 默认单连接最多缓存的乱序数据（KB）
+const size_t DEFAULT_TCP_CONNECTIONS = 65536;    // 默认最多同时跟踪的连接数
+const uint32_t DEFAULT_TCP_TIMEOUT = 60;         // 默认连接空闲超时（秒）
+
+// Top-K默认配置
+const size_t DEFAULT_TOPK_CAPACITY = 1024;       // 每类Top-K的计数器数
+const size_t TOPK_REPORT_TOP = 10;               // 报告中每类列出的条数
+const size_t TOPK_WORKER_TOP = 40;               // fanout模式下每个线程上报的条数（合并后再取前TOPK_REPORT_TOP）
+
+// DNS统计默认配置
+const size_t DEFAULT_DNS_CAPACITY = 1024;        // 查询名/类型Top-K的计数器数，0为不解析DNS
+
+// 写文件默认配置
+const size_t DEFAULT_DUMP_QUEUE = 8192;          // 写文件队列槽位数（每个槽位一帧，约16MB）
+
+// 去重计数默认配置
+const unsigned DEFAULT_DISTINCT_PRECISION = 14;  // HyperLogLog精度：2^14个寄存器，误差约0.8%
 
 // 全局变量
-vector<IPPacketInfo> captured_packets;
-int packet_count = 0;
+AnalyzerContext main_context;                    // 单线程/流水线模式的分析状态
+OutputWriter output_writer;                      // 逐包输出的后台写线程
+CapturePipeline<IPPacketInfo> pipeline;          // 采集/解码/汇总流水线（--pipeline启用）
+pcap_handler capture_handler = packet_handler;   // pcap回调：单线程内联处理或送入流水线
+LinkDecoder link_decoder = decode_ethernet_link; // 链路层解码函数，打开句柄后按链路类型选定（AF_PACKET总是以太网）
+vector<DecodeWorkerContext> pipeline_decoders;  // 流水线模式下每个解码线程的私有状态
+PacketFilter packet_filter;                      // 用户态过滤器（--match），为空时不过滤
+vector<struct sock_filter> afpacket_filter;      // AF_PACKET套接字挂载的BPF程序（--filter），为空时只接收IP包
+bool reassembly_enabled = false;                 // 是否重组分片（启用时分片只在重组完成后计入流表）
+bool tcp_reassembly_enabled = false;             // 是否重组TCP流（--tcp-memory）
+bool dns_enabled = false;                        // 是否解析DNS报文（--dns-top-k）
+bool l4_checksum_enabled = false;                // 是否校验TCP/UDP/ICMP校验和（--l4-checksum）
+bool nanosecond_timestamps = false;              // 抓包句柄的时间戳为纳秒精度（分析路径换算为微秒，记录和写文件保留纳秒）
+std::atomic<unsigned> report_epoch(0);           // fanout报告请求编号，递增表示请求新快照
+std::atomic<uint64_t> fanout_claimed(0);         // fanout线程已认领的帧数（--count）
+time_t inline_report_interval = 0;               // 单线程/流水线模式下按包时间定期输出报告（秒，0为不输出）
+std::atomic<bool> stop_requested(false);         // 收到SIGINT/SIGTERM或到达--duration时置位，各抓包循环据此退出
+std::atomic<pcap_t*> active_handle(nullptr);     // 正在抓包的pcap句柄，信号处理函数对它调用pcap_breakloop
+uint64_t capture_limit = 0;                      // --count：处理这么多帧后停止（0为不限）
+unsigned capture_duration = 0;                   // --duration：抓包开始后运行这么多秒后停止（0为不限）
+bool quiet_mode = false;            // 静默模式：不逐包打印
+bool summary_mode = false;          // 实时摘要模式：每秒输出一行速率摘要，代替逐包打印
+ExportFormat export_format = EXPORT_TEXT;  // --format：逐包/逐流记录的输出格式
+bool export_flows = false;          // --records flows：输出流记录（超时时和结束时），不输出逐包记录
+PcapDumpConfig dump_config;         // --write：原始帧写入（轮转的）pcap文件，path为空时不写
+PcapDumpRing packet_dump;           // 写文件的队列和后台线程
+
+int main(int argc, char *argv[]) {
+    const char *pcap_file = NULL;
+    unsigned long long store_packets = DEFAULT_STORE_PACKETS;
+    unsigned long long store_seconds = 0;
+    unsigned long long store_memory_mb = DEFAULT_STORE_MEMORY_MB;
+    unsigned long long pipeline_workers = 0;
+    unsigned long long ring_size = DEFAULT_RING_SIZE;
+    const char *interface_name = NULL;
+    bool use_afpacket = false;
+    unsigned long long afp_block_kb = AfPacketCapture::DEFAULT_BLOCK_SIZE / 1024;
+    unsigned long long afp_blocks = AfPacketCapture::DEFAULT_BLOCK_COUNT;
+    unsigned long long fanout_workers = 0;
+    unsigned long long report_interval = 0;
+    const char *filter_exp = NULL;  // 内核BPF过滤表达式，默认按链路类型只捕获IP包（见default_kernel_filter）
+    bool filter_given = false;
+    const char *match_exp = NULL;   // 用户态过滤表达式
+    bool match_dump = false;
+    unsigned long long flow_capacity = DEFAULT_FLOW_CAPACITY;
+    unsigned long long flow_timeout = DEFAULT_FLOW_TIMEOUT;
+    unsigned long long reassembly_memory_mb = DEFAULT_REASSEMBLY_MEMORY_MB;
+    unsigned long long reassembly_timeout = DEFAULT_REASSEMBLY_TIMEOUT;
+    unsigned long long tcp_memory_mb = DEFAULT_TCP_MEMORY_MB;
+    unsigned long long tcp_connection_kb = DEFAULT_TCP_CONNECTION_KB;
+    unsigned long long tcp_connections = DEFAULT_TCP_CONNECTIONS;
+    unsigned long long tcp_timeout = DEFAULT_TCP_TIMEOUT;
+    unsigned long long topk_capacity = DEFAULT_TOPK_CAPACITY;
+    unsigned long long dns_capacity = DEFAULT_DNS_CAPACITY;
+    unsigned long long distinct_precision = DEFAULT_DISTINCT_PRECISION;
+    unsigned long long snaplen = DEFAULT_SNAPLEN;
+    unsigned long long pcap_buffer_mb = DEFAULT_PCAP_BUFFER_MB;
+    unsigned long long stats_interval = DEFAULT_STATS_INTERVAL;
+    bool immediate_mode = false;
+    bool tstamp_nano = false;
+    unsigned long long count = 0;
+    unsigned long long duration = 0;
+    const char *output_file = NULL;
+    const char *records = "packets";
+    unsigned long long dump_size_mb = 0;
+    unsigned long long dump_seconds = 0;
+    unsigned long long dump_files = 0;
+
+    // 长选项对应的值（无短选项）
+    enum {
+        OPT_STORE_PACKETS = 256,
+        OPT_STORE_SECONDS,
+        OPT_STORE_MEMORY,
+        OPT_PIPELINE,
+        OPT_RING_SIZE,
+        OPT_BACKEND,
+        OPT_AFP_BLOCK_SIZE,
+        OPT_AFP_BLOCKS,
+        OPT_FANOUT,
+        OPT_REPORT_INTERVAL,
+        OPT_FLOWS,
+        OPT_FLOW_TIMEOUT,
+        OPT_REASSEMBLY_MEMORY,
+        OPT_REASSEMBLY_TIMEOUT,
+        OPT_TCP_MEMORY,
+        OPT_TCP_CONNECTION_MEMORY,
+        OPT_TCP_CONNECTIONS,
+        OPT_TCP_TIMEOUT,
+        OPT_L4_CHECKSUM,
+        OPT_FILTER,
+        OPT_MATCH,
+        OPT_MATCH_DUMP,
+        OPT_TOP_K,
+        OPT_DNS_TOP_K,
+        OPT_DISTINCT_PRECISION,
+        OPT_SUMMARY,
+        OPT_SNAPLEN,
+        OPT_BUFFER_SIZE,
+        OPT_IMMEDIATE,
+        OPT_TSTAMP_NANO,
+        OPT_STATS_INTERVAL,
+        OPT_FORMAT,
+        OPT_RECORDS,
+        OPT_DUMP_SIZE,
+        OPT_DUMP_SECONDS,
+        OPT_DUMP_FILES
+    };
+
+    // 解析命令行参数
+    static const struct option long_options[] = {
+        {"read",          required_argument, NULL, 'r'},
+        {"quiet",         no_argument,       NULL, 'q'},
+        {"store-packets", required_argument, NULL, OPT_STORE_PACKETS},
+        {"store-seconds", required_argument, NULL, OPT_STORE_SECONDS},
+        {"store-memory",  required_argument, NULL, OPT_STORE_MEMORY},
+        {"pipeline",      required_argument, NULL, OPT_PIPELINE},
+        {"ring-size",     required_argument, NULL, OPT_RING_SIZE},
+        {"interface",     required_argument, NULL, 'i'},
+        {"backend",       required_argument, NULL, OPT_BACKEND},
+        {"afp-block-size", required_argument, NULL, OPT_AFP_BLOCK_SIZE},
+        {"afp-blocks",    required_argument, NULL, OPT_AFP_BLOCKS},
+        {"fanout",        required_argument, NULL, OPT_FANOUT},
+        {"report-interval", required_argument, NULL, OPT_REPORT_INTERVAL},
+        {"flows",         required_argument, NULL, OPT_FLOWS},
+        {"flow-timeout",  required_argument, NULL, OPT_FLOW_TIMEOUT},
+        {"reassembly-memory", required_argument, NULL, OPT_REASSEMBLY_MEMORY},
+        {"reassembly-timeout", required_argument, NULL, OPT_REASSEMBLY_TIMEOUT},
+        {"tcp-memory",    required_argument, NULL, OPT_TCP_MEMORY},
+        {"tcp-connection-memory", required_argument, NULL, OPT_TCP_CONNECTION_MEMORY},
+        {"tcp-connections", required_argument, NULL, OPT_TCP_CONNECTIONS},
+        {"tcp-timeout",   required_argument, NULL, OPT_TCP_TIMEOUT},
+        {"l4-checksum",   no_argument,       NULL, OPT_L4_CHECKSUM},
+        {"filter",        required_argument, NULL, OPT_FILTER},
+        {"match",         required_argument, NULL, OPT_MATCH},
+        {"match-dump",    no_argument,       NULL, OPT_MATCH_DUMP},
+        {"top-k",         required_argument, NULL, OPT_TOP_K},
+        {"dns-top-k",     required_argument, NULL, OPT_DNS_TOP_K},
+        {"distinct-precision", required_argument, NULL, OPT_DISTINCT_PRECISION},
+        {"summary",       no_argument,       NULL, OPT_SUMMARY},
+        {"snaplen",       required_argument, NULL, OPT_SNAPLEN},
+        {"buffer-size",   required_argument, NULL, OPT_BUFFER_SIZE},
+        {"immediate",     no_argument,       NULL, OPT_IMMEDIATE},
+        {"tstamp-nano",   no_argument,       NULL, OPT_TSTAMP_NANO},
+        {"stats-interval", required_argument, NULL, OPT_STATS_INTERVAL},
+        {"count",         required_argument, NULL, 'c'},
+        {"duration",      required_argument, NULL, 'd'},
+        {"output",        required_argument, NULL, 'o'},
+        {"format",        required_argument, NULL, OPT_FORMAT},
+        {"records",       required_argument, NULL, OPT_RECORDS},
+        {"write",         required_argument, NULL, 'w'},
+        {"dump-size",     required_argument, NULL, OPT_DUMP_SIZE},
+        {"dump-seconds",  required_argument, NULL, OPT_DUMP_SECONDS},
+        {"dump-files",    required_argument, NULL, OPT_DUMP_FILES},
+        {"help",          no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "r:i:c:d:o:w:qh", long_options, NULL)) != -1) {
+        switch (opt) {
+            case OPT_STORE_PACKETS:
+            case OPT_STORE_SECONDS:
+            case OPT_STORE_MEMORY:
+            case OPT_PIPELINE:
+            case OPT_RING_SIZE:
+            case OPT_AFP_BLOCK_SIZE:
+            case OPT_AFP_BLOCKS:
+            case OPT_FANOUT:
+            case OPT_REPORT_INTERVAL:
+            case OPT_FLOWS:
+            case OPT_FLOW_TIMEOUT:
+            case OPT_REASSEMBLY_MEMORY:
+            case OPT_REASSEMBLY_TIMEOUT:
+            case OPT_TCP_MEMORY:
+            case OPT_TCP_CONNECTION_MEMORY:
+            case OPT_TCP_CONNECTIONS:
+            case OPT_TCP_TIMEOUT:
+            case OPT_TOP_K:
+            case OPT_DNS_TOP_K:
+            case OPT_DISTINCT_PRECISION:
+            case OPT_SNAPLEN:
+            case OPT_BUFFER_SIZE:
+            case OPT_STATS_INTERVAL:
+            case OPT_DUMP_SIZE:
+            case OPT_DUMP_SECONDS:
+            case OPT_DUMP_FILES:
+            case 'c':
+            case 'd': {
+                unsigned long long value;
+                if (!parse_number_arg(optarg, value)) {
+                    cerr << "错误：无效的数值参数 - " << optarg << endl;
+                    return 1;
+                }
+                // 以MB/KB为单位的内存参数换算成字节后不能超出size_t
+                unsigned long long unit = 1;
+                if (opt == OPT_STORE_MEMORY || opt == OPT_REASSEMBLY_MEMORY || opt == OPT_TCP_MEMORY) {
+                    unit = 1024 * 1024;
+                } else if (opt == OPT_TCP_CONNECTION_MEMORY || opt == OPT_AFP_BLOCK_SIZE) {
+                    unit = 1024;
+                }
+                if (value > SIZE_MAX / unit) {
+                    cerr << "错误：内存参数过大 - " << optarg << "（最大" << SIZE_MAX / unit
+                         << (unit == 1024 ? "KB" : "MB") << "）" << endl;
+                    return 1;
+                }
+                if (opt == OPT_STORE_PACKETS) {
+                    store_packets = value;
+                } else if (opt == OPT_STORE_SECONDS) {
+                    store_seconds = value;
+                } else if (opt == OPT_STORE_MEMORY) {
+                    store_memory_mb = value;
+                } else if (opt == OPT_PIPELINE) {
+                    pipeline_workers = value;
+                } else if (opt == OPT_RING_SIZE) {
+                    ring_size = value;
+                } else if (opt == OPT_AFP_BLOCK_SIZE) {
+                    afp_block_kb = value;
+                } else if (opt == OPT_AFP_BLOCKS) {
+                    afp_blocks = value;
+                } else if (opt == OPT_FANOUT) {
+                    fanout_workers = value;
+                } else if (opt == OPT_FLOWS) {
+                    flow_capacity = value;
+                } else if (opt == OPT_FLOW_TIMEOUT) {
+                    flow_timeout = value;
+                } else if (opt == OPT_REASSEMBLY_MEMORY) {
+                    reassembly_memory_mb = value;
+                } else if (opt == OPT_REASSEMBLY_TIMEOUT) {
+                    reassembly_timeout = value;
+                } else if (opt == OPT_TCP_MEMORY) {
+                    tcp_memory_mb = value;
+                } else if (opt == OPT_TCP_CONNECTION_MEMORY) {
+                    tcp_connection_kb = value;
+                } else if (opt == OPT_TCP_CONNECTIONS) {
+                    tcp_connections = value;
+                } else if (opt == OPT_TCP_TIMEOUT) {
+                    tcp_timeout = value;
+                } else if (opt == OPT_TOP_K) {
+                    topk_capacity = value;
+                } else if (opt == OPT_DNS_TOP_K) {
+                    dns_capacity = value;
+                } else if (opt == OPT_DISTINCT_PRECISION) {
+                    distinct_precision = value;
+                } else if (opt == OPT_SNAPLEN) {
+                    snaplen = value;
+                } else if (opt == OPT_BUFFER_SIZE) {
+                    pcap_buffer_mb = value;
+                } else if (opt == OPT_STATS_INTERVAL) {
+                    stats_interval = value;
+                } else if (opt == OPT_DUMP_SIZE) {
+                    dump_size_mb = value;
+                } else if (opt == OPT_DUMP_SECONDS) {
+                    dump_seconds = value;
+                } else if (opt == OPT_DUMP_FILES) {
+                    dump_files = value;
+                } else if (opt == 'c') {
+                    count = value;
+                } else if (opt == 'd') {
+                    duration = value;
+                } else {
+                    report_interval = value;
+                }
+                break;
+            }
+            case OPT_BACKEND:
+                if (strcmp(optarg, "pcap") == 0) {
+                    use_afpacket = false;
+                } else if (strcmp(optarg, "afpacket") == 0) {
+                    use_afpacket = true;
+                } else {
+                    cerr << "错误：未知的抓包后端 - " << optarg << "（可选pcap或afpacket）" << endl;
+                    return 1;
+                }
+                break;
+            case OPT_L4_CHECKSUM:
+                l4_checksum_enabled = true;
+                break;
+            case OPT_FILTER:
+                filter_exp = optarg;
+                filter_given = true;
+                break;
+            case OPT_MATCH:
+                match_exp = optarg;
+                break;
+            case OPT_MATCH_DUMP:
+                match_dump = true;
+                break;
+            case OPT_SUMMARY:
+                summary_mode = true;
+                break;
+            case OPT_IMMEDIATE:
+                immediate_mode = true;
+                break;
+            case OPT_TSTAMP_NANO:
+                tstamp_nano = true;
+                break;
+            case OPT_FORMAT:
+                if (!parse_export_format(optarg, export_format)) {
+                    cerr << "错误：未知的输出格式 " << optarg << "（可选text/jsonl/csv）" << endl;
+                    return 1;
+                }
+                break;
+            case OPT_RECORDS:
+                records = optarg;
+                break;
+            case 'i':
+                interface_name = optarg;
+                break;
+            case 'o':
+                output_file = optarg;
+                break;
+            case 'w':
+                dump_config.path = optarg;
+                break;
+            case 'r':
+                pcap_file = optarg;
+                break;
+            case 'q':
+                quiet_mode = true;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    // 用户态过滤器在启动时编译一次
+    if (match_exp != NULL && !packet_filter.compile(match_exp)) {
+        cerr << "错误：无法编译--match表达式 - " << packet_filter.error() << endl;
+        return 1;
+    }
+    if (match_dump) {
+        if (packet_filter.empty()) {
+            cerr << "错误：--match-dump需要同时指定--match" << endl;
+            return 1;
+        }
+        packet_filter.dump(cout);
+        return 0;
+    }
+
+    if (snaplen == 0 || snaplen > 262144 || pcap_buffer_mb > 2047 || stats_interval > 0xFFFFFFFFull) {
+        cerr << "错误：无效的抓包参数，请检查--snaplen(1~262144)/--buffer-size(MB)/--stats-interval参数" << endl;
+        return 1;
+    }
+
+    // pcap_loop/pcap_dispatch的包数参数是int；alarm的秒数是unsigned
+    if (count > INT_MAX || duration > UINT_MAX) {
+        cerr << "错误：--count不能超过" << INT_MAX << "，--duration不能超过" << UINT_MAX << "秒" << endl;
+        return 1;
+    }
+    capture_limit = count;
+    capture_duration = static_cast<unsigned>(duration);
+
+    // 机器可读格式：标准输出只写记录，横幅、报告和最终统计改写到标准错误，
+    // 便于直接用管道交给jq或导入表格/数据库
+    if (strcmp(records, "packets") != 0 && strcmp(records, "flows") != 0) {
+        cerr << "错误：--records只能是packets或flows" << endl;
+        return 1;
+    }
+    export_flows = strcmp(records, "flows") == 0;
+    if (export_format == EXPORT_TEXT && export_flows) {
+        cerr << "错误：--records flows需要同时指定--format jsonl或csv" << endl;
+        return 1;
+    }
+    if (export_flows && flow_capacity == 0) {
+        cerr << "错误：--records flows需要启用流表（--flows不能为0）" << endl;
+        return 1;
+    }
+    if (export_format != EXPORT_TEXT && summary_mode) {
+        cerr << "错误：--summary不能与--format jsonl/csv同时使用" << endl;
+        return 1;
+    }
+    if (export_format != EXPORT_TEXT) {
+        cout.rdbuf(cerr.rdbuf());
+    }
+
+    // 脚本中运行时标准输入不是终端，没有-i就无法交互式选择网卡，直接报错而不是阻塞在输入上
+    if (pcap_file == NULL && interface_name == NULL && !isatty(STDIN_FILENO)) {
+        cerr << "错误：非交互运行时需要用-i指定网卡（或用-r回放文件）" << endl;
+        return 1;
+    }
+
+    if (fanout_workers > 0 && (pipeline_workers > 0 || pcap_file != NULL)) {
+        cerr << "错误：--fanout不能与--pipeline或--read同时使用" << endl;
+        return 1;
+    }
+
+    // 写文件：队列是单生产者的，只接收一个采集线程（单线程、流水线采集线程或AF_PACKET循环）的帧
+    if (!dump_config.path.empty()) {
+        if (fanout_workers > 0) {
+            cerr << "错误：--write不能与--fanout同时使用" << endl;
+            return 1;
+        }
+        if (dump_files == 1 || dump_files > 0xFFFFFFFFull || dump_seconds > 0xFFFFFFFFull ||
+            dump_size_mb > 0xFFFFFFFFull) {
+            cerr << "错误：无效的写文件参数，--dump-files为0（不限）或不少于2" << endl;
+            return 1;
+        }
+        dump_config.rotate_bytes = dump_size_mb * 1024 * 1024;
+        dump_config.rotate_seconds = static_cast<uint32_t>(dump_seconds);
+        dump_config.file_count = static_cast<unsigned>(dump_files);
+        dump_config.queue_frames = DEFAULT_DUMP_QUEUE;
+        dump_config.block_when_full = pcap_file != NULL;
+    } else if (dump_size_mb > 0 || dump_seconds > 0 || dump_files > 0) {
+        cerr << "错误：--dump-size/--dump-seconds/--dump-files需要同时指定--write" << endl;
+        return 1;
+    }
+
+    // 预分配包存储，之后捕获过程中不再扩容（fanout模式下由各线程分别分配）
+    if (fanout_workers == 0 &&
+        !main_context.store.init(store_packets, store_seconds, store_memory_mb * 1024 * 1024)) {
+        cerr << "错误：包存储容量为0，请检查--store-packets/--store-memory参数" << endl;
+        return 1;
+    }
+
+    if (flow_capacity > 0 && (flow_timeout == 0 || flow_timeout > 0xFFFFFF || flow_capacity >= 0xFFFFFFFFull)) {
+        cerr << "错误：无效的流表参数，请检查--flows/--flow-timeout参数" << endl;
+        return 1;
+    }
+
+    // 预分配流表（fanout模式下由各线程分别分配）
+    if (fanout_workers == 0 && flow_capacity > 0 &&
+        !main_context.flows.init(flow_capacity, flow_timeout)) {
+        cerr << "错误：无法分配流表，请检查--flows/--flow-timeout参数" << endl;
+        return 1;
+    }
+    if (export_flows) {
+        main_context.flows.set_expire_callback(export_flow_record, NULL);
+    }
+
+    // 预分配Top-K计数器（fanout模式下由各线程分别分配，每个线程都需要完整容量，
+    // 因为同一地址的包会分散到多个线程）
+    if (topk_capacity >= 0xFFFFFFFFull ||
+        (fanout_workers == 0 && topk_capacity > 0 && !main_context.talkers.init(topk_capacity))) {
+        cerr << "错误：无法分配Top-K计数器，请检查--top-k参数" << endl;
+        return 1;
+    }
+
+    // 分配去重计数寄存器（fanout模式下由各线程分别分配，报告时合并）
+    if (distinct_precision > 0 &&
+        (distinct_precision < HyperLogLog::MIN_PRECISION || distinct_precision > HyperLogLog::MAX_PRECISION ||
+         (fanout_workers == 0 && !main_context.distinct.init(static_cast<unsigned>(distinct_precision))))) {
+        cerr << "错误：无效的--distinct-precision参数（0或4~18）" << endl;
+        return 1;
+    }
+    if (fanout_workers == 0) {
+        inline_report_interval = static_cast<time_t>(report_interval);
+        init_rate_stats(main_context.rates);
+    }
+
+    // 预分配分片重组缓冲池：单线程模式归main_context，流水线模式由解码线程平分，
+    // fanout模式由各抓包线程分别分配
+    reassembly_enabled = reassembly_memory_mb > 0;
+    if (reassembly_enabled) {
+        size_t reassembly_bytes = reassembly_memory_mb * 1024 * 1024;
+        bool ok = reassembly_timeout > 0 && reassembly_timeout <= 0xFFFFFFFFull;
+        if (ok && pipeline_workers > 0) {
+            pipeline_decoders.resize(pipeline_workers);
+            for (size_t i = 0; ok && i < pipeline_decoders.size(); ++i) {
+                ok = pipeline_decoders[i].fragments.init(reassembly_bytes / pipeline_workers, reassembly_timeout);
+            }
+        } else if (ok && fanout_workers == 0) {
+            ok = main_context.fragments.init(reassembly_bytes, reassembly_timeout);
+        }
+        if (!ok) {
+            cerr << "错误：无法分配分片重组缓冲池，请检查--reassembly-memory/--reassembly-timeout参数" << endl;
+            return 1;
+        }
+    }
+
+    // 预分配TCP流重组的缓冲池和连接槽位，按线程划分的方式与分片重组相同
+    tcp_reassembly_enabled = tcp_memory_mb > 0;
+    if (tcp_reassembly_enabled) {
+        size_t tcp_bytes = tcp_memory_mb * 1024 * 1024;
+        bool ok = tcp_timeout > 0 && tcp_timeout <= 0xFFFFFFFFull;
+        if (ok && pipeline_workers > 0) {
+            pipeline_decoders.resize(pipeline_workers);
+            size_t per_worker_connections = (tcp_connections + pipeline_workers - 1) / pipeline_workers;
+            for (size_t i = 0; ok && i < pipeline_decoders.size(); ++i) {
+                ok = pipeline_decoders[i].streams.init(tcp_bytes / pipeline_workers, tcp_connection_kb * 1024,
+                                                       per_worker_connections, tcp_timeout);
+            }
+        } else if (ok && fanout_workers == 0) {
+            ok = main_context.streams.init(tcp_bytes, tcp_connection_kb * 1024, tcp_connections, tcp_timeout);
+        }
+        if (!ok) {
+            cerr << "错误：无法分配TCP流重组缓冲池，请检查--tcp-memory/--tcp-connection-memory/"
+                    "--tcp-connections/--tcp-timeout参数" << endl;
+            return 1;
+        }
+    }
+
+    // 预分配DNS查询名计数器：DNS在解码阶段解析，流水线模式下归各解码线程；
+    // 与Top-K一样每个线程都需要完整容量（同一名字的查询来自不同的地址对）。
+    // 启用TCP流重组时同时注册为同一线程的重组器的消费者，解析DNS-over-TCP
+    dns_enabled = dns_capacity > 0;
+    if (dns_enabled) {
+        bool ok = dns_capacity < 0xFFFFFFFFull;
+        if (ok && pipeline_workers > 0) {
+            pipeline_decoders.resize(pipeline_workers);
+            for (size_t i = 0; ok && i < pipeline_decoders.size(); ++i) {
+                ok = pipeline_decoders[i].dns.init(dns_capacity) &&
+                     (!tcp_reassembly_enabled || pipeline_decoders[i].dns.enable_tcp(pipeline_decoders[i].streams));
+            }
+        } else if (ok && fanout_workers == 0) {
+            ok = main_context.dns.init(dns_capacity) &&
+                 (!tcp_reassembly_enabled || main_context.dns.enable_tcp(main_context.streams));
+        }
+        if (!ok) {
+            cerr << "错误：无法分配DNS查询名计数器，请检查--dns-top-k参数" << endl;
+            return 1;
+        }
+    }
+
+    // --output：把标准输出重定向到文件，逐包输出、报告和最终统计都写入该文件，错误信息仍写标准错误
+    if (output_file != NULL) {
+        int fd = open(output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || dup2(fd, STDOUT_FILENO) < 0) {
+            cerr << "错误：无法打开输出文件 " << output_file << " - " << strerror(errno) << endl;
+            return 1;
+        }
+        close(fd);
+    }
+
+    // 启动后台输出线程：回放时攒满缓冲区再写；实时捕获时另有定时刷新，输出跟不上时丢弃记录而不阻塞抓包
+    if (!output_writer.start(STDOUT_FILENO, pcap_file == NULL)) {
+        cerr << "错误：无法启动输出线程" << endl;
+        return 1;
+    }
+    if (export_format == EXPORT_CSV) {
+        OutputBuffer& out = output_writer.begin_record();
+        if (export_flows) {
+            export_flow_header(out, export_format);
+        } else {
+            export_packet_header(out, export_format);
+        }
+        output_writer.end_record();
+        // 列名留在本线程的缓冲区中会晚于流水线/fanout线程提交的记录，先写出
+        output_writer.flush();
+    }
+
+    // 流水线模式：采集线程只复制帧，解码和存储/打印在独立线程中进行
+    if (pipeline_workers > 0) {
+        pipeline_decoders.resize(pipeline_workers);
+        vector<void*> worker_contexts(pipeline_workers);
+        for (size_t i = 0; i < pipeline_decoders.size(); ++i) {
+            worker_contexts[i] = &pipeline_decoders[i];
+        }
+        pipeline.set_idle_callback(pipeline_idle);
+        if (pcap_file == NULL) {
+            pipeline.set_worker_idle_callback(pipeline_decode_idle);
+        }
+        // pcap后端按快照长度截取，离线文件和AF_PACKET按最大快照长度
+        size_t pipeline_frame_size = (pcap_file == NULL && !use_afpacket) ? snaplen : PIPELINE_MAX_FRAME_SIZE;
+        if (ring_size == 0 ||
+            !pipeline.start(pipeline_workers, ring_size, pipeline_frame_size, pcap_file != NULL,
+                            pipeline_decode, pipeline_consume, pipeline_finish, &main_context,
+                            worker_contexts.data())) {
+            cerr << "错误：无法启动流水线，请检查--pipeline/--ring-size参数" << endl;
+            return 1;
+        }
+        capture_handler = pipeline_capture_handler;
+    }
+
+    // 离线回放模式：无需交互和管理员权限
+    if (pcap_file != NULL) {
+        install_stop_handlers();
+        int result = run_offline(pcap_file, filter_exp, tstamp_nano);
+        output_writer.stop();
+        return result;
+    }
 
-int main() {
     cout << "========================================" << endl;
     cout << "     IP包捕获与解析程序" << endl;
     cout << "========================================" << endl;
@@ -68,60 +813,1336 @@ int main() {
     pcap_t *handle;
     char errbuf[PCAP_ERRBUF_SIZE];
     struct bpf_program fp;
-    const char *filter_exp = "ip";  // 只捕获IP包
-    bpf_u_int32 net;
+    bpf_u_int32 net = 0;
+    bpf_u_int32 mask = PCAP_NETMASK_UNKNOWN;
 
-    // 列出所有可用网络设备
-    cout << "正在检测网络设备..." << endl;
-    list_all_devices();
-    
-    cout << "\n请选择要监听的网卡索引号(0-9): ";
-    int device_index;
-    cin >> device_index;
-    
-    string device = get_device_by_index(device_index);
-    if (device.empty()) {
-        cerr << "错误：无效的网卡索引号！" << endl;
-        return 1;
+    string device;
+    if (interface_name != NULL) {
+        device = interface_name;
+    } else {
+        // 列出所有可用网络设备
+        cout << "正在检测网络设备..." << endl;
+        list_all_devices();
+
+        cout << "\n请选择要监听的网卡索引号(0-9): ";
+        int device_index;
+        cin >> device_index;
+
+        device = get_device_by_index(device_index);
+        if (device.empty()) {
+            cerr << "错误：无效的网卡索引号！" << endl;
+            return 1;
+        }
     }
-    
+
     cout << "\n正在打开网卡: " << device << endl;
 
-    // 打开网络设备
-    handle = pcap_open_live(device.c_str(), BUFSIZ, 1, 1000, errbuf);
+    // 选定网卡后才接管SIGINT，交互式输入时Ctrl+C仍直接退出
+    install_stop_handlers();
+
+    // AF_PACKET后端：用libpcap把--filter表达式编译为BPF程序，挂载到套接字上
+    if ((fanout_workers > 0 || use_afpacket) && filter_given &&
+        !compile_kernel_filter(filter_exp, afpacket_filter)) {
+        return 1;
+    }
+
+    // 多套接字fanout：每个线程一个AF_PACKET套接字，按流哈希分担流量
+    if (fanout_workers > 0) {
+        int result = run_fanout(device, fanout_workers, afp_block_kb * 1024, afp_blocks,
+                                store_packets, store_seconds, store_memory_mb * 1024 * 1024,
+                                flow_capacity, flow_timeout, reassembly_memory_mb * 1024 * 1024,
+                                reassembly_timeout, tcp_memory_mb * 1024 * 1024, tcp_connection_kb * 1024,
+                                tcp_connections, tcp_timeout, topk_capacity, dns_capacity,
+                                static_cast<unsigned>(distinct_precision), report_interval);
+        output_writer.stop();
+        return result;
+    }
+
+    // AF_PACKET内存映射后端
+    if (use_afpacket) {
+        int result = run_afpacket(device, afp_block_kb * 1024, afp_blocks);
+        output_writer.stop();
+        return result;
+    }
+
+    // 打开网络设备：快照长度、内核缓冲区、立即模式和时间戳精度在激活前设置
+    LiveCaptureConfig live_config;
+    live_config.snaplen = static_cast<int>(snaplen);
+    live_config.buffer_size = static_cast<int>(pcap_buffer_mb * 1024 * 1024);
+    live_config.timeout_ms = PCAP_READ_TIMEOUT_MS;
+    live_config.immediate = immediate_mode;
+    live_config.nanosecond = tstamp_nano;
+    handle = open_live_handle(device, live_config);
     if (handle == NULL) {
-        cerr << "错误：无法打开网卡 - " << errbuf << endl;
         return 1;
     }
 
-    cout << "网卡打开成功！" << endl;
+    cout << "网卡打开成功！（快照长度 " << pcap_snapshot(handle) << " 字节，内核缓冲区 "
+         << (pcap_buffer_mb > 0 ? to_string(pcap_buffer_mb) + "MB" : string("默认"))
+         << (immediate_mode ? "，立即模式" : "")
+         << (nanosecond_timestamps ? "，纳秒时间戳" : "") << "）" << endl;
+
+    // 按链路类型选定解码函数，逐包不再判断链路类型
+    if (!select_link_decoder(handle)) {
+        pcap_close(handle);
+        return 1;
+    }
+    if (filter_exp == NULL) {
+        filter_exp = default_kernel_filter(pcap_datalink(handle));
+    }
+
+    // 获取网卡的网络号和掩码（过滤表达式中的广播判断需要掩码），失败时使用未知掩码
+    if (pcap_lookupnet(device.c_str(), &net, &mask, errbuf) == -1) {
+        cerr << "警告：无法获取网卡掩码 - " << errbuf << endl;
+        net = 0;
+        mask = PCAP_NETMASK_UNKNOWN;
+    }
 
     // 编译过滤器
-    if (pcap_compile(handle, &fp, filter_exp, 0, net) == -1) {
+    if (pcap_compile(handle, &fp, filter_exp, 1, mask) == -1) {
         cerr << "错误：无法编译过滤器 - " << pcap_geterr(handle) << endl;
+        pcap_close(handle);
         return 1;
     }
 
     // 应用过滤器
     if (pcap_setfilter(handle, &fp) == -1) {
         cerr << "错误：无法应用过滤器 - " << pcap_geterr(handle) << endl;
+        pcap_freecode(&fp);
+        pcap_close(handle);
         return 1;
     }
 
-    cout << "过滤器设置成功，只捕获IP包" << endl;
+    cout << "过滤器设置成功: " << filter_exp << endl;
+    if (!start_packet_dump(pcap_datalink(handle), pcap_snapshot(handle), pcap_get_tstamp_precision(handle))) {
+        pcap_freecode(&fp);
+        pcap_close(handle);
+        return 1;
+    }
     cout << "\n开始捕获IP包... (按Ctrl+C停止)" << endl;
     cout << endl;
 
-    // 开始捕获包
-    pcap_loop(handle, -1, packet_handler, NULL);
+    // 开始捕获包，直到Ctrl+C、--count或--duration
+    int result = capture_live(handle, static_cast<unsigned>(stats_interval));
 
     // 清理
     pcap_freecode(&fp);
     pcap_close(handle);
+    output_writer.stop();
+
+    return result;
+}
+
+// 打印命令行用法
+void print_usage(const char* program) {
+    cout << "用法: " << program << " [选项]" << endl;
+    cout << "  (无参数)              交互式选择网卡并实时捕获" << endl;
+    cout << "  -r, --read <文件>     离线回放pcap/pcapng文件，结束时输出吞吐量统计" << endl;
+    cout << "  -i, --interface <网卡> 直接指定要监听的网卡，不再交互式选择" << endl;
+    cout << "  -c, --count <N>       处理N个包后停止并输出最终统计（0表示不限）" << endl;
+    cout << "  -d, --duration <秒>   抓包开始后运行指定秒数后停止并输出最终统计（0表示不限）" << endl;
+    cout << "  -o, --output <文件>   把逐包输出、报告和最终统计写入文件而不是标准输出" << endl;
+    cout << "  --backend <后端>      实时抓包后端：pcap（默认）或afpacket（Linux TPACKET_V3内存映射）" << endl;
+    cout << "  --afp-block-size <KB> afpacket后端每个块的大小（默认" << AfPacketCapture::DEFAULT_BLOCK_SIZE / 1024 << "KB，须为页大小整数倍）" << endl;
+    cout << "  --afp-blocks <N>      afpacket后端的块数（默认" << AfPacketCapture::DEFAULT_BLOCK_COUNT << "）" << endl;
+    cout << "  --fanout <N>          开启N个AF_PACKET套接字组成PACKET_FANOUT组，每个绑定一个CPU的线程处理" << endl;
+    cout << "  --report-interval <秒> 每隔指定秒数输出报告（默认0，不输出）：fanout模式合并各线程统计，" << endl;
+    cout << "                        其他模式按包时间输出Top-K和去重计数" << endl;
+    cout << "  --top-k <N>           源地址/目的地址/流三类Top-K各用N个计数器，默认1024；0表示不启用" << endl;
+    cout << "  --dns-top-k <N>       解析53端口的UDP报文，DNS查询名/类型Top-K用N个计数器（默认" << DEFAULT_DNS_CAPACITY
+         << "，0表示不解析DNS）" << endl;
+    cout << "  --distinct-precision <P> 去重计数的HyperLogLog精度（4~18，2^P个寄存器），默认14；0表示不启用" << endl;
+    cout << "  --flows <N>           流表最多同时跟踪N条五元组流（默认" << DEFAULT_FLOW_CAPACITY << "，0表示不启用）" << endl;
+    cout << "  --flow-timeout <秒>   流空闲超时（默认" << DEFAULT_FLOW_TIMEOUT << "秒）" << endl;
+    cout << "  --reassembly-memory <MB> IPv4分片重组缓冲池的内存上限（默认" << DEFAULT_REASSEMBLY_MEMORY_MB << "MB，0表示不重组）" << endl;
+    cout << "  --reassembly-timeout <秒> 分片重组超时（默认" << DEFAULT_REASSEMBLY_TIMEOUT << "秒）" << endl;
+    cout << "  --tcp-memory <MB>     TCP流重组乱序缓冲池的内存上限（默认" << DEFAULT_TCP_MEMORY_MB << "，不重组）；" << endl;
+    cout << "                        按序号拼接IPv4 TCP段，连续字节流交给注册的消费者" << endl;
+    cout << "  --tcp-connection-memory <KB> 单个连接最多缓存的乱序数据（默认" << DEFAULT_TCP_CONNECTION_KB << "KB），超出时跳过空洞" << endl;
+    cout << "  --tcp-connections <N> TCP流重组最多同时跟踪的连接数（默认" << DEFAULT_TCP_CONNECTIONS << "）" << endl;
+    cout << "  --tcp-timeout <秒>    TCP连接空闲超时（默认" << DEFAULT_TCP_TIMEOUT << "秒）" << endl;
+    cout << "  --l4-checksum         同时校验TCP/UDP（含伪首部）和ICMP校验和（IPv4首部校验和总是校验）" << endl;
+    cout << "  --filter <表达式>     内核BPF过滤表达式（libpcap语法），不匹配的包不会复制到用户态；" << endl;
+    cout << "                        默认以太网为\"ip or ip6 or vlan\"，其他链路类型为\"ip or ip6\"" << endl;
+    cout << "  --match <表达式>      用户态过滤表达式，作用于解码后的IPv4/IPv6字段，如\"src net 10.0.0.0/8 and tcp and ttl < 5\"" << endl;
+    cout << "                        （分片先重组再按数据报的端口判定；IPv6包的地址条件不成立，ttl/tos为跳数限制/流量类别）" << endl;
+    cout << "  --match-dump          打印--match编译后的判定程序并退出" << endl;
+    cout << "  -q, --quiet           不逐包打印解析结果（测量解析吞吐量时使用）" << endl;
+    cout << "  --summary             实时摘要：每秒输出一行包速率、比特率和协议占比，代替逐包打印" << endl;
+    cout << "  -w, --write <文件>    把捕获的原始帧写入pcap文件（后台线程写，采集线程不等待磁盘）" << endl;
+    cout << "  --dump-size <MB>      写入的文件达到指定大小后轮转到下一个文件（文件名加.序号，预分配磁盘空间）" << endl;
+    cout << "  --dump-seconds <秒>   按包时间每隔指定秒数轮转" << endl;
+    cout << "  --dump-files <N>      轮转的文件数，写满后覆盖最旧的（默认0，不限）" << endl;
+    cout << "  --format <格式>       逐包/逐流记录的格式：text（默认，表格）、jsonl或csv；" << endl;
+    cout << "                        jsonl/csv时标准输出只写记录，报告和统计写到标准错误" << endl;
+    cout << "  --records <类型>      jsonl/csv输出的记录：packets（默认，每包一条）或flows（流超时和结束时每流一条）" << endl;
+    cout << "  --store-packets <N>   最多保留最近N个包（默认" << DEFAULT_STORE_PACKETS << "，0表示只受内存预算限制）" << endl;
+    cout << "  --store-seconds <T>   只保留最近T秒内的包（默认0，不按时间淘汰）" << endl;
+    cout << "  --store-memory <MB>   包存储的内存预算（默认" << DEFAULT_STORE_MEMORY_MB << "MB，0表示不限制）" << endl;
+    cout << "  --pipeline <N>        启用流水线：采集线程 -> N个解码线程 -> 汇总输出线程" << endl;
+    cout << "  --ring-size <N>       流水线每个环形队列的槽位数（默认" << DEFAULT_RING_SIZE << "）" << endl;
+    cout << "  --snaplen <字节>      pcap后端每个包最多捕获的字节数（默认" << DEFAULT_SNAPLEN << "）" << endl;
+    cout << "  --buffer-size <MB>    pcap后端的内核缓冲区大小（默认" << DEFAULT_PCAP_BUFFER_MB << "MB，0表示libpcap默认值）" << endl;
+    cout << "  --immediate           pcap后端使用立即模式：包到达即交付，降低延迟但增加唤醒次数" << endl;
+    cout << "  --tstamp-nano         pcap后端和离线文件使用纳秒精度时间戳，记录和写入的文件保留纳秒（网卡/内核不支持时退回微秒）" << endl;
+    cout << "  --stats-interval <秒> pcap后端每隔指定秒数输出内核收包/丢包计数（默认" << DEFAULT_STATS_INTERVAL << "，0表示只在结束时输出）" << endl;
+    cout << "  -h, --help            显示此帮助信息" << endl;
+}
+
+// 用pcap_create打开网卡：pcap_open_live无法设置内核缓冲区、立即模式和时间戳精度
+pcap_t* open_live_handle(const string& device, const LiveCaptureConfig& config) {
+    char errbuf[PCAP_ERRBUF_SIZE];
+    pcap_t *handle = pcap_create(device.c_str(), errbuf);
+    if (handle == NULL) {
+        cerr << "错误：无法打开网卡 - " << errbuf << endl;
+        return NULL;
+    }
+    pcap_set_snaplen(handle, config.snaplen);
+    pcap_set_promisc(handle, 1);
+    pcap_set_timeout(handle, config.timeout_ms);
+    if (config.buffer_size > 0) {
+        pcap_set_buffer_size(handle, config.buffer_size);
+    }
+    if (config.immediate) {
+        pcap_set_immediate_mode(handle, 1);
+    }
+    if (config.nanosecond && pcap_set_tstamp_precision(handle, PCAP_TSTAMP_PRECISION_NANO) != 0) {
+        cerr << "警告：网卡不支持纳秒精度时间戳，使用微秒精度" << endl;
+    }
+
+    // 返回值小于0为错误，大于0为警告（如混杂模式不受支持），警告时句柄仍然可用
+    int status = pcap_activate(handle);
+    if (status < 0) {
+        cerr << "错误：无法激活网卡 - " << pcap_statustostr(status) << ": " << pcap_geterr(handle) << endl;
+        pcap_close(handle);
+        return NULL;
+    }
+    if (status > 0) {
+        cerr << "警告：" << pcap_statustostr(status) << ": " << pcap_geterr(handle) << endl;
+    }
+    nanosecond_timestamps = pcap_get_tstamp_precision(handle) == PCAP_TSTAMP_PRECISION_NANO;
+    return handle;
+}
+
+// pcap后端的抓包循环：每次pcap_dispatch最多阻塞一个读超时，返回后检查停止条件和是否到了输出pcap_stats的时间
+// Ctrl+C或--duration到时由信号处理函数调用pcap_breakloop，pcap_dispatch返回PCAP_ERROR_BREAK
+int capture_live(pcap_t* handle, unsigned stats_interval) {
+    struct pcap_stat previous;
+    memset(&previous, 0, sizeof(previous));
+    active_handle.store(handle);
+    start_duration_timer();
+    auto start = chrono::steady_clock::now();
+    auto next_stats = start + chrono::seconds(stats_interval);
+    int result = 0;
+    while (!stop_requested.load(std::memory_order_relaxed)) {
+        // --count：每批最多取剩余的包数，达到后正好停在第N个包
+        int batch = -1;
+        if (capture_limit > 0) {
+            if (main_context.stats.frames >= capture_limit) {
+                break;
+            }
+            batch = static_cast<int>(capture_limit - main_context.stats.frames);
+        }
+        result = pcap_dispatch(handle, batch, capture_handler, reinterpret_cast<u_char*>(&main_context));
+        if (result < 0) {
+            break;
+        }
+        output_writer.poll();
+        expire_idle_streams(main_context.streams);
+        if (stats_interval > 0 && chrono::steady_clock::now() >= next_stats) {
+            report_pcap_stats(handle, previous, false);
+            next_stats += chrono::seconds(stats_interval);
+        }
+    }
+    active_handle.store(nullptr);
+    if (result == PCAP_ERROR) {
+        cerr << "错误：抓包失败 - " << pcap_geterr(handle) << endl;
+    }
+
+    // 流水线模式下等待已入队的包全部处理完，再输出最终统计
+    pipeline.stop();
+    auto end = chrono::steady_clock::now();
+    finish_output();
+    print_run_summary("抓包运行统计", chrono::duration<double>(end - start).count());
+    report_pcap_stats(handle, previous, true);
+    return result == PCAP_ERROR ? 1 : 0;
+}
+
+// 接管SIGINT/SIGTERM（停止抓包并输出最终统计）和SIGALRM（--duration到时）
+// SA_RESETHAND：处理一次后恢复默认动作，收尾卡住时再按一次Ctrl+C可以直接终止
+void install_stop_handlers() {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_stop_signal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESETHAND;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    action.sa_flags = 0;
+    sigaction(SIGALRM, &action, NULL);
+}
+
+// 信号处理函数只做异步信号安全的操作：置位原子标志，并让正在运行的pcap循环尽快返回
+// （pcap_breakloop允许在信号处理函数中调用）；AF_PACKET和fanout循环每次等待超时后检查标志
+void handle_stop_signal(int signo) {
+    (void)signo;
+    stop_requested.store(true);
+    pcap_t* handle = active_handle.load();
+    if (handle != nullptr) {
+        pcap_breakloop(handle);
+    }
+}
+
+// --duration从抓包循环开始时计时，不包括打开网卡和预分配的时间
+void start_duration_timer() {
+    if (capture_duration > 0) {
+        alarm(capture_duration);
+    }
+}
+
+// 抓包结束后的输出收尾：补上实时摘要的最后一秒，导出仍活跃的流，写出所有逐包输出，之后再打印统计
+void finish_output() {
+    packet_dump.stop();
+    if (summary_mode && main_context.summary_sec != 0) {
+        emit_rate_line(main_context.rates, main_context.summary_sec);
+    }
+    if (export_flows) {
+        main_context.flows.for_each_active(export_flow_record, NULL);
+    }
+    // 流水线的解码线程已退出，剩余的连接在这里结束
+    if (tcp_reassembly_enabled) {
+        main_context.streams.close_all();
+        for (size_t i = 0; i < pipeline_decoders.size(); ++i) {
+            pipeline_decoders[i].streams.close_all();
+        }
+    }
+    output_writer.flush();
+}
+
+// 打开--write指定的文件并启动写线程（未指定时直接返回true）；链路类型、快照长度和时间戳精度取自抓包句柄
+bool start_packet_dump(int linktype, int snaplen, int tstamp_precision) {
+    if (dump_config.path.empty()) {
+        return true;
+    }
+    if (!packet_dump.start(dump_config, linktype, snaplen, tstamp_precision)) {
+        cerr << "错误：无法写入抓包文件 - " << packet_dump.error() << endl;
+        return false;
+    }
+    return true;
+}
+
+// 流表超时回调（--records flows）：在处理该包的线程中格式化到本线程的输出缓冲区
+void export_flow_record(const FlowRecord& record, void* context) {
+    (void)context;
+    OutputBuffer& out = output_writer.begin_record();
+    export_flow(out, export_format, record);
+    output_writer.end_record();
+}
+
+// 输出pcap_stats的内核计数：收到、因缓冲区满丢弃、网卡/驱动丢弃，以及与上一次输出的差值
+// 计数器是32位的，差值按无符号减法计算，回绕时仍然正确
+void report_pcap_stats(pcap_t* handle, struct pcap_stat& previous, bool final_report) {
+    struct pcap_stat current;
+    if (pcap_stats(handle, &current) != 0) {
+        cerr << "警告：无法读取抓包统计 - " << pcap_geterr(handle) << endl;
+        return;
+    }
+    uint32_t received = current.ps_recv - previous.ps_recv;
+    uint32_t dropped = current.ps_drop - previous.ps_drop;
+    uint32_t ifdropped = current.ps_ifdrop - previous.ps_ifdrop;
+    previous = current;
+
+    ostringstream report;
+    report << fixed << setprecision(2);
+    if (final_report) {
+        uint64_t offered = static_cast<uint64_t>(current.ps_recv) + current.ps_drop;
+        report << "\n========================================" << endl;
+        report << "内核抓包统计（pcap_stats）" << endl;
+        report << "----------------------------------------" << endl;
+        report << left << setw(20) << "内核收到" << current.ps_recv << endl;
+        report << left << setw(20) << "缓冲区满丢弃" << current.ps_drop << endl;
+        report << left << setw(20) << "网卡/驱动丢弃" << current.ps_ifdrop << endl;
+        report << left << setw(20) << "丢包率" << (offered > 0 ? current.ps_drop * 100.0 / offered : 0.0) << "%" << endl;
+        report << left << setw(20) << "已处理帧数" << main_context.stats.frames << endl;
+        report << "========================================" << endl;
+    } else {
+        uint64_t offered = static_cast<uint64_t>(received) + dropped;
+        report << "[抓包统计] 内核收到 " << current.ps_recv << " (+" << received << "), 缓冲区满丢弃 "
+               << current.ps_drop << " (+" << dropped << "), 网卡丢弃 " << current.ps_ifdrop
+               << " (+" << ifdropped << "), 本周期丢包率 " << (offered > 0 ? dropped * 100.0 / offered : 0.0)
+               << "%, 已处理 " << main_context.stats.frames << endl;
+    }
+    emit_report(report.str(), final_report);
+}
+
+// AF_PACKET后端：整块遍历内核共享的块环，逐帧直接调用处理函数
+int run_afpacket(const string& device, size_t block_size, size_t block_count) {
+    AfPacketCapture capture;
+    capture.set_filter(afpacket_filter);
+    if (!capture.open(device, block_size, block_count)) {
+        cerr << "错误：无法打开AF_PACKET抓包 - " << capture.error() << endl;
+        return 1;
+    }
+
+    cout << "AF_PACKET块环建立成功（TPACKET_V3，" << block_count << " x "
+         << block_size / 1024 << "KB），"
+         << (afpacket_filter.empty() ? "内核过滤器只接收IP包" : "已挂载--filter指定的BPF程序") << endl;
+    if (!start_packet_dump(DLT_EN10MB, DEFAULT_SNAPLEN, PCAP_TSTAMP_PRECISION_MICRO)) {
+        return 1;
+    }
+    cout << "\n开始捕获IP包... (按Ctrl+C停止)" << endl;
+    cout << endl;
 
+    // 按块处理；--count时最后一个块只处理到第N帧
+    start_duration_timer();
+    auto start = chrono::steady_clock::now();
+    while (!stop_requested.load(std::memory_order_relaxed) &&
+           (capture_limit == 0 || main_context.stats.frames < capture_limit)) {
+        AfPacketBlock block;
+        if (capture.next_block(1000, block)) {
+            uint64_t remaining = capture_limit > 0 ? capture_limit - main_context.stats.frames : UINT64_MAX;
+            process_afpacket_block(block, main_context, remaining);
+            capture.release_block();
+        }
+        output_writer.poll();
+        expire_idle_streams(main_context.streams);
+    }
+
+    pipeline.stop();
+    auto end = chrono::steady_clock::now();
+    finish_output();
+    print_run_summary("抓包运行统计", chrono::duration<double>(end - start).count());
+    uint64_t packets = 0;
+    uint64_t drops = 0;
+    if (capture.read_stats(packets, drops)) {
+        cout << "内核抓包统计（PACKET_STATISTICS）" << endl;
+        cout << "----------------------------------------" << endl;
+        cout << left << setw(20) << "内核收到" << packets << endl;
+        cout << left << setw(20) << "内核丢弃" << drops << endl;
+        cout << "========================================" << endl;
+    }
     return 0;
 }
 
+// 用libpcap把过滤表达式编译为以太网链路的经典BPF程序，供AF_PACKET套接字挂载
+bool compile_kernel_filter(const char* filter_exp, vector<struct sock_filter>& program) {
+    pcap_t *dead = pcap_open_dead(DLT_EN10MB, 65535);
+    if (dead == NULL) {
+        cerr << "错误：无法编译过滤器" << endl;
+        return false;
+    }
+    struct bpf_program fp;
+    if (pcap_compile(dead, &fp, filter_exp, 1, PCAP_NETMASK_UNKNOWN) == -1) {
+        cerr << "错误：无法编译过滤器 - " << pcap_geterr(dead) << endl;
+        pcap_close(dead);
+        return false;
+    }
+    // struct bpf_insn与内核的struct sock_filter字段一一对应
+    program.resize(fp.bf_len);
+    for (unsigned int i = 0; i < fp.bf_len; ++i) {
+        program[i].code = fp.bf_insns[i].code;
+        program[i].jt = fp.bf_insns[i].jt;
+        program[i].jf = fp.bf_insns[i].jf;
+        program[i].k = fp.bf_insns[i].k;
+    }
+    pcap_freecode(&fp);
+    pcap_close(dead);
+    if (program.empty()) {
+        cerr << "错误：过滤器编译结果为空" << endl;
+        return false;
+    }
+    return true;
+}
+
+// 处理一个块中的帧（最多max_frames帧，其余丢弃），返回处理的帧数；帧数据留在内存映射区，不复制
+uint64_t process_afpacket_block(AfPacketBlock& block, AnalyzerContext& context, uint64_t max_frames) {
+    u_char *user_data = reinterpret_cast<u_char*>(&context);
+    AfPacketFrame frame;
+    struct pcap_pkthdr pkthdr;
+    uint64_t processed = 0;
+    while (processed < max_frames && block.next(frame)) {
+        processed++;
+        pkthdr.ts.tv_sec = frame.sec;
+        pkthdr.ts.tv_usec = frame.nsec / 1000;
+        pkthdr.caplen = frame.caplen;
+        pkthdr.len = frame.len;
+        if (capture_handler == pipeline_capture_handler) {
+            pipeline_capture_handler(user_data, &pkthdr, frame.data);
+        } else {
+            packet_handler(user_data, &pkthdr, frame.data);
+        }
+    }
+    return processed;
+}
+
+// fanout模式：N个套接字加入同一PACKET_FANOUT组，内核按流哈希把包分给各套接字，
+// 每个套接字由一个绑定CPU的线程独立处理，线程之间没有共享的锁（--count时共享一个认领计数）
+int run_fanout(const string& device, size_t worker_count, size_t block_size, size_t block_count,
+               size_t store_packets, time_t store_seconds, size_t store_memory_bytes,
+               size_t flow_capacity, uint32_t flow_timeout, size_t reassembly_memory_bytes,
+               uint32_t reassembly_timeout, size_t tcp_memory_bytes, size_t tcp_connection_bytes,
+               size_t tcp_connections, uint32_t tcp_timeout, size_t topk_capacity, size_t dns_capacity,
+               unsigned distinct_precision, unsigned report_interval) {
+    uint16_t group_id = static_cast<uint16_t>(getpid() & 0xFFFF);
+    // 各线程的预分配表很大，出错提前返回时由unique_ptr释放已创建的线程对象
+    vector<std::unique_ptr<FanoutWorker> > workers;
+    for (size_t i = 0; i < worker_count; ++i) {
+        workers.push_back(std::unique_ptr<FanoutWorker>(new FanoutWorker()));
+        FanoutWorker* worker = workers.back().get();
+        worker->index = i;
+        // 包存储的容量和内存预算由各线程平分
+        size_t per_worker_packets = store_packets > 0 ? (store_packets + worker_count - 1) / worker_count : 0;
+        if (!worker->context.store.init(per_worker_packets, store_seconds, store_memory_bytes / worker_count)) {
+            cerr << "错误：包存储容量为0，请检查--store-packets/--store-memory参数" << endl;
+            return 1;
+        }
+        // 同一条流总是落到同一个套接字，流表按线程平分容量即可
+        size_t per_worker_flows = (flow_capacity + worker_count - 1) / worker_count;
+        if (flow_capacity > 0 && !worker->context.flows.init(per_worker_flows, flow_timeout)) {
+            cerr << "错误：无法分配流表，请检查--flows/--flow-timeout参数" << endl;
+            return 1;
+        }
+        if (export_flows) {
+            worker->context.flows.set_expire_callback(export_flow_record, NULL);
+        }
+        if (reassembly_memory_bytes > 0 &&
+            !worker->context.fragments.init(reassembly_memory_bytes / worker_count, reassembly_timeout)) {
+            cerr << "错误：无法分配分片重组缓冲池，请检查--reassembly-memory/--reassembly-timeout参数" << endl;
+            return 1;
+        }
+        size_t per_worker_connections = (tcp_connections + worker_count - 1) / worker_count;
+        if (tcp_memory_bytes > 0 &&
+            !worker->context.streams.init(tcp_memory_bytes / worker_count, tcp_connection_bytes,
+                                          per_worker_connections, tcp_timeout)) {
+            cerr << "错误：无法分配TCP流重组缓冲池，请检查--tcp-memory/--tcp-connection-memory/"
+                    "--tcp-connections/--tcp-timeout参数" << endl;
+            return 1;
+        }
+        if (topk_capacity > 0 && !worker->context.talkers.init(topk_capacity)) {
+            cerr << "错误：无法分配Top-K计数器，请检查--top-k参数" << endl;
+            return 1;
+        }
+        if (dns_capacity > 0 && (!worker->context.dns.init(dns_capacity) ||
+                                 (tcp_memory_bytes > 0 && !worker->context.dns.enable_tcp(worker->context.streams)))) {
+            cerr << "错误：无法分配DNS查询名计数器，请检查--dns-top-k参数" << endl;
+            return 1;
+        }
+        if (distinct_precision > 0 && (!worker->context.distinct.init(distinct_precision) ||
+                                       !worker->snapshots[0].distinct.init(distinct_precision) ||
+                                       !worker->snapshots[1].distinct.init(distinct_precision))) {
+            cerr << "错误：无效的--distinct-precision参数（0或4~18）" << endl;
+            return 1;
+        }
+        init_rate_stats(worker->context.rates);
+        worker->capture.set_filter(afpacket_filter);
+        if (!worker->capture.open(device, block_size, block_count) ||
+            !worker->capture.join_fanout(group_id)) {
+            cerr << "错误：无法打开第" << i << "个fanout套接字 - " << worker->capture.error() << endl;
+            return 1;
+        }
+    }
+
+    cout << "PACKET_FANOUT组" << group_id << "建立成功（hash模式，" << worker_count
+         << "个套接字，每个" << block_count << " x " << block_size / 1024 << "KB）" << endl;
+    cout << "\n开始捕获IP包... (按Ctrl+C停止)" << endl;
+    cout << endl;
+
+    // 合并各线程的统计并输出一次报告；最终报告在线程退出后直接读取它们留下的快照
+    auto emit_fanout_report = [&](bool final_report) {
+        CaptureStats merged;
+        FlowTableSummary merged_flows;
+        ReassemblyStats merged_reassembly;
+        TcpStreamStats merged_streams;
+        HeavyHitterSummary merged_talkers;
+        DnsSummary merged_dns;
+        DistinctCounters merged_distinct;
+        RateStats merged_rates;
+        collect_fanout_stats(workers, !final_report, merged, merged_flows, merged_reassembly, merged_streams,
+                             merged_talkers, merged_dns, merged_distinct, merged_rates);
+        ostringstream report;
+        report << "\n[" << (final_report ? "最终统计" : "统计报告") << "] " << worker_count << "个fanout线程合并" << endl;
+        for (size_t i = 0; i < workers.size(); ++i) {
+            report << "  线程" << i << ": 内核收到 " << workers[i]->kernel_packets
+                   << ", 内核丢弃 " << workers[i]->kernel_drops
+                   << ", 已处理 " << workers[i]->reported_frames << endl;
+        }
+        print_capture_stats(report, merged);
+        print_rate_stats(report, merged_rates);
+        if (flow_capacity > 0) {
+            print_flow_summary(report, merged_flows, flow_capacity);
+        }
+        if (reassembly_memory_bytes > 0) {
+            print_reassembly_stats(report, merged_reassembly, reassembly_memory_bytes);
+        }
+        if (tcp_memory_bytes > 0) {
+            print_tcp_stream_stats(report, merged_streams, tcp_memory_bytes);
+        }
+        if (topk_capacity > 0) {
+            print_heavy_hitters(report, merged_talkers, topk_capacity);
+        }
+        if (dns_capacity > 0) {
+            print_dns_stats(report, merged_dns, dns_capacity);
+        }
+        if (distinct_precision > 0) {
+            print_distinct_counts(report, merged_distinct, "最近一个报告周期");
+        }
+        if (final_report) {
+            print_output_stats(report);
+        }
+        emit_report(report.str(), final_report);
+    };
+
+    start_duration_timer();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i]->thread = std::thread(fanout_worker_loop, workers[i].get());
+    }
+
+    // 主线程只负责定期合并各线程的统计，并检查停止条件（每100毫秒一次）；
+    // --count由各线程处理每个块之前认领帧数，认领到第N帧的线程置位停止标志
+    auto next_report = chrono::steady_clock::now() + chrono::seconds(report_interval);
+    while (!stop_requested.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (report_interval > 0 && chrono::steady_clock::now() >= next_report) {
+            emit_fanout_report(false);
+            next_report += chrono::seconds(report_interval);
+        }
+    }
+
+    // 通知各线程退出，等它们留下最终快照后输出最终统计
+    stop_requested.store(true);
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i]->thread.join();
+    }
+    if (export_flows) {
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i]->context.flows.for_each_active(export_flow_record, NULL);
+        }
+        output_writer.flush();
+    }
+    // 线程已退出：结束剩余的TCP连接，更新最终快照中的流重组统计
+    if (tcp_memory_bytes > 0) {
+        for (size_t i = 0; i < workers.size(); ++i) {
+            FanoutSnapshot& snapshot = workers[i]->snapshots[workers[i]->front];
+            workers[i]->context.streams.close_all();
+            snapshot.streams = workers[i]->context.streams.stats();
+            workers[i]->context.dns.summarize(TOPK_WORKER_TOP, snapshot.dns);
+        }
+    }
+    emit_fanout_report(true);
+    return 0;
+}
+
+// fanout抓包线程：绑定到一个CPU，只访问自己的套接字和分析上下文
+void fanout_worker_loop(FanoutWorker* worker) {
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpu_count > 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(worker->index % cpu_count, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+
+    while (!stop_requested.load(std::memory_order_relaxed)) {
+        AfPacketBlock block;
+        if (worker->capture.next_block(100, block)) {
+            process_afpacket_block(block, worker->context, claim_fanout_frames(block.frame_count()));
+            worker->capture.release_block();
+        }
+        output_writer.poll();
+        expire_idle_streams(worker->context.streams);
+
+        // 响应报告请求：快照分多轮生成（每轮最多扫描FLOW_SCAN_STEP个流表槽位），
+        // 生成后交换前后台，主线程正在合并时留到下一轮再交换
+        unsigned epoch = report_epoch.load(std::memory_order_acquire);
+        if (!worker->building && !worker->publish_pending &&
+            epoch != worker->served_epoch.load(std::memory_order_relaxed)) {
+            begin_worker_snapshot(worker, epoch);
+        }
+        if (worker->building && continue_worker_snapshot(worker, FLOW_SCAN_STEP)) {
+            worker->publish_pending = true;
+        }
+        if (worker->publish_pending && publish_worker_snapshot(worker, false)) {
+            worker->publish_pending = false;
+        }
+    }
+    // 退出前留下最终快照（不再分轮），主线程join之后读取
+    if (worker->publish_pending) {
+        publish_worker_snapshot(worker, true);
+    }
+    if (!worker->building) {
+        begin_worker_snapshot(worker, report_epoch.load(std::memory_order_acquire));
+    }
+    continue_worker_snapshot(worker, worker->context.flows.capacity());
+    publish_worker_snapshot(worker, true);
+    // 提交本线程缓冲区中的逐包/逐流记录：主线程的flush()和stop()只提交主线程自己的缓冲区
+    output_writer.flush();
+}
+
+// 处理一个块之前认领其中的帧，返回本块可以处理的帧数；认领到--count第N帧的线程置位停止标志
+uint64_t claim_fanout_frames(uint64_t frames) {
+    if (capture_limit == 0) {
+        return frames;
+    }
+    uint64_t claimed = fanout_claimed.fetch_add(frames, std::memory_order_relaxed);
+    if (claimed >= capture_limit) {
+        return 0;
+    }
+    uint64_t allowed = std::min(frames, capture_limit - claimed);
+    if (claimed + allowed >= capture_limit) {
+        stop_requested.store(true);
+    }
+    return allowed;
+}
+
+// 开始在后台快照中生成一份快照：换出去重计数，流表留给continue_worker_snapshot()分轮扫描
+void begin_worker_snapshot(FanoutWorker* worker, unsigned epoch) {
+    FanoutSnapshot& back = worker->snapshots[1 - worker->front];
+    AnalyzerContext& context = worker->context;
+    // 去重计数按报告周期统计：本周期的寄存器随快照交出，换入主线程已清零的一份继续计数。
+    // 主线程没有合并过的（等待超时）在这里清零
+    if (!back.distinct_clear) {
+        back.distinct.clear();
+    }
+    std::swap(context.distinct, back.distinct);
+    back.distinct_clear = false;
+    context.flows.begin_summary(FLOW_REPORT_TOP, worker->flow_scan);
+    worker->building = true;
+    worker->building_epoch = epoch;
+}
+
+// 继续扫描流表，最多max_flow_entries个槽位；扫描完毕时复制定长的统计（与流表汇总取自同一时刻），
+// Top-K只取前TOPK_WORKER_TOP条，返回true
+bool continue_worker_snapshot(FanoutWorker* worker, size_t max_flow_entries) {
+    FanoutSnapshot& back = worker->snapshots[1 - worker->front];
+    AnalyzerContext& context = worker->context;
+    if (!context.flows.continue_summary(worker->flow_scan, max_flow_entries, back.flows)) {
+        return false;
+    }
+    back.stats = context.stats;
+    back.reassembly = context.fragments.stats();
+    back.streams = context.streams.stats();
+    back.rates = context.rates;
+    context.talkers.summarize(TOPK_WORKER_TOP, back.talkers);
+    context.dns.summarize(TOPK_WORKER_TOP, back.dns);
+    worker->building = false;
+    return true;
+}
+
+// 交换前后台快照；wait为false时主线程正在合并则返回false，留到下一轮
+bool publish_worker_snapshot(FanoutWorker* worker, bool wait) {
+    std::unique_lock<std::mutex> lock(worker->snapshot_mutex, std::defer_lock);
+    if (wait) {
+        lock.lock();
+    } else if (!lock.try_lock()) {
+        return false;
+    }
+    worker->front = 1 - worker->front;
+    worker->served_epoch.store(worker->building_epoch, std::memory_order_release);
+    return true;
+}
+
+// 请求所有fanout线程生成快照并合并（最多等待1秒，未响应的线程使用上一次快照）
+// request_snapshot为false时直接合并现有快照（线程已退出时使用）
+void collect_fanout_stats(vector<std::unique_ptr<FanoutWorker> >& workers, bool request_snapshot, CaptureStats& merged,
+                          FlowTableSummary& merged_flows, ReassemblyStats& merged_reassembly,
+                          TcpStreamStats& merged_streams, HeavyHitterSummary& merged_talkers,
+                          DnsSummary& merged_dns, DistinctCounters& merged_distinct, RateStats& merged_rates) {
+    if (request_snapshot) {
+        unsigned epoch = report_epoch.fetch_add(1, std::memory_order_acq_rel) + 1;
+        auto deadline = chrono::steady_clock::now() + chrono::seconds(1);
+        for (size_t i = 0; i < workers.size(); ++i) {
+            while (workers[i]->served_epoch.load(std::memory_order_acquire) != epoch &&
+                   chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+
+    merged.reset();
+    merged_flows = FlowTableSummary();
+    merged_reassembly.reset();
+    merged_streams.reset();
+    merged_talkers = HeavyHitterSummary();
+    merged_dns = DnsSummary();
+    merged_distinct = DistinctCounters();
+    merged_rates = RateStats();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        FanoutWorker* worker = workers[i].get();
+        uint64_t packets = 0;
+        uint64_t drops = 0;
+        if (worker->capture.read_stats(packets, drops)) {
+            worker->kernel_packets += packets;
+            worker->kernel_drops += drops;
+        }
+        // 线程只在交换前后台时短暂加锁（try_lock），合并期间线程照常抓包并在后台生成快照
+        std::lock_guard<std::mutex> lock(worker->snapshot_mutex);
+        FanoutSnapshot& snapshot = worker->snapshots[worker->front];
+        worker->reported_frames = snapshot.stats.frames;
+        merged.merge(snapshot.stats);
+        merged_flows.merge(snapshot.flows, FLOW_REPORT_TOP);
+        merged_reassembly.merge(snapshot.reassembly);
+        merged_streams.merge(snapshot.streams);
+        merged_talkers.merge(snapshot.talkers, TOPK_REPORT_TOP);
+        merged_dns.merge(snapshot.dns, TOPK_REPORT_TOP);
+        merged_rates.merge(snapshot.rates);
+        // 去重计数合并后清零，线程下次生成快照时直接换入
+        if (!snapshot.distinct_clear) {
+            merged_distinct.merge(snapshot.distinct);
+            snapshot.distinct.clear();
+            snapshot.distinct_clear = true;
+        }
+    }
+}
+
+// 打印抓包统计
+void print_capture_stats(ostream& os, const CaptureStats& stats) {
+    os << "抓包统计" << endl;
+    os << "----------------------------------------" << endl;
+    os << left << setw(20) << "帧数" << stats.frames << endl;
+    os << left << setw(20) << "字节数" << stats.bytes << endl;
+    os << left << setw(20) << "VLAN帧" << stats.vlan_frames << endl;
+    os << left << setw(20) << "非IP帧" << stats.non_ip_frames << endl;
+    os << left << setw(20) << "IPv4包数" << stats.ip_packets << endl;
+    os << left << setw(20) << "IPv4分片" << stats.fragments << endl;
+    os << left << setw(20) << "IPv6包数" << stats.ipv6_packets << endl;
+    os << left << setw(20) << "IPv6分片" << stats.ipv6_fragments << endl;
+    os << left << setw(20) << "过滤丢弃" << stats.filtered << endl;
+    uint64_t bad_ip = 0;
+    uint64_t bad_l4 = 0;
+    for (int protocol = 0; protocol < 256; ++protocol) {
+        if (stats.protocol_packets[protocol] > 0) {
+            os << "  " << left << setw(18) << get_protocol_name(protocol)
+               << stats.protocol_packets[protocol] << endl;
+        }
+        bad_ip += stats.bad_ip_checksums[protocol];
+        bad_l4 += stats.bad_l4_checksums[protocol];
+    }
+    for (int protocol = 0; protocol < 256; ++protocol) {
+        if (stats.ipv6_protocol_packets[protocol] > 0) {
+            os << "  IPv6/" << left << setw(13) << get_protocol_name(protocol)
+               << stats.ipv6_protocol_packets[protocol] << endl;
+        }
+    }
+    os << left << setw(20) << "首部校验和错误" << bad_ip << endl;
+    os << left << setw(20) << "传输层校验和错误" << bad_l4 << endl;
+    for (int protocol = 0; protocol < 256; ++protocol) {
+        if (stats.bad_ip_checksums[protocol] > 0 || stats.bad_l4_checksums[protocol] > 0) {
+            os << "  " << left << setw(18) << get_protocol_name(protocol)
+               << "首部 " << stats.bad_ip_checksums[protocol]
+               << ", 传输层 " << stats.bad_l4_checksums[protocol] << endl;
+        }
+    }
+    os << "========================================" << endl;
+}
+
+// 通过输出线程写出一段报告，避免与逐包输出交错；机器可读格式下标准输出只写记录，报告写到标准错误。
+// 周期报告只提交不等待（在抓包线程上调用），抓包停止后的最终报告等待写出完成
+void emit_report(const string& report, bool final_report) {
+    if (export_format != EXPORT_TEXT) {
+        cerr << report << flush;
+        return;
+    }
+    OutputBuffer& out = output_writer.begin_record();
+    out.append(report.data(), report.size());
+    if (final_report) {
+        output_writer.end_record();
+        output_writer.flush();
+    } else {
+        output_writer.submit_record();
+    }
+}
+
+// 离线回放：以最快速度把pcap文件中的包送入packet_handler
+int run_offline(const char* pcap_file, const char* filter_exp, bool nanosecond) {
+    char errbuf[PCAP_ERRBUF_SIZE];
+    struct bpf_program fp;
+
+    // 纳秒精度：libpcap把微秒精度的文件换算为纳秒，纳秒精度的文件原样给出
+    pcap_t *handle = nanosecond
+        ? pcap_open_offline_with_tstamp_precision(pcap_file, PCAP_TSTAMP_PRECISION_NANO, errbuf)
+        : pcap_open_offline(pcap_file, errbuf);
+    if (handle == NULL) {
+        cerr << "错误：无法打开pcap文件 - " << errbuf << endl;
+        return 1;
+    }
+    nanosecond_timestamps = pcap_get_tstamp_precision(handle) == PCAP_TSTAMP_PRECISION_NANO;
+
+    if (!select_link_decoder(handle)) {
+        pcap_close(handle);
+        return 1;
+    }
+    if (filter_exp == NULL) {
+        filter_exp = default_kernel_filter(pcap_datalink(handle));
+    }
+
+    // 离线文件没有网络号，使用PCAP_NETMASK_UNKNOWN编译过滤器
+    if (pcap_compile(handle, &fp, filter_exp, 1, PCAP_NETMASK_UNKNOWN) == -1) {
+        cerr << "错误：无法编译过滤器 - " << pcap_geterr(handle) << endl;
+        pcap_close(handle);
+        return 1;
+    }
+    if (pcap_setfilter(handle, &fp) == -1) {
+        cerr << "错误：无法应用过滤器 - " << pcap_geterr(handle) << endl;
+        pcap_freecode(&fp);
+        pcap_close(handle);
+        return 1;
+    }
+
+    if (!start_packet_dump(pcap_datalink(handle), pcap_snapshot(handle), pcap_get_tstamp_precision(handle))) {
+        pcap_freecode(&fp);
+        pcap_close(handle);
+        return 1;
+    }
+
+    // --count直接作为pcap_loop的包数；Ctrl+C或--duration到时pcap_loop返回PCAP_ERROR_BREAK
+    active_handle.store(handle);
+    start_duration_timer();
+    auto start = chrono::steady_clock::now();
+    int result = pcap_loop(handle, capture_limit > 0 ? static_cast<int>(capture_limit) : -1,
+                           capture_handler, reinterpret_cast<u_char*>(&main_context));
+    active_handle.store(nullptr);
+    // 流水线模式下等待已入队的包全部处理完
+    pipeline.stop();
+    auto end = chrono::steady_clock::now();
+
+    // 先写出所有逐包输出，再打印统计
+    finish_output();
+
+    if (result == -1) {
+        cerr << "错误：读取pcap文件失败 - " << pcap_geterr(handle) << endl;
+    }
+
+    print_run_summary("回放统计", chrono::duration<double>(end - start).count());
+
+    pcap_freecode(&fp);
+    pcap_close(handle);
+    return result == -1 ? 1 : 0;
+}
+
+// 打印吞吐量和各项统计（回放和实时抓包结束时共用）
+void print_run_summary(const char* title, double elapsed_seconds) {
+    // 流水线模式下链路层解码和用户态过滤在解码线程中进行，计数需要合并
+    CaptureStats stats = main_context.stats;
+    for (size_t i = 0; i < pipeline_decoders.size(); ++i) {
+        stats.merge(pipeline_decoders[i].stats);
+    }
+    double pps = elapsed_seconds > 0 ? stats.frames / elapsed_seconds : 0;
+    double bps = elapsed_seconds > 0 ? stats.bytes / elapsed_seconds : 0;
+    double ns_per_packet = stats.frames > 0 ? elapsed_seconds * 1e9 / stats.frames : 0;
+
+    cout << "\n========================================" << endl;
+    cout << title << endl;
+    cout << "----------------------------------------" << endl;
+    cout << left << setw(20) << "包数" << stats.frames << endl;
+    cout << left << setw(20) << "字节数" << stats.bytes << endl;
+    cout << left << setw(20) << "耗时" << fixed << setprecision(6) << elapsed_seconds << " 秒" << endl;
+    cout << left << setw(20) << "包速率" << setprecision(0) << pps << " 包/秒" << endl;
+    cout << left << setw(20) << "字节速率" << bps << " 字节/秒 ("
+         << setprecision(2) << bps * 8 / 1e6 << " Mbps)" << endl;
+    cout << left << setw(20) << "单包耗时" << ns_per_packet << " 纳秒/包" << endl;
+    cout << "========================================" << endl;
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+
+    print_capture_stats(cout, stats);
+    print_rate_stats(cout, main_context.rates);
+    print_store_summary(main_context.store);
+    if (main_context.flows.enabled()) {
+        FlowTableSummary flows;
+        main_context.flows.summarize(FLOW_REPORT_TOP, flows);
+        print_flow_summary(cout, flows, main_context.flows.capacity());
+    }
+    if (reassembly_enabled) {
+        // 流水线模式下各解码线程已退出，可以直接读取其统计
+        ReassemblyStats reassembly = main_context.fragments.stats();
+        size_t memory_bytes = main_context.fragments.memory_bytes();
+        for (size_t i = 0; i < pipeline_decoders.size(); ++i) {
+            reassembly.merge(pipeline_decoders[i].fragments.stats());
+            memory_bytes += pipeline_decoders[i].fragments.memory_bytes();
+        }
+        print_reassembly_stats(cout, reassembly, memory_bytes);
+    }
+    if (tcp_reassembly_enabled) {
+        TcpStreamStats streams = main_context.streams.stats();
+        size_t memory_bytes = main_context.streams.memory_bytes();
+        for (size_t i = 0; i < pipeline_decoders.size(); ++i) {
+            streams.merge(pipeline_decoders[i].streams.stats());
+            memory_bytes += pipeline_decoders[i].streams.memory_bytes();
+        }
+        print_tcp_stream_stats(cout, streams, memory_bytes);
+    }
+    if (main_context.talkers.enabled()) {
+        HeavyHitterSummary talkers;
+        main_context.talkers.summarize(TOPK_REPORT_TOP, talkers);
+        print_heavy_hitters(cout, talkers, main_context.talkers.capacity());
+    }
+    if (dns_enabled) {
+        // 流水线模式下各解码线程各上报前TOPK_WORKER_TOP个再合并，与fanout模式相同
+        DnsSummary dns;
+        size_t capacity = main_context.dns.capacity();
+        if (pipeline_decoders.empty()) {
+            main_context.dns.summarize(TOPK_REPORT_TOP, dns);
+        }
+        for (size_t i = 0; i < pipeline_decoders.size(); ++i) {
+            DnsSummary decoder_dns;
+            pipeline_decoders[i].dns.summarize(TOPK_WORKER_TOP, decoder_dns);
+            dns.merge(decoder_dns, TOPK_REPORT_TOP);
+            capacity = pipeline_decoders[i].dns.capacity();
+        }
+        print_dns_stats(cout, dns, capacity);
+    }
+    if (main_context.distinct.enabled()) {
+        print_distinct_counts(cout, main_context.distinct,
+                              inline_report_interval > 0 ? "最后一个报告周期" : "全部");
+    }
+    if (pipeline.worker_count() > 0) {
+        pipeline.print_stats(cout);
+    }
+    if (!dump_config.path.empty()) {
+        packet_dump.print_stats(cout);
+    }
+    print_output_stats(cout);
+}
+
+// 实时抓包时输出线程跟不上而丢弃的逐包记录（为0时不打印）
+void print_output_stats(ostream& os) {
+    uint64_t dropped = output_writer.dropped_records();
+    if (dropped == 0) {
+        return;
+    }
+    os << "输出统计" << endl;
+    os << "----------------------------------------" << endl;
+    os << left << setw(20) << "丢弃(缓冲池满)" << dropped << " 条记录" << endl;
+    os << "========================================" << endl;
+}
+
+// 打印包存储统计
+void print_store_summary(const PacketRingStore<IPPacketInfo>& captured_packets) {
+    cout << "包存储统计" << endl;
+    cout << "----------------------------------------" << endl;
+    cout << left << setw(20) << "容量" << captured_packets.capacity() << " 个包 ("
+         << captured_packets.memory_bytes() / 1024 << " KB)" << endl;
+    cout << left << setw(20) << "当前保留" << captured_packets.size() << " 个包" << endl;
+    cout << left << setw(20) << "已覆盖" << captured_packets.overwritten() << " 个包" << endl;
+    cout << left << setw(20) << "已过期" << captured_packets.expired() << " 个包" << endl;
+    cout << "========================================" << endl;
+}
+
+// 打印流表统计和字节数最多的流
+void print_flow_summary(ostream& os, const FlowTableSummary& summary, size_t capacity) {
+    os << "流表统计" << endl;
+    os << "----------------------------------------" << endl;
+    os << left << setw(20) << "容量" << capacity << " 条流" << endl;
+    os << left << setw(20) << "活跃流" << summary.active << endl;
+    os << left << setw(20) << "累计新建" << summary.created << endl;
+    os << left << setw(20) << "已超时" << summary.expired << endl;
+    os << left << setw(20) << "表满丢弃" << summary.dropped << " 个包" << endl;
+    if (!summary.top.empty()) {
+        os << "活跃流（按字节数）" << endl;
+        for (size_t i = 0; i < summary.top.size(); ++i) {
+            const FlowRecord& record = summary.top[i];
+            char src[INET_ADDRSTRLEN];
+            char dst[INET_ADDRSTRLEN];
+            format_ipv4_addr(record.key.src_addr, src);
+            format_ipv4_addr(record.key.dst_addr, dst);
+            os << "  " << src << ":" << record.key.src_port << " -> "
+               << dst << ":" << record.key.dst_port << " "
+               << get_protocol_name(record.key.protocol)
+               << "  " << record.packets << " 包, " << record.bytes << " 字节, "
+               << (record.last_seen_us - record.first_seen_us) / 1000 << " 毫秒" << endl;
+        }
+    }
+    os << "========================================" << endl;
+}
+
+// 打印分片重组统计
+void print_reassembly_stats(ostream& os, const ReassemblyStats& stats, size_t memory_bytes) {
+    os << "分片重组统计" << endl;
+    os << "----------------------------------------" << endl;
+    os << left << setw(20) << "缓冲池" << memory_bytes / 1024 << " KB" << endl;
+    os << left << setw(20) << "分片数" << stats.fragments << endl;
+    os << left << setw(20) << "重组完成" << stats.reassembled << " 个数据报" << endl;
+    os << left << setw(20) << "超时丢弃" << stats.timed_out << " 个分片" << endl;
+    os << left << setw(20) << "淘汰丢弃" << stats.evicted << " 个分片" << endl;
+    os << left << setw(20) << "重叠丢弃" << stats.overlaps << " 个数据报" << endl;
+    os << left << setw(20) << "重复分片" << stats.duplicates << endl;
+    os << left << setw(20) << "非法分片" << stats.invalid << endl;
+    os << "========================================" << endl;
+}
+
+// 打印TCP流重组统计
+void print_tcp_stream_stats(ostream& os, const TcpStreamStats& stats, size_t memory_bytes) {
+    uint64_t ended = stats.closed + stats.resets + stats.timed_out + stats.evicted;
+    os << "TCP流重组统计" << endl;
+    os << "----------------------------------------" << endl;
+    os << left << setw(20) << "内存" << memory_bytes / 1024 << " KB" << endl;
+    os << left << setw(20) << "TCP段数" << stats.segments << endl;
+    os << left << setw(20) << "连接数" << stats.connections << "（中途开始跟踪 " << stats.midstream
+       << "，结束时仍在跟踪 " << stats.connections - ended << "）" << endl;
+    os << left << setw(20) << "结束连接" << "FIN " << stats.closed << ", RST " << stats.resets
+       << ", 超时 " << stats.timed_out << ", 淘汰 " << stats.evicted << endl;
+    os << left << setw(20) << "交付字节" << stats.delivered_bytes << endl;
+    os << left << setw(20) << "乱序缓存" << stats.out_of_order << " 个段" << endl;
+    os << left << setw(20) << "重传段" << stats.retransmitted << endl;
+    os << left << setw(20) << "超出内存预算" << stats.overflows << " 次" << endl;
+    os << left << setw(20) << "跳过空洞" << stats.gaps << " 个, " << stats.gap_bytes << " 字节" << endl;
+    os << left << setw(20) << "截断/忽略" << stats.truncated << " / " << stats.ignored << endl;
+    os << "========================================" << endl;
+}
+
+// 打印包数最多的源地址、目的地址和流
+void print_heavy_hitters(ostream& os, const HeavyHitterSummary& summary, size_t capacity) {
+    os << "Top-K统计（Space-Saving）" << endl;
+    os << "----------------------------------------" << endl;
+    os << left << setw(20) << "计数器" << capacity << " 个/类" << endl;
+    os << left << setw(20) << "统计包数" << summary.packets << endl;
+    const char* titles[2] = { "源地址（按包数）", "目的地址（按包数）" };
+    const vector<AddressTopK::Entry>* lists[2] = { &summary.sources, &summary.destinations };
+    for (int k = 0; k < 2; ++k) {
+        if (lists[k]->empty()) {
+            continue;
+        }
+        os << titles[k] << endl;
+        for (size_t i = 0; i < lists[k]->size(); ++i) {
+            const AddressTopK::Entry& entry = (*lists[k])[i];
+            char addr[INET_ADDRSTRLEN];
+            format_ipv4_addr(entry.key, addr);
+            os << "  " << left << setw(16) << addr << entry.count << " 包（误差≤" << entry.error
+               << "）, " << entry.bytes << " 字节" << endl;
+        }
+    }
+    if (!summary.flows.empty()) {
+        os << "流（按包数）" << endl;
+        for (size_t i = 0; i < summary.flows.size(); ++i) {
+            const FlowTopK::Entry& entry = summary.flows[i];
+            char src[INET_ADDRSTRLEN];
+            char dst[INET_ADDRSTRLEN];
+            format_ipv4_addr(entry.key.src_addr, src);
+            format_ipv4_addr(entry.key.dst_addr, dst);
+            os << "  " << src << ":" << entry.key.src_port << " -> "
+               << dst << ":" << entry.key.dst_port << " "
+               << get_protocol_name(entry.key.protocol)
+               << "  " << entry.count << " 包（误差≤" << entry.error << "）, "
+               << entry.bytes << " 字节" << endl;
+        }
+    }
+    os << "========================================" << endl;
+}
+
+// 打印DNS报文计数、响应码分布和查询次数最多的名字/类型
+void print_dns_stats(ostream& os, const DnsSummary& summary, size_t capacity) {
+    const DnsMessageStats& stats = summary.stats;
+    os << "DNS统计" << endl;
+    os << "----------------------------------------" << endl;
+    os << left << setw(20) << "计数器" << capacity << " 个" << endl;
+    os << left << setw(20) << "DNS报文" << stats.messages << "（查询 " << stats.queries
+       << ", 响应 " << stats.responses << "）" << endl;
+    os << left << setw(20) << "无法解析" << stats.malformed << endl;
+    os << left << setw(20) << "回答记录" << stats.answers << "（TC置位 " << stats.truncated
+       << ", 未完整解析 " << stats.incomplete << " 个响应）" << endl;
+    if (stats.tcp_messages > 0 || stats.tcp_skipped > 0) {
+        os << left << setw(20) << "经TCP" << stats.tcp_messages << " 个报文（跳过 " << stats.tcp_skipped << "）" << endl;
+    }
+    if (stats.responses > 0) {
+        os << left << setw(20) << "响应码";
+        const char* separator = "";
+        for (uint8_t rcode = 0; rcode < 16; ++rcode) {
+            if (stats.rcodes[rcode] == 0) {
+                continue;
+            }
+            const char* name = dns_rcode_name(rcode);
+            os << separator;
+            if (name != NULL) {
+                os << name;
+            } else {
+                os << "RCODE" << static_cast<unsigned>(rcode);
+            }
+            os << " " << stats.rcodes[rcode];
+            separator = ", ";
+        }
+        os << endl;
+    }
+    if (!summary.queries.empty()) {
+        os << "查询名/类型（按次数）" << endl;
+        for (size_t i = 0; i < summary.queries.size(); ++i) {
+            const DnsQueryTopK::Entry& entry = summary.queries[i];
+            string query(entry.key.name.text, entry.key.name.length);
+            const char* type = dns_type_name(entry.key.qtype);
+            query += " ";
+            query += type != NULL ? string(type) : "TYPE" + to_string(entry.key.qtype);
+            os << "  " << left << setw(36) << query << entry.count << " 次（误差≤" << entry.error
+               << "）, " << entry.bytes << " 字节" << endl;
+        }
+    }
+    os << "========================================" << endl;
+}
+
+// 打印去重计数估计值
+void print_distinct_counts(ostream& os, const DistinctCounters& distinct, const char* window) {
+    os << "去重计数（HyperLogLog，" << window << "）" << endl;
+    os << "----------------------------------------" << endl;
+    os << left << setw(20) << "相对误差" << fixed << setprecision(2)
+       << distinct.sources.relative_error() * 100 << "%" << endl;
+    os << setprecision(0);
+    os << left << setw(20) << "源地址" << distinct.sources.estimate() << endl;
+    os << left << setw(20) << "目的地址" << distinct.destinations.estimate() << endl;
+    os << left << setw(20) << "五元组" << distinct.flows.estimate() << endl;
+    os.unsetf(ios::floatfield);
+    os << setprecision(6);
+    os << "========================================" << endl;
+}
+
+// 单线程/流水线模式的定期报告：在处理包的线程中生成，不需要暂停抓包；
+// 输出后去重计数清零，开始下一个统计窗口
+void emit_interval_report(AnalyzerContext& context) {
+    ostringstream report;
+    report << "\n[统计报告]" << endl;
+    print_rate_stats(report, context.rates);
+    if (context.talkers.enabled()) {
+        HeavyHitterSummary talkers;
+        context.talkers.summarize(TOPK_REPORT_TOP, talkers);
+        print_heavy_hitters(report, talkers, context.talkers.capacity());
+    }
+    if (context.distinct.enabled()) {
+        print_distinct_counts(report, context.distinct, "最近一个报告周期");
+        context.distinct.clear();
+    }
+    emit_report(report.str(), false);
+}
+
+// 用协议表中登记的协议初始化速率统计的协议槽位
+bool init_rate_stats(RateStats& rates) {
+    vector<uint8_t> protocols;
+    for (int protocol = 0; protocol < 256; ++protocol) {
+        if (protocol_entry(static_cast<uint8_t>(protocol)).known) {
+            protocols.push_back(static_cast<uint8_t>(protocol));
+        }
+    }
+    return rates.init(protocols);
+}
+
+// 打印各分辨率最近一个完整桶的速率、按协议细分和包长直方图
+void print_rate_stats(ostream& os, const RateStats& rates) {
+    if (!rates.enabled() || rates.latest_sec() == 0) {
+        return;
+    }
+    static const char* const RESOLUTION_NAMES[RateStats::RESOLUTIONS] = { "最近1秒", "最近10秒", "最近60秒" };
+    os << "速率统计（按包时间，取最近的完整时间桶）" << endl;
+    os << "----------------------------------------" << endl;
+    os << fixed << setprecision(2);
+    for (size_t r = 0; r < RateStats::RESOLUTIONS; ++r) {
+        const RateStats::Bucket* bucket = rates.last_complete(r, rates.latest_sec());
+        if (bucket == NULL) {
+            continue;
+        }
+        double seconds = RateStats::RESOLUTION_SECONDS[r];
+        os << left << setw(20) << RESOLUTION_NAMES[r] << bucket->packets / seconds << " 包/秒, "
+           << bucket->bytes * 8 / seconds / 1e6 << " Mbps" << endl;
+        for (size_t slot = 0; slot < rates.slot_count(); ++slot) {
+            if (bucket->protocol_packets[slot] == 0) {
+                continue;
+            }
+            string name = rates.is_other_slot(slot) ? string("其他") : get_protocol_name(rates.slot_protocol(slot));
+            os << "  " << left << setw(18) << name << bucket->protocol_packets[slot] / seconds << " 包/秒, "
+               << bucket->protocol_bytes[slot] * 8 / seconds / 1e6 << " Mbps" << endl;
+        }
+    }
+    os.unsetf(ios::floatfield);
+    os << setprecision(6);
+
+    // 最近60秒中包速率最高的一秒
+    uint64_t peak_packets = 0;
+    uint64_t peak_bytes = 0;
+    for (size_t i = 1; i <= RateStats::HISTORY; ++i) {
+        if (rates.latest_sec() < i) {
+            break;
+        }
+        const RateStats::Bucket* bucket = rates.find(0, rates.latest_sec() - i);
+        if (bucket != NULL && bucket->packets > peak_packets) {
+            peak_packets = bucket->packets;
+            peak_bytes = bucket->bytes;
+        }
+    }
+    os << left << setw(20) << "60秒内峰值" << peak_packets << " 包/秒, " << peak_bytes * 8 / 1000 << " kbps" << endl;
+
+    os << "包长分布（IP总长度，累计）" << endl;
+    const uint64_t* histogram = rates.size_histogram();
+    for (size_t i = 0; i < RateStats::SIZE_BINS; ++i) {
+        if (histogram[i] == 0) {
+            continue;
+        }
+        ostringstream range;
+        if (i == 0) {
+            range << "0-63";
+        } else {
+            range << (32u << i) << "-" << (64u << i) - 1;
+        }
+        os << "  " << left << setw(18) << range.str() << histogram[i] << endl;
+    }
+    os << "========================================" << endl;
+}
+
+// 实时摘要模式：每秒输出一行，包含该秒及最近完整的10秒/60秒桶的速率和协议占比
+void emit_rate_line(const RateStats& rates, time_t second) {
+    const RateStats::Bucket* bucket = rates.find(0, static_cast<uint64_t>(second));
+    if (bucket == NULL) {
+        return;
+    }
+    struct tm local;
+    char clock[16];
+    localtime_r(&second, &local);
+    strftime(clock, sizeof(clock), "%H:%M:%S", &local);
+
+    OutputBuffer& out = output_writer.begin_record();
+    out.append("[");
+    out.append(clock);
+    out.append("] ");
+    out.append_uint(bucket->packets);
+    out.append(" 包/秒 ");
+    out.append_uint(bucket->bytes * 8 / 1000);
+    out.append(" kbps");
+    static const char* const LABELS[RateStats::RESOLUTIONS] = { "", " | 10秒均值 ", " | 60秒均值 " };
+    for (size_t r = 1; r < RateStats::RESOLUTIONS; ++r) {
+        const RateStats::Bucket* longer = rates.last_complete(r, static_cast<uint64_t>(second) + 1);
+        if (longer != NULL) {
+            uint32_t width = RateStats::RESOLUTION_SECONDS[r];
+            out.append(LABELS[r]);
+            out.append_uint(longer->packets / width);
+            out.append(" 包/秒 ");
+            out.append_uint(longer->bytes * 8 / 1000 / width);
+            out.append(" kbps");
+        }
+    }
+    out.append(" |");
+    for (size_t slot = 0; slot < rates.slot_count(); ++slot) {
+        if (bucket->protocol_packets[slot] == 0) {
+            continue;
+        }
+        out.append_char(' ');
+        if (rates.is_other_slot(slot)) {
+            out.append("其他");
+        } else {
+            out.append(get_protocol_name(rates.slot_protocol(slot)));
+        }
+        out.append_char(' ');
+        out.append_uint(bucket->protocol_packets[slot] * 100 / bucket->packets);
+        out.append_char('%');
+    }
+    out.append_char('\n');
+    output_writer.end_record();
+}
+
+// 解析非负整数参数
+bool parse_number_arg(const char* text, unsigned long long& value) {
+    if (text == NULL || *text == '\0' || *text == '-') {
+        return false;
+    }
+    char *end = NULL;
+    errno = 0;
+    value = strtoull(text, &end, 10);
+    return errno == 0 && *end == '\0';
+}
+
 // 列出所有可用的网络设备
 void list_all_devices() {
     pcap_if_t *alldevs;
@@ -182,128 +2203,309 @@ string get_device_by_index(int index) {
     return "";
 }
 
-// 包处理回调函数
+// 纳秒精度句柄的tv_usec字段实际是纳秒；流表、重组和速率统计都按微秒计时，解码时换算，
+// 包信息中另外保留纳秒部分供记录输出（写文件直接使用句柄给出的原始时间戳）
+inline struct timeval capture_timestamp(const struct timeval& ts) {
+    struct timeval usec = ts;
+    if (nanosecond_timestamps) {
+        usec.tv_usec /= 1000;
+    }
+    return usec;
+}
+
+// 包处理回调函数（单线程模式：解码、存储、打印都在pcap回调中完成）
 void packet_handler(u_char *user_data, const struct pcap_pkthdr* pkthdr, const u_char* packet) {
-    packet_count++;
-    
-    // 跳过以太网头部
-    struct ether_header *eth_header = (struct ether_header *)packet;
-    
-    // 检查是否为IP包（以太网类型为0x0800）
-    if (ntohs(eth_header->ether_type) != ETHERTYPE_IP) {
+    AnalyzerContext& context = *reinterpret_cast<AnalyzerContext*>(user_data);
+    context.stats.frames++;
+    context.stats.bytes += pkthdr->len;
+
+    // 原始帧先交给写文件队列（只复制，不做磁盘I/O），用户态过滤和解码不影响写入的内容
+    if (packet_dump.running()) {
+        packet_dump.submit(pkthdr->ts, packet, pkthdr->caplen, pkthdr->len);
+    }
+
+    IPPacketInfo packet_info;
+    if (!decode_packet(packet, pkthdr->caplen, pkthdr->ts, context.stats, context.fragments, context.streams,
+                       context.dns, packet_info)) {
         return;
     }
+    record_packet(context, packet_info, context.stats.frames);
+}
 
-    // 获取IP头部
-    const u_char *ip_packet = packet + sizeof(struct ether_header);
-    struct ip *ip_header = (struct ip *)ip_packet;
+// decode_packet接入共享解析库的钩子：用户态过滤（--match）、分片重组、TCP流重组和DNS统计
+struct AnalyzerParseHooks {
+    AnalyzerParseHooks(CaptureStats& capture_stats, FragmentReassembler& fragment_reassembler,
+                       TcpReassembler& tcp_streams, DnsCounters& dns_counters, uint64_t capture_us)
+        : stats(capture_stats), fragments(fragment_reassembler), streams(tcp_streams), dns(dns_counters),
+          timestamp_us(capture_us), filtered(false) {}
 
-    // 解析IP包信息
-    IPPacketInfo packet_info;
-    packet_info.timestamp = pkthdr->ts.tv_sec;
-    packet_info.version = ip_header->ip_v;
-    packet_info.header_length = ip_header->ip_hl * 4;  // 转换为字节
-    packet_info.total_length = ntohs(ip_header->ip_len);
-    packet_info.identification = ntohs(ip_header->ip_id);
-    packet_info.protocol = ip_header->ip_p;
-    packet_info.checksum = ntohs(ip_header->ip_sum);
-    
-    // 解析标志位和片偏移
-    uint16_t flags_fragoff = ntohs(ip_header->ip_off);
-    packet_info.flags = (flags_fragoff & 0xE000) >> 13;  // 提取前3位作为标志位
-    packet_info.fragment_offset = flags_fragoff & 0x1FFF;  // 提取后13位作为片偏移
+    CaptureStats& stats;
+    FragmentReassembler& fragments;
+    TcpReassembler& streams;
+    DnsCounters& dns;
+    uint64_t timestamp_us;   // 流重组按微秒计时
+    bool filtered;           // 被用户态过滤器丢弃（与非IP帧分开计数）
+
+    void on_link(const LinkFrame& link) {
+        if (link.vlan_depth > 0) {
+            stats.vlan_frames++;
+        }
+    }
+
+    // 丢弃被过滤器拒绝的包，返回false供钩子直接返回
+    bool reject() {
+        filtered = true;
+        stats.filtered++;
+        return false;
+    }
+
+    // 用户态过滤：不感兴趣的包不再做后续的统计、存储和打印。
+    // 分片先送入重组器再过滤：非首片没有端口，先过滤会使按端口过滤时数据报永远收不齐，留到finish_ipv4判定
+    bool accept_ipv4(const IPv4HeaderView& ip_view) {
+        if (ip_view.is_fragment() && fragments.enabled()) {
+            return true;
+        }
+        if (!packet_filter.empty() && !packet_filter.match(ip_view)) {
+            return reject();
+        }
+        return true;
+    }
+
+    bool finish_ipv4(const IPv4HeaderView& ip_view, IPPacketInfo& packet_info) {
+        const IPv4HeaderView* segment = &ip_view;
+        IPv4HeaderView datagram;
+        if (ip_view.is_fragment() && fragments.enabled()) {
+            // 收齐数据报的那个分片按重组结果的端口判定，其余分片按自身判定（非首片端口为0）
+            segment = reassemble_fragment(fragments, ip_view, packet_info, datagram) ? &datagram : NULL;
+            if (!packet_filter.empty() &&
+                !packet_filter.match(ip_view, segment != NULL ? datagram : ip_view)) {
+                return reject();
+            }
+        }
+        // TCP段（含重组完成的数据报）送入流重组；校验和错误的段内容不可信，不参与拼接
+        if (segment != NULL && streams.enabled() && packet_info.protocol == IPPROTO_TCP &&
+            packet_info.checksum_errors == 0) {
+            streams.add(*segment, timestamp_us);
+        }
+        // 53端口的UDP数据报解析DNS；未重组的分片只有首片带UDP首部，载荷不完整，不解析
+        if (segment != NULL && dns.enabled() && packet_info.protocol == IPPROTO_UDP &&
+            !segment->is_fragment() && packet_info.checksum_errors == 0) {
+            dns.add_udp(segment->payload(), segment->payload_length());
+        }
+        return true;
+    }
+
+    bool accept_ipv6(const IPv6HeaderView& ip_view) {
+        if (!packet_filter.empty() && !packet_filter.match(ip_view)) {
+            return reject();
+        }
+        return true;
+    }
+
+    bool finish_ipv6(const IPv6HeaderView& ip_view, IPPacketInfo& packet_info) {
+        if (dns.enabled() && ip_view.protocol() == IPPROTO_UDP && !ip_view.is_fragment() &&
+            packet_info.checksum_errors == 0) {
+            dns.add_udp(ip_view.l4_data(), ip_view.l4_length());
+        }
+        return true;
+    }
+};
 
-    // 转换IP地址
-    inet_ntop(AF_INET, &(ip_header->ip_src), packet_info.source_ip, INET_ADDRSTRLEN);
-    inet_ntop(AF_INET, &(ip_header->ip_dst), packet_info.dest_ip, INET_ADDRSTRLEN);
+// 解码一帧：经共享解析库（parse_frame）剥离链路层首部，在pcap缓冲区上直接解码IPv4/IPv6首部（零拷贝）
+// 并填充包信息，过滤、重组和DNS统计通过AnalyzerParseHooks接入
+// capture_ts为句柄给出的原始时间戳（纳秒精度时tv_usec为纳秒）
+// 非IP帧、首部不完整或被用户态过滤器丢弃时返回false，计入stats
+bool decode_packet(const u_char* packet, uint32_t caplen, const struct timeval& capture_ts, CaptureStats& stats,
+                   FragmentReassembler& fragments, TcpReassembler& streams, DnsCounters& dns,
+                   IPPacketInfo& packet_info) {
+    struct timeval ts = capture_timestamp(capture_ts);
+    AnalyzerParseHooks hooks(stats, fragments, streams, dns, static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_usec);
+    if (!parse_frame(link_decoder, packet, caplen, ts, l4_checksum_enabled, hooks, packet_info)) {
+        if (!hooks.filtered) {
+            stats.non_ip_frames++;
+        }
+        return false;
+    }
+    if (nanosecond_timestamps) {
+        packet_info.timestamp_nsec = static_cast<uint32_t>(capture_ts.tv_usec);
+        packet_info.timestamp_nano = true;
+    }
+    return true;
+}
+
+// 按句柄的链路类型选定链路层解码函数，不支持的链路类型返回false
+bool select_link_decoder(pcap_t* handle) {
+    int datalink = pcap_datalink(handle);
+    switch (datalink) {
+        case DLT_EN10MB:
+            link_decoder = decode_ethernet_link;
+            return true;
+#ifdef DLT_LINUX_SLL
+        case DLT_LINUX_SLL:
+            link_decoder = decode_sll_link;
+            return true;
+#endif
+#ifdef DLT_LINUX_SLL2
+        case DLT_LINUX_SLL2:
+            link_decoder = decode_sll2_link;
+            return true;
+#endif
+        case DLT_RAW:
+#ifdef DLT_IPV4
+        case DLT_IPV4:
+#endif
+#ifdef DLT_IPV6
+        case DLT_IPV6:
+#endif
+            link_decoder = decode_raw_link;
+            return true;
+        case DLT_NULL:
+#ifdef DLT_LOOP
+        case DLT_LOOP:
+#endif
+            link_decoder = decode_null_link;
+            return true;
+        default:
+            break;
+    }
+    const char* name = pcap_datalink_val_to_name(datalink);
+    cerr << "错误：不支持的链路类型 - " << (name != NULL ? name : "未知") << " (" << datalink << ")" << endl;
+    return false;
+}
+
+// 未指定--filter时的内核过滤表达式：只有以太网链路上才会出现VLAN标签帧
+const char* default_kernel_filter(int datalink) {
+    return datalink == DLT_EN10MB ? "ip or ip6 or vlan" : "ip or ip6";
+}
+
+// 统计、保存并打印一个已解码的包
+void record_packet(AnalyzerContext& context, const IPPacketInfo& packet_info, uint64_t number) {
+    // 包数/协议统计、流表、Top-K、去重计数和速率统计；
+    // 启用重组时分片只在数据报重组完成后按整个数据报计入一次五元组结构
+    aggregate_packet(context, packet_info, reassembly_enabled);
 
     // 保存捕获的包
-    captured_packets.push_back(packet_info);
+    context.store.append(packet_info);
 
-    // 打印包信息
-    print_packet_info(packet_info, packet_count);
-    print_ip_header(ip_header, packet_info);
-    
-    cout << "\n========================================" << endl;
+    // 实时摘要模式下进入新的一秒时输出上一秒的摘要
+    if (summary_mode && packet_info.timestamp > context.summary_sec) {
+        if (context.summary_sec != 0) {
+            emit_rate_line(context.rates, context.summary_sec);
+        }
+        context.summary_sec = packet_info.timestamp;
+    }
+
+    // 按包时间定期输出Top-K和去重计数
+    if (inline_report_interval > 0 && packet_info.timestamp >= context.next_report) {
+        if (context.next_report != 0) {
+            emit_interval_report(context);
+        }
+        context.next_report = packet_info.timestamp + inline_report_interval;
+    }
+
+    if (quiet_mode || summary_mode || export_flows) {
+        return;
+    }
+
+    // 格式化到本线程的输出缓冲区，由后台线程批量写出
+    OutputBuffer& out = output_writer.begin_record();
+    if (export_format != EXPORT_TEXT) {
+        export_packet(out, export_format, packet_info, number);
+        output_writer.end_record();
+        return;
+    }
+    print_packet_info(out, packet_info, number);
+    print_ip_packet(out, packet_info);
+    out.append("\n========================================\n");
+    output_writer.end_record();
 }
 
-// 打印包基本信息
-void print_packet_info(const IPPacketInfo& packet_info, int packet_count) {
-    cout << "\n[包 #" << packet_count << "]" << endl;
-    cout << "捕获时间: " << ctime(&packet_info.timestamp);
-    cout << "----------------------------------------" << endl;
-    cout << left << setw(20) << "字段名" << setw(25) << "值" << "说明" << endl;
-    cout << "----------------------------------------" << endl;
+// 流水线采集阶段：只计数并复制帧，按地址对分配到解码线程
+void pipeline_capture_handler(u_char *user_data, const struct pcap_pkthdr* pkthdr, const u_char* packet) {
+    // 采集线程只写帧计数，其余统计由汇总线程写，两者不会写同一字段
+    AnalyzerContext& context = *reinterpret_cast<AnalyzerContext*>(user_data);
+    context.stats.frames++;
+    context.stats.bytes += pkthdr->len;
+    if (packet_dump.running()) {
+        packet_dump.submit(pkthdr->ts, packet, pkthdr->caplen, pkthdr->len);
+    }
+
+    // 源/目的地址异或作为分片依据，同一对主机的包进入同一解码线程
+    // （IPv6把两个地址的8个32位字全部异或）
+    uint32_t shard_hash = 0;
+    LinkFrame link;
+    if (link_decoder(packet, pkthdr->caplen, link)) {
+        size_t addr_offset = 0;
+        size_t addr_words = 0;
+        if (link.ethertype == LINK_ETHERTYPE_IPV4 && link.length >= IPV4_MIN_HEADER_LEN) {
+            addr_offset = 12;
+            addr_words = 2;
+        } else if (link.ethertype == LINK_ETHERTYPE_IPV6 && link.length >= IPV6_HEADER_LEN) {
+            addr_offset = 8;
+            addr_words = 8;
+        }
+        for (size_t i = 0; i < addr_words; ++i) {
+            uint32_t word;
+            memcpy(&word, link.network + addr_offset + i * 4, 4);
+            shard_hash ^= word;
+        }
+        shard_hash ^= shard_hash >> 16;
+    }
+    pipeline.submit(pkthdr->ts, packet, pkthdr->caplen, pkthdr->len, context.stats.frames, shard_hash);
 }
 
-// 打印IP头部详细信息
-void print_ip_header(const struct ip* ip_header, const IPPacketInfo& packet_info) {
-    // 版本号
-    cout << left << setw(20) << "版本号(Version)" << setw(25) << 
-            static_cast<int>(packet_info.version) << "IPv" << static_cast<int>(packet_info.version) << endl;
-    
-    // 首部长度
-    cout << left << setw(20) << "首部长度(IHL)" << setw(25) << 
-            static_cast<int>(packet_info.header_length) << "字节" << endl;
-    
-    // 总长度
-    cout << left << setw(20) << "总长度(Total Length)" << setw(25) << 
-            packet_info.total_length << "字节" << endl;
-    
-    // 标识
-    cout << left << setw(20) << "标识(Identification)" << setw(25) << 
-            "0x" << hex << setfill('0') << setw(4) << packet_info.identification << 
-            " (" << dec << packet_info.identification << ")" << setfill(' ') << endl;
-    
-    // 标志位
-    cout << left << setw(20) << "标志位(Flags)" << setw(25) << 
-            "0x" << hex << setfill('0') << setw(1) << static_cast<int>(packet_info.flags) << 
-            setfill(' ') << dec << endl;
-    print_flags_info(packet_info.flags);
-    
-    // 片偏移
-    cout << left << setw(20) << "片偏移(Fragment Offset)" << setw(25) << 
-            packet_info.fragment_offset << " * 8 = " << 
-            (packet_info.fragment_offset * 8) << " 字节" << endl;
-    
-    // 协议
-    string protocol_name = get_protocol_name(packet_info.protocol);
-    cout << left << setw(20) << "协议(Protocol)" << setw(25) << 
-            static_cast<int>(packet_info.protocol) << "(" << protocol_name << ")" << endl;
-    
-    // 首部校验和
-    cout << left << setw(20) << "首部校验和" << setw(25) << 
-            "0x" << hex << setfill('0') << setw(4) << packet_info.checksum << 
-            setfill(' ') << dec << endl;
-    
-    // 源地址
-    cout << left << setw(20) << "源IP地址(Source)" << setw(25) << 
-            packet_info.source_ip << endl;
-    
-    // 目的地址
-    cout << left << setw(20) << "目的IP地址(Destination)" << setw(25) << 
-            packet_info.dest_ip << endl;
+// 流水线解码阶段（解码线程）
+// 同一对地址的包总是由同一解码线程处理，因此一个数据报的所有分片都落到同一个重组器
+bool pipeline_decode(const PipelineFrame& frame, IPPacketInfo& packet_info, void* worker_context) {
+    DecodeWorkerContext& decoder = *static_cast<DecodeWorkerContext*>(worker_context);
+    return decode_packet(frame.data, frame.caplen, frame.ts, decoder.stats, decoder.fragments, decoder.streams,
+                         decoder.dns, packet_info);
+}
+
+// 流水线汇总阶段（汇总线程，按捕获顺序调用）
+void pipeline_consume(const IPPacketInfo& packet_info, uint64_t number, void* consumer_context) {
+    record_packet(*static_cast<AnalyzerContext*>(consumer_context), packet_info, number);
+}
+
+// 汇总线程退出前提交其输出缓冲区
+void pipeline_finish(void* consumer_context) {
+    (void)consumer_context;
+    output_writer.flush();
 }
 
-// 获取协议名称
-string get_protocol_name(uint8_t protocol) {
-    auto it = PROTOCOL_NAMES.find(protocol);
-    if (it != PROTOCOL_NAMES.end()) {
-        return it->second;
+// 汇总线程空闲时响应输出线程的定时刷新
+void pipeline_idle(void* consumer_context) {
+    (void)consumer_context;
+    output_writer.poll();
+}
+
+// 解码线程空闲时结束空闲超时的TCP连接（只在实时抓包时注册）
+void pipeline_decode_idle(void* worker_context) {
+    expire_idle_streams(static_cast<DecodeWorkerContext*>(worker_context)->streams);
+}
+
+// 按当前时间结束空闲超时的TCP连接：add()只在有新段时检查超时，链路空闲时缓存的数据和
+// 连接槽位要靠抓包循环定期调用这里释放。包时间戳与当前时间同源，只用于实时抓包
+void expire_idle_streams(TcpReassembler& streams) {
+    if (!streams.enabled()) {
+        return;
     }
-    char buffer[32];
-    snprintf(buffer, sizeof(buffer), "协议%d", protocol);
-    return buffer;
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    streams.expire(static_cast<uint64_t>(now.tv_sec) * 1000000 + now.tv_usec);
 }
 
-// 打印标志位详细信息
-void print_flags_info(uint8_t flags) {
-    bool reserved = (flags & 0x4) != 0;
-    bool df = (flags & 0x2) != 0;  // Don't Fragment
-    bool mf = (flags & 0x1) != 0;  // More Fragments
-    
-    cout << left << setw(20) << "" << setw(25) << "";
-    cout << "[保留位: " << (reserved ? "1" : "0") << ", ";
-    cout << "DF(不分片): " << (df ? "1" : "0") << ", ";
-    cout << "MF(更多分片): " << (mf ? "1" : "0") << "]" << endl;
+// 把分片送入重组器；收齐数据报时从重组结果中取传输层字段，返回true，datagram指向重组结果
+bool reassemble_fragment(FragmentReassembler& reassembler, const IPv4HeaderView& ip_view,
+                         IPPacketInfo& packet_info, IPv4HeaderView& datagram) {
+    uint64_t timestamp_us = static_cast<uint64_t>(packet_info.timestamp) * 1000000 + packet_info.timestamp_nsec / 1000;
+    if (!reassembler.add(ip_view, timestamp_us, datagram)) {
+        return false;
+    }
+    packet_info.reassembled_length = datagram.total_length();
+    dissect_l4(datagram.protocol(), datagram.payload(), datagram.payload_length(), packet_info.l4);
+    if (l4_checksum_enabled && verify_l4_checksum(datagram) == CHECKSUM_BAD) {
+        packet_info.checksum_errors |= CHECKSUM_ERROR_L4;
+    }
+    return true;
 }
@@ -0,0 +1,120 @@
+// link_decode.h - 链路层解码（以太网/VLAN、Linux cooked capture、原始IP、BSD loopback）
+#ifndef LINK_DECODE_H
+#define LINK_DECODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// 链路层解码使用的以太网类型
+const uint16_t LINK_ETHERTYPE_IPV4 = 0x0800;
+const uint16_t LINK_ETHERTYPE_IPV6 = 0x86DD;
+const uint16_t LINK_ETHERTYPE_VLAN = 0x8100;    // 802.1Q
+const uint16_t LINK_ETHERTYPE_QINQ = 0x88A8;    // 802.1ad 外层标签
+const uint16_t LINK_ETHERTYPE_QINQ_OLD = 0x9100; // 早期设备使用的QinQ外层标签
+
+// 最多剥离的VLAN标签层数，超过时按非IP帧处理
+const int LINK_MAX_VLAN_DEPTH = 4;
+
+// 链路层解码结果：网络层首部的位置和类型
+struct LinkFrame {
+    const uint8_t* network;   // 网络层首部（指向原缓冲区，不复制）
+    size_t length;            // 网络层可用字节数
+    uint16_t ethertype;       // 剥离VLAN标签后的以太网类型
+    uint8_t vlan_depth;       // 剥离的VLAN标签层数
+    uint16_t vlan_id;         // 最内层VLAN ID（vlan_depth为0时无意义）
+};
+
+// 链路层解码函数：按打开句柄时的链路类型选定一次，之后逐包直接调用，不再按包判断链路类型
+// 帧长度不足时返回false；不是IP帧时返回true，由调用方按ethertype区分
+typedef bool (*LinkDecoder)(const uint8_t* frame, size_t caplen, LinkFrame& out);
+
+inline uint16_t link_load16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+// 从offset处的以太网类型字段开始剥离VLAN标签栈，填写out
+inline bool link_strip_vlan(const uint8_t* frame, size_t caplen, size_t offset, LinkFrame& out) {
+    if (caplen < offset + 2) {
+        return false;
+    }
+    uint16_t ethertype = link_load16(frame + offset);
+    out.vlan_depth = 0;
+    out.vlan_id = 0;
+    while (ethertype == LINK_ETHERTYPE_VLAN || ethertype == LINK_ETHERTYPE_QINQ ||
+           ethertype == LINK_ETHERTYPE_QINQ_OLD) {
+        // 标签：2字节TCI（低12位为VLAN ID）+ 2字节内层类型
+        if (out.vlan_depth >= LINK_MAX_VLAN_DEPTH || caplen < offset + 6) {
+            return false;
+        }
+        out.vlan_id = link_load16(frame + offset + 2) & 0x0FFF;
+        ethertype = link_load16(frame + offset + 4);
+        offset += 4;
+        out.vlan_depth++;
+    }
+    out.ethertype = ethertype;
+    out.network = frame + offset + 2;
+    out.length = caplen - offset - 2;
+    return true;
+}
+
+// DLT_EN10MB：14字节以太网首部，类型字段位于偏移12，之后可能是VLAN标签栈
+inline bool decode_ethernet_link(const uint8_t* frame, size_t caplen, LinkFrame& out) {
+    return link_strip_vlan(frame, caplen, 12, out);
+}
+
+// DLT_LINUX_SLL（any设备）：16字节首部，协议字段位于偏移14
+// 内核已剥离硬件VLAN标签，但软件打标的帧仍可能带标签，同样按标签栈处理
+inline bool decode_sll_link(const uint8_t* frame, size_t caplen, LinkFrame& out) {
+    return link_strip_vlan(frame, caplen, 14, out);
+}
+
+// DLT_LINUX_SLL2：20字节首部，协议字段位于偏移0
+inline bool decode_sll2_link(const uint8_t* frame, size_t caplen, LinkFrame& out) {
+    if (caplen < 20) {
+        return false;
+    }
+    out.ethertype = link_load16(frame);
+    out.network = frame + 20;
+    out.length = caplen - 20;
+    out.vlan_depth = 0;
+    out.vlan_id = 0;
+    return true;
+}
+
+// DLT_RAW/DLT_IPV4/DLT_IPV6：没有链路层首部，按版本号区分IPv4/IPv6
+inline bool decode_raw_link(const uint8_t* frame, size_t caplen, LinkFrame& out) {
+    if (caplen < 1) {
+        return false;
+    }
+    uint8_t version = frame[0] >> 4;
+    out.ethertype = version == 4 ? LINK_ETHERTYPE_IPV4 : version == 6 ? LINK_ETHERTYPE_IPV6 : 0;
+    out.network = frame;
+    out.length = caplen;
+    out.vlan_depth = 0;
+    out.vlan_id = 0;
+    return true;
+}
+
+// DLT_NULL/DLT_LOOP：4字节地址族，字节序取决于抓包主机，两种字节序都接受
+// AF_INET6在各系统上取值不同（Linux 10、BSD 24/28/30）
+inline bool decode_null_link(const uint8_t* frame, size_t caplen, LinkFrame& out) {
+    if (caplen < 4) {
+        return false;
+    }
+    uint32_t family;
+    memcpy(&family, frame, sizeof(family));
+    if (family > 0xFFFF) {
+        family = __builtin_bswap32(family);
+    }
+    out.ethertype = family == 2 ? LINK_ETHERTYPE_IPV4
+                  : (family == 10 || family == 24 || family == 28 || family == 30) ? LINK_ETHERTYPE_IPV6
+                  : 0;
+    out.network = frame + 4;
+    out.length = caplen - 4;
+    out.vlan_depth = 0;
+    out.vlan_id = 0;
+    return true;
+}
+
+#endif // LINK_DECODE_H
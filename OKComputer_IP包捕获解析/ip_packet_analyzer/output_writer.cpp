@@ -0,0 +1,429 @@
+// output_writer.cpp - 缓冲异步输出实现
+#include "output_writer.h"
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <unistd.h>
+
+// ==================== OutputBuffer 实现 ====================
+
+namespace {
+// 0~255的十进制文本，编译期生成；点分十进制地址逐字节查表拼接，不做除法
+struct OctetText {
+    char text[3];
+    uint8_t length;
+};
+
+struct OctetTable {
+    OctetText octets[256];
+};
+
+constexpr OctetTable build_octet_table() {
+    OctetTable table{};
+    for (int value = 0; value < 256; ++value) {
+        OctetText& octet = table.octets[value];
+        if (value >= 100) {
+            octet.text[octet.length++] = static_cast<char>('0' + value / 100);
+        }
+        if (value >= 10) {
+            octet.text[octet.length++] = static_cast<char>('0' + value / 10 % 10);
+        }
+        octet.text[octet.length++] = static_cast<char>('0' + value % 10);
+    }
+    return table;
+}
+
+constexpr OctetTable OCTET_TABLE = build_octet_table();
+static_assert(OCTET_TABLE.octets[192].length == 3 && OCTET_TABLE.octets[7].text[0] == '7', "点分十进制表");
+}
+
+OutputBuffer::OutputBuffer(size_t capacity) : data_(capacity), size_(0) {}
+
+// 空间不足时扩容（单条记录远小于缓冲区，正常情况下不会发生）
+void OutputBuffer::reserve_more(size_t length) {
+    size_t capacity = data_.size() * 2;
+    while (capacity < size_ + length) {
+        capacity *= 2;
+    }
+    data_.resize(capacity);
+}
+
+void OutputBuffer::append(const char* text, size_t length) {
+    if (length > available()) {
+        reserve_more(length);
+    }
+    memcpy(&data_[size_], text, length);
+    size_ += length;
+}
+
+void OutputBuffer::append(const char* text) {
+    append(text, strlen(text));
+}
+
+void OutputBuffer::append_char(char c) {
+    if (available() < 1) {
+        reserve_more(1);
+    }
+    data_[size_++] = c;
+}
+
+void OutputBuffer::append_spaces(size_t count) {
+    if (count > available()) {
+        reserve_more(count);
+    }
+    memset(&data_[size_], ' ', count);
+    size_ += count;
+}
+
+void OutputBuffer::append_uint(uint64_t value) {
+    // uint64_t最多20位，预留足够空间后直接转换到缓冲区中
+    if (available() < 20) {
+        reserve_more(20);
+    }
+    char* begin = &data_[size_];
+    size_ += std::to_chars(begin, begin + 20, value).ptr - begin;
+}
+
+void OutputBuffer::append_uint(uint64_t value, int min_digits) {
+    char digits[20];
+    size_t length = std::to_chars(digits, digits + sizeof(digits), value).ptr - digits;
+    if (static_cast<size_t>(min_digits) > length) {
+        size_t zeros = static_cast<size_t>(min_digits) - length;
+        if (zeros > available()) {
+            reserve_more(zeros);
+        }
+        memset(&data_[size_], '0', zeros);
+        size_ += zeros;
+    }
+    append(digits, length);
+}
+
+void OutputBuffer::append_int(int64_t value) {
+    if (value < 0) {
+        append_char('-');
+        append_uint(static_cast<uint64_t>(-(value + 1)) + 1);
+    } else {
+        append_uint(static_cast<uint64_t>(value));
+    }
+}
+
+void OutputBuffer::append_hex(uint64_t value, int min_digits) {
+    char digits[16];
+    size_t length = std::to_chars(digits, digits + sizeof(digits), value, 16).ptr - digits;
+    for (int n = static_cast<int>(length); n < min_digits && n < 16; ++n) {
+        append_char('0');
+    }
+    append(digits, length);
+}
+
+void OutputBuffer::append_ipv4(uint32_t addr) {
+    // 最长15字节，先在栈上拼好再一次复制
+    char text[16];
+    size_t length = 0;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        const OctetText& octet = OCTET_TABLE.octets[(addr >> shift) & 0xFF];
+        memcpy(text + length, octet.text, sizeof(octet.text));
+        length += octet.length;
+        text[length++] = '.';
+    }
+    append(text, length - 1);
+}
+
+void OutputBuffer::append_ipv6(const uint8_t* addr) {
+    uint16_t groups[8];
+    for (int i = 0; i < 8; ++i) {
+        groups[i] = static_cast<uint16_t>((addr[2 * i] << 8) | addr[2 * i + 1]);
+    }
+    // RFC 5952：最长的连续全0组（至少两组，等长时取第一段）压缩为"::"，其余组去掉前导0
+    int best_start = -1;
+    int best_length = 1;
+    for (int i = 0; i < 8;) {
+        if (groups[i] != 0) {
+            ++i;
+            continue;
+        }
+        int start = i;
+        while (i < 8 && groups[i] == 0) {
+            ++i;
+        }
+        if (i - start > best_length) {
+            best_start = start;
+            best_length = i - start;
+        }
+    }
+    for (int i = 0; i < 8; ++i) {
+        if (i == best_start) {
+            append("::", 2);
+            i += best_length - 1;
+            continue;
+        }
+        if (i > 0 && i != best_start + best_length) {
+            append_char(':');
+        }
+        append_hex(groups[i], 1);
+    }
+}
+
+// 时间格式化：同一秒内的包复用上次的结果，只在秒数变化时调用localtime_r
+void OutputBuffer::append_time(time_t timestamp) {
+    static thread_local time_t cached_second = static_cast<time_t>(-1);
+    static thread_local char cached_text[64];
+    static thread_local size_t cached_length = 0;
+
+    if (timestamp != cached_second) {
+        struct tm local;
+        localtime_r(&timestamp, &local);
+        // 与ctime()相同的格式："Www Mmm dd hh:mm:ss yyyy\n"
+        cached_length = strftime(cached_text, sizeof(cached_text), "%a %b %e %H:%M:%S %Y\n", &local);
+        cached_second = timestamp;
+    }
+    append(cached_text, cached_length);
+}
+
+void OutputBuffer::append_padded(const char* text, size_t width) {
+    size_t length = strlen(text);
+    append(text, length);
+    if (length < width) {
+        append_spaces(width - length);
+    }
+}
+
+void OutputBuffer::pad_from(size_t start, size_t width) {
+    size_t length = size_ - start;
+    if (length < width) {
+        append_spaces(width - length);
+    }
+}
+
+// ==================== OutputWriter 实现 ====================
+
+namespace {
+// 当前线程正在填充的缓冲区
+thread_local OutputBuffer* t_current_buffer = NULL;
+thread_local const OutputWriter* t_buffer_owner = NULL;
+thread_local unsigned t_buffer_generation = 0;
+thread_local unsigned t_flush_epoch = 0;     // 取得缓冲区或上次提交时的定时刷新序号
+
+// 缓冲池耗尽时本条记录写到这里并丢弃，格式化代码不需要处理取不到缓冲区的情况
+OutputBuffer& discard_buffer() {
+    static thread_local OutputBuffer buffer(4096);
+    return buffer;
+}
+}
+
+OutputWriter::OutputWriter()
+    : fd_(-1), flush_each_record_(false), timed_flush_(false), drop_when_full_(false),
+      flush_threshold_(0), flush_epoch_(0),
+      running_(false), stopping_(false), generation_(0), in_flight_(0),
+      bytes_written_(0), write_calls_(0), producer_stalls_(0), dropped_records_(0) {}
+
+OutputWriter::~OutputWriter() {
+    stop();
+    for (size_t i = 0; i < all_buffers_.size(); ++i) {
+        delete all_buffers_[i];
+    }
+}
+
+bool OutputWriter::start(int fd, bool live, size_t buffer_size, size_t buffer_count) {
+    if (running_ || fd < 0 || buffer_size == 0 || buffer_count == 0) {
+        return false;
+    }
+    fd_ = fd;
+    // 只有输出到终端时才逐条提交（交互式实时显示）；写文件/管道时攒批，由定时刷新限制延迟
+    flush_each_record_ = live && isatty(fd) == 1;
+    timed_flush_ = live;
+    drop_when_full_ = live;
+    // 预留1/8空间给最后一条记录，避免记录跨缓冲区时扩容
+    flush_threshold_ = buffer_size / 8;
+    stopping_ = false;
+    generation_++;
+
+    for (size_t i = 0; i < all_buffers_.size(); ++i) {
+        delete all_buffers_[i];
+    }
+    all_buffers_.clear();
+    free_buffers_.clear();
+    pending_.clear();
+    for (size_t i = 0; i < buffer_count; ++i) {
+        OutputBuffer* buffer = new OutputBuffer(buffer_size);
+        all_buffers_.push_back(buffer);
+        free_buffers_.push_back(buffer);
+    }
+
+    running_ = true;
+    thread_ = std::thread(&OutputWriter::writer_loop, this);
+    return true;
+}
+
+bool OutputWriter::current_buffer_valid() const {
+    return t_current_buffer != NULL && t_buffer_owner == this && t_buffer_generation == generation_;
+}
+
+OutputBuffer& OutputWriter::begin_record() {
+    if (!current_buffer_valid()) {
+        t_current_buffer = acquire_buffer();
+        t_buffer_owner = this;
+        t_buffer_generation = generation_;
+        t_flush_epoch = flush_epoch_.load(std::memory_order_relaxed);
+        if (t_current_buffer == NULL) {
+            t_current_buffer = &discard_buffer();
+        }
+    }
+    return *t_current_buffer;
+}
+
+void OutputWriter::end_record() {
+    OutputBuffer* buffer = t_current_buffer;
+    if (buffer == NULL) {
+        return;
+    }
+    if (buffer == &discard_buffer()) {
+        // 缓冲池耗尽时写入的记录：丢弃，下一条记录再尝试取缓冲区
+        buffer->clear();
+        t_current_buffer = NULL;
+        dropped_records_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (flush_each_record_ || buffer->available() < flush_threshold_ ||
+        (timed_flush_ && t_flush_epoch != flush_epoch_.load(std::memory_order_relaxed))) {
+        submit_current();
+    }
+}
+
+void OutputWriter::submit_record() {
+    end_record();
+    if (running_ && current_buffer_valid()) {
+        submit_current();
+    }
+}
+
+void OutputWriter::poll() {
+    if (timed_flush_ && current_buffer_valid() &&
+        t_flush_epoch != flush_epoch_.load(std::memory_order_relaxed)) {
+        submit_current();
+    }
+}
+
+void OutputWriter::flush() {
+    if (!running_) {
+        return;
+    }
+    if (current_buffer_valid()) {
+        submit_current();
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!pending_.empty() || in_flight_ > 0) {
+        free_cv_.wait(lock);
+    }
+}
+
+void OutputWriter::stop() {
+    if (!running_) {
+        return;
+    }
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    pending_cv_.notify_one();
+    thread_.join();
+    running_ = false;
+}
+
+// 从缓冲池取一个空闲缓冲区；池空时实时抓包返回NULL（本条记录丢弃），回放时等待写线程归还
+OutputBuffer* OutputWriter::acquire_buffer() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (free_buffers_.empty()) {
+        if (drop_when_full_) {
+            return NULL;
+        }
+        producer_stalls_.fetch_add(1, std::memory_order_relaxed);
+        while (free_buffers_.empty()) {
+            free_cv_.wait(lock);
+        }
+    }
+    OutputBuffer* buffer = free_buffers_.back();
+    free_buffers_.pop_back();
+    buffer->clear();
+    return buffer;
+}
+
+void OutputWriter::submit(OutputBuffer* buffer) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(buffer);
+    }
+    pending_cv_.notify_one();
+}
+
+// 提交当前线程的缓冲区，下一条记录时再取新的缓冲区
+void OutputWriter::submit_current() {
+    OutputBuffer* buffer = t_current_buffer;
+    t_current_buffer = NULL;
+    if (buffer == &discard_buffer()) {
+        buffer->clear();
+        return;
+    }
+    if (buffer->size() == 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_buffers_.push_back(buffer);
+        return;
+    }
+    submit(buffer);
+}
+
+void OutputWriter::writer_loop() {
+    const std::chrono::milliseconds interval(FLUSH_INTERVAL_MS);
+    auto next_flush = std::chrono::steady_clock::now() + interval;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        while (pending_.empty() && !stopping_) {
+            if (!timed_flush_) {
+                pending_cv_.wait(lock);
+                continue;
+            }
+            // 定时刷新：递增序号，各生产者在下一条记录结束或poll()时提交未写满的缓冲区
+            if (pending_cv_.wait_until(lock, next_flush) == std::cv_status::timeout) {
+                flush_epoch_.fetch_add(1, std::memory_order_relaxed);
+                next_flush = std::chrono::steady_clock::now() + interval;
+            }
+        }
+        if (timed_flush_ && std::chrono::steady_clock::now() >= next_flush) {
+            flush_epoch_.fetch_add(1, std::memory_order_relaxed);
+            next_flush = std::chrono::steady_clock::now() + interval;
+        }
+        if (pending_.empty()) {
+            break;  // stopping_ 且没有待写数据
+        }
+        OutputBuffer* buffer = pending_.front();
+        pending_.pop_front();
+        in_flight_++;
+        lock.unlock();
+
+        write_all(buffer->data(), buffer->size());
+
+        lock.lock();
+        in_flight_--;
+        free_buffers_.push_back(buffer);
+        free_cv_.notify_all();
+    }
+}
+
+// 一次性写出整个缓冲区，处理EINTR和部分写
+void OutputWriter::write_all(const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd_, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;  // 输出端已关闭（如管道被关闭），丢弃剩余数据
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+        bytes_written_.fetch_add(static_cast<uint64_t>(written), std::memory_order_relaxed);
+        write_calls_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,136 @@
+// output_writer.h - 缓冲异步输出：按线程格式化缓冲区 + 后台写线程
+#ifndef OUTPUT_WRITER_H
+#define OUTPUT_WRITER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 输出缓冲区
+// 整数用std::to_chars直接写入缓冲区，IPv4地址用预先生成的0~255十进制文本表拼接，
+// 避免iostream的格式化开销；都不分配内存（缓冲区不足时才扩容）。
+class OutputBuffer {
+public:
+    explicit OutputBuffer(size_t capacity);
+
+    void append(const char* text, size_t length);
+    void append(const char* text);
+    void append_char(char c);
+    void append_spaces(size_t count);
+    void append_uint(uint64_t value);
+    void append_uint(uint64_t value, int min_digits);    // 不足位数时前补0（如微秒部分）
+    void append_int(int64_t value);
+    void append_hex(uint64_t value, int min_digits);    // 小写，不带0x前缀，不足位数补0
+    void append_ipv4(uint32_t addr);                     // 主机字节序地址 -> 点分十进制
+    void append_ipv6(const uint8_t* addr);               // 16字节网络字节序地址 -> RFC 5952压缩格式
+    void append_time(time_t timestamp);                  // 与ctime()相同的格式，含换行
+
+    // 左对齐填充：写入text后用空格补足width字节（与setw+left一致，按字节计宽）
+    void append_padded(const char* text, size_t width);
+    // 从位置start起的内容不足width字节时用空格补足，用于由多段拼成的列
+    void pad_from(size_t start, size_t width);
+
+    const char* data() const { return &data_[0]; }
+    size_t size() const { return size_; }
+    size_t capacity() const { return data_.size(); }
+    size_t available() const { return data_.size() - size_; }
+    void clear() { size_ = 0; }
+
+private:
+    void reserve_more(size_t length);
+
+    std::vector<char> data_;
+    size_t size_;
+};
+
+// 后台输出线程
+// 各格式化线程写入自己的线程局部缓冲区，缓冲区写满后整块交给后台线程，由其用一次write()写出。
+// 实时抓包时写线程每FLUSH_INTERVAL_MS发出一次定时刷新请求，生产者在下一条记录结束（或空闲时
+// 调用poll()）时提交未写满的缓冲区，输出延迟有上限而不必每条记录一次write()。
+// 写线程落后时缓冲池耗尽：回放时生产者等待空闲缓冲区，实时抓包时丢弃该条记录并计数，不阻塞抓包线程。
+class OutputWriter {
+public:
+    static const size_t DEFAULT_BUFFER_SIZE = 256 * 1024;  // 单个缓冲区大小
+    static const size_t DEFAULT_BUFFER_COUNT = 32;         // 缓冲池中的缓冲区个数
+    static const unsigned FLUSH_INTERVAL_MS = 100;         // 实时抓包时的定时刷新间隔
+
+    OutputWriter();
+    ~OutputWriter();
+
+    // 启动写线程
+    // fd: 输出文件描述符
+    // live: 为true时为实时抓包：定时刷新，缓冲池耗尽时丢弃记录；输出到终端时每条记录结束后立即提交。
+    //       为false时为离线回放：攒满缓冲区再提交，缓冲池耗尽时等待
+    bool start(int fd, bool live,
+               size_t buffer_size = DEFAULT_BUFFER_SIZE,
+               size_t buffer_count = DEFAULT_BUFFER_COUNT);
+
+    // 获取当前线程的格式化缓冲区，写完一条记录后调用end_record()
+    OutputBuffer& begin_record();
+    void end_record();
+
+    // 写线程请求了定时刷新时提交当前线程的缓冲区；抓包循环在读超时/空闲时调用，
+    // 使流量停止后已格式化的记录也能在一个刷新间隔内写出
+    void poll();
+
+    // 结束一条记录并立即提交当前线程的缓冲区，不等待写出；抓包线程输出周期报告时使用，
+    // 不会阻塞在终端/磁盘I/O上（缓冲池耗尽时与普通记录一样丢弃）
+    void submit_record();
+
+    // 提交当前线程的缓冲区并等待写线程把所有已提交数据写出
+    void flush();
+
+    // 刷新并停止写线程
+    void stop();
+
+    bool running() const { return running_; }
+    // 计数由写线程/生产者更新，可以在任意线程读取
+    uint64_t bytes_written() const { return bytes_written_.load(std::memory_order_relaxed); }
+    uint64_t write_calls() const { return write_calls_.load(std::memory_order_relaxed); }
+    uint64_t producer_stalls() const { return producer_stalls_.load(std::memory_order_relaxed); }  // 生产者等待空闲缓冲区的次数
+    uint64_t dropped_records() const { return dropped_records_.load(); }  // 缓冲池耗尽而丢弃的记录数
+
+private:
+    OutputWriter(const OutputWriter&);
+    OutputWriter& operator=(const OutputWriter&);
+
+    OutputBuffer* acquire_buffer();
+    bool current_buffer_valid() const;
+    void submit(OutputBuffer* buffer);
+    void submit_current();
+    void writer_loop();
+    void write_all(const char* data, size_t length);
+
+    int fd_;
+    bool flush_each_record_;
+    bool timed_flush_;                        // 写线程定期请求提交未写满的缓冲区
+    bool drop_when_full_;                     // 缓冲池耗尽时丢弃记录而不是等待
+    size_t flush_threshold_;                  // 缓冲区剩余空间低于此值时提交
+    std::atomic<unsigned> flush_epoch_;       // 定时刷新请求的序号，写线程每个刷新间隔递增
+    bool running_;
+    bool stopping_;
+    unsigned generation_;                     // 每次start()递增，用于识别过期的线程局部缓冲区
+
+    std::vector<OutputBuffer*> all_buffers_;  // 所有缓冲区（用于释放）
+    std::vector<OutputBuffer*> free_buffers_; // 空闲缓冲区
+    std::deque<OutputBuffer*> pending_;       // 待写出的缓冲区
+    size_t in_flight_;                        // 写线程正在写的缓冲区数
+
+    std::mutex mutex_;
+    std::condition_variable pending_cv_;      // 有数据待写/需要停止
+    std::condition_variable free_cv_;         // 有空闲缓冲区/写出完成
+    std::thread thread_;
+
+    std::atomic<uint64_t> bytes_written_;
+    std::atomic<uint64_t> write_calls_;
+    std::atomic<uint64_t> producer_stalls_;
+    std::atomic<uint64_t> dropped_records_;
+};
+
+#endif // OUTPUT_WRITER_H
@@ -0,0 +1,70 @@
+// packet_aggregate.h - 共享的逐包汇总（头文件实现）：包数/协议统计、流表、Top-K、去重计数和速率统计
+// ip_analyzer的record_packet和基准测试的汇总阶段都调用aggregate_packet，测到的就是实际运行的代码
+#ifndef PACKET_AGGREGATE_H
+#define PACKET_AGGREGATE_H
+
+#include <cstdint>
+#include <cstring>
+#include <netinet/in.h>
+#include "packet_parser.h"
+#include "capture_stats.h"
+#include "flow_table.h"
+#include "heavy_hitters.h"
+#include "hyperloglog.h"
+#include "rate_stats.h"
+
+// 一个处理线程的汇总状态，各结构未init()时不启用（CaptureStats和RateStats总是更新）
+struct PacketAggregates {
+    CaptureStats stats;                    // 抓包统计
+    FlowTable flows;                       // 五元组流表（--flows 0时不启用）
+    HeavyHitters talkers;                  // 源/目的地址和五元组Top-K（--top-k 0时不启用）
+    DistinctCounters distinct;             // 本统计窗口内的去重计数（--distinct-precision 0时不启用）
+    RateStats rates;                       // 1秒/10秒/60秒分桶的速率统计和包长直方图
+};
+
+// 把一个已解码的包计入汇总状态
+// reassembly为true时分片只在数据报重组完成（reassembled_length非0）后按整个数据报计入一次五元组结构；
+// 五元组键只容纳IPv4地址，IPv6包不计入。流表按包时间推进时间轮使空闲流超时
+inline void aggregate_packet(PacketAggregates& aggregates, const IPPacketInfo& packet_info, bool reassembly) {
+    bool fragment = (packet_info.flags & 0x1) != 0 || packet_info.fragment_offset != 0;
+    if (packet_info.version == 6) {
+        aggregates.stats.count_ipv6(packet_info.protocol, packet_info.total_length, fragment);
+    } else {
+        aggregates.stats.count_ip(packet_info.protocol, packet_info.total_length, fragment);
+    }
+    if (packet_info.checksum_errors != 0) {
+        aggregates.stats.count_checksum_errors(packet_info.protocol,
+                                               (packet_info.checksum_errors & CHECKSUM_ERROR_IP) != 0,
+                                               (packet_info.checksum_errors & CHECKSUM_ERROR_L4) != 0);
+    }
+
+    if ((aggregates.flows.enabled() || aggregates.talkers.enabled() || aggregates.distinct.enabled()) &&
+        packet_info.version == 4 &&
+        (!fragment || !reassembly || packet_info.reassembled_length > 0)) {
+        FlowKey key;
+        memset(&key, 0, sizeof(key));
+        key.src_addr = packet_info.src_addr;
+        key.dst_addr = packet_info.dst_addr;
+        key.src_port = packet_info.l4.src_port;
+        key.dst_port = packet_info.l4.dst_port;
+        key.protocol = packet_info.protocol;
+        uint64_t timestamp_us = static_cast<uint64_t>(packet_info.timestamp) * 1000000 + packet_info.timestamp_nsec / 1000;
+        uint16_t bytes = packet_info.reassembled_length > 0 ? packet_info.reassembled_length
+                                                            : packet_info.total_length;
+        if (aggregates.flows.enabled()) {
+            aggregates.flows.update(key, bytes, timestamp_us, packet_info.l4.tcp_flags);
+            aggregates.flows.expire(timestamp_us);
+        }
+        if (aggregates.talkers.enabled()) {
+            aggregates.talkers.add(key, bytes);
+        }
+        if (aggregates.distinct.enabled()) {
+            aggregates.distinct.add(key);
+        }
+    }
+
+    // 速率统计按IP总长度计字节
+    aggregates.rates.add(static_cast<uint64_t>(packet_info.timestamp), packet_info.protocol, packet_info.total_length);
+}
+
+#endif // PACKET_AGGREGATE_H
@@ -0,0 +1,400 @@
+/*
+ * 包解析微基准测试
+ * 功能：在内存中生成合成流量语料，分别测量解码、过滤、汇总各阶段的单包开销
+ *       （纳秒/包、TSC周期/包、堆分配次数/包），不需要实时流量
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <getopt.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "packet_parser.h"
+#include "packet_aggregate.h"
+#include "packet_filter.h"
+#include "dns_stats.h"
+#include "traffic_gen.h"
+
+using namespace std;
+
+// ==================== 堆分配计数 ====================
+// 替换全局operator new，统计各阶段的堆分配次数（热路径上应为0）
+
+static std::atomic<uint64_t> allocation_count(0);
+
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size > 0 ? size : 1);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// ==================== 语料生成 ====================
+
+// 语料中的一帧：数据在BenchCorpus::data中的位置
+struct BenchFrame {
+    uint32_t offset;
+    uint32_t caplen;
+    struct timeval ts;
+};
+
+// 合成语料：所有帧连续存放在一块缓冲区中
+struct BenchCorpus {
+    vector<uint8_t> data;
+    vector<BenchFrame> frames;
+    TrafficCounters counters;
+};
+
+// 用TrafficGenerator生成packets个包（分片包按两帧计），与pcap_gen写出的流量相同
+bool generate_corpus(const TrafficConfig& config, size_t packets, BenchCorpus& corpus) {
+    TrafficGenerator generator;
+    if (!generator.init(config)) {
+        return false;
+    }
+    corpus.data.reserve(packets * 400);
+    corpus.frames.reserve(packets + packets / 10);
+    for (size_t i = 0; i < packets; ++i) {
+        do {
+            size_t length;
+            BenchFrame frame;
+            const uint8_t* data = generator.next(length, frame.ts);
+            frame.offset = static_cast<uint32_t>(corpus.data.size());
+            frame.caplen = static_cast<uint32_t>(length);
+            corpus.data.insert(corpus.data.end(), data, data + length);
+            corpus.frames.push_back(frame);
+        } while (generator.has_pending());
+    }
+    corpus.counters = generator.counters();
+    return true;
+}
+
+// DNS语料：messages个DNS报文（UDP载荷），查询名从names个名字中随机抽取；
+// 一半是查询，一半是带压缩指针的响应（问题名 + CNAME + A记录）
+void generate_dns_corpus(size_t messages, size_t names, uint64_t seed, BenchCorpus& corpus) {
+    uint64_t state = seed * 0x9E3779B97F4A7C15ULL + 1;
+    corpus.data.reserve(messages * 80);
+    corpus.frames.reserve(messages);
+    for (size_t i = 0; i < messages; ++i) {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        uint64_t r = state * 2685821657736338717ULL;
+        size_t name = static_cast<size_t>(r >> 32) % names;
+        bool response = (r & 1) != 0;
+        uint16_t qtype = (r & 2) != 0 ? DNS_TYPE_AAAA : DNS_TYPE_A;
+
+        BenchFrame frame;
+        frame.offset = static_cast<uint32_t>(corpus.data.size());
+        frame.ts.tv_sec = 0;
+        frame.ts.tv_usec = 0;
+        vector<uint8_t>& out = corpus.data;
+        uint8_t header[12] = { static_cast<uint8_t>(i >> 8), static_cast<uint8_t>(i),
+                               static_cast<uint8_t>(response ? 0x81 : 0x01), static_cast<uint8_t>(response ? 0x80 : 0x00),
+                               0, 1, 0, static_cast<uint8_t>(response ? 2 : 0), 0, 0, 0, 0 };
+        out.insert(out.end(), header, header + 12);
+        // 查询名：host<n>.svc<n%97>.example.com
+        string labels[4] = { "host" + to_string(name), "svc" + to_string(name % 97), "example", "com" };
+        for (int l = 0; l < 4; ++l) {
+            out.push_back(static_cast<uint8_t>(labels[l].size()));
+            out.insert(out.end(), labels[l].begin(), labels[l].end());
+        }
+        out.push_back(0);
+        uint8_t question[4] = { 0, static_cast<uint8_t>(qtype), 0, 1 };
+        out.insert(out.end(), question, question + 4);
+        if (response) {
+            // CNAME：名字指向问题（偏移12），目标为"edge" + 指向问题中svc标签的指针
+            uint16_t svc_offset = static_cast<uint16_t>(12 + 1 + labels[0].size());
+            uint8_t cname[] = { 0xC0, 12, 0, DNS_TYPE_CNAME, 0, 1, 0, 0, 0x0E, 0x10, 0, 7,
+                                4, 'e', 'd', 'g', 'e', static_cast<uint8_t>(0xC0 | (svc_offset >> 8)),
+                                static_cast<uint8_t>(svc_offset) };
+            size_t target_offset = out.size() - frame.offset + 12;
+            out.insert(out.end(), cname, cname + sizeof(cname));
+            uint8_t a[] = { static_cast<uint8_t>(0xC0 | (target_offset >> 8)), static_cast<uint8_t>(target_offset),
+                            0, DNS_TYPE_A, 0, 1, 0, 0, 0, 60, 0, 4, 10, 0,
+                            static_cast<uint8_t>(name >> 8), static_cast<uint8_t>(name) };
+            out.insert(out.end(), a, a + sizeof(a));
+        }
+        frame.caplen = static_cast<uint32_t>(out.size() - frame.offset);
+        corpus.frames.push_back(frame);
+    }
+}
+
+// ==================== 各阶段 ====================
+
+// 按ip_analyzer的默认参数初始化汇总状态（流表262144条、Top-K 1024、去重精度14）
+bool init_aggregates(PacketAggregates& aggregates) {
+    vector<uint8_t> protocols;
+    for (int protocol = 0; protocol < 256; ++protocol) {
+        if (protocol_entry(static_cast<uint8_t>(protocol)).known && protocols.size() + 1 < RateStats::MAX_PROTOCOLS) {
+            protocols.push_back(static_cast<uint8_t>(protocol));
+        }
+    }
+    return aggregates.flows.init(262144, 60) && aggregates.talkers.init(1024) && aggregates.distinct.init(14) &&
+           aggregates.rates.init(protocols);
+}
+
+// 全流程阶段接入共享解析库的钩子：与ip_analyzer一样在填充包信息之前用--match过滤
+struct BenchFilterHooks : NoParseHooks {
+    explicit BenchFilterHooks(const PacketFilter& packet_filter) : filter(packet_filter) {}
+
+    const PacketFilter& filter;
+
+    bool accept_ipv4(const IPv4HeaderView& ip_view) { return filter.match(ip_view); }
+    bool accept_ipv6(const IPv6HeaderView& ip_view) { return filter.match(ip_view); }
+};
+
+// 一个阶段的测量结果
+struct StageResult {
+    const char* name;
+    uint64_t packets;
+    double nanoseconds;
+    uint64_t cycles;
+    uint64_t allocations;
+    uint64_t check;   // 由结果算出的校验值，防止编译器把测量的代码优化掉
+};
+
+inline uint64_t read_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// 先不计时地遍历一轮预热缓存和分支预测，再对语料重复执行rounds轮stage(frame)，记录耗时、周期和分配次数
+template <typename Stage>
+StageResult run_stage(const char* name, const BenchCorpus& corpus, size_t rounds, Stage stage) {
+    StageResult result;
+    result.name = name;
+    result.packets = static_cast<uint64_t>(corpus.frames.size()) * rounds;
+    result.check = 0;
+    for (size_t i = 0; i < corpus.frames.size(); ++i) {
+        result.check += stage(corpus.frames[i], i);
+    }
+    uint64_t allocations = allocation_count.load(std::memory_order_relaxed);
+    auto start = chrono::steady_clock::now();
+    uint64_t start_cycles = read_cycles();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < corpus.frames.size(); ++i) {
+            result.check += stage(corpus.frames[i], i);
+        }
+    }
+    result.cycles = read_cycles() - start_cycles;
+    result.nanoseconds = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    result.allocations = allocation_count.load(std::memory_order_relaxed) - allocations;
+    return result;
+}
+
+void print_result(const StageResult& result) {
+    double packets = result.packets > 0 ? static_cast<double>(result.packets) : 1;
+    cout << left << setw(14) << result.name << right << fixed
+         << setw(12) << setprecision(2) << result.nanoseconds / packets
+         << setw(14) << setprecision(2) << result.cycles / packets
+         << setw(14) << setprecision(4) << result.allocations / packets
+         << setw(14) << setprecision(0) << result.packets * 1e9 / (result.nanoseconds > 0 ? result.nanoseconds : 1)
+         << "  " << hex << result.check << dec << endl;
+}
+
+void print_usage(const char* program) {
+    cout << "用法: " << program << " [选项]" << endl;
+    cout << "  -n, --packets <N>     语料包数（默认200000）" << endl;
+    cout << "  -r, --rounds <N>      每个阶段遍历语料的轮数（默认10）" << endl;
+    cout << "  --flows <N>           语料中的流数（默认4096）" << endl;
+    cout << "  --seed <N>            随机种子（默认1，同一种子生成同一语料）" << endl;
+    cout << "  --match <表达式>      过滤阶段使用的--match表达式（默认\"tcp and dst port 443 or udp\"）" << endl;
+    cout << "  -h, --help            显示此帮助信息" << endl;
+}
+
+int main(int argc, char *argv[]) {
+    TrafficConfig config;
+    size_t packets = 200000;
+    size_t rounds = 10;
+    string match_exp = "tcp and dst port 443 or udp";
+
+    enum { OPT_FLOWS = 256, OPT_SEED, OPT_MATCH };
+    static const struct option long_options[] = {
+        {"packets", required_argument, NULL, 'n'},
+        {"rounds",  required_argument, NULL, 'r'},
+        {"flows",   required_argument, NULL, OPT_FLOWS},
+        {"seed",    required_argument, NULL, OPT_SEED},
+        {"match",   required_argument, NULL, OPT_MATCH},
+        {"help",    no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:r:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n':
+                packets = strtoull(optarg, NULL, 10);
+                break;
+            case 'r':
+                rounds = strtoull(optarg, NULL, 10);
+                break;
+            case OPT_FLOWS:
+                config.flows = strtoull(optarg, NULL, 10);
+                break;
+            case OPT_SEED:
+                config.seed = strtoull(optarg, NULL, 10);
+                break;
+            case OPT_MATCH:
+                match_exp = optarg;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (packets == 0 || rounds == 0) {
+        cerr << "错误：包数和轮数必须大于0" << endl;
+        return 1;
+    }
+
+    PacketFilter filter;
+    if (!filter.compile(match_exp)) {
+        cerr << "错误：无法编译--match表达式 - " << filter.error() << endl;
+        return 1;
+    }
+
+    BenchCorpus corpus;
+    if (!generate_corpus(config, packets, corpus)) {
+        cerr << "错误：语料生成参数无效（流数超出范围）" << endl;
+        return 1;
+    }
+    cout << "语料: " << corpus.frames.size() << " 帧, " << corpus.data.size() << " 字节（平均 "
+         << corpus.data.size() / corpus.frames.size() << " 字节/帧）; VLAN " << corpus.counters.vlan_frames
+         << ", IPv6 " << corpus.counters.ipv6_packets << ", 分片 " << corpus.counters.fragments
+         << ", 带选项 " << corpus.counters.option_packets << endl;
+    cout << "每个阶段遍历 " << rounds << " 轮";
+#if !defined(__x86_64__) && !defined(__i386__)
+    cout << "（本平台不支持TSC，周期/包为0）";
+#endif
+    cout << endl;
+
+    // 汇总阶段的输入：预先解析好的包信息
+    vector<IPPacketInfo> parsed(corpus.frames.size());
+    vector<uint8_t> parsed_ok(corpus.frames.size());
+    uint64_t parse_failures = 0;
+    uint64_t checksum_errors = 0;
+    for (size_t i = 0; i < corpus.frames.size(); ++i) {
+        const BenchFrame& frame = corpus.frames[i];
+        parsed_ok[i] = parse_frame(decode_ethernet_link, &corpus.data[frame.offset], frame.caplen, frame.ts,
+                                   false, parsed[i]);
+        parse_failures += parsed_ok[i] ? 0 : 1;
+        checksum_errors += parsed_ok[i] && parsed[i].checksum_errors != 0 ? 1 : 0;
+    }
+    // 语料由生成器保证合法，两者都应为0
+    cout << "解析失败 " << parse_failures << ", 首部校验和错误 " << checksum_errors << endl << endl;
+
+    PacketAggregates aggregator;
+    PacketAggregates full_aggregator;
+    DnsCounters dns;
+    if (!init_aggregates(aggregator) || !init_aggregates(full_aggregator) || !dns.init(1024)) {
+        cerr << "错误：无法分配汇总阶段的统计结构" << endl;
+        return 1;
+    }
+
+    const uint8_t* data = corpus.data.data();
+    vector<StageResult> results;
+
+    // 解码：链路层解码 + IPv4/IPv6首部 + 传输层分派 + 首部校验和
+    results.push_back(run_stage("解码", corpus, rounds, [&](const BenchFrame& frame, size_t) -> uint64_t {
+        IPPacketInfo packet_info;
+        if (!parse_frame(decode_ethernet_link, data + frame.offset, frame.caplen, frame.ts, false, packet_info)) {
+            return 0;
+        }
+        return packet_info.protocol + packet_info.l4.dst_port + packet_info.checksum_errors;
+    }));
+
+    // 解码并校验传输层校验和（--l4-checksum）
+    results.push_back(run_stage("解码+L4校验", corpus, rounds, [&](const BenchFrame& frame, size_t) -> uint64_t {
+        IPPacketInfo packet_info;
+        if (!parse_frame(decode_ethernet_link, data + frame.offset, frame.caplen, frame.ts, true, packet_info)) {
+            return 0;
+        }
+        return packet_info.protocol + packet_info.checksum_errors;
+    }));
+
+    // 过滤：链路层解码 + IPv4/IPv6首部视图 + 判定程序
+    results.push_back(run_stage("过滤", corpus, rounds, [&](const BenchFrame& frame, size_t) -> uint64_t {
+        LinkFrame link;
+        if (!decode_ethernet_link(data + frame.offset, frame.caplen, link)) {
+            return 0;
+        }
+        if (link.ethertype == LINK_ETHERTYPE_IPV4) {
+            IPv4HeaderView ip_view;
+            return ip_view.decode(link.network, link.length) && filter.match(ip_view) ? 1 : 0;
+        }
+        if (link.ethertype == LINK_ETHERTYPE_IPV6) {
+            IPv6HeaderView ip_view;
+            return ip_view.decode(link.network, link.length) && filter.match(ip_view) ? 1 : 0;
+        }
+        return 0;
+    }));
+
+    // 汇总：包数/协议统计、流表、Top-K、去重计数和速率统计（与record_packet相同的aggregate_packet，
+    // 按启用重组计：语料不经重组器，分片不进入五元组结构）
+    results.push_back(run_stage("汇总", corpus, rounds, [&](const BenchFrame&, size_t i) -> uint64_t {
+        if (!parsed_ok[i]) {
+            return 0;
+        }
+        aggregate_packet(aggregator, parsed[i], true);
+        return 1;
+    }));
+
+    // 全流程：经共享解析库解码并在钩子中过滤，再汇总，与ip_analyzer的decode_packet + record_packet相同
+    results.push_back(run_stage("全流程", corpus, rounds, [&](const BenchFrame& frame, size_t) -> uint64_t {
+        BenchFilterHooks hooks(filter);
+        IPPacketInfo packet_info;
+        if (!parse_frame(decode_ethernet_link, data + frame.offset, frame.caplen, frame.ts, false, hooks,
+                         packet_info)) {
+            return 0;
+        }
+        aggregate_packet(full_aggregator, packet_info, true);
+        return 1;
+    }));
+
+    // DNS：解析报文（名字含压缩指针）并计入查询名/类型Top-K，语料中的名字数多于计数器数
+    BenchCorpus dns_corpus;
+    generate_dns_corpus(corpus.frames.size(), 4096, config.seed, dns_corpus);
+    const uint8_t* dns_data = dns_corpus.data.data();
+    results.push_back(run_stage("DNS解析", dns_corpus, rounds, [&](const BenchFrame& frame, size_t) -> uint64_t {
+        if (!dns.add(dns_data + frame.offset, frame.caplen)) {
+            return 0;
+        }
+        return dns.last().questions_parsed + dns.last().answers_parsed;
+    }));
+
+    cout << left << setw(14) << "阶段" << right << setw(12) << "纳秒/包" << setw(14) << "TSC周期/包"
+         << setw(14) << "分配/包" << setw(14) << "包/秒" << "  校验值" << endl;
+    cout << "----------------------------------------------------------------------------" << endl;
+    for (size_t i = 0; i < results.size(); ++i) {
+        print_result(results[i]);
+    }
+    cout << endl << "汇总结果（含预热轮）: IPv4 " << aggregator.stats.ip_packets << " 包, IPv6 " << aggregator.stats.ipv6_packets
+         << " 包, 活跃流 " << aggregator.flows.size() << ", 五元组去重估计 " << fixed << setprecision(0)
+         << aggregator.distinct.flows.estimate() << endl;
+    cout << "DNS结果（含预热轮）: 报文 " << dns.stats().messages << ", 无法解析 " << dns.stats().malformed
+         << ", 回答记录 " << dns.stats().answers << endl;
+    return 0;
+}
@@ -0,0 +1,242 @@
+// packet_decode.h - IPv4/IPv6首部零拷贝解码视图
+#ifndef PACKET_DECODE_H
+#define PACKET_DECODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// IPv4首部最小长度（字节）
+const size_t IPV4_MIN_HEADER_LEN = 20;
+
+// IPv4首部只读视图
+// 直接引用pcap缓冲区中的字节，不复制、不分配内存、不做字符串转换；
+// 各字段按需从缓冲区读取并转换为主机字节序。
+// 视图的生命周期不能超过其引用的缓冲区（pcap回调返回后缓冲区即失效）。
+class IPv4HeaderView {
+public:
+    IPv4HeaderView() : data_(NULL), caplen_(0) {}
+
+    // 解码：检查捕获长度、版本号和首部长度，成功返回true
+    bool decode(const uint8_t* data, size_t caplen) {
+        if (data == NULL || caplen < IPV4_MIN_HEADER_LEN) {
+            return false;
+        }
+        uint8_t version_ihl = data[0];
+        size_t ihl = (version_ihl & 0x0F) * 4;
+        if ((version_ihl >> 4) != 4 || ihl < IPV4_MIN_HEADER_LEN || ihl > caplen) {
+            return false;
+        }
+        data_ = data;
+        caplen_ = caplen;
+        return true;
+    }
+
+    const uint8_t* data() const { return data_; }
+    size_t captured_length() const { return caplen_; }
+
+    uint8_t version() const { return data_[0] >> 4; }
+    uint8_t header_length() const { return (data_[0] & 0x0F) * 4; }  // 字节
+    uint8_t tos() const { return data_[1]; }
+    uint16_t total_length() const { return load16(2); }
+    uint16_t identification() const { return load16(4); }
+
+    // 标志位与片偏移的原始16位字（主机字节序）
+    uint16_t flags_fragment() const { return load16(6); }
+    uint8_t flags() const { return flags_fragment() >> 13; }
+    uint16_t fragment_offset() const { return flags_fragment() & 0x1FFF; }  // 单位：8字节
+    bool dont_fragment() const { return (flags_fragment() & 0x4000) != 0; }
+    bool more_fragments() const { return (flags_fragment() & 0x2000) != 0; }
+    bool is_fragment() const { return (flags_fragment() & 0x3FFF) != 0; }
+
+    uint8_t ttl() const { return data_[8]; }
+    uint8_t protocol() const { return data_[9]; }
+    uint16_t checksum() const { return load16(10); }
+
+    // 源/目的地址（主机字节序）
+    uint32_t src_addr() const { return load32(12); }
+    uint32_t dst_addr() const { return load32(16); }
+
+    // 载荷（首部之后的数据），长度取总长度与捕获长度中较小者
+    const uint8_t* payload() const { return data_ + header_length(); }
+    size_t payload_length() const {
+        size_t end = total_length();
+        if (end > caplen_ || end < header_length()) {
+            end = caplen_;
+        }
+        return end - header_length();
+    }
+
+    // 传输层端口（TCP/UDP/SCTP的前4字节），只有未分片包或首片才带传输层首部；
+    // 其他协议或长度不足时端口为0并返回false
+    bool l4_ports(uint16_t& src_port, uint16_t& dst_port) const {
+        uint8_t proto = protocol();
+        if ((proto != IPPROTO_TCP && proto != IPPROTO_UDP && proto != IPPROTO_SCTP) ||
+            fragment_offset() != 0 || payload_length() < 4) {
+            src_port = 0;
+            dst_port = 0;
+            return false;
+        }
+        src_port = load16(header_length());
+        dst_port = load16(header_length() + 2);
+        return true;
+    }
+
+private:
+    uint16_t load16(size_t offset) const {
+        uint16_t value;
+        memcpy(&value, data_ + offset, sizeof(value));
+        return ntohs(value);
+    }
+
+    uint32_t load32(size_t offset) const {
+        uint32_t value;
+        memcpy(&value, data_ + offset, sizeof(value));
+        return ntohl(value);
+    }
+
+    const uint8_t* data_;  // 指向IPv4首部第一个字节
+    size_t caplen_;        // 从首部开始的可用字节数
+};
+
+// IPv6固定首部长度（字节）
+const size_t IPV6_HEADER_LEN = 40;
+
+// IPv6首部只读视图
+// 与IPv4HeaderView一样直接引用缓冲区；decode()时沿扩展首部链走到上层协议，
+// 记录上层协议号、传输层首部偏移和分片首部中的字段。
+class IPv6HeaderView {
+public:
+    // 扩展首部链最多跟随的首部数，防止构造的包使解码循环过长
+    static const int MAX_EXTENSION_HEADERS = 16;
+
+    IPv6HeaderView()
+        : data_(NULL), caplen_(0), l4_offset_(0), protocol_(0), extension_count_(0),
+          fragment_(false), more_fragments_(false), fragment_offset_(0), fragment_id_(0) {}
+
+    // 解码：检查捕获长度和版本号，跟随扩展首部链，成功返回true
+    // 扩展首部被截断时仍返回true，此时上层协议为截断处的下一首部，传输层长度为0
+    bool decode(const uint8_t* data, size_t caplen) {
+        if (data == NULL || caplen < IPV6_HEADER_LEN || (data[0] >> 4) != 6) {
+            return false;
+        }
+        data_ = data;
+        caplen_ = caplen;
+        fragment_ = false;
+        more_fragments_ = false;
+        fragment_offset_ = 0;
+        fragment_id_ = 0;
+        extension_count_ = 0;
+
+        size_t end = available_length();
+        size_t offset = IPV6_HEADER_LEN;
+        uint8_t next = data_[6];
+        while (extension_count_ < MAX_EXTENSION_HEADERS && offset + 8 <= end) {
+            size_t length;
+            if (next == IPPROTO_HOPOPTS || next == IPPROTO_ROUTING || next == IPPROTO_DSTOPTS ||
+                next == 135 /* Mobility */ || next == 139 /* HIP */ || next == 140 /* Shim6 */) {
+                length = (static_cast<size_t>(data_[offset + 1]) + 1) * 8;
+            } else if (next == IPPROTO_AH) {
+                length = (static_cast<size_t>(data_[offset + 1]) + 2) * 4;
+            } else if (next == IPPROTO_FRAGMENT) {
+                uint16_t offset_flags = load16(offset + 2);
+                fragment_ = true;
+                fragment_offset_ = offset_flags >> 3;
+                more_fragments_ = (offset_flags & 0x1) != 0;
+                fragment_id_ = load32(offset + 4);
+                length = 8;
+            } else {
+                break;   // 上层协议（含ESP和“无下一首部”）
+            }
+            next = data_[offset];
+            offset += length;
+            extension_count_++;
+            if (fragment_ && fragment_offset_ != 0) {
+                break;   // 非首片不含传输层首部
+            }
+        }
+        protocol_ = next;
+        l4_offset_ = offset;
+        return true;
+    }
+
+    const uint8_t* data() const { return data_; }
+    size_t captured_length() const { return caplen_; }
+
+    uint8_t version() const { return data_[0] >> 4; }
+    uint8_t traffic_class() const { return static_cast<uint8_t>(load16(0) >> 4); }
+    uint32_t flow_label() const { return load32(0) & 0xFFFFF; }
+    uint16_t payload_length() const { return load16(4); }
+    uint8_t next_header() const { return data_[6]; }    // 固定首部中的下一首部
+    uint8_t hop_limit() const { return data_[7]; }
+    const uint8_t* src_addr() const { return data_ + 8; }    // 16字节，网络字节序
+    const uint8_t* dst_addr() const { return data_ + 24; }
+
+    // 扩展首部链解析结果
+    uint8_t protocol() const { return protocol_; }           // 上层协议号
+    int extension_count() const { return extension_count_; }
+    size_t l4_offset() const { return l4_offset_; }          // 传输层首部相对首部起点的偏移
+    bool is_fragment() const { return fragment_; }
+    bool more_fragments() const { return more_fragments_; }
+    uint16_t fragment_offset() const { return fragment_offset_; }  // 单位：8字节
+    uint32_t fragment_id() const { return fragment_id_; }
+
+    // 传输层数据，长度取载荷长度与捕获长度中较小者
+    const uint8_t* l4_data() const { return data_ + l4_offset_; }
+    size_t l4_length() const {
+        size_t end = available_length();
+        return end > l4_offset_ ? end - l4_offset_ : 0;
+    }
+
+    // 传输层端口，规则与IPv4HeaderView::l4_ports相同（非首片、其他协议或长度不足时为0并返回false）
+    bool l4_ports(uint16_t& src_port, uint16_t& dst_port) const {
+        if ((protocol_ != IPPROTO_TCP && protocol_ != IPPROTO_UDP && protocol_ != IPPROTO_SCTP) ||
+            fragment_offset_ != 0 || l4_length() < 4) {
+            src_port = 0;
+            dst_port = 0;
+            return false;
+        }
+        src_port = load16(l4_offset_);
+        dst_port = load16(l4_offset_ + 2);
+        return true;
+    }
+
+private:
+    size_t available_length() const {
+        size_t end = IPV6_HEADER_LEN + payload_length();
+        return end < caplen_ ? end : caplen_;
+    }
+
+    uint16_t load16(size_t offset) const {
+        uint16_t value;
+        memcpy(&value, data_ + offset, sizeof(value));
+        return ntohs(value);
+    }
+
+    uint32_t load32(size_t offset) const {
+        uint32_t value;
+        memcpy(&value, data_ + offset, sizeof(value));
+        return ntohl(value);
+    }
+
+    const uint8_t* data_;    // 指向IPv6固定首部第一个字节
+    size_t caplen_;          // 从首部开始的可用字节数
+    size_t l4_offset_;
+    uint8_t protocol_;
+    int extension_count_;
+    bool fragment_;
+    bool more_fragments_;
+    uint16_t fragment_offset_;
+    uint32_t fragment_id_;
+};
+
+// 将主机字节序IPv4地址格式化为点分十进制，buffer至少INET_ADDRSTRLEN字节
+inline const char* format_ipv4_addr(uint32_t addr, char* buffer) {
+    struct in_addr in;
+    in.s_addr = htonl(addr);
+    return inet_ntop(AF_INET, &in, buffer, INET_ADDRSTRLEN);
+}
+
+#endif // PACKET_DECODE_H
@@ -0,0 +1,459 @@
+// packet_filter.cpp - 用户态过滤表达式的解析与编译
+#include "packet_filter.h"
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <iomanip>
+#include <arpa/inet.h>
+
+namespace {
+
+// 语法树节点（只在编译期间存在）
+struct FilterNode {
+    enum Type { TEST, AND, OR, NOT };
+    Type type;
+    int left;
+    int right;
+    PacketFilter::Instruction insn;
+};
+
+// 比较条件：op value，或闭区间[low, high]
+struct Comparison {
+    PacketFilter::Op op;
+    uint32_t low;
+    uint32_t high;
+    bool range;
+};
+
+const char* const FIELD_NAMES[] = {
+    "src_addr", "dst_addr", "protocol", "ttl", "tos", "total_length",
+    "flags_fragment", "src_port", "dst_port"
+};
+
+const char* const OP_NAMES[] = { "==", "!=", "<", "<=", ">", ">=", "==", "!= 0" };
+
+// 递归下降解析器
+// expr      := and_expr ( ("or" | "||") and_expr )*
+// and_expr  := not_expr ( ("and" | "&&") not_expr )*
+// not_expr  := ("not" | "!") not_expr | "(" expr ")" | predicate
+class FilterParser {
+public:
+    FilterParser(const std::string& expression, std::vector<FilterNode>& nodes)
+        : pos_(0), nodes_(nodes) {
+        tokenize(expression);
+    }
+
+    // 解析整个表达式，返回根节点，失败返回-1
+    int parse() {
+        if (!error_.empty()) {
+            return -1;
+        }
+        if (tokens_.empty()) {
+            return fail("表达式为空");
+        }
+        int root = parse_or();
+        if (root >= 0 && pos_ < tokens_.size()) {
+            return fail("多余的内容");
+        }
+        return root;
+    }
+
+    const std::string& error() const { return error_; }
+
+private:
+    void tokenize(const std::string& text) {
+        size_t i = 0;
+        while (i < text.size()) {
+            char c = text[i];
+            if (isspace(static_cast<unsigned char>(c))) {
+                i++;
+            } else if (c == '(' || c == ')') {
+                tokens_.push_back(std::string(1, c));
+                i++;
+            } else if (c == '&' || c == '|') {
+                if (i + 1 >= text.size() || text[i + 1] != c) {
+                    error_ = std::string("无法识别的字符 '") + c + "'";
+                    return;
+                }
+                tokens_.push_back(text.substr(i, 2));
+                i += 2;
+            } else if (c == '!' || c == '=' || c == '<' || c == '>') {
+                size_t length = (i + 1 < text.size() && text[i + 1] == '=') ? 2 : 1;
+                tokens_.push_back(text.substr(i, length));
+                i += length;
+            } else if (isalnum(static_cast<unsigned char>(c)) || c == '.' || c == '/' || c == '-' || c == '_') {
+                size_t start = i;
+                while (i < text.size() &&
+                       (isalnum(static_cast<unsigned char>(text[i])) || text[i] == '.' ||
+                        text[i] == '/' || text[i] == '-' || text[i] == '_')) {
+                    i++;
+                }
+                std::string word = text.substr(start, i - start);
+                for (size_t k = 0; k < word.size(); ++k) {
+                    word[k] = static_cast<char>(tolower(static_cast<unsigned char>(word[k])));
+                }
+                tokens_.push_back(word);
+            } else {
+                error_ = std::string("无法识别的字符 '") + c + "'";
+                return;
+            }
+        }
+    }
+
+    int fail(const std::string& message) {
+        if (error_.empty()) {
+            error_ = message;
+            if (pos_ < tokens_.size()) {
+                error_ += "（第" + std::to_string(pos_ + 1) + "个词 \"" + tokens_[pos_] + "\" 附近）";
+            } else {
+                error_ += "（表达式末尾）";
+            }
+        }
+        return -1;
+    }
+
+    bool peek(const char* token) const {
+        return pos_ < tokens_.size() && tokens_[pos_] == token;
+    }
+
+    bool accept(const char* token) {
+        if (peek(token)) {
+            pos_++;
+            return true;
+        }
+        return false;
+    }
+
+    int add_node(FilterNode::Type type, int left, int right) {
+        if (left < 0 || right < 0) {
+            return -1;
+        }
+        FilterNode node;
+        node.type = type;
+        node.left = left;
+        node.right = right;
+        nodes_.push_back(node);
+        return static_cast<int>(nodes_.size() - 1);
+    }
+
+    int add_test(PacketFilter::Field field, PacketFilter::Op op, uint32_t value, uint32_t mask = 0xFFFFFFFFu) {
+        FilterNode node;
+        node.type = FilterNode::TEST;
+        node.left = -1;
+        node.right = -1;
+        node.insn.field = static_cast<uint8_t>(field);
+        node.insn.op = static_cast<uint8_t>(op);
+        node.insn.value = value;
+        node.insn.mask = mask;
+        node.insn.jump_true = PacketFilter::ACCEPT;
+        node.insn.jump_false = PacketFilter::REJECT;
+        nodes_.push_back(node);
+        return static_cast<int>(nodes_.size() - 1);
+    }
+
+    int parse_or() {
+        int left = parse_and();
+        while (left >= 0 && (accept("or") || accept("||"))) {
+            left = add_node(FilterNode::OR, left, parse_and());
+        }
+        return left;
+    }
+
+    int parse_and() {
+        int left = parse_not();
+        while (left >= 0 && (accept("and") || accept("&&"))) {
+            left = add_node(FilterNode::AND, left, parse_not());
+        }
+        return left;
+    }
+
+    int parse_not() {
+        if (accept("not") || accept("!")) {
+            int child = parse_not();
+            return child < 0 ? -1 : add_node(FilterNode::NOT, child, child);
+        }
+        if (accept("(")) {
+            int inner = parse_or();
+            if (inner >= 0 && !accept(")")) {
+                return fail("缺少右括号");
+            }
+            return inner;
+        }
+        return parse_predicate();
+    }
+
+    bool parse_number(const std::string& text, uint32_t max_value, uint32_t& value) {
+        if (text.empty() || !isdigit(static_cast<unsigned char>(text[0]))) {
+            return false;
+        }
+        char* end = NULL;
+        errno = 0;
+        unsigned long parsed = strtoul(text.c_str(), &end, 10);
+        if (errno != 0 || *end != '\0' || parsed > max_value) {
+            return false;
+        }
+        value = static_cast<uint32_t>(parsed);
+        return true;
+    }
+
+    // 解析"a.b.c.d"或"a.b.c.d/len"，得到主机字节序的网络号和掩码
+    bool parse_cidr(const std::string& text, bool allow_prefix, uint32_t& network, uint32_t& mask) {
+        size_t slash = text.find('/');
+        std::string address = text.substr(0, slash);
+        uint32_t prefix = 32;
+        if (slash != std::string::npos) {
+            if (!allow_prefix || !parse_number(text.substr(slash + 1), 32, prefix)) {
+                return false;
+            }
+        }
+        struct in_addr in;
+        if (inet_pton(AF_INET, address.c_str(), &in) != 1) {
+            return false;
+        }
+        mask = prefix == 0 ? 0 : 0xFFFFFFFFu << (32 - prefix);
+        network = ntohl(in.s_addr) & mask;
+        return true;
+    }
+
+    // 解析可选的比较运算符和数值（或"low-high"区间）
+    bool parse_comparison(uint32_t max_value, Comparison& cmp) {
+        cmp.op = PacketFilter::OP_EQ;
+        cmp.range = false;
+        static const struct { const char* token; PacketFilter::Op op; } ops[] = {
+            {"=", PacketFilter::OP_EQ}, {"==", PacketFilter::OP_EQ}, {"!=", PacketFilter::OP_NE},
+            {"<", PacketFilter::OP_LT}, {"<=", PacketFilter::OP_LE},
+            {">", PacketFilter::OP_GT}, {">=", PacketFilter::OP_GE},
+        };
+        bool has_op = false;
+        for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); ++i) {
+            if (accept(ops[i].token)) {
+                cmp.op = ops[i].op;
+                has_op = true;
+                break;
+            }
+        }
+        if (pos_ >= tokens_.size()) {
+            return false;
+        }
+        const std::string& text = tokens_[pos_];
+        size_t dash = text.find('-');
+        if (dash != std::string::npos && !has_op) {
+            if (!parse_number(text.substr(0, dash), max_value, cmp.low) ||
+                !parse_number(text.substr(dash + 1), max_value, cmp.high) || cmp.low > cmp.high) {
+                return false;
+            }
+            cmp.range = true;
+        } else if (!parse_number(text, max_value, cmp.low)) {
+            return false;
+        }
+        pos_++;
+        return true;
+    }
+
+    int comparison_node(PacketFilter::Field field, const Comparison& cmp) {
+        if (cmp.range) {
+            return add_node(FilterNode::AND, add_test(field, PacketFilter::OP_GE, cmp.low),
+                            add_test(field, PacketFilter::OP_LE, cmp.high));
+        }
+        return add_test(field, cmp.op, cmp.low);
+    }
+
+    // 按方向生成一对字段上的条件：src/dst只取一个，未指定方向时两者任一满足即可
+    int directional(int direction, PacketFilter::Field src_field, PacketFilter::Field dst_field,
+                    PacketFilter::Op op, uint32_t value, uint32_t mask) {
+        if (direction == 1) {
+            return add_test(src_field, op, value, mask);
+        }
+        if (direction == 2) {
+            return add_test(dst_field, op, value, mask);
+        }
+        return add_node(FilterNode::OR, add_test(src_field, op, value, mask),
+                        add_test(dst_field, op, value, mask));
+    }
+
+    int parse_predicate() {
+        if (pos_ >= tokens_.size()) {
+            return fail("缺少条件");
+        }
+        std::string word = tokens_[pos_++];
+
+        // 方向限定：src/dst
+        int direction = 0;
+        if (word == "src" || word == "dst") {
+            direction = word == "src" ? 1 : 2;
+            if (pos_ >= tokens_.size()) {
+                return fail("src/dst之后缺少host/net/port");
+            }
+            word = tokens_[pos_++];
+            if (word != "host" && word != "net" && word != "port") {
+                pos_--;   // "src 10.0.0.0/8"：省略host/net
+                word = "net";
+            }
+        }
+
+        if (word == "host" || word == "net") {
+            uint32_t network, mask;
+            if (pos_ >= tokens_.size() || !parse_cidr(tokens_[pos_], word == "net", network, mask)) {
+                return fail(word == "host" ? "无效的IPv4地址" : "无效的网段（应为a.b.c.d/n）");
+            }
+            pos_++;
+            return directional(direction, PacketFilter::FIELD_SRC_ADDR, PacketFilter::FIELD_DST_ADDR,
+                               PacketFilter::OP_MASK_EQ, network, mask);
+        }
+        if (word == "port") {
+            Comparison cmp;
+            if (!parse_comparison(65535, cmp)) {
+                return fail("无效的端口");
+            }
+            if (direction == 1) {
+                return comparison_node(PacketFilter::FIELD_SRC_PORT, cmp);
+            }
+            if (direction == 2) {
+                return comparison_node(PacketFilter::FIELD_DST_PORT, cmp);
+            }
+            return add_node(FilterNode::OR, comparison_node(PacketFilter::FIELD_SRC_PORT, cmp),
+                            comparison_node(PacketFilter::FIELD_DST_PORT, cmp));
+        }
+
+        // 协议
+        static const struct { const char* name; uint8_t number; } protocols[] = {
+            {"icmp", 1}, {"igmp", 2}, {"tcp", 6}, {"udp", 17}, {"gre", 47},
+            {"esp", 50}, {"ah", 51}, {"ospf", 89}, {"sctp", 132},
+        };
+        bool explicit_proto = word == "proto";
+        if (explicit_proto) {
+            if (pos_ >= tokens_.size()) {
+                return fail("proto之后缺少协议");
+            }
+            word = tokens_[pos_++];
+            uint32_t number;
+            if (parse_number(word, 255, number)) {
+                return add_test(PacketFilter::FIELD_PROTOCOL, PacketFilter::OP_EQ, number);
+            }
+        }
+        for (size_t i = 0; i < sizeof(protocols) / sizeof(protocols[0]); ++i) {
+            if (word == protocols[i].name) {
+                return add_test(PacketFilter::FIELD_PROTOCOL, PacketFilter::OP_EQ, protocols[i].number);
+            }
+        }
+        if (explicit_proto) {
+            pos_--;
+            return fail("未知的协议");
+        }
+
+        // 分片标志
+        if (word == "frag") {
+            return add_test(PacketFilter::FIELD_FLAGS_FRAGMENT, PacketFilter::OP_MASK_ANY, 0, 0x3FFF);
+        }
+        if (word == "df") {
+            return add_test(PacketFilter::FIELD_FLAGS_FRAGMENT, PacketFilter::OP_MASK_ANY, 0, 0x4000);
+        }
+        if (word == "mf") {
+            return add_test(PacketFilter::FIELD_FLAGS_FRAGMENT, PacketFilter::OP_MASK_ANY, 0, 0x2000);
+        }
+
+        // 数值字段
+        PacketFilter::Field field;
+        uint32_t max_value;
+        if (word == "ttl") {
+            field = PacketFilter::FIELD_TTL;
+            max_value = 255;
+        } else if (word == "tos") {
+            field = PacketFilter::FIELD_TOS;
+            max_value = 255;
+        } else if (word == "len") {
+            field = PacketFilter::FIELD_TOTAL_LENGTH;
+            max_value = 65535;
+        } else {
+            pos_--;
+            return fail("未知的条件");
+        }
+        Comparison cmp;
+        if (!parse_comparison(max_value, cmp)) {
+            return fail("无效的数值");
+        }
+        return comparison_node(field, cmp);
+    }
+
+    std::vector<std::string> tokens_;
+    size_t pos_;
+    std::vector<FilterNode>& nodes_;
+    std::string error_;
+};
+
+// 生成指令：先生成右子树，左子树的跳转指向右子树入口，因此所有跳转都指向更小的下标
+int32_t emit(const std::vector<FilterNode>& nodes, int index, int32_t jump_true, int32_t jump_false,
+             std::vector<PacketFilter::Instruction>& program) {
+    const FilterNode& node = nodes[index];
+    switch (node.type) {
+        case FilterNode::TEST: {
+            PacketFilter::Instruction insn = node.insn;
+            insn.jump_true = jump_true;
+            insn.jump_false = jump_false;
+            program.push_back(insn);
+            return static_cast<int32_t>(program.size() - 1);
+        }
+        case FilterNode::AND: {
+            int32_t right = emit(nodes, node.right, jump_true, jump_false, program);
+            return emit(nodes, node.left, right, jump_false, program);
+        }
+        case FilterNode::OR: {
+            int32_t right = emit(nodes, node.right, jump_true, jump_false, program);
+            return emit(nodes, node.left, jump_true, right, program);
+        }
+        case FilterNode::NOT:
+            return emit(nodes, node.left, jump_false, jump_true, program);
+    }
+    return jump_false;
+}
+
+void print_target(std::ostream& os, int32_t target) {
+    if (target == PacketFilter::ACCEPT) {
+        os << "accept";
+    } else if (target == PacketFilter::REJECT) {
+        os << "reject";
+    } else {
+        os << target;
+    }
+}
+
+}
+
+const int32_t PacketFilter::ACCEPT;
+const int32_t PacketFilter::REJECT;
+
+bool PacketFilter::compile(const std::string& expression) {
+    program_.clear();
+    entry_ = ACCEPT;
+    error_.clear();
+
+    std::vector<FilterNode> nodes;
+    FilterParser parser(expression, nodes);
+    int root = parser.parse();
+    if (root < 0) {
+        error_ = parser.error();
+        return false;
+    }
+    entry_ = emit(nodes, root, ACCEPT, REJECT, program_);
+    return true;
+}
+
+void PacketFilter::dump(std::ostream& os) const {
+    for (int32_t pc = static_cast<int32_t>(program_.size()) - 1; pc >= 0; --pc) {
+        const Instruction& insn = program_[pc];
+        os << (pc == entry_ ? "=> " : "   ") << "(" << std::setw(3) << std::setfill('0') << pc
+           << std::setfill(' ') << ") " << FIELD_NAMES[insn.field];
+        if (insn.op == OP_MASK_EQ || insn.op == OP_MASK_ANY) {
+            os << " & 0x" << std::hex << insn.mask << std::dec;
+        }
+        os << " " << OP_NAMES[insn.op];
+        if (insn.op != OP_MASK_ANY) {
+            os << " " << insn.value;
+        }
+        os << "  jt ";
+        print_target(os, insn.jump_true);
+        os << " jf ";
+        print_target(os, insn.jump_false);
+        os << std::endl;
+    }
+}
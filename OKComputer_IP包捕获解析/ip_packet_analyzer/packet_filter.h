@@ -0,0 +1,164 @@
+// packet_filter.h - 用户态过滤器：作用于已解码IPv4/IPv6字段的表达式，编译为扁平的判定程序
+#ifndef PACKET_FILTER_H
+#define PACKET_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "packet_decode.h"
+
+// 过滤表达式示例：
+//   src net 10.0.0.0/8 and tcp and not port 22
+//   (udp or icmp) and ttl < 5
+//   frag or len > 1500
+// 表达式在启动时编译一次，得到一组“比较字段、按结果跳转”的指令（与经典BPF的组织方式相同）：
+// 每条指令读取一个字段并与常量比较，真/假分别跳到另一条指令或直接接受/拒绝。
+// 与/或/非通过跳转目标实现短路求值，匹配时没有递归、没有内存分配。
+class PacketFilter {
+public:
+    // 指令读取的字段
+    enum Field {
+        FIELD_SRC_ADDR,
+        FIELD_DST_ADDR,
+        FIELD_PROTOCOL,
+        FIELD_TTL,
+        FIELD_TOS,
+        FIELD_TOTAL_LENGTH,
+        FIELD_FLAGS_FRAGMENT,   // 标志位与片偏移的原始16位字
+        FIELD_SRC_PORT,         // 非TCP/UDP/SCTP或非首片为0
+        FIELD_DST_PORT
+    };
+
+    // 比较方式（value/mask为常量）
+    enum Op {
+        OP_EQ,          // field == value
+        OP_NE,
+        OP_LT,
+        OP_LE,
+        OP_GT,
+        OP_GE,
+        OP_MASK_EQ,     // (field & mask) == value，用于CIDR
+        OP_MASK_ANY     // (field & mask) != 0，用于标志位
+    };
+
+    // 跳转目标：非负数为指令下标，负数为终止
+    static const int32_t ACCEPT = -1;
+    static const int32_t REJECT = -2;
+
+    struct Instruction {
+        uint8_t field;
+        uint8_t op;
+        uint32_t value;
+        uint32_t mask;
+        int32_t jump_true;
+        int32_t jump_false;
+    };
+
+    PacketFilter() : entry_(ACCEPT) {}
+
+    // 编译表达式，失败时返回false，错误信息见error()
+    bool compile(const std::string& expression);
+
+    bool empty() const { return program_.empty(); }
+    size_t size() const { return program_.size(); }
+    const std::string& error() const { return error_; }
+
+    // 打印编译后的指令（调试用）
+    void dump(std::ostream& os) const;
+
+    // 执行判定程序：跳转只会指向更小的下标，因此一定会终止
+    bool match(const IPv4HeaderView& ip_view) const {
+        return match(ip_view, ip_view);
+    }
+
+    // 端口取自ports_view，其余字段取自ip_view：分片重组完成时ports_view为重组出的数据报，
+    // 使非首片也能按端口判定
+    bool match(const IPv4HeaderView& ip_view, const IPv4HeaderView& ports_view) const {
+        int32_t pc = entry_;
+        while (pc >= 0) {
+            const Instruction& insn = program_[pc];
+            pc = test(insn, load(insn.field, ip_view, ports_view)) ? insn.jump_true : insn.jump_false;
+        }
+        return pc == ACCEPT;
+    }
+
+    // IPv6：地址条件（IPv4地址/网段）不成立，ttl/tos/len分别对应跳数限制、流量类别和总长度，
+    // frag/mf对应分片扩展首部，df不成立
+    bool match(const IPv6HeaderView& ip_view) const {
+        int32_t pc = entry_;
+        while (pc >= 0) {
+            const Instruction& insn = program_[pc];
+            bool result = insn.field != FIELD_SRC_ADDR && insn.field != FIELD_DST_ADDR &&
+                          test(insn, load(insn.field, ip_view));
+            pc = result ? insn.jump_true : insn.jump_false;
+        }
+        return pc == ACCEPT;
+    }
+
+private:
+    static uint32_t load(uint8_t field, const IPv4HeaderView& ip_view, const IPv4HeaderView& ports_view) {
+        uint16_t src_port, dst_port;
+        switch (field) {
+            case FIELD_SRC_ADDR:       return ip_view.src_addr();
+            case FIELD_DST_ADDR:       return ip_view.dst_addr();
+            case FIELD_PROTOCOL:       return ip_view.protocol();
+            case FIELD_TTL:            return ip_view.ttl();
+            case FIELD_TOS:            return ip_view.tos();
+            case FIELD_TOTAL_LENGTH:   return ip_view.total_length();
+            case FIELD_FLAGS_FRAGMENT: return ip_view.flags_fragment();
+            case FIELD_SRC_PORT:
+                ports_view.l4_ports(src_port, dst_port);
+                return src_port;
+            case FIELD_DST_PORT:
+                ports_view.l4_ports(src_port, dst_port);
+                return dst_port;
+        }
+        return 0;
+    }
+
+    static uint32_t load(uint8_t field, const IPv6HeaderView& ip_view) {
+        uint16_t src_port, dst_port;
+        switch (field) {
+            case FIELD_PROTOCOL:       return ip_view.protocol();
+            case FIELD_TTL:            return ip_view.hop_limit();
+            case FIELD_TOS:            return ip_view.traffic_class();
+            case FIELD_TOTAL_LENGTH:   return IPV6_HEADER_LEN + ip_view.payload_length();
+            case FIELD_FLAGS_FRAGMENT:
+                // 按IPv4的标志位/片偏移字布局：MF为0x2000，片偏移在低13位
+                if (!ip_view.is_fragment()) {
+                    return 0;
+                }
+                return (ip_view.more_fragments() ? 0x2000u : 0u) | ip_view.fragment_offset();
+            case FIELD_SRC_PORT:
+                ip_view.l4_ports(src_port, dst_port);
+                return src_port;
+            case FIELD_DST_PORT:
+                ip_view.l4_ports(src_port, dst_port);
+                return dst_port;
+            default:
+                return 0;
+        }
+    }
+
+    static bool test(const Instruction& insn, uint32_t value) {
+        switch (insn.op) {
+            case OP_EQ:       return value == insn.value;
+            case OP_NE:       return value != insn.value;
+            case OP_LT:       return value < insn.value;
+            case OP_LE:       return value <= insn.value;
+            case OP_GT:       return value > insn.value;
+            case OP_GE:       return value >= insn.value;
+            case OP_MASK_EQ:  return (value & insn.mask) == insn.value;
+            case OP_MASK_ANY: return (value & insn.mask) != 0;
+        }
+        return false;
+    }
+
+    std::vector<Instruction> program_;
+    int32_t entry_;
+    std::string error_;
+};
+
+#endif // PACKET_FILTER_H
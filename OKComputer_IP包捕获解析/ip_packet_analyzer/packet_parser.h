@@ -0,0 +1,194 @@
+// packet_parser.h - 共享的包解析库（头文件实现）：解析结果结构体与IPv4/IPv6解析
+// ip_analyzer、test_packet_parser和基准测试都使用这里的解析函数，热路径的优化只需做一处
+#ifndef PACKET_PARSER_H
+#define PACKET_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <sys/time.h>
+#include "packet_decode.h"
+#include "link_decode.h"
+#include "checksum.h"
+#include "protocol_table.h"
+
+// IP包解析结果结构体
+struct IPPacketInfo {
+    uint8_t version;          // 版本号
+    uint8_t header_length;    // 首部长度（IPv6为固定首部加扩展首部，超过255时记为255）
+    uint16_t total_length;    // 总长度
+    uint16_t identification;  // 标识
+    uint8_t flags;           // 标志位
+    uint16_t fragment_offset; // 片偏移
+    uint8_t protocol;        // 协议（IPv6为扩展首部链之后的上层协议）
+    uint16_t checksum;       // 首部校验和
+    uint8_t checksum_errors; // 校验结果：CHECKSUM_ERROR_IP / CHECKSUM_ERROR_L4 按位或
+    uint8_t ttl;             // 生存时间（IPv6为跳数限制）
+    uint32_t src_addr;       // 源IP地址（主机字节序，打印时才格式化）
+    uint32_t dst_addr;       // 目的IP地址（主机字节序，打印时才格式化）
+    uint8_t src_addr6[16];   // IPv6源地址（网络字节序，仅version为6时有效）
+    uint8_t dst_addr6[16];   // IPv6目的地址
+    uint32_t ipv6_fragment_id; // IPv6分片扩展首部中的标识
+    uint16_t vlan_id;        // 最内层VLAN ID
+    uint8_t vlan_depth;      // VLAN标签层数，0表示无标签
+    L4Info l4;               // 传输层字段（按协议分派表解析，非首片或无解析函数时valid为false）
+    uint16_t reassembled_length; // 本分片使数据报重组完成时为数据报总长度，否则为0
+    time_t timestamp;        // 捕获时间戳
+    uint32_t timestamp_nsec; // 捕获时间戳的纳秒部分（微秒精度时为微秒×1000）
+    bool timestamp_nano;     // 时间戳来自纳秒精度的句柄，timestamp_nsec的后3位有效
+};
+
+// IPPacketInfo::checksum_errors 的取值
+const uint8_t CHECKSUM_ERROR_IP = 0x1;   // IPv4首部校验和错误
+const uint8_t CHECKSUM_ERROR_L4 = 0x2;   // TCP/UDP/ICMP校验和错误
+
+// 从IPv4解码视图填充包信息（只复制定长字段，不做字符串转换）
+// verify_l4为true时同时校验TCP/UDP/ICMP校验和
+inline void fill_packet_info(const IPv4HeaderView& ip_view, const struct timeval& ts, bool verify_l4,
+                             IPPacketInfo& packet_info) {
+    uint16_t flags_fragoff = ip_view.flags_fragment();
+    packet_info.timestamp = ts.tv_sec;
+    packet_info.timestamp_nsec = static_cast<uint32_t>(ts.tv_usec) * 1000;
+    packet_info.timestamp_nano = false;
+    packet_info.version = ip_view.version();
+    packet_info.header_length = ip_view.header_length();
+    packet_info.total_length = ip_view.total_length();
+    packet_info.identification = ip_view.identification();
+    packet_info.flags = flags_fragoff >> 13;               // 前3位为标志位
+    packet_info.fragment_offset = flags_fragoff & 0x1FFF;  // 后13位为片偏移
+    packet_info.protocol = ip_view.protocol();
+    packet_info.checksum = ip_view.checksum();
+    packet_info.ttl = ip_view.ttl();
+    packet_info.src_addr = ip_view.src_addr();
+    packet_info.dst_addr = ip_view.dst_addr();
+    packet_info.reassembled_length = 0;
+
+    // 只有未分片包或首片带传输层首部，按协议号查表分派到解析函数
+    if (packet_info.fragment_offset == 0) {
+        dissect_l4(packet_info.protocol, ip_view.payload(), ip_view.payload_length(), packet_info.l4);
+    } else {
+        packet_info.l4 = L4Info();
+    }
+
+    // 每个包都校验首部校验和；传输层校验和按需校验（分片在重组完成后校验）
+    packet_info.checksum_errors = ipv4_header_checksum_ok(ip_view) ? 0 : CHECKSUM_ERROR_IP;
+    if (verify_l4 && verify_l4_checksum(ip_view) == CHECKSUM_BAD) {
+        packet_info.checksum_errors |= CHECKSUM_ERROR_L4;
+    }
+}
+
+// 从IPv6解码视图填充包信息：扩展首部计入首部长度，分片扩展首部中的字段填入标志位/片偏移
+// IPv6没有首部校验和；传输层校验和需要IPv6伪首部，这里不校验
+inline void fill_ipv6_info(const IPv6HeaderView& ip_view, const struct timeval& ts, IPPacketInfo& packet_info) {
+    uint32_t total_length = IPV6_HEADER_LEN + ip_view.payload_length();
+    packet_info.timestamp = ts.tv_sec;
+    packet_info.timestamp_nsec = static_cast<uint32_t>(ts.tv_usec) * 1000;
+    packet_info.timestamp_nano = false;
+    packet_info.version = 6;
+    packet_info.header_length = ip_view.l4_offset() < 255 ? static_cast<uint8_t>(ip_view.l4_offset()) : 255;
+    packet_info.total_length = total_length < 0xFFFF ? static_cast<uint16_t>(total_length) : 0xFFFF;
+    packet_info.identification = 0;
+    packet_info.flags = ip_view.more_fragments() ? 0x1 : 0;
+    packet_info.fragment_offset = ip_view.fragment_offset();
+    packet_info.protocol = ip_view.protocol();
+    packet_info.checksum = 0;
+    packet_info.checksum_errors = 0;
+    packet_info.ttl = ip_view.hop_limit();
+    packet_info.src_addr = 0;
+    packet_info.dst_addr = 0;
+    memcpy(packet_info.src_addr6, ip_view.src_addr(), 16);
+    memcpy(packet_info.dst_addr6, ip_view.dst_addr(), 16);
+    packet_info.ipv6_fragment_id = ip_view.fragment_id();
+    packet_info.reassembled_length = 0;
+
+    if (packet_info.fragment_offset == 0) {
+        dissect_l4(packet_info.protocol, ip_view.l4_data(), ip_view.l4_length(), packet_info.l4);
+    } else {
+        packet_info.l4 = L4Info();
+    }
+}
+
+// 解析钩子：parse_ip_packet/parse_frame在解码出首部后回调，调用方借此接入过滤、分片重组等处理，
+// 链路层剥离和IPv4/IPv6分派仍只有一份。钩子类型是模板参数，空钩子内联后没有额外开销
+//   on_link      链路层首部剥离之后（不论是否IP帧）
+//   accept_ipv4  IPv4首部解码之后、填充包信息之前，返回false时丢弃该包（未分片的包在这里过滤，
+//                省去填充的开销）
+//   finish_ipv4  填充包信息之后，返回false时丢弃该包（分片要先重组才能按端口判定）
+//   accept_ipv6/finish_ipv6 同上
+struct NoParseHooks {
+    void on_link(const LinkFrame&) {}
+    bool accept_ipv4(const IPv4HeaderView&) { return true; }
+    bool finish_ipv4(const IPv4HeaderView&, IPPacketInfo&) { return true; }
+    bool accept_ipv6(const IPv6HeaderView&) { return true; }
+    bool finish_ipv6(const IPv6HeaderView&, IPPacketInfo&) { return true; }
+};
+
+// 解析一个从IP首部开始的包：按版本号分派到IPv4/IPv6解析
+// 首部检查都在解码视图中完成，长度不足、版本号不是4或6或被钩子丢弃时返回false
+template <typename Hooks>
+inline bool parse_ip_packet(const uint8_t* data, size_t length, const struct timeval& ts, bool verify_l4,
+                            Hooks& hooks, IPPacketInfo& packet_info) {
+    if (data == NULL || length == 0) {
+        return false;
+    }
+    packet_info.vlan_id = 0;
+    packet_info.vlan_depth = 0;
+    switch (data[0] >> 4) {
+        case 4: {
+            IPv4HeaderView ip_view;
+            if (!ip_view.decode(data, length) || !hooks.accept_ipv4(ip_view)) {
+                return false;
+            }
+            fill_packet_info(ip_view, ts, verify_l4, packet_info);
+            return hooks.finish_ipv4(ip_view, packet_info);
+        }
+        case 6: {
+            IPv6HeaderView ip_view;
+            if (!ip_view.decode(data, length) || !hooks.accept_ipv6(ip_view)) {
+                return false;
+            }
+            fill_ipv6_info(ip_view, ts, packet_info);
+            return hooks.finish_ipv6(ip_view, packet_info);
+        }
+        default:
+            return false;
+    }
+}
+
+inline bool parse_ip_packet(const uint8_t* data, size_t length, const struct timeval& ts, bool verify_l4,
+                            IPPacketInfo& packet_info) {
+    NoParseHooks hooks;
+    return parse_ip_packet(data, length, ts, verify_l4, hooks, packet_info);
+}
+
+// 解析一个链路层帧：先用链路层解码函数剥离链路层首部，再解析IP首部，记录VLAN信息
+template <typename Hooks>
+inline bool parse_frame(LinkDecoder decode_link, const uint8_t* frame, size_t caplen, const struct timeval& ts,
+                        bool verify_l4, Hooks& hooks, IPPacketInfo& packet_info) {
+    LinkFrame link;
+    if (!decode_link(frame, caplen, link)) {
+        return false;
+    }
+    hooks.on_link(link);
+    if ((link.ethertype != LINK_ETHERTYPE_IPV4 && link.ethertype != LINK_ETHERTYPE_IPV6) ||
+        !parse_ip_packet(link.network, link.length, ts, verify_l4, hooks, packet_info)) {
+        return false;
+    }
+    packet_info.vlan_id = link.vlan_id;
+    packet_info.vlan_depth = link.vlan_depth;
+    return true;
+}
+
+inline bool parse_frame(LinkDecoder decode_link, const uint8_t* frame, size_t caplen, const struct timeval& ts,
+                        bool verify_l4, IPPacketInfo& packet_info) {
+    NoParseHooks hooks;
+    return parse_frame(decode_link, frame, caplen, ts, verify_l4, hooks, packet_info);
+}
+
+// 获取协议名称（查编译期生成的分派表，不分配内存）
+inline const char* get_protocol_name(uint8_t protocol) {
+    return protocol_name(protocol);
+}
+
+#endif // PACKET_PARSER_H
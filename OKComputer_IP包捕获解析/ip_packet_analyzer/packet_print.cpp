@@ -0,0 +1,374 @@
+// packet_print.cpp - 解析结果的逐字段格式化输出
+#include "packet_print.h"
+#include <arpa/inet.h>
+
+// 打印包基本信息
+void print_packet_info(OutputBuffer& out, const IPPacketInfo& packet_info, uint64_t packet_number) {
+    out.append("\n[包 #");
+    out.append_uint(packet_number);
+    out.append("]\n捕获时间: ");
+    out.append_time(packet_info.timestamp);
+    out.append("----------------------------------------\n");
+    out.append_padded("字段名", 20);
+    out.append_padded("值", 25);
+    out.append("说明\n");
+    out.append("----------------------------------------\n");
+}
+
+// 按版本号选择首部打印函数
+void print_ip_packet(OutputBuffer& out, const IPPacketInfo& packet_info) {
+    if (packet_info.version == 6) {
+        print_ipv6_header(out, packet_info);
+    } else {
+        print_ip_header(out, packet_info);
+    }
+}
+
+// 打印IP头部详细信息（字段名列宽20字节，值列宽25字节）
+void print_ip_header(OutputBuffer& out, const IPPacketInfo& packet_info) {
+    size_t column;
+
+    // 版本号
+    out.append_padded("版本号(Version)", 20);
+    column = out.size();
+    out.append_uint(packet_info.version);
+    out.pad_from(column, 25);
+    out.append("IPv");
+    out.append_uint(packet_info.version);
+    out.append_char('\n');
+
+    // VLAN标签（链路层解码时剥离）
+    if (packet_info.vlan_depth > 0) {
+        out.append_padded("VLAN", 20);
+        column = out.size();
+        out.append_uint(packet_info.vlan_id);
+        out.pad_from(column, 25);
+        out.append_uint(packet_info.vlan_depth);
+        out.append("层标签\n");
+    }
+
+    // 首部长度
+    out.append_padded("首部长度(IHL)", 20);
+    column = out.size();
+    out.append_uint(packet_info.header_length);
+    out.pad_from(column, 25);
+    out.append("字节\n");
+
+    // 总长度
+    out.append_padded("总长度(Total Length)", 20);
+    column = out.size();
+    out.append_uint(packet_info.total_length);
+    out.pad_from(column, 25);
+    out.append("字节\n");
+
+    // 标识
+    out.append_padded("标识(Identification)", 20);
+    out.append("0x");
+    out.append_hex(packet_info.identification, 4);
+    out.append(" (");
+    out.append_uint(packet_info.identification);
+    out.append(")\n");
+
+    // 标志位
+    out.append_padded("标志位(Flags)", 20);
+    out.append("0x");
+    out.append_hex(packet_info.flags, 1);
+    out.append_char('\n');
+    print_flags_info(out, packet_info.flags);
+
+    // 片偏移
+    out.append_padded("片偏移(Fragment Offset)", 20);
+    column = out.size();
+    out.append_uint(packet_info.fragment_offset);
+    out.pad_from(column, 25);
+    out.append(" * 8 = ");
+    out.append_uint(packet_info.fragment_offset * 8);
+    out.append(" 字节\n");
+
+    // 协议
+    out.append_padded("协议(Protocol)", 20);
+    column = out.size();
+    out.append_uint(packet_info.protocol);
+    out.pad_from(column, 25);
+    out.append_char('(');
+    out.append(get_protocol_name(packet_info.protocol));
+    out.append(")\n");
+
+    // 首部校验和
+    out.append_padded("首部校验和", 20);
+    column = out.size();
+    out.append("0x");
+    out.append_hex(packet_info.checksum, 4);
+    out.pad_from(column, 25);
+    out.append((packet_info.checksum_errors & CHECKSUM_ERROR_IP) != 0 ? "(错误)\n" : "(正确)\n");
+    if ((packet_info.checksum_errors & CHECKSUM_ERROR_L4) != 0) {
+        out.append_padded("传输层校验和", 20);
+        out.append_padded("", 25);
+        out.append("(错误)\n");
+    }
+
+    // 源地址（仅在打印时才格式化为文本）
+    out.append_padded("源IP地址(Source)", 20);
+    out.append_ipv4(packet_info.src_addr);
+    out.append_char('\n');
+
+    // 目的地址
+    out.append_padded("目的IP地址(Destination)", 20);
+    out.append_ipv4(packet_info.dst_addr);
+    out.append_char('\n');
+
+    print_transport_info(out, packet_info);
+}
+
+// 打印IPv6首部信息（列宽与print_ip_header相同）
+void print_ipv6_header(OutputBuffer& out, const IPPacketInfo& packet_info) {
+    size_t column;
+    char address[INET6_ADDRSTRLEN];
+
+    out.append_padded("版本号(Version)", 20);
+    column = out.size();
+    out.append_uint(packet_info.version);
+    out.pad_from(column, 25);
+    out.append("IPv6\n");
+
+    if (packet_info.vlan_depth > 0) {
+        out.append_padded("VLAN", 20);
+        column = out.size();
+        out.append_uint(packet_info.vlan_id);
+        out.pad_from(column, 25);
+        out.append_uint(packet_info.vlan_depth);
+        out.append("层标签\n");
+    }
+
+    // 载荷长度
+    out.append_padded("载荷长度(Payload)", 20);
+    column = out.size();
+    out.append_uint(packet_info.total_length - IPV6_HEADER_LEN);
+    out.pad_from(column, 25);
+    out.append("字节\n");
+
+    // 扩展首部
+    out.append_padded("扩展首部", 20);
+    column = out.size();
+    out.append_uint(packet_info.header_length - IPV6_HEADER_LEN);
+    out.pad_from(column, 25);
+    out.append("字节\n");
+
+    // 分片扩展首部
+    if ((packet_info.flags & 0x1) != 0 || packet_info.fragment_offset != 0) {
+        out.append_padded("分片标识", 20);
+        out.append("0x");
+        out.append_hex(packet_info.ipv6_fragment_id, 8);
+        out.append_char('\n');
+        out.append_padded("片偏移(Fragment Offset)", 20);
+        column = out.size();
+        out.append_uint(packet_info.fragment_offset);
+        out.pad_from(column, 25);
+        out.append(" * 8 = ");
+        out.append_uint(packet_info.fragment_offset * 8);
+        out.append((packet_info.flags & 0x1) != 0 ? " 字节, M=1\n" : " 字节, M=0\n");
+    }
+
+    // 上层协议
+    out.append_padded("上层协议(Next Header)", 20);
+    column = out.size();
+    out.append_uint(packet_info.protocol);
+    out.pad_from(column, 25);
+    out.append_char('(');
+    out.append(get_protocol_name(packet_info.protocol));
+    out.append(")\n");
+
+    out.append_padded("跳数限制(Hop Limit)", 20);
+    out.append_uint(packet_info.ttl);
+    out.append_char('\n');
+
+    // 地址只在打印时才格式化为文本
+    out.append_padded("源IP地址(Source)", 20);
+    out.append(inet_ntop(AF_INET6, packet_info.src_addr6, address, sizeof(address)));
+    out.append_char('\n');
+    out.append_padded("目的IP地址(Destination)", 20);
+    out.append(inet_ntop(AF_INET6, packet_info.dst_addr6, address, sizeof(address)));
+    out.append_char('\n');
+
+    print_transport_info(out, packet_info);
+}
+
+// 打印传输层字段（由协议分派表中的解析函数填写）
+void print_transport_info(OutputBuffer& out, const IPPacketInfo& packet_info) {
+    const L4Info& l4 = packet_info.l4;
+    if (!l4.valid) {
+        return;
+    }
+    if (packet_info.protocol == IPPROTO_ICMP || packet_info.protocol == IPPROTO_ICMPV6) {
+        out.append_padded(packet_info.protocol == IPPROTO_ICMP ? "ICMP类型/代码" : "ICMPv6类型/代码", 20);
+        out.append_uint(l4.icmp_type);
+        out.append_char('/');
+        out.append_uint(l4.icmp_code);
+        out.append_char('\n');
+        return;
+    }
+
+    out.append_padded("源端口", 20);
+    out.append_uint(l4.src_port);
+    out.append_char('\n');
+    out.append_padded("目的端口", 20);
+    out.append_uint(l4.dst_port);
+    out.append_char('\n');
+    if (packet_info.protocol == IPPROTO_UDP) {
+        out.append_padded("UDP长度", 20);
+        out.append_uint(l4.udp_length);
+        out.append(" 字节\n");
+    } else if (packet_info.protocol == IPPROTO_TCP) {
+        out.append_padded("序号/确认号", 20);
+        out.append_uint(l4.tcp_seq);
+        out.append_char('/');
+        out.append_uint(l4.tcp_ack);
+        out.append_char('\n');
+        out.append_padded("窗口", 20);
+        out.append_uint(l4.tcp_window);
+        out.append_char('\n');
+        static const char* const TCP_FLAG_NAMES[8] = { "FIN", "SYN", "RST", "PSH", "ACK", "URG", "ECE", "CWR" };
+        out.append_padded("TCP标志位", 20);
+        out.append("0x");
+        out.append_hex(l4.tcp_flags, 2);
+        for (int bit = 0; bit < 8; ++bit) {
+            if ((l4.tcp_flags & (1 << bit)) != 0) {
+                out.append_char(' ');
+                out.append(TCP_FLAG_NAMES[bit]);
+            }
+        }
+        out.append_char('\n');
+    }
+}
+
+// 打印标志位详细信息
+void print_flags_info(OutputBuffer& out, uint8_t flags) {
+    bool reserved = (flags & 0x4) != 0;
+    bool df = (flags & 0x2) != 0;  // Don't Fragment
+    bool mf = (flags & 0x1) != 0;  // More Fragments
+
+    out.append_spaces(20 + 25);
+    out.append("[保留位: ");
+    out.append(reserved ? "1" : "0");
+    out.append(", DF(不分片): ");
+    out.append(df ? "1" : "0");
+    out.append(", MF(更多分片): ");
+    out.append(mf ? "1" : "0");
+    out.append("]\n");
+}
+
+namespace {
+// 记录类型：已知类型打印名称，其他打印TYPE<编号>
+void append_dns_type(OutputBuffer& out, uint16_t type) {
+    const char* name = dns_type_name(type);
+    if (name != NULL) {
+        out.append(name);
+    } else {
+        out.append("TYPE");
+        out.append_uint(type);
+    }
+}
+
+void append_dns_class(OutputBuffer& out, uint16_t rclass) {
+    if (rclass == 1) {
+        out.append("IN");
+    } else {
+        out.append("CLASS");
+        out.append_uint(rclass);
+    }
+}
+}
+
+// 打印DNS报文（列宽与print_ip_header相同）
+void print_dns_message(OutputBuffer& out, const DnsMessage& message) {
+    size_t column;
+
+    out.append_padded("DNS标识", 20);
+    out.append("0x");
+    out.append_hex(message.id, 4);
+    out.append_char('\n');
+
+    // 标志：QR、操作码、AA/TC/RD/RA和响应码
+    out.append_padded("DNS标志", 20);
+    column = out.size();
+    out.append("0x");
+    out.append_hex(message.flags, 4);
+    out.pad_from(column, 25);
+    out.append(message.is_response() ? "响应" : "查询");
+    if (message.opcode() != 0) {
+        out.append(", OPCODE ");
+        out.append_uint(message.opcode());
+    }
+    static const char* const DNS_FLAG_NAMES[4] = { "RA", "RD", "TC", "AA" };
+    for (int bit = 3; bit >= 0; --bit) {
+        if ((message.flags & (0x0080 << bit)) != 0) {
+            out.append(", ");
+            out.append(DNS_FLAG_NAMES[bit]);
+        }
+    }
+    if (message.is_response()) {
+        const char* rcode = dns_rcode_name(message.rcode());
+        out.append(", ");
+        if (rcode != NULL) {
+            out.append(rcode);
+        } else {
+            out.append("RCODE ");
+            out.append_uint(message.rcode());
+        }
+    }
+    out.append_char('\n');
+
+    out.append_padded("记录数", 20);
+    column = out.size();
+    out.append_uint(message.question_count);
+    out.append_char('/');
+    out.append_uint(message.answer_count);
+    out.append_char('/');
+    out.append_uint(message.authority_count);
+    out.append_char('/');
+    out.append_uint(message.additional_count);
+    out.pad_from(column, 25);
+    out.append("问题/回答/授权/附加\n");
+
+    for (size_t i = 0; i < message.questions_parsed; ++i) {
+        const DnsQuestion& question = message.questions[i];
+        out.append_padded("问题", 20);
+        out.append(question.name.text, question.name.length);
+        out.append_char(' ');
+        append_dns_type(out, question.qtype);
+        out.append_char(' ');
+        append_dns_class(out, question.qclass);
+        out.append_char('\n');
+    }
+
+    for (size_t i = 0; i < message.answers_parsed; ++i) {
+        const DnsRecord& record = message.answers[i];
+        out.append_padded("回答", 20);
+        out.append(record.name.text, record.name.length);
+        out.append_char(' ');
+        append_dns_type(out, record.type);
+        out.append_char(' ');
+        append_dns_class(out, record.rclass);
+        out.append(" TTL ");
+        out.append_uint(record.ttl);
+        out.append_char(' ');
+        if (record.type == DNS_TYPE_A) {
+            out.append_ipv4(load_be32(record.address));
+        } else if (record.type == DNS_TYPE_AAAA) {
+            out.append_ipv6(record.address);
+        } else if (record.target.length > 0) {
+            out.append(record.target.text, record.target.length);
+        } else {
+            out.append_uint(record.rdlength);
+            out.append(" 字节");
+        }
+        out.append_char('\n');
+    }
+
+    if (!message.complete) {
+        out.append_padded("未解析", 20);
+        out.append_uint(message.question_count - message.questions_parsed +
+                        message.answer_count - message.answers_parsed);
+        out.append(" 条问题/回答（超出保存上限或无法解析）\n");
+    }
+}
@@ -0,0 +1,24 @@
+// packet_print.h - 解析结果的逐字段格式化输出（写入OutputBuffer）
+#ifndef PACKET_PRINT_H
+#define PACKET_PRINT_H
+
+#include <cstdint>
+#include "packet_parser.h"
+#include "dns_parser.h"
+#include "output_writer.h"
+
+// 打印包序号、捕获时间和表头
+void print_packet_info(OutputBuffer& out, const IPPacketInfo& packet_info, uint64_t packet_number);
+
+// 按版本号打印IPv4或IPv6首部及传输层字段
+void print_ip_packet(OutputBuffer& out, const IPPacketInfo& packet_info);
+
+void print_ip_header(OutputBuffer& out, const IPPacketInfo& packet_info);
+void print_ipv6_header(OutputBuffer& out, const IPPacketInfo& packet_info);
+void print_transport_info(OutputBuffer& out, const IPPacketInfo& packet_info);
+void print_flags_info(OutputBuffer& out, uint8_t flags);
+
+// 打印DNS报文的首部、问题和回答记录
+void print_dns_message(OutputBuffer& out, const DnsMessage& message);
+
+#endif // PACKET_PRINT_H
@@ -0,0 +1,110 @@
+// packet_store.h - 定长预分配的环形包存储
+#ifndef PACKET_STORE_H
+#define PACKET_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <vector>
+
+// 环形包存储
+// 初始化时按容量一次性分配，之后追加不再分配内存；
+// 容量满时覆盖最旧的记录，设置了保留时长时淘汰超时的记录。
+// T 必须可默认构造并包含 time_t timestamp 成员。
+template <typename T>
+class PacketRingStore {
+public:
+    PacketRingStore()
+        : head_(0), count_(0), max_age_(0),
+          appended_(0), overwritten_(0), expired_(0) {}
+
+    // 初始化存储
+    // max_packets: 最多保留的包数（0表示只受内存预算限制）
+    // max_age_seconds: 最多保留的时长（0表示不按时间淘汰）
+    // memory_budget_bytes: 存储区可用的内存上限（0表示不限制）
+    // 两个上限都为0或预算不足一条记录时返回false
+    bool init(size_t max_packets, time_t max_age_seconds, size_t memory_budget_bytes) {
+        size_t capacity = max_packets;
+        if (memory_budget_bytes > 0) {
+            size_t budget_capacity = memory_budget_bytes / sizeof(T);
+            if (capacity == 0 || budget_capacity < capacity) {
+                capacity = budget_capacity;
+            }
+        }
+        if (capacity == 0) {
+            return false;
+        }
+        slots_.assign(capacity, T());
+        max_age_ = max_age_seconds;
+        clear();
+        return true;
+    }
+
+    // 追加一条记录：容量满时覆盖最旧记录；按时间淘汰是均摊O(1)
+    void append(const T& item) {
+        size_t capacity = slots_.size();
+        if (capacity == 0) {
+            return;
+        }
+        if (max_age_ > 0) {
+            expire_before(item.timestamp - max_age_);
+        }
+        size_t tail = head_ + count_;
+        if (tail >= capacity) {
+            tail -= capacity;
+        }
+        slots_[tail] = item;
+        if (count_ == capacity) {
+            // 已满：最旧的记录被覆盖
+            head_ = (head_ + 1 == capacity) ? 0 : head_ + 1;
+            overwritten_++;
+        } else {
+            count_++;
+        }
+        appended_++;
+    }
+
+    // 按时间顺序访问，index为0是最旧的记录
+    const T& at(size_t index) const {
+        size_t pos = head_ + index;
+        if (pos >= slots_.size()) {
+            pos -= slots_.size();
+        }
+        return slots_[pos];
+    }
+
+    void clear() {
+        head_ = 0;
+        count_ = 0;
+        appended_ = 0;
+        overwritten_ = 0;
+        expired_ = 0;
+    }
+
+    size_t size() const { return count_; }
+    size_t capacity() const { return slots_.size(); }
+    size_t memory_bytes() const { return slots_.size() * sizeof(T); }
+    uint64_t appended() const { return appended_; }
+    uint64_t overwritten() const { return overwritten_; }  // 因容量满被覆盖的记录数
+    uint64_t expired() const { return expired_; }          // 因超过保留时长被淘汰的记录数
+
+private:
+    // 淘汰时间戳早于cutoff的最旧记录
+    void expire_before(time_t cutoff) {
+        while (count_ > 0 && slots_[head_].timestamp < cutoff) {
+            head_ = (head_ + 1 == slots_.size()) ? 0 : head_ + 1;
+            count_--;
+            expired_++;
+        }
+    }
+
+    std::vector<T> slots_;  // 预分配的存储区
+    size_t head_;           // 最旧记录的位置
+    size_t count_;          // 当前记录数
+    time_t max_age_;        // 保留时长（秒）
+    uint64_t appended_;
+    uint64_t overwritten_;
+    uint64_t expired_;
+};
+
+#endif // PACKET_STORE_H
@@ -0,0 +1,320 @@
+// pcap_dump_ring.cpp - 轮转pcap写文件
+#include "pcap_dump_ring.h"
+#include "capture_pipeline.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+const uint64_t PCAP_FILE_HEADER_SIZE = 24;     // pcap文件头
+const uint64_t PCAP_RECORD_HEADER_SIZE = 16;   // 每个包的记录头
+const size_t FILE_BUFFER_SIZE = 1024 * 1024;   // 每个文件的stdio缓冲区，攒满再write
+
+// 单写者计数器：只有一个线程写，用load+store代替原子加
+void bump(std::atomic<uint64_t>& counter, uint64_t delta = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+}
+
+PcapDumpConfig::PcapDumpConfig()
+    : rotate_bytes(0), rotate_seconds(0), file_count(0), queue_frames(8192), block_when_full(false) {}
+
+PcapDumpRing::PcapDumpRing()
+    : running_(false), dead_(NULL), queue_(NULL), arena_(NULL), max_frame_size_(0), stopping_(false),
+      rotating_(false), sequence_(0), current_bytes_(0), current_frames_(0), current_start_sec_(0),
+      dirty_(false), prepare_requested_(false), prepare_failed_(false), file_stopping_(false),
+      queued_(0), dropped_(0), blocked_(0), truncated_(0), queue_high_water_(0),
+      written_frames_(0), written_bytes_(0), files_(0), rotation_waits_(0) {
+    current_.dumper = NULL;
+    prepared_.dumper = NULL;
+}
+
+PcapDumpRing::~PcapDumpRing() {
+    stop();
+    delete queue_;
+    delete arena_;
+    if (dead_ != NULL) {
+        pcap_close(dead_);
+    }
+}
+
+bool PcapDumpRing::start(const PcapDumpConfig& config, int linktype, int snaplen, int tstamp_precision) {
+    if (running_ || config.path.empty() || config.queue_frames == 0 || config.file_count == 1) {
+        error_ = "写文件参数无效";
+        return false;
+    }
+    config_ = config;
+
+    // 队列保存每帧的前snaplen字节，与抓包的快照长度一致，写入的文件不会比输入短
+    if (snaplen <= 0 || static_cast<size_t>(snaplen) > DUMP_MAX_FRAME_SIZE) {
+        snaplen = static_cast<int>(DUMP_MAX_FRAME_SIZE);
+    }
+    max_frame_size_ = static_cast<size_t>(snaplen);
+    dead_ = pcap_open_dead_with_tstamp_precision(linktype, snaplen, static_cast<unsigned int>(tstamp_precision));
+    if (dead_ == NULL) {
+        error_ = "无法创建pcap句柄";
+        return false;
+    }
+
+    // 第一个文件在启动时同步打开，路径或权限错误可以立即报告
+    rotating_ = config_.rotate_bytes > 0 || config_.rotate_seconds > 0;
+    sequence_ = 0;
+    if (!open_file(file_path(0), current_, error_)) {
+        return false;
+    }
+    current_bytes_ = PCAP_FILE_HEADER_SIZE;
+    current_frames_ = 0;
+    files_.store(1);
+
+    queue_ = new SpscRing<DumpFrame>(config_.queue_frames);
+    // 数据区至少能放下两个最大帧，保证回绕跳过尾部后仍有足够的连续空间
+    size_t arena_size = queue_->capacity() * DUMP_ARENA_BYTES_PER_SLOT;
+    if (arena_size < 2 * max_frame_size_) {
+        arena_size = 2 * max_frame_size_;
+    }
+    arena_ = new SpscArena(arena_size);
+    stopping_.store(false);
+    file_stopping_ = false;
+    prepare_requested_ = rotating_;
+    prepare_failed_ = false;
+    running_ = true;
+    file_thread_ = std::thread(&PcapDumpRing::file_loop, this);
+    writer_ = std::thread(&PcapDumpRing::writer_loop, this);
+    return true;
+}
+
+bool PcapDumpRing::submit(const struct timeval& ts, const uint8_t* data, uint32_t caplen, uint32_t len) {
+    bool truncated = caplen > max_frame_size_;
+    if (truncated) {
+        caplen = static_cast<uint32_t>(max_frame_size_);
+    }
+    size_t arena_bytes = 0;
+    DumpFrame* frame = queue_->begin_push();
+    uint8_t* slot = frame != NULL ? arena_->reserve(caplen, arena_bytes) : NULL;
+    if (slot == NULL) {
+        if (!config_.block_when_full) {
+            bump(dropped_);
+            return false;
+        }
+        bump(blocked_);
+        unsigned idle = 0;
+        while ((frame = queue_->begin_push()) == NULL ||
+               (slot = arena_->reserve(caplen, arena_bytes)) == NULL) {
+            pipeline_backoff(idle);
+        }
+    }
+    if (truncated) {
+        bump(truncated_);
+    }
+    memcpy(slot, data, caplen);
+    arena_->commit(arena_bytes);
+    frame->ts = ts;
+    frame->caplen = caplen;
+    frame->len = len;
+    frame->arena_bytes = static_cast<uint32_t>(arena_bytes);
+    frame->data = slot;
+    queue_->commit_push();
+    bump(queued_);
+    size_t depth = queue_->size_approx();
+    if (depth > queue_high_water_.load(std::memory_order_relaxed)) {
+        queue_high_water_.store(depth, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void PcapDumpRing::stop() {
+    if (!running_) {
+        return;
+    }
+    // 写线程写完队列中剩余的帧后把当前文件交给文件线程，文件线程关闭所有文件后退出
+    stopping_.store(true, std::memory_order_release);
+    writer_.join();
+    file_thread_.join();
+    running_ = false;
+}
+
+// 不轮转时就是path本身；轮转时为path.序号，限定文件数时序号循环使用
+std::string PcapDumpRing::file_path(uint64_t sequence) const {
+    if (!rotating_) {
+        return config_.path;
+    }
+    uint64_t index = config_.file_count > 0 ? sequence % config_.file_count : sequence;
+    return config_.path + "." + std::to_string(index);
+}
+
+bool PcapDumpRing::open_file(const std::string& path, DumpFile& file, std::string& error) {
+    FILE* fp = fopen(path.c_str(), "wb");
+    if (fp == NULL) {
+        error = "无法打开 " + path + " - " + strerror(errno);
+        return false;
+    }
+    setvbuf(fp, NULL, _IOFBF, FILE_BUFFER_SIZE);
+    // 按大小轮转时预分配整个文件的磁盘块（不改变文件长度），写入时不再逐次分配；
+    // 文件系统不支持时忽略
+    if (config_.rotate_bytes > 0) {
+        fallocate(fileno(fp), FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(config_.rotate_bytes));
+    }
+    pcap_dumper_t* dumper = pcap_dump_fopen(dead_, fp);
+    if (dumper == NULL) {
+        error = "无法写入 " + path + " - " + pcap_geterr(dead_);
+        fclose(fp);
+        return false;
+    }
+    file.dumper = dumper;
+    file.open_path = path;
+    file.final_path = path;
+    return true;
+}
+
+// 换用文件线程预先打开的文件（写线程）
+void PcapDumpRing::rotate() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (prepared_.dumper == NULL && !prepare_failed_) {
+        bump(rotation_waits_);
+        cv_.wait(lock, [this] { return prepared_.dumper != NULL || prepare_failed_; });
+    }
+    if (prepared_.dumper == NULL) {
+        // 打开下一个文件失败（如磁盘满、权限）：停止轮转，继续写当前文件
+        error_ = prepare_error_ + "，停止轮转";
+        rotating_ = false;
+        return;
+    }
+
+    DumpFile next = prepared_;
+    prepared_.dumper = NULL;
+    next.final_path = file_path(++sequence_);
+    closing_.push_back(current_);
+    renaming_.push_back(next);
+    prepare_requested_ = true;
+    cv_.notify_all();
+    lock.unlock();
+
+    current_ = next;
+    current_bytes_ = PCAP_FILE_HEADER_SIZE;
+    current_frames_ = 0;
+    dirty_ = false;
+    bump(files_);
+}
+
+void PcapDumpRing::write_frame(const DumpFrame& frame) {
+    uint64_t record_bytes = PCAP_RECORD_HEADER_SIZE + frame.caplen;
+    if (rotating_ && current_frames_ > 0 &&
+        ((config_.rotate_bytes > 0 && current_bytes_ + record_bytes > config_.rotate_bytes) ||
+         (config_.rotate_seconds > 0 && frame.ts.tv_sec >= current_start_sec_ + config_.rotate_seconds))) {
+        rotate();
+    }
+    if (current_frames_ == 0) {
+        current_start_sec_ = frame.ts.tv_sec;
+    }
+
+    struct pcap_pkthdr header;
+    header.ts = frame.ts;
+    header.caplen = frame.caplen;
+    header.len = frame.len;
+    pcap_dump(reinterpret_cast<u_char*>(current_.dumper), &header, frame.data);
+    current_bytes_ += record_bytes;
+    current_frames_++;
+    dirty_ = true;
+    bump(written_frames_);
+    bump(written_bytes_, record_bytes);
+}
+
+// 写线程：从队列取帧写入当前文件；队列持续为空时把stdio缓冲区写出，低流量时文件内容也能及时落盘
+void PcapDumpRing::writer_loop() {
+    unsigned idle = 0;
+    while (true) {
+        DumpFrame* frame = queue_->front();
+        if (frame == NULL) {
+            if (stopping_.load(std::memory_order_acquire) && queue_->front() == NULL) {
+                break;
+            }
+            if (dirty_ && idle >= 64) {
+                pcap_dump_flush(current_.dumper);
+                dirty_ = false;
+            }
+            pipeline_backoff(idle);
+            continue;
+        }
+        idle = 0;
+        write_frame(*frame);
+        uint32_t arena_bytes = frame->arena_bytes;
+        queue_->pop();
+        arena_->release(arena_bytes);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    closing_.push_back(current_);
+    current_.dumper = NULL;
+    file_stopping_ = true;
+    cv_.notify_all();
+}
+
+// 文件线程：关闭写完的文件、把换用的文件改为正式文件名、预先打开下一个文件
+void PcapDumpRing::file_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] {
+            return file_stopping_ || !closing_.empty() || !renaming_.empty() ||
+                   (prepare_requested_ && prepared_.dumper == NULL);
+        });
+        std::vector<DumpFile> closing;
+        std::vector<DumpFile> renaming;
+        closing.swap(closing_);
+        renaming.swap(renaming_);
+        bool prepare = prepare_requested_ && prepared_.dumper == NULL && !file_stopping_;
+        prepare_requested_ = false;
+        bool stopping = file_stopping_;
+        lock.unlock();
+
+        // 先关闭旧文件再改名：限定文件数时新文件的正式文件名就是最旧的那个文件
+        for (size_t i = 0; i < closing.size(); ++i) {
+            pcap_dump_close(closing[i].dumper);
+        }
+        for (size_t i = 0; i < renaming.size(); ++i) {
+            rename(renaming[i].open_path.c_str(), renaming[i].final_path.c_str());
+        }
+        DumpFile next;
+        std::string error;
+        bool opened = prepare && open_file(config_.path + ".next", next, error);
+
+        lock.lock();
+        if (prepare) {
+            if (opened) {
+                prepared_ = next;
+            } else {
+                prepare_failed_ = true;
+                prepare_error_ = error;
+            }
+            cv_.notify_all();
+        }
+        if (stopping && closing_.empty() && renaming_.empty()) {
+            break;
+        }
+    }
+
+    // 最后一个预先打开而没有用上的文件
+    if (prepared_.dumper != NULL) {
+        pcap_dump_close(prepared_.dumper);
+        unlink(prepared_.open_path.c_str());
+        prepared_.dumper = NULL;
+    }
+}
+
+void PcapDumpRing::print_stats(std::ostream& os) const {
+    os << "抓包写文件统计" << std::endl;
+    os << "----------------------------------------" << std::endl;
+    os << "写入: " << written_frames_.load() << " 帧, " << written_bytes_.load() << " 字节, "
+       << files_.load() << " 个文件（最后一个 " << current_.final_path << "）" << std::endl;
+    os << "队列: 入队 " << queued_.load() << ", 丢弃(队列/数据区满) " << dropped_.load()
+       << ", 等待(回放反压) " << blocked_.load() << ", 峰值 " << queue_high_water_.load()
+       << "/" << (queue_ != NULL ? queue_->capacity() : 0)
+       << ", 数据区 " << (arena_ != NULL ? arena_->size() / 1024 : 0) << "KB" << std::endl;
+    os << "截断(超过快照长度" << max_frame_size_ << "字节) " << truncated_.load()
+       << ", 轮转时等待下一个文件 " << rotation_waits_.load() << " 次" << std::endl;
+    if (!error_.empty()) {
+        os << "错误: " << error_ << std::endl;
+    }
+    os << "========================================" << std::endl;
+}
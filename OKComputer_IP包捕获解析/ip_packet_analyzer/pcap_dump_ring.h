@@ -0,0 +1,135 @@
+// pcap_dump_ring.h - 轮转pcap写文件（无锁队列 + 后台写线程 + 异步开关文件）
+#ifndef PCAP_DUMP_RING_H
+#define PCAP_DUMP_RING_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/time.h>
+#include <pcap.h>
+#include "spsc_ring.h"
+
+// 单帧的最大保存长度（libpcap的最大快照长度）；实际上限为start()时给出的快照长度，
+// 超出部分截断（写入文件的caplen为截断后的长度，len保留原长）
+const size_t DUMP_MAX_FRAME_SIZE = 262144;
+
+// 帧数据区按队列每个槽位平均预留的字节数（帧数据按实际长度首尾相接存放）
+const size_t DUMP_ARENA_BYTES_PER_SLOT = 2048;
+
+// 写文件参数
+struct PcapDumpConfig {
+    PcapDumpConfig();
+
+    std::string path;          // 输出文件；轮转时为前缀，依次写path.0、path.1……
+    uint64_t rotate_bytes;     // 文件达到此大小后轮转（0为不按大小），同时作为预分配的大小
+    uint32_t rotate_seconds;   // 按包时间每隔此秒数轮转（0为不按时间）
+    unsigned file_count;       // 轮转的文件数，写满后覆盖最旧的（0为不限，编号一直递增）
+    size_t queue_frames;       // 队列槽位数（向上取整为2的幂）
+    bool block_when_full;      // 为true时队列满则等待（离线回放，不丢包），否则丢弃并计数
+};
+
+// 轮转pcap写文件
+// 采集线程只把帧复制进无锁SPSC队列，从不做磁盘I/O；写线程从队列取帧调用pcap_dump，
+// 按大小或包时间轮转。下一个文件由文件线程提前打开（以.next为名，按大小轮转时用
+// fallocate预分配磁盘空间），轮转时写线程直接换用；旧文件的关闭（写出缓冲区）和
+// 新文件改名为正式文件名也在文件线程中进行，写线程只在下一个文件还未就绪时等待，
+// 此时队列继续缓冲采集线程的帧。
+class PcapDumpRing {
+public:
+    PcapDumpRing();
+    ~PcapDumpRing();
+
+    // 打开第一个文件并启动写线程和文件线程；linktype/snaplen写入pcap文件头，
+    // snaplen同时是队列中单帧的最大保存长度。tstamp_precision为抓包句柄的时间戳精度
+    // （PCAP_TSTAMP_PRECISION_MICRO/NANO），决定文件头的magic和submit()时间戳的单位
+    bool start(const PcapDumpConfig& config, int linktype, int snaplen,
+               int tstamp_precision = PCAP_TSTAMP_PRECISION_MICRO);
+
+    // 采集线程：复制一帧进队列，队列满时丢弃并返回false（回放模式下等待）
+    // ts与抓包句柄给出的一致（纳秒精度时tv_usec字段为纳秒）
+    bool submit(const struct timeval& ts, const uint8_t* data, uint32_t caplen, uint32_t len);
+
+    // 写完队列中剩余的帧，关闭所有文件并停止线程
+    void stop();
+
+    bool running() const { return running_; }
+    const std::string& error() const { return error_; }
+
+    // 打印队列、写入和轮转统计
+    void print_stats(std::ostream& os) const;
+
+private:
+    PcapDumpRing(const PcapDumpRing&);
+    PcapDumpRing& operator=(const PcapDumpRing&);
+
+    struct DumpFrame {
+        struct timeval ts;
+        uint32_t caplen;
+        uint32_t len;
+        uint32_t arena_bytes;     // 在数据区中占用的字节数，写入后归还
+        const uint8_t* data;      // 帧数据，位于arena_中
+    };
+
+    // 已打开的文件：写线程用完后交给文件线程关闭并改名
+    struct DumpFile {
+        pcap_dumper_t* dumper;
+        std::string open_path;    // 打开时的文件名（预先打开的文件为.next）
+        std::string final_path;   // 关闭前改成的正式文件名
+    };
+
+    std::string file_path(uint64_t sequence) const;
+    bool open_file(const std::string& path, DumpFile& file, std::string& error);
+    void rotate();
+    void write_frame(const DumpFrame& frame);
+    void writer_loop();
+    void file_loop();
+
+    PcapDumpConfig config_;
+    bool running_;
+    std::string error_;
+    pcap_t* dead_;                        // 只用于生成文件头（链路类型、快照长度、时间戳精度）
+    SpscRing<DumpFrame>* queue_;          // 采集 -> 写线程
+    SpscArena* arena_;                    // 队列中帧的数据（采集线程预留，写线程归还）
+    size_t max_frame_size_;               // 文件头中的快照长度
+    std::atomic<bool> stopping_;
+    std::thread writer_;
+    std::thread file_thread_;
+
+    // 写线程私有
+    DumpFile current_;
+    bool rotating_;                       // 是否轮转（打开下一个文件失败后停止轮转，继续写当前文件）
+    uint64_t sequence_;                   // 当前文件的序号
+    uint64_t current_bytes_;              // 当前文件已写字节数（含文件头）
+    uint64_t current_frames_;             // 当前文件已写帧数
+    time_t current_start_sec_;            // 当前文件第一个包的时间（秒）
+    bool dirty_;                          // 有帧还在stdio缓冲区中，空闲时写出
+
+    // 文件线程与写线程共享（mutex_保护）
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    DumpFile prepared_;                   // 预先打开的下一个文件，dumper为NULL表示尚未就绪
+    bool prepare_requested_;
+    bool prepare_failed_;
+    std::string prepare_error_;
+    std::vector<DumpFile> closing_;       // 待关闭的文件
+    std::vector<DumpFile> renaming_;      // 待从.next改为正式文件名的文件
+    bool file_stopping_;
+
+    // 统计
+    std::atomic<uint64_t> queued_;        // 已入队帧数（采集线程写）
+    std::atomic<uint64_t> dropped_;       // 队列或数据区满而丢弃的帧数（采集线程写）
+    std::atomic<uint64_t> blocked_;       // 回放模式下队列满而等待的次数（采集线程写）
+    std::atomic<uint64_t> truncated_;     // 超过快照长度而截断的帧数（采集线程写）
+    std::atomic<uint64_t> queue_high_water_;
+    std::atomic<uint64_t> written_frames_;  // 以下由写线程写
+    std::atomic<uint64_t> written_bytes_;
+    std::atomic<uint64_t> files_;
+    std::atomic<uint64_t> rotation_waits_;  // 轮转时下一个文件还未就绪而等待的次数
+};
+
+#endif // PCAP_DUMP_RING_H
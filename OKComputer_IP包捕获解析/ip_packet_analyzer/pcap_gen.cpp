@@ -0,0 +1,183 @@
+/*
+ * 合成流量pcap生成工具
+ * 功能：用TrafficGenerator逐帧生成以太网流量，通过libpcap的pcap_dump写入pcap文件，
+ *       用于大规模回放测试（ip_analyzer -r）。流数、Zipf分布的主机、分片比例、
+ *       VLAN标签和校验和错误比例均可配置，同一种子生成同一文件
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <getopt.h>
+#include <pcap.h>
+#include "traffic_gen.h"
+
+using namespace std;
+
+void print_usage(const char* program) {
+    cout << "用法: " << program << " -w <文件> [选项]" << endl;
+    cout << "  -w, --write <文件>         输出的pcap文件（\"-\"表示标准输出）" << endl;
+    cout << "  -n, --packets <N>          生成的包数（默认1000000，分片包按一个包计）" << endl;
+    cout << "  --flows <N>                五元组流数（默认4096）" << endl;
+    cout << "  --talkers <N>              源主机数（默认与流数相同）" << endl;
+    cout << "  --zipf <S>                 按流排名抽取的Zipf指数（默认1.0，0为均匀分布）" << endl;
+    cout << "  --fragments <P>            拆成两片的IPv4包百分比（默认5）" << endl;
+    cout << "  --vlan <P>                 带802.1Q标签的包百分比（默认20）" << endl;
+    cout << "  --ipv6 <P>                 IPv6包百分比（默认10）" << endl;
+    cout << "  --options <P>              带IPv4选项的包百分比（默认10）" << endl;
+    cout << "  --bad-ip-checksum <P>      IPv4首部校验和错误的包百分比（默认0）" << endl;
+    cout << "  --bad-l4-checksum <P>      传输层校验和错误的包百分比（默认0）" << endl;
+    cout << "  --rate <N>                 时间戳按每秒N个包递增（默认100000）" << endl;
+    cout << "  --seed <N>                 随机种子（默认1）" << endl;
+    cout << "  -h, --help                 显示此帮助信息" << endl;
+    cout << endl;
+    cout << "示例:" << endl;
+    cout << "  " << program << " -w replay.pcap -n 5000000 --flows 100000 --zipf 1.2 --bad-l4-checksum 1" << endl;
+    cout << "  ip_analyzer -q --l4-checksum -r replay.pcap" << endl;
+}
+
+// 解析百分比参数，超出0-100时返回false
+bool parse_percent(const char* text, unsigned& value) {
+    char* end;
+    unsigned long parsed = strtoul(text, &end, 10);
+    if (*text == '\0' || *end != '\0' || parsed > 100) {
+        return false;
+    }
+    value = static_cast<unsigned>(parsed);
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    TrafficConfig config;
+    uint64_t packets = 1000000;
+    string output_file;
+
+    enum { OPT_FLOWS = 256, OPT_TALKERS, OPT_ZIPF, OPT_FRAGMENTS, OPT_VLAN, OPT_IPV6, OPT_OPTIONS,
+           OPT_BAD_IP, OPT_BAD_L4, OPT_RATE, OPT_SEED };
+    static const struct option long_options[] = {
+        {"write",           required_argument, NULL, 'w'},
+        {"packets",         required_argument, NULL, 'n'},
+        {"flows",           required_argument, NULL, OPT_FLOWS},
+        {"talkers",         required_argument, NULL, OPT_TALKERS},
+        {"zipf",            required_argument, NULL, OPT_ZIPF},
+        {"fragments",       required_argument, NULL, OPT_FRAGMENTS},
+        {"vlan",            required_argument, NULL, OPT_VLAN},
+        {"ipv6",            required_argument, NULL, OPT_IPV6},
+        {"options",         required_argument, NULL, OPT_OPTIONS},
+        {"bad-ip-checksum", required_argument, NULL, OPT_BAD_IP},
+        {"bad-l4-checksum", required_argument, NULL, OPT_BAD_L4},
+        {"rate",            required_argument, NULL, OPT_RATE},
+        {"seed",            required_argument, NULL, OPT_SEED},
+        {"help",            no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    bool percent_ok = true;
+    while ((opt = getopt_long(argc, argv, "w:n:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'w':
+                output_file = optarg;
+                break;
+            case 'n':
+                packets = strtoull(optarg, NULL, 10);
+                break;
+            case OPT_FLOWS:
+                config.flows = strtoull(optarg, NULL, 10);
+                break;
+            case OPT_TALKERS:
+                config.talkers = strtoull(optarg, NULL, 10);
+                break;
+            case OPT_ZIPF:
+                config.zipf_exponent = strtod(optarg, NULL);
+                break;
+            case OPT_FRAGMENTS:
+                percent_ok = parse_percent(optarg, config.fragment_percent) && percent_ok;
+                break;
+            case OPT_VLAN:
+                percent_ok = parse_percent(optarg, config.vlan_percent) && percent_ok;
+                break;
+            case OPT_IPV6:
+                percent_ok = parse_percent(optarg, config.ipv6_percent) && percent_ok;
+                break;
+            case OPT_OPTIONS:
+                percent_ok = parse_percent(optarg, config.option_percent) && percent_ok;
+                break;
+            case OPT_BAD_IP:
+                percent_ok = parse_percent(optarg, config.bad_ip_checksum_percent) && percent_ok;
+                break;
+            case OPT_BAD_L4:
+                percent_ok = parse_percent(optarg, config.bad_l4_checksum_percent) && percent_ok;
+                break;
+            case OPT_RATE:
+                config.packets_per_second = strtoull(optarg, NULL, 10);
+                break;
+            case OPT_SEED:
+                config.seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (output_file.empty()) {
+        cerr << "错误：需要用-w指定输出文件" << endl;
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (!percent_ok) {
+        cerr << "错误：百分比参数必须是0-100的整数" << endl;
+        return 1;
+    }
+
+    TrafficGenerator generator;
+    if (!generator.init(config)) {
+        cerr << "错误：生成参数无效（流数、主机数、Zipf指数或速率超出范围）" << endl;
+        return 1;
+    }
+
+    // 以太网链路类型的“假”句柄只用于pcap_dump_open写文件头
+    pcap_t* handle = pcap_open_dead(DLT_EN10MB, 65535);
+    if (handle == NULL) {
+        cerr << "错误：无法创建pcap句柄" << endl;
+        return 1;
+    }
+    pcap_dumper_t* dumper = pcap_dump_open(handle, output_file.c_str());
+    if (dumper == NULL) {
+        cerr << "错误：无法打开输出文件 " << output_file << " - " << pcap_geterr(handle) << endl;
+        pcap_close(handle);
+        return 1;
+    }
+
+    auto start = chrono::steady_clock::now();
+    struct pcap_pkthdr header;
+    for (uint64_t i = 0; i < packets; ++i) {
+        // 分片包的两片在连续两次next()中返回
+        do {
+            size_t length;
+            const uint8_t* frame = generator.next(length, header.ts);
+            header.caplen = static_cast<bpf_u_int32>(length);
+            header.len = static_cast<bpf_u_int32>(length);
+            pcap_dump(reinterpret_cast<u_char*>(dumper), &header, frame);
+        } while (generator.has_pending());
+    }
+    pcap_dump_close(dumper);
+    pcap_close(handle);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // 摘要写到标准错误，输出文件为标准输出时不会混入pcap数据
+    const TrafficCounters& counters = generator.counters();
+    cerr << "已写入 " << output_file << ": " << packets << " 个包, " << counters.frames << " 帧, "
+         << counters.bytes << " 字节" << endl;
+    cerr << "  VLAN帧 " << counters.vlan_frames << ", IPv6包 " << counters.ipv6_packets
+         << ", 分片 " << counters.fragments << ", 带选项 " << counters.option_packets << endl;
+    cerr << "  IPv4首部校验和错误 " << counters.bad_ip_checksums << ", 传输层校验和错误 "
+         << counters.bad_l4_checksums << endl;
+    cerr << "  耗时 " << fixed << setprecision(2) << seconds << " 秒 ("
+         << setprecision(0) << (seconds > 0 ? counters.frames / seconds : 0) << " 帧/秒)" << endl;
+    return 0;
+}
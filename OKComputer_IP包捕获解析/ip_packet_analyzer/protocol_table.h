@@ -0,0 +1,162 @@
+// protocol_table.h - 协议号分派表（256项，编译期生成）与传输层解析
+#ifndef PROTOCOL_TABLE_H
+#define PROTOCOL_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <netinet/in.h>
+
+// 传输层解析结果
+struct L4Info {
+    bool valid;             // 是否解析出传输层首部（未分片包或首片，且长度足够）
+    uint8_t tcp_flags;      // TCP标志位（FIN/SYN/RST/PSH/ACK/URG/ECE/CWR）
+    uint8_t icmp_type;      // ICMP类型
+    uint8_t icmp_code;      // ICMP代码
+    uint16_t src_port;      // TCP/UDP/SCTP源端口
+    uint16_t dst_port;      // TCP/UDP/SCTP目的端口
+    uint16_t tcp_window;    // TCP窗口
+    uint16_t udp_length;    // UDP长度（首部+数据）
+    uint32_t tcp_seq;       // TCP序号
+    uint32_t tcp_ack;       // TCP确认号
+};
+
+// 传输层解析函数：segment为IPv4载荷或IPv6扩展首部链之后的数据，length为其可用长度；长度不足时返回false
+typedef bool (*L4Dissector)(const uint8_t* segment, size_t length, L4Info& info);
+
+inline uint16_t load_be16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline uint32_t load_be32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+// TCP：端口、序号、确认号、标志位、窗口（需要完整的20字节首部）
+inline bool dissect_tcp(const uint8_t* segment, size_t length, L4Info& info) {
+    if (length < 20) {
+        return false;
+    }
+    info.src_port = load_be16(segment);
+    info.dst_port = load_be16(segment + 2);
+    info.tcp_seq = load_be32(segment + 4);
+    info.tcp_ack = load_be32(segment + 8);
+    info.tcp_flags = segment[13];
+    info.tcp_window = load_be16(segment + 14);
+    return true;
+}
+
+// UDP：端口、长度
+inline bool dissect_udp(const uint8_t* segment, size_t length, L4Info& info) {
+    if (length < 8) {
+        return false;
+    }
+    info.src_port = load_be16(segment);
+    info.dst_port = load_be16(segment + 2);
+    info.udp_length = load_be16(segment + 4);
+    return true;
+}
+
+// ICMP/ICMPv6：类型、代码（两者首部前两个字节相同）
+inline bool dissect_icmp(const uint8_t* segment, size_t length, L4Info& info) {
+    if (length < 4) {
+        return false;
+    }
+    info.icmp_type = segment[0];
+    info.icmp_code = segment[1];
+    return true;
+}
+
+// SCTP：只取公共首部中的端口
+inline bool dissect_sctp(const uint8_t* segment, size_t length, L4Info& info) {
+    if (length < 12) {
+        return false;
+    }
+    info.src_port = load_be16(segment);
+    info.dst_port = load_be16(segment + 2);
+    return true;
+}
+
+// 分派表的一项
+struct ProtocolEntry {
+    char name[16];          // 协议名；未登记的协议为“协议N”
+    bool known;             // 是否为登记的协议（速率统计按协议细分时单独占一个槽位）
+    L4Dissector dissect;    // 传输层解析函数，NULL表示不解析
+};
+
+struct ProtocolTable {
+    ProtocolEntry entries[256];
+};
+
+namespace protocol_table_detail {
+constexpr void copy_name(char* dest, const char* src) {
+    size_t i = 0;
+    for (; src[i] != '\0' && i + 1 < sizeof(ProtocolEntry::name); ++i) {
+        dest[i] = src[i];
+    }
+    dest[i] = '\0';
+}
+
+constexpr void set_entry(ProtocolEntry& entry, const char* name, L4Dissector dissect) {
+    copy_name(entry.name, name);
+    entry.known = true;
+    entry.dissect = dissect;
+}
+
+constexpr ProtocolTable build_protocol_table() {
+    ProtocolTable table{};
+    // 未登记的协议名在编译期格式化为“协议N”，运行时不需要snprintf
+    for (int protocol = 0; protocol < 256; ++protocol) {
+        char* name = table.entries[protocol].name;
+        copy_name(name, "协议");
+        size_t length = 0;
+        while (name[length] != '\0') {
+            ++length;
+        }
+        if (protocol >= 100) {
+            name[length++] = static_cast<char>('0' + protocol / 100);
+        }
+        if (protocol >= 10) {
+            name[length++] = static_cast<char>('0' + protocol / 10 % 10);
+        }
+        name[length++] = static_cast<char>('0' + protocol % 10);
+        name[length] = '\0';
+        table.entries[protocol].known = false;
+        table.entries[protocol].dissect = nullptr;
+    }
+    set_entry(table.entries[IPPROTO_ICMP], "ICMP", dissect_icmp);
+    set_entry(table.entries[IPPROTO_IGMP], "IGMP", nullptr);
+    set_entry(table.entries[IPPROTO_TCP], "TCP", dissect_tcp);
+    set_entry(table.entries[IPPROTO_UDP], "UDP", dissect_udp);
+    set_entry(table.entries[50], "ESP", nullptr);
+    set_entry(table.entries[51], "AH", nullptr);
+    set_entry(table.entries[58], "ICMPv6", dissect_icmp);
+    set_entry(table.entries[89], "OSPF", nullptr);
+    set_entry(table.entries[132], "SCTP", dissect_sctp);
+    return table;
+}
+}
+
+// 协议号直接作为下标，查表为O(1)且不分配内存
+inline constexpr ProtocolTable PROTOCOL_TABLE = protocol_table_detail::build_protocol_table();
+
+inline const ProtocolEntry& protocol_entry(uint8_t protocol) {
+    return PROTOCOL_TABLE.entries[protocol];
+}
+
+inline const char* protocol_name(uint8_t protocol) {
+    return PROTOCOL_TABLE.entries[protocol].name;
+}
+
+// 按协议号分派到传输层解析函数；无解析函数或长度不足时info.valid为false
+inline bool dissect_l4(uint8_t protocol, const uint8_t* segment, size_t length, L4Info& info) {
+    info = L4Info();
+    L4Dissector dissect = PROTOCOL_TABLE.entries[protocol].dissect;
+    info.valid = dissect != nullptr && dissect(segment, length, info);
+    return info.valid;
+}
+
+static_assert(PROTOCOL_TABLE.entries[IPPROTO_TCP].dissect == dissect_tcp, "TCP分派项");
+static_assert(PROTOCOL_TABLE.entries[255].name[6] == '2', "未登记协议名在编译期生成");
+
+#endif // PROTOCOL_TABLE_H
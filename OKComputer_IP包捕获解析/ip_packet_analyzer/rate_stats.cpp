@@ -0,0 +1,90 @@
+// rate_stats.cpp - 速率统计实现
+#include "rate_stats.h"
+
+const size_t RateStats::RESOLUTIONS;
+const size_t RateStats::HISTORY;
+const size_t RateStats::MAX_PROTOCOLS;
+const size_t RateStats::SIZE_BINS;
+const uint32_t RateStats::RESOLUTION_SECONDS[RateStats::RESOLUTIONS] = { 1, 10, 60 };
+
+RateStats::RateStats() : slot_count_(0), latest_sec_(0) {
+    memset(protocol_slot_, 0, sizeof(protocol_slot_));
+    memset(slot_protocols_, 0, sizeof(slot_protocols_));
+    memset(size_histogram_, 0, sizeof(size_histogram_));
+}
+
+bool RateStats::init(const std::vector<uint8_t>& protocols) {
+    if (protocols.size() + 1 > MAX_PROTOCOLS) {
+        return false;
+    }
+    // 未列出的协议都映射到最后一个槽位（“其他”）
+    slot_count_ = protocols.size() + 1;
+    memset(protocol_slot_, static_cast<int>(protocols.size()), sizeof(protocol_slot_));
+    memset(slot_protocols_, 0, sizeof(slot_protocols_));
+    for (size_t i = 0; i < protocols.size(); ++i) {
+        protocol_slot_[protocols[i]] = static_cast<uint8_t>(i);
+        slot_protocols_[i] = protocols[i];
+    }
+
+    Bucket empty_bucket;
+    memset(&empty_bucket, 0, sizeof(empty_bucket));
+    for (size_t r = 0; r < RESOLUTIONS; ++r) {
+        series_[r].assign(HISTORY, empty_bucket);
+    }
+    memset(size_histogram_, 0, sizeof(size_histogram_));
+    latest_sec_ = 0;
+    return true;
+}
+
+const RateStats::Bucket* RateStats::find(size_t resolution, uint64_t start) const {
+    if (!enabled() || resolution >= RESOLUTIONS) {
+        return NULL;
+    }
+    const Bucket& bucket = series_[resolution][(start / RESOLUTION_SECONDS[resolution]) % HISTORY];
+    return bucket.start_sec == start && bucket.packets > 0 ? &bucket : NULL;
+}
+
+const RateStats::Bucket* RateStats::last_complete(size_t resolution, uint64_t timestamp_sec) const {
+    if (resolution >= RESOLUTIONS) {
+        return NULL;
+    }
+    uint32_t width = RESOLUTION_SECONDS[resolution];
+    uint64_t current = timestamp_sec - timestamp_sec % width;
+    if (current < width) {
+        return NULL;
+    }
+    return find(resolution, current - width);
+}
+
+void RateStats::merge(const RateStats& other) {
+    if (!other.enabled()) {
+        return;
+    }
+    if (!enabled()) {
+        *this = other;
+        return;
+    }
+    // 两个线程使用同一组协议初始化，槽位一一对应
+    for (size_t r = 0; r < RESOLUTIONS; ++r) {
+        for (size_t i = 0; i < HISTORY; ++i) {
+            Bucket& mine = series_[r][i];
+            const Bucket& theirs = other.series_[r][i];
+            if (theirs.start_sec > mine.start_sec) {
+                mine = theirs;
+            } else if (theirs.start_sec == mine.start_sec) {
+                mine.packets += theirs.packets;
+                mine.bytes += theirs.bytes;
+                for (size_t s = 0; s < slot_count_; ++s) {
+                    mine.protocol_packets[s] += theirs.protocol_packets[s];
+                    mine.protocol_bytes[s] += theirs.protocol_bytes[s];
+                }
+            }
+        }
+    }
+    for (size_t i = 0; i < SIZE_BINS; ++i) {
+        size_histogram_[i] += other.size_histogram_[i];
+    }
+    if (other.latest_sec_ > latest_sec_) {
+        latest_sec_ = other.latest_sec_;
+    }
+}
@@ -0,0 +1,95 @@
+// rate_stats.h - 按时间分桶的速率统计（1秒/10秒/60秒）与包长直方图
+#ifndef RATE_STATS_H
+#define RATE_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// 速率统计
+// 每种分辨率一个定长环形桶数组，桶下标 = (起始秒 / 分辨率) % HISTORY；
+// 包落入的桶起始秒与桶中记录的不同时说明桶已过期，清零后复用，因此更新是O(1)的，运行时不分配内存。
+// 按协议细分的计数只为初始化时指定的协议（PROTOCOL_NAMES中的协议）保留槽位，其余协议计入“其他”。
+// 与CaptureStats一样每个处理线程一份，报告时按桶起始秒对齐合并。
+class RateStats {
+public:
+    static const size_t RESOLUTIONS = 3;      // 1秒、10秒、60秒
+    static const size_t HISTORY = 60;         // 每种分辨率保留的桶数
+    static const size_t MAX_PROTOCOLS = 16;   // 单独统计的协议数上限（含“其他”）
+    static const size_t SIZE_BINS = 11;       // 包长直方图：<64, [64,128), ..., [32768,65536)
+    static const uint32_t RESOLUTION_SECONDS[RESOLUTIONS];
+
+    struct Bucket {
+        uint64_t start_sec;                          // 桶起始时间（对齐到分辨率），0表示空桶
+        uint64_t packets;
+        uint64_t bytes;                              // IP总长度之和（IPv6为固定首部+载荷）
+        uint64_t protocol_packets[MAX_PROTOCOLS];    // 按协议槽位细分
+        uint64_t protocol_bytes[MAX_PROTOCOLS];
+    };
+
+    RateStats();
+
+    // protocols为需要单独统计的协议号，最多MAX_PROTOCOLS-1个
+    bool init(const std::vector<uint8_t>& protocols);
+    bool enabled() const { return slot_count_ > 0; }
+
+    // 统计一个包
+    void add(uint64_t timestamp_sec, uint8_t protocol, uint32_t bytes) {
+        uint8_t slot = protocol_slot_[protocol];
+        for (size_t r = 0; r < RESOLUTIONS; ++r) {
+            uint64_t start = timestamp_sec - timestamp_sec % RESOLUTION_SECONDS[r];
+            Bucket& bucket = series_[r][(start / RESOLUTION_SECONDS[r]) % HISTORY];
+            if (bucket.start_sec != start) {
+                if (bucket.start_sec > start) {
+                    continue;   // 比环中保留的历史还旧的乱序包
+                }
+                memset(&bucket, 0, sizeof(bucket));
+                bucket.start_sec = start;
+            }
+            bucket.packets++;
+            bucket.bytes += bytes;
+            bucket.protocol_packets[slot]++;
+            bucket.protocol_bytes[slot] += bytes;
+        }
+        size_histogram_[size_bin(bytes)]++;
+        if (timestamp_sec > latest_sec_) {
+            latest_sec_ = timestamp_sec;
+        }
+    }
+
+    // 包长所在的直方图区间：<64为0，之后每个2的幂一个区间
+    static size_t size_bin(uint32_t bytes) {
+        if (bytes < 64) {
+            return 0;
+        }
+        size_t bin = 31 - __builtin_clz(bytes) - 5;
+        return bin < SIZE_BINS ? bin : SIZE_BINS - 1;
+    }
+
+    // 返回起始秒为start的桶，不在环中时返回NULL
+    const Bucket* find(size_t resolution, uint64_t start) const;
+
+    // timestamp_sec所在桶的前一个桶（已结束），该时段没有包时返回NULL
+    const Bucket* last_complete(size_t resolution, uint64_t timestamp_sec) const;
+
+    // 按桶起始秒对齐合并另一线程的统计
+    void merge(const RateStats& other);
+
+    size_t slot_count() const { return slot_count_; }
+    // 槽位对应的协议号；最后一个槽位为“其他”
+    uint8_t slot_protocol(size_t slot) const { return slot_protocols_[slot]; }
+    bool is_other_slot(size_t slot) const { return slot + 1 == slot_count_; }
+    uint64_t latest_sec() const { return latest_sec_; }
+    const uint64_t* size_histogram() const { return size_histogram_; }
+
+private:
+    std::vector<Bucket> series_[RESOLUTIONS];
+    uint8_t protocol_slot_[256];              // 协议号 -> 槽位
+    uint8_t slot_protocols_[MAX_PROTOCOLS];   // 槽位 -> 协议号
+    size_t slot_count_;
+    uint64_t size_histogram_[SIZE_BINS];
+    uint64_t latest_sec_;                     // 见过的最大包时间
+};
+
+#endif // RATE_STATS_H
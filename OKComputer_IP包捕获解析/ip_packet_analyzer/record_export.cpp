@@ -0,0 +1,215 @@
+// record_export.cpp - 机器可读的逐包/逐流记录
+#include "record_export.h"
+#include <cstring>
+
+namespace {
+// 列顺序与export_packet/export_flow中写字段的顺序一致
+const char* const PACKET_COLUMNS[] = {
+    "number", "ts", "version", "src", "dst", "protocol", "protocol_name", "length", "header_length",
+    "id", "flags", "fragment_offset", "ttl", "vlan", "src_port", "dst_port", "tcp_flags",
+    "icmp_type", "icmp_code", "checksum_errors"
+};
+
+const char* const FLOW_COLUMNS[] = {
+    "src", "dst", "src_port", "dst_port", "protocol", "protocol_name", "packets", "bytes",
+    "first_seen", "last_seen", "duration_us", "tcp_flags"
+};
+
+// 按格式写字段分隔符和键名：JSON为{"键":值,...}，CSV只写值，用逗号分隔。
+// 所有值都是数字、地址或协议名，不含引号、逗号和控制字符，无需转义
+class RecordWriter {
+public:
+    RecordWriter(OutputBuffer& out, ExportFormat format)
+        : out_(out), json_(format == EXPORT_JSONL), first_(true) {
+        if (json_) {
+            out_.append_char('{');
+        }
+    }
+
+    void add_uint(const char* name, uint64_t value) {
+        begin_field(name);
+        out_.append_uint(value);
+    }
+
+    void add_text(const char* name, const char* text) {
+        begin_field(name);
+        quote();
+        out_.append(text);
+        quote();
+    }
+
+    void add_ipv4(const char* name, uint32_t addr) {
+        begin_field(name);
+        quote();
+        out_.append_ipv4(addr);
+        quote();
+    }
+
+    void add_ipv6(const char* name, const uint8_t* addr) {
+        begin_field(name);
+        quote();
+        out_.append_ipv6(addr);
+        quote();
+    }
+
+    // 秒.微秒，微秒部分固定6位
+    // 秒.小数部分，digits为小数位数（微秒6位，纳秒9位）
+    void add_time(const char* name, uint64_t seconds, uint32_t fraction, int digits) {
+        begin_field(name);
+        out_.append_uint(seconds);
+        out_.append_char('.');
+        out_.append_uint(fraction, digits);
+    }
+
+    // 不适用的字段：JSON中省略，CSV中留空列
+    void skip(const char* name) {
+        if (!json_) {
+            begin_field(name);
+        }
+    }
+
+    void finish() {
+        if (json_) {
+            out_.append_char('}');
+        }
+        out_.append_char('\n');
+    }
+
+private:
+    void begin_field(const char* name) {
+        if (!first_) {
+            out_.append_char(',');
+        }
+        first_ = false;
+        if (json_) {
+            out_.append_char('"');
+            out_.append(name);
+            out_.append("\":", 2);
+        }
+    }
+
+    void quote() {
+        if (json_) {
+            out_.append_char('"');
+        }
+    }
+
+    OutputBuffer& out_;
+    bool json_;
+    bool first_;
+};
+
+void write_csv_header(OutputBuffer& out, const char* const* columns, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0) {
+            out.append_char(',');
+        }
+        out.append(columns[i]);
+    }
+    out.append_char('\n');
+}
+}
+
+bool parse_export_format(const char* text, ExportFormat& format) {
+    if (strcmp(text, "text") == 0) {
+        format = EXPORT_TEXT;
+    } else if (strcmp(text, "jsonl") == 0 || strcmp(text, "json") == 0) {
+        format = EXPORT_JSONL;
+    } else if (strcmp(text, "csv") == 0) {
+        format = EXPORT_CSV;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void export_packet_header(OutputBuffer& out, ExportFormat format) {
+    if (format == EXPORT_CSV) {
+        write_csv_header(out, PACKET_COLUMNS, sizeof(PACKET_COLUMNS) / sizeof(PACKET_COLUMNS[0]));
+    }
+}
+
+void export_flow_header(OutputBuffer& out, ExportFormat format) {
+    if (format == EXPORT_CSV) {
+        write_csv_header(out, FLOW_COLUMNS, sizeof(FLOW_COLUMNS) / sizeof(FLOW_COLUMNS[0]));
+    }
+}
+
+void export_packet(OutputBuffer& out, ExportFormat format, const IPPacketInfo& packet_info, uint64_t number) {
+    RecordWriter record(out, format);
+    bool ipv6 = packet_info.version == 6;
+    record.add_uint("number", number);
+    if (packet_info.timestamp_nano) {
+        record.add_time("ts", static_cast<uint64_t>(packet_info.timestamp), packet_info.timestamp_nsec, 9);
+    } else {
+        record.add_time("ts", static_cast<uint64_t>(packet_info.timestamp), packet_info.timestamp_nsec / 1000, 6);
+    }
+    record.add_uint("version", packet_info.version);
+    if (ipv6) {
+        record.add_ipv6("src", packet_info.src_addr6);
+        record.add_ipv6("dst", packet_info.dst_addr6);
+    } else {
+        record.add_ipv4("src", packet_info.src_addr);
+        record.add_ipv4("dst", packet_info.dst_addr);
+    }
+    record.add_uint("protocol", packet_info.protocol);
+    record.add_text("protocol_name", get_protocol_name(packet_info.protocol));
+    record.add_uint("length", packet_info.total_length);
+    record.add_uint("header_length", packet_info.header_length);
+    // IPv6只有分片扩展首部带标识
+    record.add_uint("id", ipv6 ? packet_info.ipv6_fragment_id : packet_info.identification);
+    record.add_uint("flags", packet_info.flags);
+    record.add_uint("fragment_offset", packet_info.fragment_offset);
+    record.add_uint("ttl", packet_info.ttl);
+    if (packet_info.vlan_depth > 0) {
+        record.add_uint("vlan", packet_info.vlan_id);
+    } else {
+        record.skip("vlan");
+    }
+
+    // 传输层字段：端口（TCP/UDP/SCTP）、TCP标志位、ICMP类型和代码，未解析出传输层首部时都不输出
+    const L4Info& l4 = packet_info.l4;
+    bool icmp = packet_info.protocol == IPPROTO_ICMP || packet_info.protocol == IPPROTO_ICMPV6;
+    if (l4.valid && !icmp) {
+        record.add_uint("src_port", l4.src_port);
+        record.add_uint("dst_port", l4.dst_port);
+    } else {
+        record.skip("src_port");
+        record.skip("dst_port");
+    }
+    if (l4.valid && packet_info.protocol == IPPROTO_TCP) {
+        record.add_uint("tcp_flags", l4.tcp_flags);
+    } else {
+        record.skip("tcp_flags");
+    }
+    if (l4.valid && icmp) {
+        record.add_uint("icmp_type", l4.icmp_type);
+        record.add_uint("icmp_code", l4.icmp_code);
+    } else {
+        record.skip("icmp_type");
+        record.skip("icmp_code");
+    }
+    record.add_uint("checksum_errors", packet_info.checksum_errors);
+    record.finish();
+}
+
+void export_flow(OutputBuffer& out, ExportFormat format, const FlowRecord& flow) {
+    RecordWriter record(out, format);
+    record.add_ipv4("src", flow.key.src_addr);
+    record.add_ipv4("dst", flow.key.dst_addr);
+    record.add_uint("src_port", flow.key.src_port);
+    record.add_uint("dst_port", flow.key.dst_port);
+    record.add_uint("protocol", flow.key.protocol);
+    record.add_text("protocol_name", get_protocol_name(flow.key.protocol));
+    record.add_uint("packets", flow.packets);
+    record.add_uint("bytes", flow.bytes);
+    record.add_time("first_seen", flow.first_seen_us / 1000000, static_cast<uint32_t>(flow.first_seen_us % 1000000), 6);
+    record.add_time("last_seen", flow.last_seen_us / 1000000, static_cast<uint32_t>(flow.last_seen_us % 1000000), 6);
+    record.add_uint("duration_us", flow.last_seen_us - flow.first_seen_us);
+    if (flow.key.protocol == IPPROTO_TCP) {
+        record.add_uint("tcp_flags", flow.tcp_flags);
+    } else {
+        record.skip("tcp_flags");
+    }
+    record.finish();
+}
@@ -0,0 +1,30 @@
+// record_export.h - 机器可读的逐包/逐流记录（JSON Lines和CSV）
+#ifndef RECORD_EXPORT_H
+#define RECORD_EXPORT_H
+
+#include <cstdint>
+#include "packet_parser.h"
+#include "flow_table.h"
+#include "output_writer.h"
+
+// 输出格式：文本为原有的逐字段表格，JSONL每行一个JSON对象，CSV首行为列名
+enum ExportFormat {
+    EXPORT_TEXT,
+    EXPORT_JSONL,
+    EXPORT_CSV
+};
+
+// 解析--format参数（text/jsonl/csv）
+bool parse_export_format(const char* text, ExportFormat& format);
+
+// CSV列名行（JSONL没有表头，不输出）
+void export_packet_header(OutputBuffer& out, ExportFormat format);
+void export_flow_header(OutputBuffer& out, ExportFormat format);
+
+// 一个已解码的包 -> 一条记录。不适用的字段在JSON中省略，在CSV中留空，列数固定
+void export_packet(OutputBuffer& out, ExportFormat format, const IPPacketInfo& packet_info, uint64_t number);
+
+// 一条流（超时或结束时仍活跃）-> 一条记录
+void export_flow(OutputBuffer& out, ExportFormat format, const FlowRecord& record);
+
+#endif // RECORD_EXPORT_H
@@ -0,0 +1,54 @@
+// sample_packets.h - 手写的测试IP包（测试程序逐个解析，基准测试以它们为模板生成语料）
+#ifndef SAMPLE_PACKETS_H
+#define SAMPLE_PACKETS_H
+
+#include <cstdint>
+#include <vector>
+
+// 测试数据：预定义的IP包
+inline const std::vector<std::vector<uint8_t>> test_packets = {
+    // 测试包1: TCP SYN包 (192.168.1.100 -> 192.168.1.1)
+    {
+        0x45, 0x00, 0x00, 0x3c,  // Version/IHL, DSCP/ECN, Total Length
+        0x4a, 0x2c, 0x40, 0x00,  // Identification, Flags/Fragment Offset
+        0x40, 0x06, 0x12, 0x34,  // TTL, Protocol, Header Checksum
+        0xc0, 0xa8, 0x01, 0x64,  // Source IP: 192.168.1.100
+        0xc0, 0xa8, 0x01, 0x01,  // Destination IP: 192.168.1.1
+        // TCP数据...
+        0xab, 0xcd, 0xef, 0x01, 0x00, 0x00, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x00, 0x50, 0x02, 0x71, 0x10,
+        0x12, 0x34, 0x00, 0x00, 0x02, 0x04, 0x05, 0xb4,
+        0x04, 0x02, 0x08, 0x0a, 0x00, 0x0f, 0x7a, 0x8b,
+        0x00, 0x00, 0x00, 0x00, 0x01, 0x03, 0x03, 0x07
+    },
+    // 测试包2: UDP包 (8.8.8.8 -> 192.168.1.100)
+    {
+        0x45, 0x00, 0x05, 0xdc,  // Version/IHL, DSCP/ECN, Total Length
+        0x3f, 0x1a, 0x20, 0x00,  // Identification, Flags/Fragment Offset
+        0x3f, 0x11, 0x56, 0x78,  // TTL, Protocol, Header Checksum
+        0x08, 0x08, 0x08, 0x08,  // Source IP: 8.8.8.8
+        0xc0, 0xa8, 0x01, 0x64,  // Destination IP: 192.168.1.100
+        // UDP数据...
+        0x00, 0x35, 0x00, 0x35, 0x05, 0xc8, 0x12, 0x34,
+        0x12, 0x34, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x03, 0x77, 0x77, 0x77,
+        0x06, 0x67, 0x6f, 0x6f, 0x67, 0x6c, 0x65, 0x03,
+        0x63, 0x6f, 0x6d, 0x00, 0x00, 0x01, 0x00, 0x01
+    },
+    // 测试包3: ICMP Echo Request (192.168.1.100 -> 8.8.8.8)
+    {
+        0x45, 0x00, 0x00, 0x54,  // Version/IHL, DSCP/ECN, Total Length
+        0x5c, 0x8f, 0x40, 0x00,  // Identification, Flags/Fragment Offset
+        0x40, 0x01, 0x9a, 0xbc,  // TTL, Protocol, Header Checksum
+        0xc0, 0xa8, 0x01, 0x64,  // Source IP: 192.168.1.100
+        0x08, 0x08, 0x08, 0x08,  // Destination IP: 8.8.8.8
+        // ICMP数据...
+        0x08, 0x00, 0x12, 0x34, 0x00, 0x01, 0x00, 0x0a,
+        0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0,
+        0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88,
+        0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff, 0x00,
+        0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88
+    }
+};
+
+#endif // SAMPLE_PACKETS_H
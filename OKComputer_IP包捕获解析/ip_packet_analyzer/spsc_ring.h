@@ -0,0 +1,166 @@
+// spsc_ring.h - 无锁单生产者/单消费者环形队列
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 单生产者/单消费者环形队列
+// 生产者只写tail_，消费者只写head_，两端各自缓存对方的索引，
+// 只有在缓存的索引显示队列满/空时才读取对方的原子变量，减少缓存行往返。
+// 槽位原地读写：生产者用begin_push()/commit_push()直接填充槽位，
+// 消费者用front()/pop()直接读取槽位，大对象（如整帧数据）无需额外复制。
+template <typename T>
+class SpscRing {
+public:
+    // capacity会向上取整为2的幂
+    explicit SpscRing(size_t capacity)
+        : head_(0), tail_cache_(0), tail_(0), head_cache_(0) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    // ---------- 生产者端 ----------
+
+    // 返回可写槽位，队列满时返回NULL
+    T* begin_push() {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ > mask_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ > mask_) {
+                return NULL;
+            }
+        }
+        return &slots_[tail & mask_];
+    }
+
+    // 发布begin_push()返回的槽位
+    void commit_push() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool try_push(const T& value) {
+        T* slot = begin_push();
+        if (slot == NULL) {
+            return false;
+        }
+        *slot = value;
+        commit_push();
+        return true;
+    }
+
+    // ---------- 消费者端 ----------
+
+    // 返回队首槽位，队列空时返回NULL
+    T* front() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) {
+                return NULL;
+            }
+        }
+        return &slots_[head & mask_];
+    }
+
+    // 释放front()返回的槽位
+    void pop() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool try_pop(T& value) {
+        T* slot = front();
+        if (slot == NULL) {
+            return false;
+        }
+        value = *slot;
+        pop();
+        return true;
+    }
+
+    // ---------- 任意线程 ----------
+
+    // 当前元素个数（近似值，用于统计）
+    size_t size_approx() const {
+        size_t tail = tail_.load(std::memory_order_acquire);
+        size_t head = head_.load(std::memory_order_acquire);
+        return tail - head;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    SpscRing(const SpscRing&);
+    SpscRing& operator=(const SpscRing&);
+
+    // 生产者和消费者的变量分别放在不同缓存行，避免伪共享
+    char pad0_[64];
+    std::atomic<size_t> head_;   // 消费者写
+    size_t tail_cache_;          // 消费者缓存的tail_
+    char pad1_[64];
+    std::atomic<size_t> tail_;   // 生产者写
+    size_t head_cache_;          // 生产者缓存的head_
+    char pad2_[64];
+    size_t mask_;
+    std::vector<T> slots_;
+};
+
+// 单生产者/单消费者的变长字节区，与SpscRing配合保存变长记录（如整帧数据）：
+// 生产者按入队顺序预留连续空间，环中只保存指针和占用的字节数；消费者按同样的顺序归还，
+// 因此只需两个累计字节数即可判断剩余空间，小帧不占用最大帧的空间。
+// 尾部放不下时跳到开头，跳过的字节计入该记录的占用，归还时一并释放
+class SpscArena {
+public:
+    explicit SpscArena(size_t size)
+        : released_(0), written_(0), released_cache_(0), bytes_(size) {}
+
+    // ---------- 生产者端 ----------
+
+    // 预留length字节的连续空间，空间不足时返回NULL；used返回实际占用的字节数，
+    // 写入数据后用commit(used)确认。length不超过size()/2时总能在归还后成功
+    uint8_t* reserve(size_t length, size_t& used) {
+        size_t size = bytes_.size();
+        size_t offset = written_ % size;
+        size_t skip = offset + length > size ? size - offset : 0;
+        size_t need = skip + length;
+        if (written_ + need - released_cache_ > size) {
+            released_cache_ = released_.load(std::memory_order_acquire);
+            if (written_ + need - released_cache_ > size) {
+                return NULL;
+            }
+        }
+        used = need;
+        return &bytes_[(offset + skip) % size];
+    }
+
+    void commit(size_t used) { written_ += used; }
+
+    // ---------- 消费者端 ----------
+
+    // 归还最早的一条记录占用的字节（读完数据之后调用）
+    void release(size_t used) {
+        released_.store(released_.load(std::memory_order_relaxed) + used, std::memory_order_release);
+    }
+
+    size_t size() const { return bytes_.size(); }
+
+private:
+    SpscArena(const SpscArena&);
+    SpscArena& operator=(const SpscArena&);
+
+    char pad0_[64];
+    std::atomic<size_t> released_;   // 累计归还字节数（消费者写）
+    char pad1_[64];
+    size_t written_;                 // 累计写入字节数（生产者私有）
+    size_t released_cache_;          // 生产者缓存的released_
+    char pad2_[64];
+    std::vector<uint8_t> bytes_;
+};
+
+#endif // SPSC_RING_H
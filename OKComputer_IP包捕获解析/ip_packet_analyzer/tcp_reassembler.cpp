@@ -0,0 +1,549 @@
+// tcp_reassembler.cpp - TCP流重组实现
+#include "tcp_reassembler.h"
+#include "protocol_table.h"
+
+const uint32_t TcpReassembler::NIL;
+
+namespace {
+const uint8_t TCP_FIN = 0x01;
+const uint8_t TCP_SYN = 0x02;
+const uint8_t TCP_RST = 0x04;
+const uint8_t TCP_ACK = 0x10;
+
+// 超前下一个待交付序号这么多字节以上的段视为不属于当前连接（序号回绕或伪造），不缓存
+const uint32_t MAX_AHEAD = 1u << 30;
+}
+
+TcpReassembler::TcpReassembler()
+    : connection_chunks_(0), bucket_mask_(0), free_slot_(NIL), oldest_(NIL), newest_(NIL),
+      buffer_oldest_(NIL), buffer_newest_(NIL), active_(0), next_id_(1), timeout_us_(0),
+      consumer_count_(0) {}
+
+bool TcpReassembler::init(size_t memory_budget_bytes, size_t connection_budget_bytes,
+                          size_t max_connections, uint32_t timeout_sec) {
+    // 全局预算只用于乱序数据的缓冲池（含块的元数据），连接槽位按max_connections另行分配
+    size_t chunk_count = memory_budget_bytes / (CHUNK_SIZE + sizeof(Chunk) + sizeof(uint32_t));
+    if (chunk_count == 0 || chunk_count >= NIL || connection_budget_bytes < CHUNK_SIZE ||
+        max_connections == 0 || max_connections >= NIL || timeout_sec == 0) {
+        return false;
+    }
+
+    chunk_pool_.assign(chunk_count * CHUNK_SIZE, 0);
+    chunk_info_.assign(chunk_count, Chunk());
+    free_chunks_.resize(chunk_count);
+    for (size_t i = 0; i < chunk_count; ++i) {
+        free_chunks_[i] = static_cast<uint32_t>(chunk_count - 1 - i);
+    }
+    connection_chunks_ = connection_budget_bytes / CHUNK_SIZE;
+
+    slots_.assign(max_connections, Connection());
+    for (size_t i = 0; i < max_connections; ++i) {
+        slots_[i].in_use = false;
+        slots_[i].next = (i + 1 < max_connections) ? static_cast<uint32_t>(i + 1) : NIL;
+    }
+    free_slot_ = 0;
+
+    size_t bucket_count = 1;
+    while (bucket_count < max_connections) {
+        bucket_count <<= 1;
+    }
+    buckets_.assign(bucket_count, NIL);
+    bucket_mask_ = bucket_count - 1;
+
+    oldest_ = NIL;
+    newest_ = NIL;
+    buffer_oldest_ = NIL;
+    buffer_newest_ = NIL;
+    active_ = 0;
+    next_id_ = 1;
+    timeout_us_ = static_cast<uint64_t>(timeout_sec) * 1000000;
+    stats_.reset();
+    return true;
+}
+
+bool TcpReassembler::add_consumer(TcpStreamConsumer consumer, void* context) {
+    if (consumer_count_ >= MAX_CONSUMERS) {
+        return false;
+    }
+    consumers_[consumer_count_] = consumer;
+    consumer_contexts_[consumer_count_] = context;
+    consumer_count_++;
+    return true;
+}
+
+size_t TcpReassembler::memory_bytes() const {
+    return chunk_pool_.size() + chunk_info_.size() * sizeof(Chunk) +
+           free_chunks_.capacity() * sizeof(uint32_t) + slots_.size() * sizeof(Connection) +
+           buckets_.size() * sizeof(uint32_t);
+}
+
+// 对称哈希：两个方向的段落到同一个桶
+uint32_t TcpReassembler::hash_key(uint32_t addr_a, uint16_t port_a, uint32_t addr_b, uint16_t port_b) {
+    uint64_t a = (static_cast<uint64_t>(addr_a) << 16) | port_a;
+    uint64_t b = (static_cast<uint64_t>(addr_b) << 16) | port_b;
+    if (a > b) {
+        uint64_t t = a;
+        a = b;
+        b = t;
+    }
+    uint64_t h = a * 0x9E3779B97F4A7C15ULL;
+    h ^= b * 0xC2B2AE3D27D4EB4FULL;
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 32;
+    return static_cast<uint32_t>(h);
+}
+
+uint32_t TcpReassembler::find(uint32_t src_addr, uint16_t src_port, uint32_t dst_addr, uint16_t dst_port,
+                              uint32_t hash, int& direction) const {
+    uint32_t index = buckets_[hash & bucket_mask_];
+    while (index != NIL) {
+        const Connection& entry = slots_[index];
+        if (entry.hash == hash) {
+            if (entry.client_addr == src_addr && entry.client_port == src_port &&
+                entry.server_addr == dst_addr && entry.server_port == dst_port) {
+                direction = 0;
+                return index;
+            }
+            if (entry.client_addr == dst_addr && entry.client_port == dst_port &&
+                entry.server_addr == src_addr && entry.server_port == src_port) {
+                direction = 1;
+                return index;
+            }
+        }
+        index = entry.hash_next;
+    }
+    return NIL;
+}
+
+uint32_t TcpReassembler::create(uint32_t client_addr, uint16_t client_port, uint32_t server_addr,
+                                uint16_t server_port, uint32_t hash, uint64_t timestamp_us) {
+    if (free_slot_ == NIL) {
+        close(oldest_, TCP_CLOSE_EVICTED, timestamp_us);
+    }
+    uint32_t index = free_slot_;
+    Connection& entry = slots_[index];
+    free_slot_ = entry.next;
+
+    entry.client_addr = client_addr;
+    entry.server_addr = server_addr;
+    entry.client_port = client_port;
+    entry.server_port = server_port;
+    entry.in_use = true;
+    entry.hash = hash;
+    entry.buffer_prev = NIL;
+    entry.buffer_next = NIL;
+    entry.id = next_id_++;
+    entry.last_us = timestamp_us;
+    entry.chunk_count = 0;
+    memset(entry.half, 0, sizeof(entry.half));
+    entry.half[0].chunks = NIL;
+    entry.half[1].chunks = NIL;
+
+    // 挂到哈希桶和活动时间链表的尾部
+    uint32_t& bucket = buckets_[hash & bucket_mask_];
+    entry.hash_next = bucket;
+    bucket = index;
+    entry.prev = newest_;
+    entry.next = NIL;
+    if (newest_ != NIL) {
+        slots_[newest_].next = index;
+    } else {
+        oldest_ = index;
+    }
+    newest_ = index;
+    active_++;
+    stats_.connections++;
+
+    TcpStreamEvent event;
+    memset(&event, 0, sizeof(event));
+    event.type = TCP_STREAM_OPEN;
+    event.timestamp_us = timestamp_us;
+    emit(event, entry);
+    return index;
+}
+
+// 更新最近活动时间，移到活动时间链表的尾部
+void TcpReassembler::touch(uint32_t index, uint64_t timestamp_us) {
+    Connection& entry = slots_[index];
+    entry.last_us = timestamp_us;
+    if (newest_ == index) {
+        return;
+    }
+    if (entry.prev != NIL) {
+        slots_[entry.prev].next = entry.next;
+    } else {
+        oldest_ = entry.next;
+    }
+    slots_[entry.next].prev = entry.prev;
+    entry.prev = newest_;
+    entry.next = NIL;
+    slots_[newest_].next = index;
+    newest_ = index;
+}
+
+// 结束连接：缓存的数据先交付（空洞以GAP报告），再通知消费者并释放槽位
+void TcpReassembler::close(uint32_t index, TcpCloseReason reason, uint64_t timestamp_us) {
+    drain(index, 0, true, timestamp_us);
+    drain(index, 1, true, timestamp_us);
+
+    switch (reason) {
+        case TCP_CLOSE_FIN: stats_.closed++; break;
+        case TCP_CLOSE_RST: stats_.resets++; break;
+        case TCP_CLOSE_TIMEOUT: stats_.timed_out++; break;
+        case TCP_CLOSE_EVICTED: stats_.evicted++; break;
+        default: break;
+    }
+    TcpStreamEvent event;
+    memset(&event, 0, sizeof(event));
+    event.type = TCP_STREAM_CLOSE;
+    event.reason = reason;
+    event.timestamp_us = timestamp_us;
+    emit(event, slots_[index]);
+    release(index);
+}
+
+void TcpReassembler::release(uint32_t index) {
+    Connection& entry = slots_[index];
+
+    uint32_t* link = &buckets_[entry.hash & bucket_mask_];
+    while (*link != index) {
+        link = &slots_[*link].hash_next;
+    }
+    *link = entry.hash_next;
+
+    if (entry.prev != NIL) {
+        slots_[entry.prev].next = entry.next;
+    } else {
+        oldest_ = entry.next;
+    }
+    if (entry.next != NIL) {
+        slots_[entry.next].prev = entry.prev;
+    } else {
+        newest_ = entry.prev;
+    }
+
+    entry.in_use = false;
+    entry.next = free_slot_;
+    free_slot_ = index;
+    active_--;
+}
+
+void TcpReassembler::expire(uint64_t now_us) {
+    while (oldest_ != NIL && slots_[oldest_].last_us + timeout_us_ <= now_us) {
+        close(oldest_, TCP_CLOSE_TIMEOUT, now_us);
+    }
+}
+
+void TcpReassembler::close_all() {
+    uint64_t now_us = newest_ != NIL ? slots_[newest_].last_us : 0;
+    while (oldest_ != NIL) {
+        close(oldest_, TCP_CLOSE_SHUTDOWN, now_us);
+    }
+}
+
+void TcpReassembler::add(const IPv4HeaderView& ip_view, uint64_t timestamp_us) {
+    if (!enabled() || ip_view.protocol() != IPPROTO_TCP || ip_view.is_fragment()) {
+        return;
+    }
+    expire(timestamp_us);
+
+    const uint8_t* segment = ip_view.payload();
+    size_t length = ip_view.payload_length();
+    if (length < 20) {
+        return;
+    }
+    stats_.segments++;
+    // 载荷被截断的段无法按序号拼接，忽略（缺失的数据在强制交付或连接结束时以GAP报告）
+    size_t data_offset = static_cast<size_t>(segment[12] >> 4) * 4;
+    if (data_offset < 20 || data_offset > length || ip_view.total_length() > ip_view.captured_length()) {
+        stats_.truncated++;
+        return;
+    }
+
+    uint32_t src_addr = ip_view.src_addr();
+    uint32_t dst_addr = ip_view.dst_addr();
+    uint16_t src_port = load_be16(segment);
+    uint16_t dst_port = load_be16(segment + 2);
+    uint32_t seq = load_be32(segment + 4);
+    uint8_t flags = segment[13];
+    const uint8_t* data = segment + data_offset;
+    size_t data_length = length - data_offset;
+
+    uint32_t hash = hash_key(src_addr, src_port, dst_addr, dst_port);
+    int direction = 0;
+    uint32_t index = find(src_addr, src_port, dst_addr, dst_port, hash, direction);
+    if (index == NIL) {
+        // SYN开始跟踪；只见到SYN-ACK时以接收方为客户端；没有见到握手的数据段从中途开始跟踪；
+        // 未知连接的RST和纯ACK不跟踪
+        if ((flags & TCP_RST) != 0) {
+            return;
+        }
+        if ((flags & TCP_SYN) != 0 && (flags & TCP_ACK) != 0) {
+            index = create(dst_addr, dst_port, src_addr, src_port, hash, timestamp_us);
+            direction = 1;
+        } else if ((flags & TCP_SYN) != 0 || data_length > 0) {
+            index = create(src_addr, src_port, dst_addr, dst_port, hash, timestamp_us);
+            direction = 0;
+            if ((flags & TCP_SYN) == 0) {
+                stats_.midstream++;
+            }
+        } else {
+            return;
+        }
+    }
+    touch(index, timestamp_us);
+    process(index, direction, seq, flags, data, data_length, timestamp_us);
+}
+
+void TcpReassembler::process(uint32_t index, int direction, uint32_t seq, uint8_t flags,
+                             const uint8_t* data, size_t length, uint64_t timestamp_us) {
+    if ((flags & TCP_RST) != 0) {
+        close(index, TCP_CLOSE_RST, timestamp_us);
+        return;
+    }
+
+    HalfStream& half = slots_[index].half[direction];
+    // SYN占用一个序号，其后（TCP Fast Open）的数据从初始序号+1开始
+    if ((flags & TCP_SYN) != 0) {
+        if (!half.seq_known) {
+            half.next_seq = seq + 1;
+            half.seq_known = true;
+        }
+        seq++;
+    }
+    if (!half.seq_known) {
+        half.next_seq = seq;
+        half.seq_known = true;
+    }
+    if (half.closed) {
+        if (length > 0) {
+            stats_.ignored++;
+        }
+        return;
+    }
+    if ((flags & TCP_FIN) != 0 && !half.fin) {
+        half.fin = true;
+        half.fin_seq = seq + static_cast<uint32_t>(length);
+    }
+
+    if (length > 0) {
+        int32_t delta = static_cast<int32_t>(seq - half.next_seq);
+        if (delta < 0) {
+            // 重传：已交付的部分裁掉
+            uint32_t overlap = half.next_seq - seq;
+            if (overlap >= length) {
+                stats_.retransmitted++;
+                length = 0;
+            } else {
+                data += overlap;
+                length -= overlap;
+                seq = half.next_seq;
+                delta = 0;
+            }
+        }
+        if (length > 0 && delta == 0) {
+            deliver(index, direction, data, length, timestamp_us);
+            drain(index, direction, false, timestamp_us);
+        } else if (length > 0 && static_cast<uint32_t>(delta) >= MAX_AHEAD) {
+            stats_.ignored++;
+        } else if (length > 0 && !buffer(index, direction, seq, data, length, timestamp_us)) {
+            // 超出内存预算：该方向的缓存全部强制交付，本段随后交付，中间的空洞跳过
+            stats_.overflows++;
+            drain(index, direction, true, timestamp_us);
+            delta = static_cast<int32_t>(seq - half.next_seq);
+            if (delta > 0) {
+                skip(index, direction, static_cast<uint32_t>(delta), timestamp_us);
+            } else if (delta < 0) {
+                uint32_t overlap = half.next_seq - seq;
+                data += overlap;
+                length = overlap >= length ? 0 : length - overlap;
+            }
+            if (length > 0) {
+                deliver(index, direction, data, length, timestamp_us);
+            }
+        }
+    }
+    check_fin(index, direction);
+}
+
+void TcpReassembler::deliver(uint32_t index, int direction, const uint8_t* data, size_t length,
+                             uint64_t timestamp_us) {
+    Connection& entry = slots_[index];
+    HalfStream& half = entry.half[direction];
+    TcpStreamEvent event;
+    memset(&event, 0, sizeof(event));
+    event.type = TCP_STREAM_DATA;
+    event.direction = static_cast<uint8_t>(direction);
+    event.data = data;
+    event.length = static_cast<uint32_t>(length);
+    event.offset = half.offset;
+    event.timestamp_us = timestamp_us;
+    emit(event, entry);
+
+    half.next_seq += static_cast<uint32_t>(length);
+    half.offset += length;
+    stats_.delivered_bytes += length;
+}
+
+void TcpReassembler::skip(uint32_t index, int direction, uint32_t length, uint64_t timestamp_us) {
+    Connection& entry = slots_[index];
+    HalfStream& half = entry.half[direction];
+    TcpStreamEvent event;
+    memset(&event, 0, sizeof(event));
+    event.type = TCP_STREAM_GAP;
+    event.direction = static_cast<uint8_t>(direction);
+    event.length = length;
+    event.offset = half.offset;
+    event.timestamp_us = timestamp_us;
+    emit(event, entry);
+
+    half.next_seq += length;
+    half.offset += length;
+    stats_.gaps++;
+    stats_.gap_bytes += length;
+}
+
+// 依次交付缓存链表头部已连续的块；force为true时遇到空洞也跳过，直到链表为空
+void TcpReassembler::drain(uint32_t index, int direction, bool force, uint64_t timestamp_us) {
+    HalfStream& half = slots_[index].half[direction];
+    while (half.chunks != NIL) {
+        uint32_t chunk = half.chunks;
+        const Chunk& info = chunk_info_[chunk];
+        int32_t delta = static_cast<int32_t>(info.seq - half.next_seq);
+        if (delta > 0) {
+            if (!force) {
+                break;
+            }
+            skip(index, direction, static_cast<uint32_t>(delta), timestamp_us);
+            delta = 0;
+        }
+        // 与已交付数据重叠的部分裁掉
+        uint32_t overlap = static_cast<uint32_t>(-delta);
+        if (overlap < info.length) {
+            deliver(index, direction, &chunk_pool_[static_cast<size_t>(chunk) * CHUNK_SIZE] + overlap,
+                    info.length - overlap, timestamp_us);
+        }
+        half.chunks = info.next;
+        free_chunk(index, chunk);
+    }
+}
+
+// 把乱序段复制进缓冲池，按序号插入缓存链表；超出单连接预算或缓冲池无法腾出空间时返回false
+bool TcpReassembler::buffer(uint32_t index, int direction, uint32_t seq, const uint8_t* data, size_t length,
+                            uint64_t timestamp_us) {
+    HalfStream& half = slots_[index].half[direction];
+    uint32_t* link = &half.chunks;
+    while (*link != NIL && static_cast<int32_t>(chunk_info_[*link].seq - seq) < 0) {
+        link = &chunk_info_[*link].next;
+    }
+    // 与已缓存的段起始序号相同且不更长：重传，不再缓存
+    if (*link != NIL && chunk_info_[*link].seq == seq && chunk_info_[*link].length >= length) {
+        stats_.retransmitted++;
+        return true;
+    }
+
+    size_t count = (length + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    if (!reserve_chunks(index, count, timestamp_us)) {
+        return false;
+    }
+    Connection& entry = slots_[index];
+    if (entry.chunk_count == 0) {
+        entry.buffer_prev = buffer_newest_;
+        entry.buffer_next = NIL;
+        if (buffer_newest_ != NIL) {
+            slots_[buffer_newest_].buffer_next = index;
+        } else {
+            buffer_oldest_ = index;
+        }
+        buffer_newest_ = index;
+    }
+    entry.chunk_count += static_cast<uint32_t>(count);
+
+    // 大于一块的段拆成多块，依次插在link之后，保持链表按序号有序
+    while (length > 0) {
+        size_t piece = length < CHUNK_SIZE ? length : CHUNK_SIZE;
+        uint32_t chunk = free_chunks_.back();
+        free_chunks_.pop_back();
+        memcpy(&chunk_pool_[static_cast<size_t>(chunk) * CHUNK_SIZE], data, piece);
+        Chunk& info = chunk_info_[chunk];
+        info.seq = seq;
+        info.length = static_cast<uint16_t>(piece);
+        info.next = *link;
+        *link = chunk;
+        link = &info.next;
+        seq += static_cast<uint32_t>(piece);
+        data += piece;
+        length -= piece;
+    }
+    stats_.out_of_order++;
+    return true;
+}
+
+// 为连接预留count块：超出单连接预算时返回false；缓冲池不足时从最早开始缓存的其他连接
+// 依次强制交付，直到腾出足够的块
+bool TcpReassembler::reserve_chunks(uint32_t index, size_t count, uint64_t timestamp_us) {
+    if (slots_[index].chunk_count + count > connection_chunks_) {
+        return false;
+    }
+    while (free_chunks_.size() < count) {
+        uint32_t victim = buffer_oldest_;
+        if (victim == index) {
+            victim = slots_[victim].buffer_next;
+        }
+        if (victim == NIL) {
+            return false;
+        }
+        stats_.overflows++;
+        drain(victim, 0, true, timestamp_us);
+        drain(victim, 1, true, timestamp_us);
+        check_fin(victim, 0);
+        if (slots_[victim].in_use) {
+            check_fin(victim, 1);
+        }
+    }
+    return true;
+}
+
+void TcpReassembler::free_chunk(uint32_t index, uint32_t chunk) {
+    free_chunks_.push_back(chunk);
+    Connection& entry = slots_[index];
+    if (--entry.chunk_count > 0) {
+        return;
+    }
+    if (entry.buffer_prev != NIL) {
+        slots_[entry.buffer_prev].buffer_next = entry.buffer_next;
+    } else {
+        buffer_oldest_ = entry.buffer_next;
+    }
+    if (entry.buffer_next != NIL) {
+        slots_[entry.buffer_next].buffer_prev = entry.buffer_prev;
+    } else {
+        buffer_newest_ = entry.buffer_prev;
+    }
+    entry.buffer_prev = NIL;
+    entry.buffer_next = NIL;
+}
+
+// FIN之前的数据全部交付后关闭该方向，两个方向都关闭时结束连接
+void TcpReassembler::check_fin(uint32_t index, int direction) {
+    Connection& entry = slots_[index];
+    HalfStream& half = entry.half[direction];
+    if (half.fin && !half.closed && half.next_seq == half.fin_seq) {
+        half.closed = true;
+    }
+    if (entry.half[0].closed && entry.half[1].closed) {
+        close(index, TCP_CLOSE_FIN, entry.last_us);
+    }
+}
+
+void TcpReassembler::emit(TcpStreamEvent& event, const Connection& entry) const {
+    event.stream_id = entry.id;
+    event.client_addr = entry.client_addr;
+    event.server_addr = entry.server_addr;
+    event.client_port = entry.client_port;
+    event.server_port = entry.server_port;
+    for (size_t i = 0; i < consumer_count_; ++i) {
+        consumers_[i](event, consumer_contexts_[i]);
+    }
+}
@@ -0,0 +1,211 @@
+// tcp_reassembler.h - TCP流重组（预分配缓冲池，单连接与全局内存均有上限）
+#ifndef TCP_REASSEMBLER_H
+#define TCP_REASSEMBLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "packet_decode.h"
+
+// 流重组统计（每个处理线程一份，报告时合并）
+struct TcpStreamStats {
+    uint64_t segments;         // 送入重组的TCP段数
+    uint64_t connections;      // 开始跟踪的连接数
+    uint64_t midstream;        // 其中未见到握手、从中途开始跟踪的连接数
+    uint64_t closed;           // 双向FIN正常结束的连接数
+    uint64_t resets;           // RST结束的连接数
+    uint64_t timed_out;        // 空闲超时的连接数
+    uint64_t evicted;          // 因连接槽位不足被淘汰的连接数
+    uint64_t delivered_bytes;  // 交给消费者的连续字节数
+    uint64_t out_of_order;     // 乱序到达、先放入缓冲池的段数
+    uint64_t retransmitted;    // 数据已交付或已缓存的重传段数
+    uint64_t overflows;        // 超出单连接或全局内存预算、强制交付缓存数据的次数
+    uint64_t gaps;             // 强制交付或连接结束时跳过的空洞数
+    uint64_t gap_bytes;        // 跳过的字节数
+    uint64_t truncated;        // 因捕获长度不足而忽略的段数
+    uint64_t ignored;          // 半连接已关闭后或序号超出窗口的段数
+
+    TcpStreamStats() { reset(); }
+
+    void reset() {
+        memset(this, 0, sizeof(*this));
+    }
+
+    void merge(const TcpStreamStats& other) {
+        segments += other.segments;
+        connections += other.connections;
+        midstream += other.midstream;
+        closed += other.closed;
+        resets += other.resets;
+        timed_out += other.timed_out;
+        evicted += other.evicted;
+        delivered_bytes += other.delivered_bytes;
+        out_of_order += other.out_of_order;
+        retransmitted += other.retransmitted;
+        overflows += other.overflows;
+        gaps += other.gaps;
+        gap_bytes += other.gap_bytes;
+        truncated += other.truncated;
+        ignored += other.ignored;
+    }
+};
+
+// 流事件类型
+enum TcpStreamEventType {
+    TCP_STREAM_OPEN,    // 开始跟踪一个连接
+    TCP_STREAM_DATA,    // 一个方向上新的连续字节
+    TCP_STREAM_GAP,     // 一个方向上缺失、被跳过的字节（只有长度，没有数据）
+    TCP_STREAM_CLOSE    // 连接结束，之后不再有该连接的事件
+};
+
+// 连接结束原因
+enum TcpCloseReason {
+    TCP_CLOSE_FIN,       // 双向FIN
+    TCP_CLOSE_RST,       // RST
+    TCP_CLOSE_TIMEOUT,   // 空闲超时
+    TCP_CLOSE_EVICTED,   // 连接槽位不足被淘汰
+    TCP_CLOSE_SHUTDOWN   // 抓包结束
+};
+
+// 交给消费者的事件；地址和端口为主机字节序，客户端是发起SYN的一方（中途跟踪时为先发数据的一方）
+struct TcpStreamEvent {
+    TcpStreamEventType type;
+    uint64_t stream_id;        // 连接编号（每个重组器内从1开始递增）
+    uint32_t client_addr;
+    uint32_t server_addr;
+    uint16_t client_port;
+    uint16_t server_port;
+    uint8_t direction;         // DATA/GAP：0为客户端到服务端，1为服务端到客户端
+    TcpCloseReason reason;     // CLOSE：结束原因
+    const uint8_t* data;       // DATA：字节数据，只在回调期间有效
+    uint32_t length;           // DATA/GAP：字节数
+    uint64_t offset;           // DATA/GAP：在该方向字节流中的偏移（从0开始，含跳过的字节）
+    uint64_t timestamp_us;     // 触发事件的包时间
+};
+
+// 流消费者：在调用add()/expire()/close_all()的线程中同步调用
+typedef void (*TcpStreamConsumer)(const TcpStreamEvent& event, void* context);
+
+// TCP流重组器
+// - 连接按两端（地址, 端口）对称哈希，SYN/SYN-ACK开始跟踪，没有见到握手的数据段从中途开始跟踪；
+//   双向FIN都被确认交付后或收到RST时结束，空闲超时和槽位不足时从最久未活动的连接开始结束
+// - 按序到达的数据直接从包缓冲区交给消费者（零拷贝）；乱序到达的数据复制到定长块组成的
+//   缓冲池，按序号排成链表，空洞被补上后依次交付；重传部分被裁掉，同一数据不会交付两次
+// - 缓冲池在初始化时按全局内存预算一次性分配，每个连接最多占用单连接预算内的块数；
+//   超出单连接预算时强制交付该方向的缓存数据（空洞以GAP事件报告），全局缓冲池用尽时
+//   从最早开始缓存的连接依次强制交付，内存不会随连接数或乱序程度增长
+// 只处理IPv4（与流表的五元组键一致），分片需要先经过FragmentReassembler重组。
+// 非线程安全：每个处理线程使用独立的实例。
+class TcpReassembler {
+public:
+    static const size_t CHUNK_SIZE = 2048;     // 缓冲池块大小
+    static const size_t MAX_CONSUMERS = 8;
+
+    TcpReassembler();
+
+    // 按全局内存预算分配缓冲池，connection_budget_bytes为单连接最多缓存的字节数，
+    // max_connections为同时跟踪的连接数，timeout_sec秒内没有新段的连接被结束
+    bool init(size_t memory_budget_bytes, size_t connection_budget_bytes,
+              size_t max_connections, uint32_t timeout_sec);
+    bool enabled() const { return !slots_.empty(); }
+
+    // 注册消费者，超过MAX_CONSUMERS个时返回false
+    bool add_consumer(TcpStreamConsumer consumer, void* context);
+
+    // 送入一个完整（未分片或已重组）的IPv4 TCP段，并结束timestamp_us时已超时的连接
+    void add(const IPv4HeaderView& ip_view, uint64_t timestamp_us);
+
+    // 结束now_us时已空闲超时的连接
+    void expire(uint64_t now_us);
+
+    // 结束所有连接（抓包结束时调用，事件时间取最后一个段的时间），缓存的数据先交付
+    void close_all();
+
+    const TcpStreamStats& stats() const { return stats_; }
+    size_t active() const { return active_; }
+    size_t memory_bytes() const;
+
+private:
+    static const uint32_t NIL = 0xFFFFFFFFu;
+
+    // 缓存块：按序号排序的单向链表
+    struct Chunk {
+        uint32_t seq;
+        uint16_t length;
+        uint32_t next;
+    };
+
+    // 一个方向的字节流
+    struct HalfStream {
+        uint32_t next_seq;     // 下一个待交付字节的序号
+        uint32_t fin_seq;      // FIN的序号（fin为true时有效）
+        uint64_t offset;       // 已交付和跳过的字节数
+        uint32_t chunks;       // 缓存链表头，NIL为空
+        bool seq_known;        // 已确定初始序号
+        bool fin;              // 已收到FIN
+        bool closed;           // FIN之前的数据已全部交付
+    };
+
+    struct Connection {
+        uint32_t client_addr;
+        uint32_t server_addr;
+        uint16_t client_port;
+        uint16_t server_port;
+        bool in_use;
+        uint32_t hash;
+        uint32_t hash_next;         // 哈希桶链表
+        uint32_t prev;              // 按最近活动时间的链表/空闲链表
+        uint32_t next;
+        uint32_t buffer_prev;       // 持有缓存块的连接链表（按开始缓存的时间）
+        uint32_t buffer_next;
+        uint64_t id;
+        uint64_t last_us;
+        uint32_t chunk_count;       // 两个方向共占用的块数
+        HalfStream half[2];         // 0: 客户端到服务端，1: 服务端到客户端
+    };
+
+    static uint32_t hash_key(uint32_t addr_a, uint16_t port_a, uint32_t addr_b, uint16_t port_b);
+    uint32_t find(uint32_t src_addr, uint16_t src_port, uint32_t dst_addr, uint16_t dst_port,
+                  uint32_t hash, int& direction) const;
+    uint32_t create(uint32_t client_addr, uint16_t client_port, uint32_t server_addr,
+                    uint16_t server_port, uint32_t hash, uint64_t timestamp_us);
+    void touch(uint32_t index, uint64_t timestamp_us);
+    void close(uint32_t index, TcpCloseReason reason, uint64_t timestamp_us);
+    void release(uint32_t index);
+
+    void process(uint32_t index, int direction, uint32_t seq, uint8_t flags,
+                 const uint8_t* data, size_t length, uint64_t timestamp_us);
+    void deliver(uint32_t index, int direction, const uint8_t* data, size_t length, uint64_t timestamp_us);
+    void skip(uint32_t index, int direction, uint32_t length, uint64_t timestamp_us);
+    void drain(uint32_t index, int direction, bool force, uint64_t timestamp_us);
+    bool buffer(uint32_t index, int direction, uint32_t seq, const uint8_t* data, size_t length,
+                uint64_t timestamp_us);
+    bool reserve_chunks(uint32_t index, size_t count, uint64_t timestamp_us);
+    void free_chunk(uint32_t index, uint32_t chunk);
+    void check_fin(uint32_t index, int direction);
+
+    void emit(TcpStreamEvent& event, const Connection& entry) const;
+
+    std::vector<uint8_t> chunk_pool_;     // 缓存数据
+    std::vector<Chunk> chunk_info_;       // 块的序号、长度和链表指针
+    std::vector<uint32_t> free_chunks_;   // 空闲块栈
+    size_t connection_chunks_;            // 单连接最多占用的块数
+    std::vector<Connection> slots_;
+    std::vector<uint32_t> buckets_;       // 哈希桶（链表头）
+    size_t bucket_mask_;
+    uint32_t free_slot_;
+    uint32_t oldest_;                     // 最久未活动的连接
+    uint32_t newest_;
+    uint32_t buffer_oldest_;              // 最早开始缓存的连接
+    uint32_t buffer_newest_;
+    size_t active_;
+    uint64_t next_id_;
+    uint64_t timeout_us_;
+    TcpStreamConsumer consumers_[MAX_CONSUMERS];
+    void* consumer_contexts_[MAX_CONSUMERS];
+    size_t consumer_count_;
+    TcpStreamStats stats_;
+};
+
+#endif // TCP_REASSEMBLER_H
@@ -0,0 +1,347 @@
+// test_dns_parser.cpp - DNS解析的断言测试（压缩指针、循环/前向/越界指针、截断、超长名字、UDP统计）
+// 编译运行: make -f Makefile.test check
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "dns_parser.h"
+#include "dns_stats.h"
+#include "test_util.h"
+
+namespace {
+// 按线上格式逐段拼出DNS报文
+struct Message {
+    std::vector<uint8_t> bytes;
+
+    // 12字节首部
+    Message(uint16_t flags, uint16_t questions, uint16_t answers) {
+        u16(0x1234);
+        u16(flags);
+        u16(questions);
+        u16(answers);
+        u16(0);
+        u16(0);
+    }
+
+    size_t size() const { return bytes.size(); }
+
+    void u8(uint8_t value) { bytes.push_back(value); }
+
+    void u16(uint16_t value) {
+        u8(static_cast<uint8_t>(value >> 8));
+        u8(static_cast<uint8_t>(value));
+    }
+
+    void u32(uint32_t value) {
+        u16(static_cast<uint16_t>(value >> 16));
+        u16(static_cast<uint16_t>(value));
+    }
+
+    void label(const std::string& text) {
+        u8(static_cast<uint8_t>(text.size()));
+        bytes.insert(bytes.end(), text.begin(), text.end());
+    }
+
+    // 点分名字，以0结尾
+    void name(const std::string& dotted) {
+        size_t start = 0;
+        while (start < dotted.size()) {
+            size_t dot = dotted.find('.', start);
+            if (dot == std::string::npos) {
+                dot = dotted.size();
+            }
+            label(dotted.substr(start, dot - start));
+            start = dot + 1;
+        }
+        u8(0);
+    }
+
+    void pointer(size_t offset) {
+        u16(static_cast<uint16_t>(0xC000 | offset));
+    }
+
+    void question(uint16_t qtype) {
+        u16(qtype);
+        u16(1);
+    }
+
+    // 回答记录的固定部分（名字之后），rdlength之后由调用方写入rdata
+    void record(uint16_t type, uint16_t rdlength) {
+        u16(type);
+        u16(1);
+        u32(300);
+        u16(rdlength);
+    }
+};
+
+bool read_name(const Message& message, size_t& offset, std::string& text) {
+    DnsName name;
+    if (!read_dns_name(message.bytes.data(), message.size(), offset, name)) {
+        return false;
+    }
+    text.assign(name.text, name.length);
+    return true;
+}
+
+// 普通名字：转小写、标签内的'.'和不可打印字符替换为'?'，根域名为"."
+void test_plain_names() {
+    std::printf("名字文本\n");
+    Message m(0, 1, 0);
+    size_t first = m.size();
+    m.name("WWW.Example.COM");
+    size_t second = m.size();
+    m.label("a.b");
+    m.label(std::string("x y\x01", 4));
+    m.u8(0);
+    size_t root = m.size();
+    m.u8(0);
+
+    std::string text;
+    size_t offset = first;
+    CHECK(read_name(m, offset, text) && text == "www.example.com" && offset == second);
+    CHECK(read_name(m, offset, text) && text == "a?b.x?y?" && offset == root);
+    CHECK(read_name(m, offset, text) && text == "." && offset == m.size());
+}
+
+// 压缩指针：跟随到之前的名字，offset停在第一个指针之后；指针可以连续跟随
+void test_compression() {
+    std::printf("压缩指针\n");
+    Message m(0x8180, 1, 2);
+    size_t qname = m.size();
+    m.name("www.example.com");
+    m.question(DNS_TYPE_CNAME);
+    // 回答1：名字为指向问题的指针，CNAME目标为"cdn" + 指向"example.com"的指针
+    m.pointer(qname);
+    m.record(DNS_TYPE_CNAME, 6);
+    size_t target = m.size();
+    m.label("cdn");
+    m.pointer(qname + 4);
+    // 回答2：名字为指向CNAME目标的指针（指针链），A记录
+    size_t second = m.size();
+    m.pointer(target);
+    m.record(DNS_TYPE_A, 4);
+    m.u32(0x5DB8D822);
+
+    std::string text;
+    size_t offset = target;
+    CHECK(read_name(m, offset, text) && text == "cdn.example.com" && offset == second);
+    offset = second;
+    CHECK(read_name(m, offset, text) && text == "cdn.example.com" && offset == second + 2);
+
+    DnsMessage message;
+    CHECK(parse_dns_message(m.bytes.data(), m.size(), message));
+    CHECK(message.is_response() && message.rcode() == 0);
+    CHECK(message.questions_parsed == 1 && std::string(message.questions[0].name.text) == "www.example.com");
+    CHECK(message.answers_parsed == 2 && message.complete);
+    CHECK(std::string(message.answers[0].name.text) == "www.example.com");
+    CHECK(message.answers[0].type == DNS_TYPE_CNAME &&
+          std::string(message.answers[0].target.text) == "cdn.example.com");
+    CHECK(message.answers[1].type == DNS_TYPE_A && message.answers[1].address[0] == 0x5D &&
+          message.answers[1].address[3] == 0x22);
+}
+
+// 指向自身或构成循环的指针、前向指针、指向首部或越界的指针都被拒绝
+void test_bad_pointers() {
+    std::printf("循环/前向/越界指针\n");
+    std::string text;
+    size_t offset;
+
+    Message self(0, 1, 0);
+    self.pointer(DNS_HEADER_LEN);              // 指向自身
+    offset = DNS_HEADER_LEN;
+    CHECK(!read_name(self, offset, text));
+
+    Message loop(0, 1, 0);
+    loop.label("a");
+    loop.pointer(DNS_HEADER_LEN);              // "a" + 指回名字开头
+    offset = DNS_HEADER_LEN;
+    CHECK(!read_name(loop, offset, text));
+
+    // 两个名字互相指向：第二个名字指向第一个，第一个的指针指向第二个（前向）
+    Message mutual(0, 2, 0);
+    mutual.label("a");
+    mutual.pointer(DNS_HEADER_LEN + 4);
+    size_t second = mutual.size();
+    mutual.label("b");
+    mutual.pointer(DNS_HEADER_LEN);
+    offset = DNS_HEADER_LEN;
+    CHECK(!read_name(mutual, offset, text));
+    offset = second;
+    CHECK(!read_name(mutual, offset, text));
+
+    Message header(0, 1, 0);
+    header.pointer(4);                         // 指向首部
+    offset = DNS_HEADER_LEN;
+    CHECK(!read_name(header, offset, text));
+
+    Message beyond(0, 1, 0);
+    beyond.pointer(0x3FFF);                    // 越界
+    offset = DNS_HEADER_LEN;
+    CHECK(!read_name(beyond, offset, text));
+
+    Message cut(0, 1, 0);
+    cut.u8(0xC0);                              // 指针只有1字节
+    offset = DNS_HEADER_LEN;
+    CHECK(!read_name(cut, offset, text));
+
+    Message reserved(0, 1, 0);
+    reserved.u8(0x41);                         // 保留的标签类型
+    reserved.u8(0);
+    offset = DNS_HEADER_LEN;
+    CHECK(!read_name(reserved, offset, text));
+
+    DnsMessage message;
+    CHECK(!parse_dns_message(loop.bytes.data(), loop.size(), message));
+}
+
+// 标签或名字结尾超出报文、名字超过255字节
+void test_truncated_and_long() {
+    std::printf("截断的标签与超长名字\n");
+    std::string text;
+    size_t offset;
+
+    Message truncated(0, 1, 0);
+    truncated.u8(10);                          // 标签声明10字节，只有3字节
+    truncated.u8('a');
+    truncated.u8('b');
+    truncated.u8('c');
+    offset = DNS_HEADER_LEN;
+    CHECK(!read_name(truncated, offset, text));
+
+    Message unterminated(0, 1, 0);
+    unterminated.label("abc");                 // 缺少结尾的0
+    offset = DNS_HEADER_LEN;
+    CHECK(!read_name(unterminated, offset, text));
+
+    // 3个63字节标签 + 1个61字节标签：线上长度正好255
+    std::string label63(63, 'x');
+    Message longest(0, 1, 0);
+    longest.label(label63);
+    longest.label(label63);
+    longest.label(label63);
+    longest.label(std::string(61, 'y'));
+    longest.u8(0);
+    offset = DNS_HEADER_LEN;
+    CHECK(read_name(longest, offset, text) && text.size() == 253 && offset == longest.size());
+
+    Message too_long(0, 1, 0);
+    too_long.label(label63);
+    too_long.label(label63);
+    too_long.label(label63);
+    too_long.label(std::string(62, 'y'));      // 256字节
+    too_long.u8(0);
+    offset = DNS_HEADER_LEN;
+    CHECK(!read_name(too_long, offset, text));
+
+    // 经指针拼接后超过255字节同样拒绝
+    Message joined(0, 2, 0);
+    joined.label(label63);
+    joined.label(label63);
+    joined.u8(0);
+    size_t second = joined.size();
+    joined.label(label63);
+    joined.label(label63);
+    joined.pointer(DNS_HEADER_LEN);
+    offset = second;
+    CHECK(!read_name(joined, offset, text));
+}
+
+// 报文级：首部不足、问题截断时失败；回答截断时成功但不完整
+void test_message_bounds() {
+    std::printf("报文截断\n");
+    DnsMessage message;
+    Message query(0x0100, 1, 0);
+    query.name("example.com");
+    query.question(DNS_TYPE_AAAA);
+    CHECK(parse_dns_message(query.bytes.data(), query.size(), message));
+    CHECK(!message.is_response() && message.questions[0].qtype == DNS_TYPE_AAAA && message.complete);
+    CHECK(!parse_dns_message(query.bytes.data(), DNS_HEADER_LEN - 1, message));
+    CHECK(!parse_dns_message(query.bytes.data(), query.size() - 1, message));   // 缺少qclass
+
+    Message response(0x8183, 1, 2);
+    response.name("example.com");
+    response.question(DNS_TYPE_A);
+    response.pointer(DNS_HEADER_LEN);
+    response.record(DNS_TYPE_A, 4);
+    response.u32(0x01020304);
+    response.pointer(DNS_HEADER_LEN);
+    response.record(DNS_TYPE_A, 4);
+    response.u16(0x0506);                      // rdata只有2字节
+    CHECK(parse_dns_message(response.bytes.data(), response.size(), message));
+    CHECK(message.rcode() == 3 && message.answers_parsed == 1 && !message.complete);
+
+    Message bad_rdata(0x8180, 1, 1);
+    bad_rdata.name("example.com");
+    bad_rdata.question(DNS_TYPE_A);
+    bad_rdata.pointer(DNS_HEADER_LEN);
+    bad_rdata.record(DNS_TYPE_A, 3);           // A记录的rdata必须为4字节
+    bad_rdata.u8(1);
+    bad_rdata.u16(2);
+    CHECK(parse_dns_message(bad_rdata.bytes.data(), bad_rdata.size(), message));
+    CHECK(message.answers_parsed == 0 && !message.complete);
+}
+
+// 构造UDP段（不计算校验和，DnsCounters不校验）
+std::vector<uint8_t> udp_segment(uint16_t src_port, uint16_t dst_port, const Message& payload, size_t padding) {
+    std::vector<uint8_t> segment(8);
+    size_t length = 8 + payload.size();
+    put16(segment, 0, src_port);
+    put16(segment, 2, dst_port);
+    put16(segment, 4, static_cast<uint16_t>(length));
+    segment.insert(segment.end(), payload.bytes.begin(), payload.bytes.end());
+    segment.insert(segment.end(), padding, 0xEE);
+    return segment;
+}
+
+// DnsCounters：按UDP长度去掉以太网填充，只统计查询中的问题，无法解析的计入malformed
+void test_counters() {
+    std::printf("DNS统计\n");
+    DnsCounters dns;
+    CHECK(dns.init(16));
+
+    Message query(0x0100, 1, 0);
+    query.name("Example.com");
+    query.question(DNS_TYPE_A);
+    std::vector<uint8_t> segment = udp_segment(40000, DNS_PORT, query, 6);
+    dns.add_udp(segment.data(), segment.size());
+    dns.add_udp(segment.data(), segment.size());
+
+    Message response(0x8180, 1, 1);
+    response.name("example.com");
+    response.question(DNS_TYPE_A);
+    response.pointer(DNS_HEADER_LEN);
+    response.record(DNS_TYPE_A, 4);
+    response.u32(0x01020304);
+    segment = udp_segment(DNS_PORT, 40000, response, 0);
+    dns.add_udp(segment.data(), segment.size());
+
+    Message looped(0x0100, 1, 0);
+    looped.pointer(DNS_HEADER_LEN);
+    looped.question(DNS_TYPE_A);
+    segment = udp_segment(40001, DNS_PORT, looped, 0);
+    dns.add_udp(segment.data(), segment.size());
+
+    segment = udp_segment(40000, 5353, query, 0);    // 非53端口不解析
+    dns.add_udp(segment.data(), segment.size());
+
+    const DnsMessageStats& stats = dns.stats();
+    CHECK(stats.messages == 3 && stats.queries == 2 && stats.responses == 1);
+    CHECK(stats.questions == 2 && stats.answers == 1 && stats.rcodes[0] == 1);
+    CHECK(stats.malformed == 1);
+
+    DnsSummary summary;
+    dns.summarize(10, summary);
+    CHECK(summary.queries.size() == 1 && std::string(summary.queries[0].key.name.text) == "example.com" &&
+          summary.queries[0].key.qtype == DNS_TYPE_A && summary.queries[0].count == 2);
+}
+}
+
+int main() {
+    test_plain_names();
+    test_compression();
+    test_bad_pointers();
+    test_truncated_and_long();
+    test_message_bounds();
+    test_counters();
+    return test_result("DNS解析测试");
+}
@@ -0,0 +1,202 @@
+// test_packet_filter.cpp - 用户态过滤器与IPv4分片重组的断言测试
+// 编译运行: make -f Makefile.test check
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "packet_filter.h"
+#include "fragment_reassembler.h"
+#include "test_util.h"
+
+namespace {
+const uint16_t MF = 0x2000;
+const uint16_t DF = 0x4000;
+
+// 传输层首部的前4字节为端口，其余填充
+std::vector<uint8_t> ports_payload(uint16_t src_port, uint16_t dst_port, size_t length) {
+    std::vector<uint8_t> payload(length);
+    for (size_t i = 0; i < length; ++i) {
+        payload[i] = static_cast<uint8_t>(i * 7 + 1);
+    }
+    put16(payload, 0, src_port);
+    put16(payload, 2, dst_port);
+    return payload;
+}
+
+// 视图引用bytes，复制后须重新解码，因此每次使用时生成
+struct Packet {
+    std::vector<uint8_t> bytes;
+
+    explicit Packet(const std::vector<uint8_t>& data) : bytes(data) {}
+
+    IPv4HeaderView view() const {
+        IPv4HeaderView ip_view;
+        ip_view.decode(bytes.data(), bytes.size());
+        return ip_view;
+    }
+};
+
+Packet tcp(uint32_t src, uint16_t src_port, uint32_t dst, uint16_t dst_port, uint8_t ttl = 64) {
+    return Packet(make_ipv4(src, dst, IPPROTO_TCP, ttl, 1, DF, ports_payload(src_port, dst_port, 20)));
+}
+
+Packet udp(uint32_t src, uint16_t src_port, uint32_t dst, uint16_t dst_port, uint8_t ttl = 64) {
+    return Packet(make_ipv4(src, dst, IPPROTO_UDP, ttl, 1, 0, ports_payload(src_port, dst_port, 8)));
+}
+
+bool matches(const char* expression, const Packet& packet) {
+    PacketFilter filter;
+    if (!filter.compile(expression)) {
+        std::printf("  编译失败 \"%s\": %s\n", expression, filter.error().c_str());
+        test_failures++;
+        return false;
+    }
+    return filter.match(packet.view());
+}
+
+// 地址、协议、端口与短路求值
+void test_filter_basic() {
+    std::printf("过滤器：地址/协议/端口\n");
+    const char* expression = "src net 10.0.0.0/8 and tcp and not port 22";
+    CHECK(matches(expression, tcp(0x0A010203, 40000, 0x01010101, 80)));
+    CHECK(!matches(expression, tcp(0x0A010203, 40000, 0x01010101, 22)));
+    CHECK(!matches(expression, tcp(0x0B010203, 40000, 0x01010101, 80)));
+    CHECK(!matches(expression, udp(0x0A010203, 40000, 0x01010101, 80)));
+
+    CHECK(matches("host 192.168.1.1", udp(0x01010101, 53, 0xC0A80101, 40000)));
+    CHECK(!matches("src host 192.168.1.1", udp(0x01010101, 53, 0xC0A80101, 40000)));
+    CHECK(matches("dst port 53 or src port 53", udp(0x01010101, 53, 0xC0A80101, 40000)));
+    CHECK(matches("(udp or icmp) and ttl < 5", udp(1, 1, 2, 2, 4)));
+    CHECK(!matches("(udp or icmp) and ttl < 5", udp(1, 1, 2, 2, 5)));
+    CHECK(matches("len >= 40 and len < 41", tcp(1, 1, 2, 2)));
+    CHECK(matches("proto 6 and df and not frag", tcp(1, 1, 2, 2)));
+    CHECK(!matches("! (tcp || udp)", tcp(1, 1, 2, 2)));
+}
+
+// 语法或取值错误时编译失败并给出错误信息
+void test_filter_errors() {
+    std::printf("过滤器：编译错误\n");
+    const char* invalid[] = {
+        "port 70000", "src net 10.0.0.0/33", "tcp and", "(tcp", "host 1.2.3", "ttl < 256", "proto foo", "bogus",
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+        PacketFilter filter;
+        bool compiled = filter.compile(invalid[i]);
+        CHECK(!compiled && !filter.error().empty());
+        if (compiled) {
+            std::printf("  \"%s\" 不应编译成功\n", invalid[i]);
+        }
+    }
+}
+
+// 分片：非首片没有端口；端口条件可以用重组出的数据报判定
+void test_filter_fragments() {
+    std::printf("过滤器：分片\n");
+    Packet first(make_ipv4(1, 2, IPPROTO_UDP, 64, 7, MF, ports_payload(40000, 53, 16)));
+    Packet middle(make_ipv4(1, 2, IPPROTO_UDP, 64, 7, MF | 2, std::vector<uint8_t>(16, 0)));
+    Packet last(make_ipv4(1, 2, IPPROTO_UDP, 64, 7, 4, std::vector<uint8_t>(8, 0)));
+    CHECK(matches("frag and mf and port 53", first));
+    CHECK(matches("frag and mf", middle) && !matches("port 53", middle));
+    CHECK(matches("frag and not mf", last) && !matches("df", last));
+
+    PacketFilter filter;
+    CHECK(filter.compile("udp and dst port 53"));
+    CHECK(filter.match(middle.view(), first.view()));
+}
+
+// 按偏移乱序送入分片（重复的分片忽略），返回是否收齐
+bool reassemble(FragmentReassembler& reassembler, const std::vector<Packet>& fragments,
+                std::vector<uint8_t>& output) {
+    IPv4HeaderView datagram;
+    for (size_t i = 0; i < fragments.size(); ++i) {
+        if (reassembler.add(fragments[i].view(), 1000000, datagram)) {
+            output.assign(datagram.data(), datagram.data() + datagram.total_length());
+            return true;
+        }
+    }
+    return false;
+}
+
+// 把一个UDP数据报按每片fragment_size字节切成分片
+std::vector<Packet> split(const std::vector<uint8_t>& payload, size_t fragment_size, uint16_t identification) {
+    std::vector<Packet> fragments;
+    for (size_t start = 0; start < payload.size(); start += fragment_size) {
+        size_t end = std::min(start + fragment_size, payload.size());
+        uint16_t flags = static_cast<uint16_t>((end < payload.size() ? MF : 0) | (start / 8));
+        std::vector<uint8_t> part(payload.begin() + start, payload.begin() + end);
+        fragments.push_back(Packet(make_ipv4(0x0A000001, 0x0A000002, IPPROTO_UDP, 64, identification, flags, part)));
+    }
+    return fragments;
+}
+
+// 乱序、重复的分片收齐后得到与原数据报一致的载荷，首部的分片标志清除、总长度和校验和更新
+void test_reassembly() {
+    std::printf("分片重组：乱序与重复\n");
+    FragmentReassembler reassembler;
+    CHECK(reassembler.init(1 << 20, 30));
+    std::vector<uint8_t> payload = ports_payload(40000, 53, 3000);
+    std::vector<Packet> fragments = split(payload, 1480, 9);
+    CHECK(fragments.size() == 3);
+    std::vector<Packet> shuffled;
+    shuffled.push_back(fragments[2]);
+    shuffled.push_back(fragments[1]);
+    shuffled.push_back(fragments[1]);
+    shuffled.push_back(fragments[0]);
+
+    std::vector<uint8_t> output;
+    CHECK(reassemble(reassembler, shuffled, output));
+    IPv4HeaderView datagram;
+    CHECK(datagram.decode(output.data(), output.size()));
+    CHECK(datagram.total_length() == 20 + payload.size());
+    CHECK(!datagram.is_fragment() && ipv4_header_checksum_ok(datagram));
+    CHECK(std::vector<uint8_t>(datagram.payload(), datagram.payload() + datagram.payload_length()) == payload);
+    CHECK(reassembler.stats().reassembled == 1 && reassembler.stats().duplicates == 1);
+    CHECK(reassembler.pending() == 0);
+}
+
+// 部分重叠的分片使整个数据报被丢弃；长度不合法的分片计入invalid
+void test_reassembly_rejects() {
+    std::printf("分片重组：重叠与非法分片\n");
+    FragmentReassembler reassembler;
+    CHECK(reassembler.init(1 << 20, 30));
+    IPv4HeaderView datagram;
+
+    Packet first(make_ipv4(1, 2, IPPROTO_UDP, 64, 3, MF, std::vector<uint8_t>(16, 1)));
+    Packet overlap(make_ipv4(1, 2, IPPROTO_UDP, 64, 3, 1, std::vector<uint8_t>(16, 2)));   // 偏移8，与首片重叠
+    CHECK(!reassembler.add(first.view(), 1000000, datagram));
+    CHECK(!reassembler.add(overlap.view(), 1000000, datagram));
+    CHECK(reassembler.stats().overlaps == 1 && reassembler.pending() == 0);
+
+    Packet odd(make_ipv4(1, 2, IPPROTO_UDP, 64, 4, MF, std::vector<uint8_t>(13, 0)));      // 非末片长度不是8的倍数
+    CHECK(!reassembler.add(odd.view(), 1000000, datagram));
+    Packet huge(make_ipv4(1, 2, IPPROTO_UDP, 64, 5, 0x1FFF, std::vector<uint8_t>(64, 0))); // 超过65535字节
+    CHECK(!reassembler.add(huge.view(), 1000000, datagram));
+    CHECK(reassembler.stats().invalid == 2 && reassembler.pending() == 0);
+}
+
+// 超时未收齐的数据报被丢弃，之后到达的分片重新开始
+void test_reassembly_timeout() {
+    std::printf("分片重组：超时\n");
+    FragmentReassembler reassembler;
+    CHECK(reassembler.init(1 << 20, 30));
+    std::vector<Packet> fragments = split(ports_payload(40000, 53, 100), 64, 11);
+    IPv4HeaderView datagram;
+    CHECK(!reassembler.add(fragments[0].view(), 1000000, datagram));
+    CHECK(reassembler.pending() == 1);
+    reassembler.expire(40 * 1000000ull);
+    CHECK(reassembler.pending() == 0 && reassembler.stats().timed_out == 1);
+    CHECK(!reassembler.add(fragments[1].view(), 41 * 1000000ull, datagram));
+    CHECK(reassembler.pending() == 1 && reassembler.stats().reassembled == 0);
+}
+}
+
+int main() {
+    test_filter_basic();
+    test_filter_errors();
+    test_filter_fragments();
+    test_reassembly();
+    test_reassembly_rejects();
+    test_reassembly_timeout();
+    return test_result("过滤器与分片重组测试");
+}
@@ -0,0 +1,298 @@
+// test_tcp_reassembler.cpp - TCP流重组的断言测试（乱序、重叠、单连接/全局预算、空闲超时、DNS-over-TCP）
+// 编译运行: make -f Makefile.test check
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "tcp_reassembler.h"
+#include "dns_stats.h"
+#include "test_util.h"
+
+namespace {
+const uint8_t FIN = 0x01;
+const uint8_t SYN = 0x02;
+const uint8_t RST = 0x04;
+const uint8_t ACK = 0x10;
+
+const uint32_t CLIENT = 0x0A000001;   // 10.0.0.1
+const uint32_t SERVER = 0x0A000002;   // 10.0.0.2
+
+// 构造一个IPv4 TCP段（不计算TCP校验和，重组器不校验）
+std::vector<uint8_t> make_segment(uint32_t src, uint16_t src_port, uint32_t dst, uint16_t dst_port,
+                                  uint32_t seq, uint8_t flags, const std::string& payload) {
+    std::vector<uint8_t> segment(20 + payload.size(), 0);
+    put16(segment, 0, src_port);
+    put16(segment, 2, dst_port);
+    put32(segment, 4, seq);
+    segment[12] = 5 << 4;
+    segment[13] = flags;
+    put16(segment, 14, 65535);
+    for (size_t i = 0; i < payload.size(); ++i) {
+        segment[20 + i] = static_cast<uint8_t>(payload[i]);
+    }
+    return make_ipv4(src, dst, IPPROTO_TCP, 64, 0, 0x4000, segment);
+}
+
+// 记录消费者收到的事件
+struct Recorder {
+    std::string data[2];        // 每个方向交付的字节
+    uint64_t gap_bytes[2] = {0, 0};
+    unsigned opens = 0;
+    unsigned closes = 0;
+    TcpCloseReason last_reason = TCP_CLOSE_SHUTDOWN;
+    bool offsets_ok = true;     // DATA/GAP的偏移与已收到的字节数连续
+
+    static void consume(const TcpStreamEvent& event, void* context) {
+        Recorder& r = *static_cast<Recorder*>(context);
+        switch (event.type) {
+            case TCP_STREAM_OPEN:
+                r.opens++;
+                break;
+            case TCP_STREAM_DATA:
+                if (event.offset != r.data[event.direction].size() + r.gap_bytes[event.direction]) {
+                    r.offsets_ok = false;
+                }
+                r.data[event.direction].append(reinterpret_cast<const char*>(event.data), event.length);
+                break;
+            case TCP_STREAM_GAP:
+                if (event.offset != r.data[event.direction].size() + r.gap_bytes[event.direction]) {
+                    r.offsets_ok = false;
+                }
+                r.gap_bytes[event.direction] += event.length;
+                break;
+            case TCP_STREAM_CLOSE:
+                r.closes++;
+                r.last_reason = event.reason;
+                break;
+        }
+    }
+};
+
+// 送入一个段，时间戳为秒
+void feed(TcpReassembler& streams, const std::vector<uint8_t>& packet, uint64_t second = 1) {
+    IPv4HeaderView view;
+    if (view.decode(packet.data(), packet.size())) {
+        streams.add(view, second * 1000000);
+    }
+}
+
+void client_segment(TcpReassembler& streams, uint32_t seq, uint8_t flags, const std::string& payload,
+                    uint16_t client_port = 40000, uint64_t second = 1) {
+    feed(streams, make_segment(CLIENT, client_port, SERVER, 80, seq, flags, payload), second);
+}
+
+void server_segment(TcpReassembler& streams, uint32_t seq, uint8_t flags, const std::string& payload,
+                    uint16_t client_port = 40000, uint64_t second = 1) {
+    feed(streams, make_segment(SERVER, 80, CLIENT, client_port, seq, flags, payload), second);
+}
+
+bool init_streams(TcpReassembler& streams, Recorder& recorder, size_t memory, size_t per_connection) {
+    return streams.init(memory, per_connection, 16, 30) && streams.add_consumer(Recorder::consume, &recorder);
+}
+
+// 握手、按序数据、双向FIN
+void test_in_order() {
+    std::printf("按序交付与FIN结束\n");
+    TcpReassembler streams;
+    Recorder r;
+    CHECK(init_streams(streams, r, 1 << 20, 64 * 1024));
+    client_segment(streams, 1000, SYN, "");
+    server_segment(streams, 5000, SYN | ACK, "");
+    client_segment(streams, 1001, ACK, "GET / HTTP/1.0\r\n\r\n");
+    server_segment(streams, 5001, ACK, "HTTP/1.0 200 OK\r\n");
+    client_segment(streams, 1019, FIN | ACK, "");
+    server_segment(streams, 5018, FIN | ACK, "");
+    CHECK(r.opens == 1);
+    CHECK(r.data[0] == "GET / HTTP/1.0\r\n\r\n");
+    CHECK(r.data[1] == "HTTP/1.0 200 OK\r\n");
+    CHECK(r.closes == 1 && r.last_reason == TCP_CLOSE_FIN);
+    CHECK(streams.active() == 0);
+    CHECK(streams.stats().closed == 1 && streams.stats().out_of_order == 0);
+    CHECK(r.offsets_ok);
+}
+
+// 乱序到达的段缓存后按序交付
+void test_out_of_order() {
+    std::printf("乱序段\n");
+    TcpReassembler streams;
+    Recorder r;
+    CHECK(init_streams(streams, r, 1 << 20, 64 * 1024));
+    client_segment(streams, 100, SYN, "");
+    client_segment(streams, 109, ACK, "world");
+    client_segment(streams, 106, ACK, "lo ");
+    CHECK(r.data[0].empty());
+    client_segment(streams, 101, ACK, "hello");
+    CHECK(r.data[0] == "hellolo world");
+    CHECK(streams.stats().out_of_order == 2);
+    CHECK(streams.stats().gaps == 0);
+    CHECK(r.offsets_ok);
+}
+
+// 重叠与重传：同一字节只交付一次，以先到的数据为准
+void test_overlap() {
+    std::printf("重叠段与重传\n");
+    TcpReassembler streams;
+    Recorder r;
+    CHECK(init_streams(streams, r, 1 << 20, 64 * 1024));
+    client_segment(streams, 0, SYN, "");
+    client_segment(streams, 1, ACK, "abcdef");
+    client_segment(streams, 4, ACK, "DEFGHI");        // 前3字节与已交付数据重叠
+    CHECK(r.data[0] == "abcdefGHI");
+    client_segment(streams, 1, ACK, "abc");           // 完全重传
+    CHECK(streams.stats().retransmitted == 1);
+    client_segment(streams, 16, ACK, "pqrs");         // 两个互相重叠的乱序段
+    client_segment(streams, 13, ACK, "mnopq");
+    client_segment(streams, 10, ACK, "jkl");
+    CHECK(r.data[0] == "abcdefGHIjklmnopqrs");
+    client_segment(streams, 12, ACK, "LMNOPQRSTU");   // 与已交付数据部分重叠，只交付新的部分
+    CHECK(r.data[0] == "abcdefGHIjklmnopqrsTU");
+    CHECK(streams.stats().gaps == 0);
+    CHECK(r.offsets_ok);
+}
+
+// 单连接预算：缓存超出时强制交付，缺失的字节以GAP报告
+void test_connection_budget() {
+    std::printf("单连接内存预算\n");
+    TcpReassembler streams;
+    Recorder r;
+    CHECK(init_streams(streams, r, 1 << 20, TcpReassembler::CHUNK_SIZE));
+    client_segment(streams, 0, SYN, "");
+    std::string block(TcpReassembler::CHUNK_SIZE, 'x');
+    client_segment(streams, 101, ACK, block);          // 缓存1块，已达单连接上限
+    CHECK(r.data[0].empty() && streams.stats().out_of_order == 1);
+    client_segment(streams, 101 + 3000, ACK, "tail");  // 超出预算：缓存数据强制交付
+    CHECK(streams.stats().overflows == 1);
+    CHECK(r.gap_bytes[0] == 100 + (3000 - TcpReassembler::CHUNK_SIZE));
+    CHECK(r.data[0] == block + "tail");
+    CHECK(streams.stats().gaps == 2);
+    client_segment(streams, 1, ACK, "late");           // 已被跳过的数据不再交付
+    CHECK(r.data[0] == block + "tail");
+    CHECK(r.offsets_ok);
+}
+
+// 全局预算：缓冲池用尽时从最早开始缓存的其他连接强制交付
+void test_global_budget() {
+    std::printf("全局内存预算\n");
+    TcpReassembler streams;
+    Recorder r;
+    // 恰好两块的缓冲池
+    size_t two_chunks = 2 * (TcpReassembler::CHUNK_SIZE + 16);
+    CHECK(init_streams(streams, r, two_chunks, 64 * 1024));
+    client_segment(streams, 0, SYN, "", 40001);
+    client_segment(streams, 0, SYN, "", 40002);
+    client_segment(streams, 0, SYN, "", 40003);
+    client_segment(streams, 11, ACK, "first", 40001);   // 连接1缓存1块
+    client_segment(streams, 11, ACK, "second", 40002);  // 连接2缓存1块，缓冲池已满
+    CHECK(r.data[0].empty());
+    client_segment(streams, 11, ACK, "third", 40003);   // 连接3需要1块：最早缓存的连接1被强制交付
+    CHECK(streams.stats().overflows == 1);
+    CHECK(r.data[0] == "first");
+    CHECK(r.gap_bytes[0] == 10);
+    CHECK(streams.stats().out_of_order == 3);
+    streams.close_all();                                 // 其余连接结束时交付缓存
+    CHECK(r.data[0] == "firstsecondthird");
+    CHECK(r.closes == 3 && streams.active() == 0);
+}
+
+// 空闲超时：不再有新段时由expire()结束连接并交付缓存的数据
+void test_expire() {
+    std::printf("空闲超时\n");
+    TcpReassembler streams;
+    Recorder r;
+    CHECK(init_streams(streams, r, 1 << 20, 64 * 1024));
+    client_segment(streams, 0, SYN, "", 40000, 100);
+    client_segment(streams, 6, ACK, "later", 40000, 100);
+    streams.expire(120 * 1000000ULL);
+    CHECK(streams.active() == 1);
+    streams.expire(131 * 1000000ULL);
+    CHECK(streams.active() == 0);
+    CHECK(r.closes == 1 && r.last_reason == TCP_CLOSE_TIMEOUT);
+    CHECK(r.data[0] == "later" && r.gap_bytes[0] == 5);
+    CHECK(streams.stats().timed_out == 1);
+}
+
+// RST立即结束连接
+void test_reset() {
+    std::printf("RST\n");
+    TcpReassembler streams;
+    Recorder r;
+    CHECK(init_streams(streams, r, 1 << 20, 64 * 1024));
+    client_segment(streams, 0, SYN, "");
+    server_segment(streams, 0, RST, "");
+    CHECK(r.closes == 1 && r.last_reason == TCP_CLOSE_RST && streams.active() == 0);
+}
+
+// 带2字节长度前缀的DNS查询
+std::string dns_tcp_query(uint16_t id, const char* name) {
+    std::string message;
+    message += static_cast<char>(id >> 8);
+    message += static_cast<char>(id);
+    message += std::string("\x01\x00\x00\x01\x00\x00\x00\x00\x00\x00", 10);
+    const char* label = name;
+    while (*label != '\0') {
+        const char* dot = label;
+        while (*dot != '\0' && *dot != '.') {
+            dot++;
+        }
+        message += static_cast<char>(dot - label);
+        message.append(label, dot - label);
+        label = *dot == '.' ? dot + 1 : dot;
+    }
+    message += std::string("\x00\x00\x01\x00\x01", 5);
+    std::string framed;
+    framed += static_cast<char>(message.size() >> 8);
+    framed += static_cast<char>(message.size());
+    return framed + message;
+}
+
+// DNS-over-TCP消费者：报文跨段拼接、一段多个报文、空洞后停止解析
+void test_dns_over_tcp() {
+    std::printf("DNS-over-TCP\n");
+    TcpReassembler streams;
+    DnsCounters dns;
+    CHECK(streams.init(1 << 20, 64 * 1024, 16, 30));
+    CHECK(dns.init(64));
+    CHECK(dns.enable_tcp(streams));
+
+    std::string first = dns_tcp_query(1, "example.com");
+    std::string second = dns_tcp_query(2, "www.example.org");
+    std::string third = dns_tcp_query(3, "example.com");
+    feed(streams, make_segment(CLIENT, 40000, SERVER, DNS_PORT, 0, SYN, ""));
+    // 第一个报文拆成三段（长度前缀也被拆开），第二、三个报文在同一段中
+    feed(streams, make_segment(CLIENT, 40000, SERVER, DNS_PORT, 1, ACK, first.substr(0, 1)));
+    feed(streams, make_segment(CLIENT, 40000, SERVER, DNS_PORT, 2, ACK, first.substr(1, 10)));
+    feed(streams, make_segment(CLIENT, 40000, SERVER, DNS_PORT, 12, ACK, first.substr(11)));
+    uint32_t seq = 1 + static_cast<uint32_t>(first.size());
+    feed(streams, make_segment(CLIENT, 40000, SERVER, DNS_PORT, seq, ACK, second + third));
+    CHECK(dns.stats().tcp_messages == 3);
+    CHECK(dns.stats().queries == 3 && dns.stats().malformed == 0);
+    DnsSummary summary;
+    dns.summarize(10, summary);
+    CHECK(!summary.queries.empty() && std::string(summary.queries[0].key.name.text) == "example.com" &&
+          summary.queries[0].count == 2);
+
+    // 空洞之后失去报文边界，不再解析
+    seq += static_cast<uint32_t>(second.size() + third.size());
+    feed(streams, make_segment(CLIENT, 40000, SERVER, DNS_PORT, seq + 100, ACK, first));
+    streams.close_all();
+    CHECK(dns.stats().tcp_messages == 3);
+    CHECK(dns.stats().tcp_skipped == 1);
+
+    // 非53端口的连接不解析
+    client_segment(streams, 0, SYN, "");
+    client_segment(streams, 1, ACK, first);
+    CHECK(dns.stats().tcp_messages == 3 && dns.stats().malformed == 0);
+}
+}
+
+int main() {
+    test_in_order();
+    test_out_of_order();
+    test_overlap();
+    test_connection_budget();
+    test_global_budget();
+    test_expire();
+    test_reset();
+    test_dns_over_tcp();
+    return test_result("TCP流重组测试");
+}
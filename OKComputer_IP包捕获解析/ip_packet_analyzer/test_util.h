@@ -0,0 +1,63 @@
+// test_util.h - 断言测试共用的失败计数、CHECK宏和构包函数（每个测试程序只有一个源文件包含）
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <netinet/in.h>
+#include "checksum.h"
+
+// 失败的断言数，main()最后用test_result()汇报
+inline int test_failures = 0;
+
+// 断言失败时打印位置和条件并计数，继续执行后面的断言
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            std::printf("  失败 %s:%d: %s\n", __FILE__, __LINE__, #cond);        \
+            test_failures++;                                                     \
+        }                                                                        \
+    } while (0)
+
+// 打印测试结果，返回进程退出码（有失败时为1）
+inline int test_result(const char* suite) {
+    if (test_failures > 0) {
+        std::printf("%s：%d 项失败\n", suite, test_failures);
+        return 1;
+    }
+    std::printf("%s：全部通过\n", suite);
+    return 0;
+}
+
+// 按网络字节序写入
+inline void put16(std::vector<uint8_t>& out, size_t offset, uint16_t value) {
+    out[offset] = static_cast<uint8_t>(value >> 8);
+    out[offset + 1] = static_cast<uint8_t>(value);
+}
+
+inline void put32(std::vector<uint8_t>& out, size_t offset, uint32_t value) {
+    put16(out, offset, static_cast<uint16_t>(value >> 16));
+    put16(out, offset + 2, static_cast<uint16_t>(value));
+}
+
+// 构造一个IPv4包：20字节首部（首部校验和正确）+ 载荷，flags_fragment为标志位与片偏移的原始字
+inline std::vector<uint8_t> make_ipv4(uint32_t src, uint32_t dst, uint8_t protocol, uint8_t ttl,
+                                      uint16_t identification, uint16_t flags_fragment,
+                                      const std::vector<uint8_t>& payload) {
+    std::vector<uint8_t> packet(20);
+    packet[0] = 0x45;
+    put16(packet, 2, static_cast<uint16_t>(20 + payload.size()));
+    put16(packet, 4, identification);
+    put16(packet, 6, flags_fragment);
+    packet[8] = ttl;
+    packet[9] = protocol;
+    put32(packet, 12, src);
+    put32(packet, 16, dst);
+    put16(packet, 10, internet_checksum(packet.data(), 20));
+    packet.insert(packet.end(), payload.begin(), payload.end());
+    return packet;
+}
+
+#endif // TEST_UTIL_H
@@ -0,0 +1,335 @@
+// traffic_gen.cpp - 合成流量生成器实现
+#include "traffic_gen.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <netinet/in.h>
+#include "checksum.h"
+#include "link_decode.h"
+#include "sample_packets.h"
+
+namespace {
+
+const uint8_t IPPROTO_ICMPV6_NUMBER = 58;
+const uint16_t DEFAULT_TCP_PORTS[] = { 443, 80, 22, 8080 };
+const uint16_t DEFAULT_UDP_PORTS[] = { 53, 123, 443, 5353 };
+const uint8_t TCP_SYN = 0x02;
+const uint8_t TCP_PSH = 0x08;
+const uint8_t TCP_ACK = 0x10;
+
+void store_be16(uint8_t* p, uint16_t value) {
+    p[0] = static_cast<uint8_t>(value >> 8);
+    p[1] = static_cast<uint8_t>(value);
+}
+
+void store_be32(uint8_t* p, uint32_t value) {
+    store_be16(p, static_cast<uint16_t>(value >> 16));
+    store_be16(p + 2, static_cast<uint16_t>(value));
+}
+
+// 传输层校验和字段在首部中的偏移
+size_t checksum_offset(uint8_t protocol) {
+    return protocol == IPPROTO_TCP ? 16 : protocol == IPPROTO_UDP ? 6 : 2;
+}
+
+// IPv6地址：IPv4地址嵌入2001:db8::/96
+void store_ipv6_address(uint8_t* p, uint32_t address) {
+    memset(p, 0, 16);
+    store_be32(p, 0x20010db8);
+    store_be32(p + 12, address);
+}
+
+} // namespace
+
+TrafficConfig::TrafficConfig()
+    : seed(1), flows(4096), talkers(0), zipf_exponent(1.0), vlan_percent(20), ipv6_percent(10),
+      fragment_percent(5), option_percent(10), bad_ip_checksum_percent(0), bad_l4_checksum_percent(0),
+      packets_per_second(100000), start_sec(1700000000) {
+}
+
+TrafficGenerator::TrafficGenerator()
+    : state_(0), pending_length_(0), sequence_(0), step_ns_(0), time_ns_(0) {
+    ts_.tv_sec = 0;
+    ts_.tv_usec = 0;
+    memset(&counters_, 0, sizeof(counters_));
+}
+
+bool TrafficGenerator::init(const TrafficConfig& config) {
+    if (config.flows == 0 || config.flows > 0xFFFFFFFFull || config.talkers > 0xFFFFFEull ||
+        config.zipf_exponent < 0 || config.packets_per_second == 0 ||
+        config.vlan_percent > 100 || config.ipv6_percent > 100 || config.fragment_percent > 100 ||
+        config.option_percent > 100 || config.bad_ip_checksum_percent > 100 ||
+        config.bad_l4_checksum_percent > 100) {
+        return false;
+    }
+    config_ = config;
+    state_ = config.seed != 0 ? config.seed : 0x9E3779B97F4A7C15ULL;
+    pending_length_ = 0;
+    sequence_ = 0;
+    ts_.tv_sec = config.start_sec;
+    ts_.tv_usec = 0;
+    step_ns_ = std::max<uint64_t>(1, 1000000000ULL / config.packets_per_second);
+    time_ns_ = 0;
+    memset(&counters_, 0, sizeof(counters_));
+
+    // 从手写测试包中取传输层首部作为模板（TCP 20字节、UDP 8字节加DNS查询、ICMP 8字节）
+    templates_.clear();
+    templates_protocol_.clear();
+    const uint8_t protocols[] = { IPPROTO_TCP, IPPROTO_UDP, IPPROTO_ICMP };
+    for (uint8_t protocol : protocols) {
+        for (const std::vector<uint8_t>& packet : test_packets) {
+            if (packet[9] != protocol) {
+                continue;
+            }
+            size_t ihl = (packet[0] & 0x0F) * 4;
+            size_t length = protocol == IPPROTO_TCP ? 20 : protocol == IPPROTO_UDP ? packet.size() - ihl : 8;
+            templates_.push_back(std::vector<uint8_t>(packet.begin() + ihl, packet.begin() + ihl + length));
+            templates_protocol_.push_back(protocol);
+            break;
+        }
+    }
+    if (templates_.size() != 3) {
+        return false;
+    }
+
+    // 流表：第i个流的源地址为第(i % talkers)个主机，排名靠前的流集中在少数主机上，
+    // 因此按流排名的Zipf分布同时给出了按主机的重尾分布
+    size_t talkers = config.talkers != 0 ? config.talkers : config.flows;
+    flows_.resize(config.flows);
+    for (size_t i = 0; i < flows_.size(); ++i) {
+        Flow& flow = flows_[i];
+        flow.src_addr = 0x0A000001 + static_cast<uint32_t>(i % talkers);
+        flow.dst_addr = 0xC0A80001 + random_below(0xFFFE);
+        flow.src_port = static_cast<uint16_t>(1024 + random_below(60000));
+        // 协议分布：TCP 60%、UDP 30%、ICMP 10%
+        uint32_t pick = random_below(10);
+        flow.template_index = pick < 6 ? 0 : pick < 9 ? 1 : 2;
+        flow.dst_port = flow.template_index == 0 ? DEFAULT_TCP_PORTS[random_below(4)]
+                      : flow.template_index == 1 ? DEFAULT_UDP_PORTS[random_below(4)] : 0;
+        flow.tcp_ipv6 = chance(config.ipv6_percent);
+        flow.tcp_open = false;
+        flow.tcp_seq = static_cast<uint32_t>(random());
+        flow.tcp_ack = static_cast<uint32_t>(random()) + 1;
+    }
+
+    // Zipf分布：排名r（从1开始）的权重为1/r^s，预先计算累积概率，抽样时二分查找
+    zipf_cdf_.clear();
+    if (config.zipf_exponent > 0) {
+        zipf_cdf_.resize(flows_.size());
+        double total = 0;
+        for (size_t i = 0; i < zipf_cdf_.size(); ++i) {
+            total += 1.0 / std::pow(static_cast<double>(i + 1), config.zipf_exponent);
+            zipf_cdf_[i] = total;
+        }
+        for (size_t i = 0; i < zipf_cdf_.size(); ++i) {
+            zipf_cdf_[i] /= total;
+        }
+    }
+    return true;
+}
+
+// xorshift64*：确定性的伪随机数，同一种子生成同一序列
+uint64_t TrafficGenerator::random() {
+    state_ ^= state_ >> 12;
+    state_ ^= state_ << 25;
+    state_ ^= state_ >> 27;
+    return state_ * 0x2545F4914F6CDD1DULL;
+}
+
+size_t TrafficGenerator::pick_flow() {
+    if (zipf_cdf_.empty()) {
+        return random() % flows_.size();
+    }
+    double u = static_cast<double>(random() >> 11) * (1.0 / 9007199254740992.0);
+    size_t index = std::upper_bound(zipf_cdf_.begin(), zipf_cdf_.end(), u) - zipf_cdf_.begin();
+    return index < flows_.size() ? index : flows_.size() - 1;
+}
+
+void TrafficGenerator::advance_time() {
+    time_ns_ += step_ns_;
+    while (time_ns_ >= 1000000000ULL) {
+        ts_.tv_sec++;
+        time_ns_ -= 1000000000ULL;
+    }
+    ts_.tv_usec = static_cast<suseconds_t>(time_ns_ / 1000);
+}
+
+// 在segment_中构造传输层首部和载荷，校验和字段清零，返回长度；TCP按流推进序列号
+size_t TrafficGenerator::build_segment(Flow& flow) {
+    const std::vector<uint8_t>& header = templates_[flow.template_index];
+    uint8_t protocol = templates_protocol_[flow.template_index];
+    memcpy(segment_, header.data(), header.size());
+    if (protocol == IPPROTO_TCP || protocol == IPPROTO_UDP) {
+        store_be16(segment_, flow.src_port);
+        store_be16(segment_ + 2, flow.dst_port);
+    }
+
+    // 载荷长度：40%只有首部、30%小包、30%接近MTU
+    uint32_t size_class = random_below(10);
+    size_t payload = size_class < 4 ? 0 : size_class < 7 ? random_below(200) : 512 + random_below(948);
+    if (protocol == IPPROTO_TCP) {
+        // 第一个段是SYN（不带载荷，占一个序号），之后的段为ACK，带载荷时加PSH
+        uint8_t flags;
+        if (!flow.tcp_open) {
+            flags = TCP_SYN;
+            payload = 0;
+            flow.tcp_open = true;
+        } else {
+            flags = static_cast<uint8_t>(TCP_ACK | (payload > 0 ? TCP_PSH : 0));
+        }
+        store_be32(segment_ + 4, flow.tcp_seq);
+        store_be32(segment_ + 8, (flags & TCP_ACK) != 0 ? flow.tcp_ack : 0);
+        segment_[13] = flags;
+        flow.tcp_seq += (flags & TCP_SYN) != 0 ? 1 : static_cast<uint32_t>(payload);
+    }
+    size_t length = header.size() + payload;
+    memset(segment_ + header.size(), static_cast<uint8_t>(sequence_), payload);
+    if (protocol == IPPROTO_UDP) {
+        store_be16(segment_ + 4, static_cast<uint16_t>(length));
+    }
+    memset(segment_ + checksum_offset(protocol), 0, 2);
+    return length;
+}
+
+// 写以太网首部（可带VLAN标签），返回网络层首部的偏移
+size_t TrafficGenerator::begin_frame(uint8_t* frame, bool vlan, uint16_t vlan_id, uint16_t ethertype) {
+    static const uint8_t MACS[12] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb };
+    memcpy(frame, MACS, sizeof(MACS));
+    size_t offset = sizeof(MACS);
+    if (vlan) {
+        store_be16(frame + offset, LINK_ETHERTYPE_VLAN);
+        store_be16(frame + offset + 2, vlan_id);
+        offset += 4;
+    }
+    store_be16(frame + offset, ethertype);
+    return offset + 2;
+}
+
+// 构造IPv4包：options_length为选项字节数（4的倍数），flags_fragment为标志位和片偏移，返回包长
+size_t TrafficGenerator::write_ipv4(uint8_t* packet, const Flow& flow, uint8_t protocol, uint16_t flags_fragment,
+                                    size_t options_length, const uint8_t* payload, size_t payload_length,
+                                    bool bad_checksum) {
+    size_t header_length = IPV4_MIN_HEADER_LEN + options_length;
+    memset(packet, 0, header_length);
+    packet[0] = static_cast<uint8_t>(0x40 | (header_length / 4));
+    store_be16(packet + 2, static_cast<uint16_t>(header_length + payload_length));
+    store_be16(packet + 4, static_cast<uint16_t>(sequence_));
+    store_be16(packet + 6, flags_fragment);
+    packet[8] = 64;
+    packet[9] = protocol;
+    store_be32(packet + 12, flow.src_addr);
+    store_be32(packet + 16, flow.dst_addr);
+    // 选项区：NOP填充，最后一个字节为EOL
+    if (options_length > 0) {
+        memset(packet + IPV4_MIN_HEADER_LEN, 1, options_length - 1);
+    }
+    uint16_t checksum = internet_checksum(packet, header_length);
+    if (bad_checksum) {
+        checksum ^= 0x00FF;
+    }
+    memcpy(packet + 10, &checksum, sizeof(checksum));
+    memcpy(packet + header_length, payload, payload_length);
+    return header_length + payload_length;
+}
+
+size_t TrafficGenerator::write_ipv6(uint8_t* packet, const Flow& flow, uint8_t protocol,
+                                    const uint8_t* payload, size_t payload_length) {
+    memset(packet, 0, IPV6_HEADER_LEN);
+    packet[0] = 0x60;
+    store_be16(packet + 4, static_cast<uint16_t>(payload_length));
+    packet[6] = protocol;
+    packet[7] = 64;
+    store_ipv6_address(packet + 8, flow.src_addr);
+    store_ipv6_address(packet + 24, flow.dst_addr);
+    memcpy(packet + IPV6_HEADER_LEN, payload, payload_length);
+    return IPV6_HEADER_LEN + payload_length;
+}
+
+const uint8_t* TrafficGenerator::next(size_t& length, struct timeval& ts) {
+    if (pending_length_ > 0) {
+        length = pending_length_;
+        pending_length_ = 0;
+        ts = ts_;
+        counters_.frames++;
+        counters_.bytes += length;
+        return pending_;
+    }
+
+    advance_time();
+    ts = ts_;
+    size_t flow_index = pick_flow();
+    Flow& flow = flows_[flow_index];
+    uint8_t protocol = templates_protocol_[flow.template_index];
+    size_t segment_length = build_segment(flow);
+
+    bool vlan = chance(config_.vlan_percent);
+    uint16_t vlan_id = static_cast<uint16_t>(1 + flow_index % 4094);
+    bool ipv6 = protocol == IPPROTO_TCP ? flow.tcp_ipv6 : chance(config_.ipv6_percent);
+    bool bad_l4 = chance(config_.bad_l4_checksum_percent);
+    counters_.vlan_frames += vlan ? 1 : 0;
+
+    // 传输层校验和（TCP/UDP/ICMPv6含伪首部），在分片前对完整的数据计算，重组后可以校验
+    uint64_t sum = 0;
+    if (ipv6) {
+        if (protocol == IPPROTO_ICMP) {
+            protocol = IPPROTO_ICMPV6_NUMBER;
+            segment_[0] = segment_[0] == 8 ? 128 : segment_[0] == 0 ? 129 : segment_[0];   // 回显请求/应答
+        }
+        uint8_t addresses[32];
+        store_ipv6_address(addresses, flow.src_addr);
+        store_ipv6_address(addresses + 16, flow.dst_addr);
+        sum = checksum_accumulate(addresses, sizeof(addresses));
+        sum += htons(protocol);
+        sum += htons(static_cast<uint16_t>(segment_length));
+    } else if (protocol == IPPROTO_TCP || protocol == IPPROTO_UDP) {
+        uint8_t addresses[8];
+        store_be32(addresses, flow.src_addr);
+        store_be32(addresses + 4, flow.dst_addr);
+        sum = checksum_accumulate(addresses, sizeof(addresses));
+        sum += htons(protocol);
+        sum += htons(static_cast<uint16_t>(segment_length));
+    }
+    uint16_t checksum = internet_checksum(segment_, segment_length, sum);
+    if (protocol == IPPROTO_UDP && checksum == 0) {
+        checksum = 0xFFFF;   // UDP用全1表示校验和为0，全0表示未计算
+    }
+    if (bad_l4) {
+        // 换成不等价的值（0与0xFFFF在反码和中等价，UDP的0还表示不校验，都要避开）
+        uint16_t bad = checksum ^ 0x00FF;
+        checksum = bad != 0 && bad != 0xFFFF ? bad : static_cast<uint16_t>(checksum ^ 0x0F00);
+        counters_.bad_l4_checksums++;
+    }
+    memcpy(segment_ + checksum_offset(protocol), &checksum, sizeof(checksum));
+
+    size_t offset;
+    if (ipv6) {
+        offset = begin_frame(frame_, vlan, vlan_id, LINK_ETHERTYPE_IPV6);
+        length = offset + write_ipv6(frame_ + offset, flow, protocol, segment_, segment_length);
+        counters_.ipv6_packets++;
+    } else {
+        size_t options = chance(config_.option_percent) ? 4 * (1 + random_below(10)) : 0;
+        bool bad_ip = chance(config_.bad_ip_checksum_percent);
+        counters_.option_packets += options > 0 ? 1 : 0;
+        counters_.bad_ip_checksums += bad_ip ? 1 : 0;
+        offset = begin_frame(frame_, vlan, vlan_id, LINK_ETHERTYPE_IPV4);
+        if (segment_length > 64 && chance(config_.fragment_percent)) {
+            // 分成两片：首片载荷长度取8的倍数，第二片留到下一次调用返回
+            size_t first = (segment_length / 2) & ~static_cast<size_t>(7);
+            length = offset + write_ipv4(frame_ + offset, flow, protocol, 0x2000, options,
+                                         segment_, first, bad_ip);
+            size_t pending_offset = begin_frame(pending_, vlan, vlan_id, LINK_ETHERTYPE_IPV4);
+            pending_length_ = pending_offset + write_ipv4(pending_ + pending_offset, flow, protocol,
+                                                          static_cast<uint16_t>(first / 8), 0,
+                                                          segment_ + first, segment_length - first, false);
+            counters_.fragments += 2;
+            counters_.vlan_frames += vlan ? 1 : 0;
+        } else {
+            length = offset + write_ipv4(frame_ + offset, flow, protocol, 0x4000, options,
+                                         segment_, segment_length, bad_ip);
+        }
+    }
+    sequence_++;
+    counters_.frames++;
+    counters_.bytes += length;
+    return frame_;
+}
@@ -0,0 +1,105 @@
+// traffic_gen.h - 合成流量生成器（pcap生成工具和基准测试共用）
+#ifndef TRAFFIC_GEN_H
+#define TRAFFIC_GEN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <vector>
+#include <sys/time.h>
+
+// 生成参数（比例均为百分比）
+struct TrafficConfig {
+    TrafficConfig();
+
+    uint64_t seed;                  // 随机种子，同一种子和参数生成同一序列
+    size_t flows;                   // 五元组流数
+    size_t talkers;                 // 源地址数（0表示与流数相同）
+    double zipf_exponent;           // 按流排名抽取的Zipf指数，0为均匀分布
+    unsigned vlan_percent;          // 带802.1Q标签的帧
+    unsigned ipv6_percent;          // 封装为IPv6的包（TCP为连接）
+    unsigned fragment_percent;      // 拆成两片的IPv4包（只对载荷超过64字节的包）
+    unsigned option_percent;        // 带IPv4选项的包
+    unsigned bad_ip_checksum_percent; // IPv4首部校验和错误的包
+    unsigned bad_l4_checksum_percent; // TCP/UDP/ICMP校验和错误的包
+    uint64_t packets_per_second;    // 时间戳间隔（每秒包数）
+    time_t start_sec;               // 第一个包的时间戳
+};
+
+// 各类包的计数
+struct TrafficCounters {
+    uint64_t frames;            // 生成的帧数（分片包按两帧计）
+    uint64_t bytes;
+    uint64_t vlan_frames;
+    uint64_t ipv6_packets;
+    uint64_t fragments;
+    uint64_t option_packets;
+    uint64_t bad_ip_checksums;
+    uint64_t bad_l4_checksums;
+};
+
+// 合成流量生成器
+// 以sample_packets.h中的手写包为模板取TCP/UDP/ICMP首部，流按Zipf分布抽取，
+// 载荷长度分三档（只有首部/小包/接近MTU）。TCP流的第一个段为不带载荷的SYN，
+// 之后为ACK/PSH，序列号从每个流的随机ISN开始按载荷长度递增。每次next()生成一帧以太网帧，
+// 分片包的第二片在下一次调用时返回。帧缓冲区和流表在init()时分配，生成过程中不再分配内存，
+// 因此可以流式生成上百万个包而不占用与包数成比例的内存。
+class TrafficGenerator {
+public:
+    TrafficGenerator();
+
+    bool init(const TrafficConfig& config);
+
+    // 生成下一帧，返回帧数据（在下一次调用前有效），长度写入length
+    const uint8_t* next(size_t& length, struct timeval& ts);
+
+    // 上一个包被分片，下一次next()返回它的第二片
+    bool has_pending() const { return pending_length_ > 0; }
+
+    const TrafficCounters& counters() const { return counters_; }
+
+    static const size_t MAX_FRAME_SIZE = 1600;
+
+private:
+    struct Flow {
+        uint32_t src_addr;
+        uint32_t dst_addr;
+        uint16_t src_port;
+        uint16_t dst_port;
+        uint8_t template_index;   // 0: TCP, 1: UDP, 2: ICMP
+        bool tcp_ipv6;            // TCP流整条连接使用同一IP版本（UDP/ICMP逐包抽取）
+        bool tcp_open;            // 已发出SYN，之后的段为ACK（有载荷时加PSH）
+        uint32_t tcp_seq;         // 下一个段的序列号（初始为ISN，SYN占用一个序号）
+        uint32_t tcp_ack;         // 确认号（对端ISN + 1）
+    };
+
+    uint64_t random();
+    uint32_t random_below(uint32_t bound) { return static_cast<uint32_t>(random() % bound); }
+    bool chance(unsigned percent) { return random_below(100) < percent; }
+    size_t pick_flow();
+    void advance_time();
+    size_t build_segment(Flow& flow);
+    size_t begin_frame(uint8_t* frame, bool vlan, uint16_t vlan_id, uint16_t ethertype);
+    size_t write_ipv4(uint8_t* packet, const Flow& flow, uint8_t protocol, uint16_t flags_fragment,
+                      size_t options_length, const uint8_t* payload, size_t payload_length, bool bad_checksum);
+    size_t write_ipv6(uint8_t* packet, const Flow& flow, uint8_t protocol,
+                      const uint8_t* payload, size_t payload_length);
+
+    TrafficConfig config_;
+    uint64_t state_;                          // xorshift64*状态
+    std::vector<Flow> flows_;
+    std::vector<double> zipf_cdf_;            // 按排名的累积概率，空表示均匀
+    std::vector<std::vector<uint8_t> > templates_;   // 传输层首部模板
+    std::vector<uint8_t> templates_protocol_;
+    uint8_t segment_[MAX_FRAME_SIZE];         // 当前包的传输层数据
+    uint8_t frame_[MAX_FRAME_SIZE + 64];
+    uint8_t pending_[MAX_FRAME_SIZE + 64];    // 待返回的第二个分片
+    size_t pending_length_;
+    uint64_t sequence_;                       // 已生成的包数（用作IP标识）
+    struct timeval ts_;
+    uint64_t step_ns_;                        // 相邻包的时间间隔
+    uint64_t time_ns_;                        // 当前秒内的纳秒数
+    TrafficCounters counters_;
+};
+
+#endif // TRAFFIC_GEN_H